@@ -12,14 +12,17 @@
 #include <range/v3/view/slice.hpp>
 #include <clipp.h>
 
+#include <chrono>
 #include <numeric>
 #include <iostream>
+#include <sstream>
 
 using namespace blocksci;
 
 int64_t countBlocks(BlockRange &chain);
 int64_t calculateMaxOutputSingleThreaded(BlockRange &chain);
 int64_t calculateMaxOutputMultithreaded(BlockRange &chain);
+int64_t calculateMaxOutputColumnar(BlockRange &chain);
 int64_t calculateMaxInputSingleThreaded(BlockRange &chain);
 int64_t calculateMaxInputMultithreaded(BlockRange &chain);
 int64_t calculateMaxFeeSingleThreaded(BlockRange &chain);
@@ -30,8 +33,20 @@ uint32_t calculateVersionGreaterOneSingleThreaded(BlockRange &chain);
 uint32_t calculateVersionGreaterOneMultithreaded(BlockRange &chain);
 uint32_t calculateUniqueLocktimeChangeSingleThreaded(BlockRange &chain);
 uint32_t calculateUniqueLocktimeChangeMultithreaded(BlockRange &chain);
+uint32_t calculateKHopTraversalSingleThreaded(BlockRange &chain);
+uint32_t calculateKHopTraversal(BlockRange &chain);
 uint32_t calculateZeroConfOutputSingleThreaded(BlockRange &chain);
 uint32_t calculateZeroConfOutputMultithreaded(BlockRange &chain);
+uint32_t calculateNonzeroLocktimeScannerSingleThreaded(BlockRange &chain);
+uint32_t calculateNonzeroLocktimeScanner(BlockRange &chain);
+int64_t calculateMaxOutputScanner(BlockRange &chain);
+int64_t calculateMaxInputScanner(BlockRange &chain);
+int64_t calculateMaxFeeScanner(BlockRange &chain);
+uint32_t calculateVersionGreaterOneScanner(BlockRange &chain);
+int64_t calculateTotalOutputValueKernels(BlockRange &chain);
+int64_t calculateTotalFeeKernels(BlockRange &chain);
+int64_t calculateMaxOutputKernels(BlockRange &chain);
+int64_t calculatePubkeyHashOutputsKernels(BlockRange &chain);
 
 int64_t calculateSatoshiDiceTotalOutputValue(BlockRange &chain, uint32_t addressNum, AddressType::Enum type);
 
@@ -41,19 +56,27 @@ int64_t calculateMaxFeeRandom(Blockchain &chain, const std::vector<uint32_t> &in
 template <typename Func, typename... Args>
 auto timeFunc(std::string name, Func func, uint32_t iterations, Args&& ...args) -> decltype(func(args...));
 
+void printNumaReport(BlockRange &chain);
+
 int main(int argc, char * argv[]) {
     bool includeRandom = false;
     bool includeTraversal = false;
     std::string configLocation;
     int endBlock = 0;
     uint32_t iterations = 1;
+    unsigned int threadCount = 0;
+    bool disableNuma = false;
+    bool numaReport = false;
 
     auto cli = (
         clipp::value("config file location", configLocation),
         clipp::option("-r", "--with-random").set(includeRandom).doc("Include random order benchmarks"),
         clipp::option("-t", "--with-traversal").set(includeTraversal).doc("Include graph traversal benchmarks"),
         clipp::option("-m", "--max-block") & clipp::value("Run benchmark up to the given block", endBlock),
-        clipp::option("-i", "--iterations") & clipp::value("Number of iterations for each benchmark", iterations)
+        clipp::option("-i", "--iterations") & clipp::value("Number of iterations for each benchmark", iterations),
+        clipp::option("-j", "--threads") & clipp::value("Number of threads of the multithreaded benchmarks (default: one per CPU)", threadCount),
+        clipp::option("--no-numa").set(disableNuma).doc("Do not pin threads to NUMA nodes or assign chain segments to nodes"),
+        clipp::option("-n", "--numa-report").set(numaReport).doc("Report the share of chain pages and tasks that are accessed across NUMA nodes")
     );
     auto res = parse(argc, argv, cli);
     if (res.any_error()) {
@@ -61,42 +84,89 @@ int main(int argc, char * argv[]) {
         return 0;
     }
 
+    TaskPool::setSharedThreadCount(threadCount, !disableNuma);
     Blockchain chain(configLocation, endBlock);
     
     std::cout << "Heating up cache." << std::endl;
 
-    timeFunc("loadingTxData", calculateMaxFeeMultithreaded, 1, chain);
-    timeFunc("loadingVersionNo", calculateVersionGreaterOneSingleThreaded, 1, chain);
+    auto warmupStart = std::chrono::steady_clock::now();
+    auto warmedFiles = chain.warmup();
+    uint64_t warmedBytes = 0;
+    double residentBytes = 0;
+    for (auto &file : warmedFiles) {
+        warmedBytes += file.size;
+        residentBytes += file.residentFraction * static_cast<double>(file.size);
+    }
+    std::chrono::duration<double> warmupTime = std::chrono::steady_clock::now() - warmupStart;
+    std::cout << "Read " << warmedFiles.size() << " files (" << warmedBytes / (1024 * 1024) << " MiB) in " << warmupTime.count() << " seconds, "
+    << (warmedBytes > 0 ? residentBytes / static_cast<double>(warmedBytes) * 100 : 100.0) << "% resident" << std::endl;
 
     auto totalBlocks = timeFunc("countBlocks", countBlocks, 1, chain);
     std::cout << "Running benchmark over " << totalBlocks << " blocks." << std::endl;
 
     std::cout << std::endl << "Benchmarks:" << std::endl;
+    TaskPool::shared().resetNodeStats();
 
     // Sequential transaction graph iteration
     auto locktime1 = timeFunc("nonzeroLocktimeSingleThreaded", calculateNonzeroLocktimeSingleThreaded, iterations, chain);
     auto locktime2 = timeFunc("nonzeroLocktimeMultithreaded", calculateNonzeroLocktimeMultithreaded, iterations, chain);
+    auto locktime3 = timeFunc("nonzeroLocktimeScannerSingleThreaded", calculateNonzeroLocktimeScannerSingleThreaded, iterations, chain);
+    auto locktime4 = timeFunc("nonzeroLocktimeScanner", calculateNonzeroLocktimeScanner, iterations, chain);
     auto maxOutput1 = timeFunc("maxOutputSingleThreaded", calculateMaxOutputSingleThreaded, iterations, chain);
     auto maxOutput2 = timeFunc("maxOutputMultithreaded", calculateMaxOutputMultithreaded, iterations, chain);
+    auto maxOutput4 = timeFunc("maxOutputScanner", calculateMaxOutputScanner, iterations, chain);
+    int64_t maxOutput3 = -1;
+    bool hasColumns = static_cast<bool>(chain[0].outputColumns());
+    if (hasColumns) {
+        maxOutput3 = timeFunc("maxOutputColumnar", calculateMaxOutputColumnar, iterations, chain);
+    }
     auto maxInput1 = timeFunc("maxInputSingleThreaded", calculateMaxInputSingleThreaded, iterations, chain);
     auto maxInput2 = timeFunc("maxInputMultithreaded", calculateMaxInputMultithreaded, iterations, chain);
+    auto maxInput3 = timeFunc("maxInputScanner", calculateMaxInputScanner, iterations, chain);
     auto maxFee1 = timeFunc("maxFeeSingleThreaded", calculateMaxFeeSingleThreaded, iterations, chain);
     auto maxFee2 = timeFunc("maxFeeMultithreaded", calculateMaxFeeMultithreaded, iterations, chain);
+    auto maxFee3 = timeFunc("maxFeeScanner", calculateMaxFeeScanner, iterations, chain);
 
     auto version1 = timeFunc("versionGreaterOneSingleThreaded", calculateVersionGreaterOneSingleThreaded, iterations, chain);
     auto version2 = timeFunc("versionGreaterOneMultithreaded", calculateVersionGreaterOneMultithreaded, iterations, chain);
+    auto version3 = timeFunc("versionGreaterOneScanner", calculateVersionGreaterOneScanner, iterations, chain);
+
+    // Inout kernels, once for every instruction set the CPU supports
+    std::vector<std::string> kernelResults;
+    for (auto isa : {SimdIsa::Scalar, SimdIsa::AVX2, SimdIsa::AVX512}) {
+        if (isa > detectedSimdIsa()) {
+            break;
+        }
+        setActiveSimdIsa(isa);
+        std::string isaName = simdIsaName(isa);
+        std::stringstream results;
+        results << "Kernels " << isaName << " = (";
+        results << timeFunc("totalOutputValueKernels " + isaName, calculateTotalOutputValueKernels, iterations, chain) << ", ";
+        results << timeFunc("totalFeeKernels " + isaName, calculateTotalFeeKernels, iterations, chain);
+        if (hasColumns) {
+            results << ", " << timeFunc("maxOutputKernels " + isaName, calculateMaxOutputKernels, iterations, chain);
+            results << ", " << timeFunc("pubkeyHashOutputsKernels " + isaName, calculatePubkeyHashOutputsKernels, iterations, chain);
+        }
+        results << ")";
+        kernelResults.push_back(results.str());
+    }
+    setActiveSimdIsa(detectedSimdIsa());
 
     // Graph traversal queries
     uint32_t uniqueLocktimeSingle = 0;
     uint32_t uniqueLocktimeMulti = 0;
     uint32_t zeroconfSingle = 0;
     uint32_t zeroconfMulti = 0;
+    uint32_t kHopSingle = 0;
+    uint32_t kHopMulti = 0;
 
     if(includeTraversal) {
         uniqueLocktimeSingle = timeFunc("uniqueLocktimeChangeSingleThreaded", calculateUniqueLocktimeChangeSingleThreaded, iterations, chain);
         uniqueLocktimeMulti = timeFunc("uniqueLocktimeChangeMultithreaded", calculateUniqueLocktimeChangeMultithreaded, iterations, chain);
         zeroconfSingle = timeFunc("zeroConfOutputSingleThreaded", calculateZeroConfOutputSingleThreaded, iterations, chain);
         zeroconfMulti = timeFunc("zeroConfOutputMultithreaded", calculateZeroConfOutputMultithreaded, iterations, chain);
+        kHopSingle = timeFunc("kHopTraversalSingleThreaded", calculateKHopTraversalSingleThreaded, iterations, chain);
+        kHopMulti = timeFunc("kHopTraversal", calculateKHopTraversal, iterations, chain);
     }
 
     int64_t maxSatoshiDiceOutput = -1;
@@ -117,17 +187,28 @@ int main(int argc, char * argv[]) {
 
     // Print results
     std::cout << std::endl << "Results:" << std::endl;;
-    std::cout << "Nonzero Locktime = (" << locktime1 << ", " << locktime2 << ")" << std::endl;
-    std::cout << "Max Output = (" << maxOutput1 << ", " << maxOutput2 << ")" << std::endl;
-    std::cout << "Max Input = (" << maxInput1 << ", " << maxInput2 << ")" << std::endl;
-    std::cout << "Max Fee = (" << maxFee1 << ", " << maxFee2 << ")" << std::endl;
-    std::cout << "Version > 1 = (" << version1 << ", " << version2 << ")" << std::endl;
+    std::cout << "Nonzero Locktime = (" << locktime1 << ", " << locktime2 << ", " << locktime3 << ", " << locktime4 << ")" << std::endl;
+    std::cout << "Max Output = (" << maxOutput1 << ", " << maxOutput2;
+    if (hasColumns) {
+        std::cout << ", " << maxOutput3;
+    }
+    std::cout << ", " << maxOutput4 << ")" << std::endl;
+    std::cout << "Max Input = (" << maxInput1 << ", " << maxInput2 << ", " << maxInput3 << ")" << std::endl;
+    std::cout << "Max Fee = (" << maxFee1 << ", " << maxFee2 << ", " << maxFee3 << ")" << std::endl;
+    std::cout << "Version > 1 = (" << version1 << ", " << version2 << ", " << version3 << ")" << std::endl;
+    for (auto &results : kernelResults) {
+        std::cout << results << std::endl;
+    }
     if(maxSatoshiDiceOutput >= 0) {
         std::cout << "SatoshiDice Output Value = (" << maxSatoshiDiceOutput << ")" << std::endl;
     }
     if(includeTraversal) {
         std::cout << "Zeroconf Outputs = (" << zeroconfSingle << ", " << zeroconfMulti << ")" << std::endl;
         std::cout << "Unique Change = (" << uniqueLocktimeSingle << ", " << uniqueLocktimeMulti << ")" << std::endl;
+        std::cout << "K-Hop Reachable = (" << kHopSingle << ", " << kHopMulti << ")" << std::endl;
+    }
+    if (numaReport) {
+        printNumaReport(chain);
     }
     return 0;
 }
@@ -166,6 +247,23 @@ int64_t calculateMaxOutputMultithreaded(BlockRange &chain) {
     return chain.mapReduce<int64_t>(extract, combine);
 }
 
+int64_t calculateMaxOutputColumnar(BlockRange &chain) {
+    auto extract = [](const BlockRange &segment) {
+        int64_t maxValue = 0;
+        for (auto block : segment) {
+            auto columns = block.outputColumns();
+            for (uint64_t i = 0; i < columns->size(); i++) {
+                maxValue = std::max(columns->getValue(i), maxValue);
+            }
+        }
+        return maxValue;
+    };
+    
+    auto combine = [](int64_t &a, int64_t &b) -> int64_t & { a = std::max(a,b); return a; };
+    
+    return chain.mapReduce<int64_t>(extract, combine);
+}
+
 int64_t calculateMaxInputSingleThreaded(BlockRange &chain) {
     int64_t curMax = 0;
     for (auto block : chain) {
@@ -355,8 +453,204 @@ uint32_t calculateUniqueLocktimeChangeMultithreaded(BlockRange &chain) {
 
     return chain.mapReduce<uint32_t>(extract, combine);
 }
+// Forward traversals start from the transactions of the block in the middle of the range
+constexpr uint32_t traversalHops = 6;
+
+uint32_t calculateKHopTraversalSingleThreaded(BlockRange &chain) {
+    auto seedBlock = chain[chain.size() / 2];
+    std::vector<bool> visited(chain.endTxIndex());
+    std::vector<uint32_t> frontier;
+    for (auto txNum = seedBlock.firstTxIndex(); txNum < seedBlock.endTxIndex(); txNum++) {
+        visited[txNum] = true;
+        frontier.push_back(txNum);
+    }
+    uint32_t count = static_cast<uint32_t>(frontier.size());
+    for (uint32_t depth = 0; depth < traversalHops && !frontier.empty(); depth++) {
+        std::vector<uint32_t> next;
+        for (auto txNum : frontier) {
+            for (auto output : Transaction(txNum, chain.getAccess()).outputs()) {
+                auto spendingTxNum = output.getSpendingTxIndex();
+                if (spendingTxNum && *spendingTxNum < visited.size() && !visited[*spendingTxNum]) {
+                    visited[*spendingTxNum] = true;
+                    next.push_back(*spendingTxNum);
+                }
+            }
+        }
+        count += static_cast<uint32_t>(next.size());
+        frontier = std::move(next);
+    }
+    return count;
+}
 
+uint32_t calculateKHopTraversal(BlockRange &chain) {
+    auto seedBlock = chain[chain.size() / 2];
+    std::vector<uint32_t> seeds(seedBlock.size());
+    std::iota(seeds.begin(), seeds.end(), seedBlock.firstTxIndex());
+    TraversalOptions options;
+    options.maxDepth = traversalHops;
+    // The single threaded version stops at the end of the range, so the results stay comparable
+    auto endTx = chain.endTxIndex();
+    options.edgeFilter = [endTx](const TxEdge &edge) { return edge.toTx < endTx; };
+    return static_cast<uint32_t>(traverseTxGraph(seeds, options, chain.getAccess()).txNums.size());
+}
+
+uint32_t calculateNonzeroLocktimeScannerSingleThreaded(BlockRange &chain) {
+    uint32_t count = 0;
+    for (ChainScanner scanner(chain); scanner.next();) {
+        count += scanner.tx().locktime() > 0;
+    }
+    return count;
+}
+
+uint32_t calculateNonzeroLocktimeScanner(BlockRange &chain) {
+    auto extract = [](const BlockRange &segment) {
+        uint32_t count = 0;
+        for (ChainScanner scanner(segment); scanner.next();) {
+            count += scanner.tx().locktime() > 0;
+        }
+        return count;
+    };
+
+    auto combine = [](uint32_t &a, uint32_t &b) -> uint32_t & { a += b; return a; };
+
+    return chain.mapReduce<uint32_t>(extract, combine);
+}
+
+int64_t calculateMaxOutputScanner(BlockRange &chain) {
+    auto extract = [](const BlockRange &segment) {
+        int64_t maxValue = 0;
+        for (ChainScanner scanner(segment); scanner.next();) {
+            for (auto &output : scanner.tx().outputs()) {
+                maxValue = std::max(output.getValue(), maxValue);
+            }
+        }
+        return maxValue;
+    };
+
+    auto combine = [](int64_t &a, int64_t &b) -> int64_t & { a = std::max(a,b); return a; };
+
+    return chain.mapReduce<int64_t>(extract, combine);
+}
+
+int64_t calculateMaxInputScanner(BlockRange &chain) {
+    auto extract = [](const BlockRange &segment) {
+        int64_t maxValue = 0;
+        for (ChainScanner scanner(segment); scanner.next();) {
+            for (auto &input : scanner.tx().inputs()) {
+                maxValue = std::max(input.getValue(), maxValue);
+            }
+        }
+        return maxValue;
+    };
 
+    auto combine = [](int64_t &a, int64_t &b) -> int64_t & { a = std::max(a,b); return a; };
+
+    return chain.mapReduce<int64_t>(extract, combine);
+}
+
+int64_t calculateMaxFeeScanner(BlockRange &chain) {
+    auto extract = [](const BlockRange &segment) {
+        int64_t maxValue = 0;
+        for (ChainScanner scanner(segment); scanner.next();) {
+            auto &tx = scanner.tx();
+            if (tx.isCoinbase()) {
+                continue;
+            }
+            int64_t fee = 0;
+            for (auto &input : tx.inputs()) {
+                fee += input.getValue();
+            }
+            for (auto &output : tx.outputs()) {
+                fee -= output.getValue();
+            }
+            maxValue = std::max(fee, maxValue);
+        }
+        return maxValue;
+    };
+
+    auto combine = [](int64_t &a, int64_t &b) -> int64_t & { a = std::max(a,b); return a; };
+
+    return chain.mapReduce<int64_t>(extract, combine);
+}
+
+uint32_t calculateVersionGreaterOneScanner(BlockRange &chain) {
+    auto extract = [](const BlockRange &segment) {
+        uint32_t count = 0;
+        for (ChainScanner scanner(segment, ScanColumn::Version); scanner.next();) {
+            count += *scanner.tx().version > 1;
+        }
+        return count;
+    };
+
+    auto combine = [](uint32_t &a, uint32_t &b) -> uint32_t & { a += b; return a; };
+
+    return chain.mapReduce<uint32_t>(extract, combine);
+}
+
+int64_t calculateTotalOutputValueKernels(BlockRange &chain) {
+    auto extract = [](const BlockRange &segment) {
+        return totalOutputValue(segment);
+    };
+
+    auto combine = [](int64_t &a, int64_t &b) -> int64_t & { a += b; return a; };
+
+    return chain.mapReduce<int64_t>(extract, combine);
+}
+
+int64_t calculateTotalFeeKernels(BlockRange &chain) {
+    auto extract = [](const BlockRange &segment) {
+        return totalFee(segment);
+    };
+
+    auto combine = [](int64_t &a, int64_t &b) -> int64_t & { a += b; return a; };
+
+    return chain.mapReduce<int64_t>(extract, combine);
+}
+
+int64_t calculateMaxOutputKernels(BlockRange &chain) {
+    auto extract = [](const BlockRange &segment) {
+        int64_t maxValue = 0;
+        for (auto block : segment) {
+            maxValue = std::max(kernels::maxValue(*block.outputColumns()), maxValue);
+        }
+        return maxValue;
+    };
+
+    auto combine = [](int64_t &a, int64_t &b) -> int64_t & { a = std::max(a,b); return a; };
+
+    return chain.mapReduce<int64_t>(extract, combine);
+}
+
+int64_t calculatePubkeyHashOutputsKernels(BlockRange &chain) {
+    auto extract = [](const BlockRange &segment) {
+        TypeCounts counts{};
+        for (auto block : segment) {
+            kernels::countTypes(*block.outputColumns(), counts);
+        }
+        return static_cast<int64_t>(counts[AddressType::PUBKEYHASH]);
+    };
+
+    auto combine = [](int64_t &a, int64_t &b) -> int64_t & { a += b; return a; };
+
+    return chain.mapReduce<int64_t>(extract, combine);
+}
+
+void printNumaReport(BlockRange &chain) {
+    auto &pool = TaskPool::shared();
+    auto &topology = NumaTopology::system();
+    auto report = chain.numaAccessReport();
+    std::cout << std::endl << "NUMA:" << std::endl;
+    std::cout << pool.threadCount() << " threads on " << pool.nodeCount() << " of " << topology.nodeCount() << " nodes" << std::endl;
+    std::cout << "Remote tasks = " << report.remoteTaskRatio() * 100 << "% (" << report.remoteTasks << " of " << report.localTasks + report.remoteTasks << ")" << std::endl;
+    if (!report.pagePlacementKnown) {
+        std::cout << "Page placement is not reported by the kernel" << std::endl;
+        return;
+    }
+    std::cout << "Remote pages = " << report.remotePageRatio() * 100 << "% (" << report.remotePages << " of " << report.residentPages << " resident, " << report.pageCount << " total)" << std::endl;
+    for (size_t i = 0; i < topology.nodeCount(); i++) {
+        std::cout << "Node " << topology.nodes()[i].id << ": " << report.nodePages[i] << " pages" << std::endl;
+    }
+}
 
 template <typename Func, typename... Args>
 auto timeFunc(std::string name, Func func, uint32_t iterations, Args&& ...args) -> decltype(func(args...)) {
@@ -298,9 +298,10 @@ def new_init(self, loc, max_block=0):
         old_init(self, loc, max_block)
     self.block_times = None
     ec2_instance_path = "/home/ubuntu/BlockSci/IS_EC2"
-    tx_heated_path = "/home/ubuntu/BlockSci/TX_DATA_HEATED"
-    scripts_heated_path = "/home/ubuntu/BlockSci/SCRIPT_DATA_HEATED"
-    index_heated_path = "/home/ubuntu/BlockSci/INDEX_DATA_HEATED"
+    # util/warmup.sh creates the markers in the data directory once each stage has been read
+    tx_heated_path = os.path.join(self.data_location, "TX_DATA_HEATED")
+    scripts_heated_path = os.path.join(self.data_location, "SCRIPT_DATA_HEATED")
+    index_heated_path = os.path.join(self.data_location, "INDEX_DATA_HEATED")
 
     if os.path.exists(ec2_instance_path):
         if not os.path.exists(tx_heated_path):
@@ -319,7 +320,18 @@ def most_valuable_addresses(self, nlargest=100):
     )
     return heapq.nlargest(nlargest, current_address_vals.items(), key=operator.itemgetter(1))
 
+old_snapshot = Blockchain.snapshot
+
+
+def snapshot(self):
+    """Return a Blockchain pinned to the current generation of the data, which stays valid while this Blockchain is refreshed"""
+    pinned = old_snapshot(self)
+    pinned.block_times = None
+    return pinned
+
+
 Blockchain.__init__ = new_init
+Blockchain.snapshot = snapshot
 Blockchain.range = block_range
 Blockchain.heights_to_dates = heights_to_dates
 Blockchain.most_valuable_addresses = most_valuable_addresses
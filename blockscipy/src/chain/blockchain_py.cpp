@@ -15,6 +15,13 @@
 #include <blocksci/chain/access.hpp>
 #include <blocksci/scripts/script_range.hpp>
 #include <blocksci/cluster/cluster.hpp>
+#include <blocksci/chain/transaction.hpp>
+#include <blocksci/chain/tx_graph.hpp>
+
+#include <pybind11/numpy.h>
+
+#include <algorithm>
+#include <cstring>
 
 namespace py = pybind11;
 
@@ -34,6 +41,63 @@ namespace {
             })};
         }
     };
+
+    pybind11::array_t<int64_t> toIndexArray(const std::vector<ranges::optional<uint32_t>> &indexes) {
+        pybind11::array_t<int64_t> ret{indexes.size()};
+        auto data = ret.mutable_data();
+        for (size_t i = 0; i < indexes.size(); i++) {
+            data[i] = indexes[i] ? static_cast<int64_t>(*indexes[i]) : -1;
+        }
+        return ret;
+    }
+
+    template <typename Hash>
+    std::vector<Hash> hashesFromRows(const pybind11::array_t<uint8_t, pybind11::array::c_style | pybind11::array::forcecast> &rows) {
+        auto count = static_cast<size_t>(rows.shape(0));
+        std::vector<Hash> hashes(count);
+        auto data = rows.data();
+        for (size_t i = 0; i < count; i++) {
+            std::memcpy(hashes[i].begin(), data + i * Hash::WIDTH, Hash::WIDTH);
+        }
+        return hashes;
+    }
+
+    TraversalDirection traversalDirectionFromString(const std::string &direction) {
+        if (direction == "forward") {
+            return TraversalDirection::Forward;
+        } else if (direction == "backward") {
+            return TraversalDirection::Backward;
+        } else if (direction == "both") {
+            return TraversalDirection::Both;
+        }
+        throw std::invalid_argument("direction must be 'forward', 'backward' or 'both'");
+    }
+
+    pybind11::dict traversalResultToDict(const TraversalResult &result, bool collectEdges) {
+        pybind11::array_t<uint32_t> txIndexes{result.txNums.size()};
+        pybind11::array_t<uint32_t> depths{result.txNums.size()};
+        std::copy(result.txNums.begin(), result.txNums.end(), txIndexes.mutable_data());
+        auto depthData = depths.mutable_data();
+        for (uint32_t depth = 0; depth < result.depthCount(); depth++) {
+            std::fill(depthData + result.depthOffsets[depth], depthData + result.depthOffsets[depth + 1], depth);
+        }
+        pybind11::dict ret;
+        ret["tx_indexes"] = txIndexes;
+        ret["depths"] = depths;
+        ret["truncated"] = result.truncated;
+        if (collectEdges) {
+            pybind11::array_t<int64_t> edges(std::vector<pybind11::ssize_t>{static_cast<pybind11::ssize_t>(result.edges.size()), 4});
+            auto edgeData = edges.mutable_data();
+            for (auto &edge : result.edges) {
+                *edgeData++ = edge.fromTx;
+                *edgeData++ = edge.toTx;
+                *edgeData++ = edge.inoutNum;
+                *edgeData++ = edge.direction == TraversalDirection::Forward ? 1 : -1;
+            }
+            ret["edges"] = edges;
+        }
+        return ret;
+    }
 }
 
 void init_blockchain(py::class_<Blockchain> &cl) {
@@ -71,6 +135,28 @@ void init_blockchain(py::class_<Blockchain> &cl) {
     .def_property_readonly("data_location", &Blockchain::dataLocation, "Returns the location of the data directory that this Blockchain object represents.")
     .def_property_readonly("config_location", &Blockchain::configLocation, "Returns the location of the configuration file that this Blockchain object represents.")
     .def("reload", &Blockchain::reload, "Reload the blockchain to make new blocks visible (Invalidates current BlockSci objects).")
+    .def("snapshot", &Blockchain::snapshot, "Return a Blockchain pinned to the current generation of the data. The snapshot and the objects loaded from it stay valid while this Blockchain is refreshed.")
+    // The next generation is loaded without the GIL, but published while holding it, so that no other Python thread
+    // is querying this Blockchain while its block range is updated
+    .def("refresh", [](Blockchain &chain) {
+        std::shared_ptr<DataAccess> next;
+        {
+            pybind11::gil_scoped_release release;
+            next = chain.loadNextGeneration();
+        }
+        chain.publishGeneration(next);
+        return next != nullptr;
+    }, "Load a new generation of the data if the parser has added blocks and publish it atomically. Returns whether a new generation was published. Objects not loaded from a snapshot stay valid for five minutes after a new generation has been published.")
+    .def("wait_for_update", [](Blockchain &chain, double timeoutSeconds) {
+        std::shared_ptr<DataAccess> next;
+        {
+            pybind11::gil_scoped_release release;
+            next = chain.waitForNextGeneration(std::chrono::milliseconds(static_cast<int64_t>(timeoutSeconds * 1000)));
+        }
+        chain.publishGeneration(next);
+        return next != nullptr;
+    }, "Wait until the parser has finished updating the data directory or the timeout (in seconds) expires, then refresh. Returns whether a new generation was published.", pybind11::arg("timeout"))
+    .def_property_readonly("generation", &Blockchain::generation, "Number of generations of the data that have been published before the current one.")
     .def("is_parser_running", &Blockchain::isParserRunning, "Returns whether the parser is currently operating on this chain's data directory.")
     .def("addresses", [](Blockchain &chain, AddressType::Enum type) {
         static constexpr auto table = make_dynamic_table<AddressType, PythonScriptRangeFunctor>();
@@ -92,7 +178,7 @@ void init_blockchain(py::class_<Blockchain> &cl) {
     }, "This functions gets the transaction with given index.", pybind11::arg("index"))
     .def("tx_with_hash", [](Blockchain &chain, const std::string &hash) {
         return Transaction{hash, chain.getAccess()};
-    },"This functions gets the transaction with given hash.", pybind11::arg("tx_hash"))
+    },"This functions gets the transaction with given hash. The hash may be abbreviated to any prefix that is unique in the chain.", pybind11::arg("tx_hash"))
     .def("address_from_index", [](Blockchain &chain, uint32_t index, AddressType::Enum type) {
         return Address{index, type, chain.getAccess()};
     }, "Construct an address object from an address num and type", pybind11::arg("index"), pybind11::arg("type"))
@@ -104,6 +190,61 @@ void init_blockchain(py::class_<Blockchain> &cl) {
             return ranges::nullopt;
         }
     }, "Construct an address object from an address string", pybind11::arg("address_string"))
+    .def("all_addresses_from_string", [](Blockchain &chain, const std::string &addressString) {
+        pybind11::list pyAddresses;
+        for (auto &address : getAllAddressesFromString(addressString, chain.getAccess())) {
+            pyAddresses.append(address.getScript().wrapped);
+        }
+        return pyAddresses;
+    }, "Construct the address objects of all scripts with the identifier of an address string. A taproot address has one script per output it received.", pybind11::arg("address_string"))
+    .def("tx_indexes", [](Blockchain &chain, const std::vector<std::string> &txHashes, unsigned int threads) {
+        std::vector<ranges::optional<uint32_t>> indexes;
+        {
+            pybind11::gil_scoped_release release;
+            indexes = getTxIndexes(txHashes, chain.getAccess(), threads);
+        }
+        return toIndexArray(indexes);
+    }, "Look up the indexes of many transaction hashes at once using batched index lookups. Returns a numpy array with -1 for hashes that are not in the chain.", pybind11::arg("tx_hashes"), pybind11::arg("threads") = 1)
+    .def("tx_indexes", [](Blockchain &chain, pybind11::array_t<uint8_t, pybind11::array::c_style | pybind11::array::forcecast> txHashes, unsigned int threads) {
+        if (txHashes.ndim() != 2 || txHashes.shape(1) != 32) {
+            throw std::invalid_argument("tx_hashes must be an array of shape (n, 32)");
+        }
+        auto hashes = hashesFromRows<uint256>(txHashes);
+        std::vector<ranges::optional<uint32_t>> indexes;
+        {
+            pybind11::gil_scoped_release release;
+            indexes = getTxIndexes(hashes, chain.getAccess(), threads);
+        }
+        return toIndexArray(indexes);
+    }, "Look up the indexes of many transactions from the raw bytes of their hashes, one hash per row in internal byte order (the reverse of the hex string), without parsing hex strings. Returns a numpy array with -1 for hashes that are not in the chain.", pybind11::arg("tx_hashes"), pybind11::arg("threads") = 1)
+    .def("tx_indexes_with_prefix", [](Blockchain &chain, const std::string &prefix, size_t limit) {
+        pybind11::gil_scoped_release release;
+        return getTxIndexesWithPrefix(prefix, chain.getAccess(), limit);
+    }, "Look up the indexes of the transactions whose hash begins with the given hex prefix, at most limit of them in ascending order.", pybind11::arg("prefix"), pybind11::arg("limit") = 100)
+    .def("lookup_addresses", [](Blockchain &chain, AddressType::Enum type, pybind11::array_t<uint8_t, pybind11::array::c_style | pybind11::array::forcecast> hashes, unsigned int threads) {
+        if (hashes.ndim() != 2 || (hashes.shape(1) != 20 && hashes.shape(1) != 32)) {
+            throw std::invalid_argument("hashes must be an array of shape (n, 20) or (n, 32)");
+        }
+        std::vector<ranges::optional<uint32_t>> indexes;
+        if (hashes.shape(1) == 20) {
+            auto keys = hashesFromRows<uint160>(hashes);
+            pybind11::gil_scoped_release release;
+            indexes = lookupAddresses(type, keys, chain.getAccess(), threads);
+        } else {
+            auto keys = hashesFromRows<uint256>(hashes);
+            pybind11::gil_scoped_release release;
+            indexes = lookupAddresses(type, keys, chain.getAccess(), threads);
+        }
+        return toIndexArray(indexes);
+    }, "Look up the address numbers of many addresses of the given type from the raw bytes of their hashes, one hash per row. Returns a numpy array with -1 for addresses that are not in the chain.", pybind11::arg("type"), pybind11::arg("hashes"), pybind11::arg("threads") = 1)
+    .def("addresses_from_strings", [](Blockchain &chain, const std::vector<std::string> &addressStrings, unsigned int threads) {
+        std::vector<ranges::optional<Address>> addresses;
+        {
+            pybind11::gil_scoped_release release;
+            addresses = getAddressesFromStrings(addressStrings, chain.getAccess(), threads);
+        }
+        return addresses;
+    }, "Construct address objects from many address strings at once using batched index lookups. Returns None for strings that are invalid or not in the chain.", pybind11::arg("address_strings"), pybind11::arg("threads") = 1)
     .def("addresses_with_prefix", [](Blockchain &chain, const std::string &addressPrefix) {
         pybind11::list pyAddresses;
         auto addresses = getAddressesWithPrefix(addressPrefix, chain.getAccess());
@@ -112,6 +253,81 @@ void init_blockchain(py::class_<Blockchain> &cl) {
         }
         return pyAddresses;
     }, "Find all addresses beginning with the given prefix", pybind11::arg("prefix"))
+    .def("update_address_prefix_index", [](Blockchain &chain, unsigned int threads) {
+        pybind11::gil_scoped_release release;
+        return updateAddressPrefixIndex(chain.getAccess(), threads);
+    }, "Build or extend the index that makes addresses_with_prefix fast. Returns the number of scripts that were added to it.", pybind11::arg("threads") = 1)
+    .def("traverse", [](Blockchain &chain, const std::vector<uint32_t> &txIndexes, uint32_t maxDepth, const std::string &direction, int64_t minValue, const std::vector<AddressType::Enum> &addressTypes, uint64_t maxVisited, const pybind11::object &edgeFilter, bool collectEdges) {
+        TraversalOptions options;
+        options.direction = traversalDirectionFromString(direction);
+        options.maxDepth = maxDepth;
+        options.maxVisited = maxVisited;
+        options.collectEdges = collectEdges;
+        uint32_t typeMask = 0;
+        for (auto type : addressTypes) {
+            typeMask |= uint32_t{1} << static_cast<uint32_t>(type);
+        }
+        if (minValue > 0 || typeMask != 0 || !edgeFilter.is_none()) {
+            // The value and type checks run without the GIL, the Python callable only sees the edges that pass them
+            options.edgeFilter = [&](const TxEdge &edge) {
+                if (edge.inout->getValue() < minValue) {
+                    return false;
+                }
+                if (typeMask != 0 && !(typeMask & (uint32_t{1} << static_cast<uint32_t>(edge.inout->getType())))) {
+                    return false;
+                }
+                if (edgeFilter.is_none()) {
+                    return true;
+                }
+                pybind11::gil_scoped_acquire acquire;
+                return edgeFilter(edge.fromTx, edge.toTx, edge.inout->getValue(), edge.inout->getType()).cast<bool>();
+            };
+        }
+        TraversalResult result;
+        {
+            pybind11::gil_scoped_release release;
+            result = traverseTxGraph(txIndexes, options, chain.getAccess());
+        }
+        return traversalResultToDict(result, collectEdges);
+    }, "Breadth-first search over the transaction spend graph from the transactions with the given indexes, expanding every hop in parallel. "
+    "direction is 'forward' (to the spending transactions), 'backward' (to the spent transactions) or 'both'. Only outputs worth at least min_value "
+    "and of one of address_types (all types if empty) are followed. edge_filter(from_index, to_index, value, address_type) can reject further "
+    "edges, it holds the GIL, so it serializes the traversal. Returns a dict with the visited 'tx_indexes' ordered by depth, their 'depths', "
+    "whether max_visited 'truncated' the search and, with collect_edges, the followed 'edges' as rows of "
+    "(from_index, to_index, inout_num, 1 for forward or -1 for backward).",
+    pybind11::arg("tx_indexes"), pybind11::arg("max_depth") = 1, pybind11::arg("direction") = "forward", pybind11::arg("min_value") = 0,
+    pybind11::arg("address_types") = std::vector<AddressType::Enum>{}, pybind11::arg("max_visited") = 0, pybind11::arg("edge_filter") = pybind11::none(),
+    pybind11::arg("collect_edges") = false)
+    .def("warmup", [](Blockchain &chain, bool includeChain, bool includeScripts, bool includeIndexes, std::vector<std::string> extraPaths, std::vector<std::string> lockedPaths, unsigned int threads) {
+        WarmupSpec spec;
+        spec.chain = includeChain;
+        spec.scripts = includeScripts;
+        spec.indexes = includeIndexes;
+        spec.extraPaths = std::move(extraPaths);
+        spec.lockedPaths = std::move(lockedPaths);
+        spec.threadCount = threads;
+        std::vector<WarmupFileResult> results;
+        {
+            pybind11::gil_scoped_release release;
+            results = chain.warmup(spec);
+        }
+        pybind11::list pyResults;
+        for (auto &result : results) {
+            pybind11::dict entry;
+            entry["path"] = result.path;
+            entry["size"] = result.size;
+            entry["bytes_read"] = result.bytesRead;
+            entry["error"] = result.error;
+            entry["seconds"] = result.seconds;
+            entry["throughput"] = result.throughput();
+            entry["resident_fraction"] = result.residentFraction;
+            entry["locked"] = result.locked;
+            pyResults.append(entry);
+        }
+        return pyResults;
+    }, "Read the data files into the page cache using parallel reads and return the throughput (MiB/s) and resident fraction of every file. Files that could not be read completely have a non-empty error. Files in locked_paths are locked in memory until the Blockchain object is destroyed.",
+    pybind11::arg("chain") = true, pybind11::arg("scripts") = true, pybind11::arg("indexes") = false,
+    pybind11::arg("extra_paths") = std::vector<std::string>{}, pybind11::arg("locked_paths") = std::vector<std::string>{}, pybind11::arg("threads") = 0)
     .def("_segment_indexes", [](Blockchain &chain, BlockHeight start, BlockHeight stop, unsigned int cpuCount) {
         auto segments = chain[{start, stop}].segment(cpuCount);
         std::vector<std::pair<BlockHeight, BlockHeight>> ret;
@@ -34,6 +34,7 @@
 #include "scripts/witness_unknown/witness_unknown_py.hpp"
 
 #include <blocksci/chain/blockchain.hpp>
+#include <blocksci/chain/task_pool.hpp>
 #include <blocksci/cluster/cluster.hpp>
 #include <blocksci/address/equiv_address.hpp>
 
@@ -270,4 +271,11 @@ PYBIND11_MODULE(_blocksci, m) {
 
     addCommonRangeMethods(genericRangeCl);
     addCommonIteratorMethods(genericIteratorCl);
+
+    m.def("set_thread_count", [](unsigned int threadCount, bool numaAware) {
+        TaskPool::setSharedThreadCount(threadCount, numaAware);
+    }, "Set the number of threads used by the parallel operations of BlockSci, such as clustering. 0 uses one thread per CPU core. With numa_aware, threads are pinned to NUMA nodes and every node processes its own part of the chain.", py::arg("thread_count"), py::arg("numa_aware") = false);
+    m.def("thread_count", []() {
+        return TaskPool::shared().threadCount();
+    }, "Return the number of threads used by the parallel operations of BlockSci");
 }
@@ -79,6 +79,10 @@ void init_address(py::class_<blocksci::ScriptBase> &cl) {
     .def_property_readonly("_access", [](const ScriptBase &script) {
         return Access{&script.getAccess()};
     })
+    .def("balance_series", [](const ScriptBase &script, const std::vector<BlockHeight> &heights) {
+        py::gil_scoped_release release;
+        return script.calculateBalanceSeries(heights);
+    }, "Calculates the balances held by this address at each of the heights (-1 for the full chain). Uses the balance history index when the parser has built it.", py::arg("heights"))
     ;
 }
 
@@ -0,0 +1,146 @@
+//
+//  taproot_index_benchmark.cpp
+//  blocksci
+//
+//  Compares taproot address lookups through the memory mapped taproot index with the RocksDB hash index and with a
+//  full scan over the WITNESS_UNKNOWN scripts, and checks that the index finds the same scripts as the scan.
+//
+//  Usage: taproot_index_benchmark <config path> [taproot address...]
+//  Without addresses, a sample of the taproot addresses in the chain is looked up.
+//
+
+#include <blocksci/blocksci.hpp>
+#include <blocksci/address/address.hpp>
+#include <blocksci/scripts/witness_unknown_script.hpp>
+
+#include <internal/data_access.hpp>
+#include <internal/hash_index.hpp>
+#include <internal/memory_view.hpp>
+#include <internal/script_access.hpp>
+#include <internal/taproot_index.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+using namespace blocksci;
+
+namespace {
+    constexpr size_t sampleSize = 1000;
+
+    double millisecondsSince(std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    uint256 outputKey(const WitnessUnknownScriptData &script) {
+        uint256 key;
+        std::copy_n(script.scriptData.begin(), 32, key.begin());
+        return key;
+    }
+
+    bool isTaproot(const WitnessUnknownScriptData &script) {
+        return script.witnessVersion == 1 && script.scriptData.size() == 32;
+    }
+}
+
+int main(int argc, const char * argv[]) {
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " <config path> [taproot address...]" << std::endl;
+        return 1;
+    }
+
+    Blockchain chain(argv[1]);
+    auto &access = chain.getAccess();
+    auto &scripts = access.getScripts();
+    auto scriptCount = scripts.scriptCount(DedupAddressType::WITNESS_UNKNOWN);
+
+    auto taprootIndex = access.getHashIndex().getTaprootIndex();
+    if (taprootIndex == nullptr) {
+        std::cerr << "No taproot index, run blocksci_parser update first" << std::endl;
+        return 1;
+    }
+    std::cout << "WITNESS_UNKNOWN scripts: " << scriptCount << ", indexed: " << taprootIndex->scriptCount() << ", taproot outputs in index: " << taprootIndex->entryCount() << std::endl;
+
+    std::vector<std::string> addressStrings(argv + 2, argv + argc);
+    if (addressStrings.empty()) {
+        auto step = std::max<uint32_t>(1, scriptCount / sampleSize);
+        for (uint32_t scriptNum = 1; scriptNum <= scriptCount && addressStrings.size() < sampleSize; scriptNum += step) {
+            if (isTaproot(*std::get<0>(scripts.getScriptData<DedupAddressType::WITNESS_UNKNOWN>(scriptNum)))) {
+                addressStrings.push_back(ScriptAddress<AddressType::WITNESS_UNKNOWN>(scriptNum, access).addressString());
+            }
+        }
+    }
+    std::vector<uint256> keys;
+    for (auto &addressString : addressStrings) {
+        auto address = getAddressFromString(addressString, access);
+        if (!address || address->type != AddressType::WITNESS_UNKNOWN) {
+            std::cerr << "Not a known taproot address: " << addressString << std::endl;
+            return 1;
+        }
+        keys.push_back(outputKey(*std::get<0>(scripts.getScriptData<DedupAddressType::WITNESS_UNKNOWN>(address->scriptNum))));
+    }
+    std::cout << "Looking up " << keys.size() << " taproot addresses" << std::endl;
+
+    // Full scan, all addresses are matched in a single pass over the scripts
+    auto start = std::chrono::steady_clock::now();
+    std::map<uint256, std::vector<uint32_t>> scanned;
+    for (auto &key : keys) {
+        scanned[key];
+    }
+    for (uint32_t scriptNum = 1; scriptNum <= scriptCount; scriptNum++) {
+        auto script = std::get<0>(scripts.getScriptData<DedupAddressType::WITNESS_UNKNOWN>(scriptNum));
+        if (isTaproot(*script)) {
+            auto it = scanned.find(outputKey(*script));
+            if (it != scanned.end()) {
+                it->second.push_back(scriptNum);
+            }
+        }
+    }
+    std::cout << "Full WITNESS_UNKNOWN scan:       " << millisecondsSince(start) << " ms" << std::endl;
+
+    start = std::chrono::steady_clock::now();
+    size_t mismatches = 0;
+    size_t scriptsFound = 0;
+    for (size_t i = 0; i < addressStrings.size(); i++) {
+        auto addresses = getAllAddressesFromString(addressStrings[i], access);
+        scriptsFound += addresses.size();
+        std::vector<uint32_t> scriptNums;
+        for (auto &address : addresses) {
+            scriptNums.push_back(address.scriptNum);
+        }
+        if (scriptNums != scanned[keys[i]]) {
+            mismatches++;
+        }
+    }
+    std::cout << "getAllAddressesFromString:       " << millisecondsSince(start) << " ms, " << scriptsFound << " scripts" << std::endl;
+
+    start = std::chrono::steady_clock::now();
+    for (auto &addressString : addressStrings) {
+        getAddressFromString(addressString, access);
+    }
+    std::cout << "getAddressFromString:            " << millisecondsSince(start) << " ms" << std::endl;
+
+    start = std::chrono::steady_clock::now();
+    getAddressesFromStrings(addressStrings, access);
+    std::cout << "getAddressesFromStrings:         " << millisecondsSince(start) << " ms" << std::endl;
+
+    // The same batch against the RocksDB column family alone
+    HashIndex rocksdbOnly{access.config.hashIndexFilePath(), true};
+    std::vector<MemoryView> views;
+    for (auto &key : keys) {
+        views.push_back(MemoryView{reinterpret_cast<const char *>(key.begin()), key.size()});
+    }
+    start = std::chrono::steady_clock::now();
+    rocksdbOnly.lookupAddresses(AddressType::WITNESS_UNKNOWN, views);
+    std::cout << "RocksDB hash index batch lookup: " << millisecondsSince(start) << " ms" << std::endl;
+
+    if (mismatches > 0) {
+        std::cerr << mismatches << " addresses resolved to different scripts than the full scan" << std::endl;
+        return 1;
+    }
+    std::cout << "All lookups match the full scan" << std::endl;
+    return 0;
+}
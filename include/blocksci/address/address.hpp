@@ -12,6 +12,7 @@
 #include <blocksci/blocksci_export.h>
 #include <blocksci/address/address_fwd.hpp>
 #include <blocksci/core/address_types.hpp>
+#include <blocksci/core/core_fwd.hpp>
 #include <blocksci/core/raw_address.hpp>
 #include <blocksci/core/typedefs.hpp>
 #include <blocksci/chain/chain_fwd.hpp>
@@ -21,6 +22,7 @@
 #include <range/v3/utility/optional.hpp>
 
 #include <functional>
+#include <string>
 #include <unordered_set>
 #include <vector>
 
@@ -99,8 +101,16 @@ namespace blocksci {
         EquivAddress getEquivAddresses(bool nestedEquivalent) const;
         
         ranges::any_view<OutputPointer> getOutputPointers() const;
+        /** Balance of the address after the block at the given height, -1 for the end of the chain
+         *
+         * Read from the balance history index when the parser has built it, otherwise calculated from the outputs.
+         */
         int64_t calculateBalance(BlockHeight height) const;
+        /** Balances of the address after the blocks at the given heights, -1 for the end of the chain */
+        std::vector<int64_t> calculateBalanceSeries(const std::vector<BlockHeight> &heights) const;
         ranges::any_view<Output> getOutputs() const;
+        /** Inputs spending outputs of this address, read from the address input index when the parser has built it */
+        ranges::any_view<InputPointer> getInputPointers() const;
         ranges::any_view<Input> getInputs() const;
         ranges::any_view<Transaction> getTransactions() const;
         ranges::any_view<Transaction> getOutputTransactions() const;
@@ -118,8 +128,40 @@ namespace blocksci {
     
     ranges::optional<Address> BLOCKSCI_EXPORT getAddressFromString(const std::string &addressString, DataAccess &access);
     
+    /** All addresses with the identifier of the address string
+     *
+     * Every output to a taproot address has its own WITNESS_UNKNOWN script, so a taproot address string resolves to
+     * one address per output, in the order they were first seen. Other address strings resolve to at most one address.
+     */
+    std::vector<Address> BLOCKSCI_EXPORT getAllAddressesFromString(const std::string &addressString, DataAccess &access);
+    
+    /** Batched version of getAddressFromString, resolves all strings of one address type with a single sorted lookup */
+    std::vector<ranges::optional<Address>> BLOCKSCI_EXPORT getAddressesFromStrings(const std::vector<std::string> &addressStrings, DataAccess &access, unsigned int threadCount = 1);
+    
+    /** Address numbers of many identifiers (pubkey hash, script hash etc.) of the given type, nullopt for unknown identifiers
+     *
+     * The identifiers must have the size the hash index uses for the type: 20 bytes for most types, 32 bytes for
+     * WITNESS_SCRIPTHASH and WITNESS_UNKNOWN.
+     */
+    std::vector<ranges::optional<uint32_t>> BLOCKSCI_EXPORT lookupAddresses(AddressType::Enum type, const std::vector<uint160> &hashes, DataAccess &access, unsigned int threadCount = 1);
+    std::vector<ranges::optional<uint32_t>> BLOCKSCI_EXPORT lookupAddresses(AddressType::Enum type, const std::vector<uint256> &hashes, DataAccess &access, unsigned int threadCount = 1);
+    
+    /** Output pointers of many addresses, which must belong to the same blockchain, in the order of the given addresses */
+    std::vector<std::vector<OutputPointer>> BLOCKSCI_EXPORT getOutputPointers(const std::vector<Address> &addresses, unsigned int threadCount = 1);
+    
+    /** All P2PKH, P2SH, P2WPKH, P2WSH and taproot addresses whose address string begins with prefix
+     *
+     * Uses the address prefix index if it has been built, @see updateAddressPrefixIndex, and scans the scripts that are
+     * not covered by it.
+     */
     std::vector<Address> BLOCKSCI_EXPORT getAddressesWithPrefix(const std::string &prefix, DataAccess &access);
     
+    /** Brings the address prefix index used by getAddressesWithPrefix up to date on threadCount threads
+     *
+     * @return the number of scripts that were added to the index
+     */
+    uint64_t BLOCKSCI_EXPORT updateAddressPrefixIndex(DataAccess &access, unsigned int threadCount = 1);
+    
     inline size_t hashAddress(uint32_t scriptNum, AddressType::Enum type) {
         return (static_cast<size_t>(scriptNum) << 32) + static_cast<size_t>(type);
     }
@@ -12,11 +12,16 @@
 #include <blocksci/chain/algorithms.hpp>
 #include <blocksci/chain/block.hpp>
 #include <blocksci/chain/blockchain.hpp>
+#include <blocksci/chain/chain_scanner.hpp>
+#include <blocksci/chain/inout_kernels.hpp>
 #include <blocksci/chain/input_pointer.hpp>
 #include <blocksci/chain/input.hpp>
+#include <blocksci/chain/numa.hpp>
 #include <blocksci/chain/output_pointer.hpp>
 #include <blocksci/chain/output.hpp>
+#include <blocksci/chain/task_pool.hpp>
 #include <blocksci/chain/transaction.hpp>
 #include <blocksci/chain/transaction_range.hpp>
+#include <blocksci/chain/tx_graph.hpp>
 
 #endif /* chain_h */
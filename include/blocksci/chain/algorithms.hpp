@@ -10,6 +10,7 @@
 
 #include <blocksci/blocksci_export.h>
 #include <blocksci/chain/chain_fwd.hpp>
+#include <blocksci/chain/inout_kernels.hpp>
 #include <blocksci/chain/output.hpp>
 #include <blocksci/chain/input.hpp>
 #include <blocksci/chain/output.hpp>
@@ -187,16 +188,56 @@ namespace blocksci {
         return ranges::accumulate(values, uint64_t{0});
     }
     
+    namespace internal {
+        using GenericAggregate = std::integral_constant<int, 0>;
+        using TxAggregate = std::integral_constant<int, 1>;
+        using TxIndexRangeAggregate = std::integral_constant<int, 2>;
+        
+        /** Transactions and ranges of consecutive transactions or blocks are aggregated with the Inout kernels straight
+         * from the chain data, everything else goes through Input and Output objects
+         */
+        template <typename T, typename D = std::decay_t<T>>
+        using AggregateTag = std::integral_constant<int, std::is_same<D, Transaction>::value ? TxAggregate::value : (std::is_base_of<TransactionRange, D>::value || std::is_base_of<BlockRange, D>::value ? TxIndexRangeAggregate::value : GenericAggregate::value)>;
+        
+        template <typename T>
+        inline int64_t totalInputValue(T && t, GenericAggregate) {
+            auto values = inputs(std::forward<T>(t)) | ranges::views::transform([](const Input &a) { return a.getValue(); });
+            return ranges::accumulate(values, int64_t{0});
+        }
+        
+        inline int64_t totalInputValue(const Transaction &tx, TxAggregate) {
+            return kernels::sumValues(tx.inputSpan());
+        }
+        
+        template <typename T>
+        inline int64_t totalInputValue(const T &t, TxIndexRangeAggregate) {
+            return t.size() == 0 ? 0 : kernels::totalInputValue(t.getAccess(), t.firstTxIndex(), t.endTxIndex());
+        }
+        
+        template <typename T>
+        inline int64_t totalOutputValue(T && t, GenericAggregate) {
+            auto values = outputs(std::forward<T>(t)) | ranges::views::transform([](const Output &a) { return a.getValue(); });
+            return ranges::accumulate(values, int64_t{0});
+        }
+        
+        inline int64_t totalOutputValue(const Transaction &tx, TxAggregate) {
+            return kernels::sumValues(tx.outputSpan());
+        }
+        
+        template <typename T>
+        inline int64_t totalOutputValue(const T &t, TxIndexRangeAggregate) {
+            return t.size() == 0 ? 0 : kernels::totalOutputValue(t.getAccess(), t.firstTxIndex(), t.endTxIndex());
+        }
+    } // namespace internal
+    
     template <typename T>
     inline int64_t BLOCKSCI_EXPORT totalInputValue(T && t) {
-        auto values = inputs(std::forward<T>(t)) | ranges::views::transform([](const Input &a) { return a.getValue(); });
-        return ranges::accumulate(values, int64_t{0});
+        return internal::totalInputValue(std::forward<T>(t), internal::AggregateTag<T>{});
     }
     
     template <typename T>
     inline int64_t BLOCKSCI_EXPORT totalOutputValue(T && t) {
-        auto values = outputs(std::forward<T>(t)) | ranges::views::transform([](const Output &a) { return a.getValue(); });
-        return ranges::accumulate(values, int64_t{0});
+        return internal::totalOutputValue(std::forward<T>(t), internal::AggregateTag<T>{});
     }
     
     inline int64_t BLOCKSCI_EXPORT fee(const Transaction &tx) {
@@ -253,9 +294,25 @@ namespace blocksci {
         return ranges::views::transform(txes(t), feePerByte);
     }
     
+    namespace internal {
+        template <typename T>
+        inline int64_t totalFee(T &t, GenericAggregate) {
+            return ranges::accumulate(fees(t), int64_t{0});
+        }
+        
+        inline int64_t totalFee(const Transaction &tx, TxAggregate) {
+            return tx.fee();
+        }
+        
+        template <typename T>
+        inline int64_t totalFee(const T &t, TxIndexRangeAggregate) {
+            return t.size() == 0 ? 0 : kernels::totalFee(t.getAccess(), t.firstTxIndex(), t.endTxIndex());
+        }
+    } // namespace internal
+    
     template <typename T>
     inline int64_t BLOCKSCI_EXPORT totalFee(T &t) {
-        return ranges::accumulate(fees(t), int64_t{0});
+        return internal::totalFee(t, internal::AggregateTag<T>{});
     }
 } // namespace blocksci
 
@@ -11,10 +11,13 @@
 
 #include <blocksci/blocksci_export.h>
 #include <blocksci/chain/block.hpp>
+#include <blocksci/chain/numa.hpp>
+#include <blocksci/chain/task_pool.hpp>
 
+#include <limits>
 #include <map>
 #include <type_traits>
-#include <future>
+#include <vector>
 
 namespace blocksci {
     struct DataConfiguration;
@@ -32,25 +35,53 @@ namespace blocksci {
             static constexpr bool value = decltype(test<F>(nullptr))::value;
         };
         
+        /** Wraps results so that bool results do not end up in a std::vector<bool>, whose elements share bytes */
+        template <typename ResultType>
+        struct ReduceSlot {
+            ResultType value{};
+        };
+        
+        /** Runs mapFunc on every segment as a task of the pool on the node it is assigned to, then folds the results of
+         * each node with reduceFunc in segment order on a thread of that node
+         *
+         * Segments must be assigned to nodes in ascending order, so that folding the node results in node order reduces
+         * the segments in order and the result does not depend on which thread ran which segment.
+         */
         template <typename ResultType, typename It, typename MapFunc, typename ReduceFunc>
-        ResultType BLOCKSCI_EXPORT mapReduceBlocksImp(It begin, It end, MapFunc mapFunc, ReduceFunc reduceFunc, int segmentBeginNum) {
-            auto segmentCount = static_cast<int>(std::distance(begin, end));
-            if(segmentCount == 1) {
-                ResultType res{};
-                auto ret = mapFunc(*begin, segmentBeginNum);
-                res = reduceFunc(res, ret);
-                return res;
-            } else {
-                auto mid = begin;
-                std::advance(mid, segmentCount / 2);
-                auto handle = std::async(std::launch::async, mapReduceBlocksImp<ResultType, It, MapFunc, ReduceFunc>, begin, mid, mapFunc, reduceFunc, segmentBeginNum);
-                ResultType res{};
-                auto ret2 = mapReduceBlocksImp<ResultType>(mid, end, mapFunc, reduceFunc, segmentBeginNum + segmentCount / 2);
-                auto ret1 = handle.get();
-                res = reduceFunc(res, ret1);
-                res = reduceFunc(res, ret2);
-                return res;
+        std::vector<ReduceSlot<ResultType>> BLOCKSCI_EXPORT mapReduceNodesImp(TaskPool &pool, It begin, It end, const std::vector<unsigned int> &segmentNodes, MapFunc &mapFunc, ReduceFunc &reduceFunc) {
+            auto segmentCount = static_cast<size_t>(std::distance(begin, end));
+            std::vector<ReduceSlot<ResultType>> results(segmentCount);
+            pool.parallelForOnNodes(segmentNodes, [&](size_t i) {
+                auto segment = begin;
+                std::advance(segment, i);
+                results[i].value = mapFunc(*segment, static_cast<int>(i));
+            });
+            
+            auto nodeCount = pool.nodeCount();
+            std::vector<unsigned int> nodes;
+            for (unsigned int node = 0; node < nodeCount; node++) {
+                nodes.push_back(node);
             }
+            std::vector<ReduceSlot<ResultType>> nodeResults(nodeCount);
+            pool.parallelForOnNodes(nodes, [&](size_t node) {
+                auto &res = nodeResults[node].value;
+                for (size_t i = 0; i < segmentCount; i++) {
+                    if (segmentNodes[i] % nodeCount == node) {
+                        res = reduceFunc(res, results[i].value);
+                    }
+                }
+            });
+            return nodeResults;
+        }
+        
+        template <typename ResultType, typename It, typename MapFunc, typename ReduceFunc>
+        ResultType BLOCKSCI_EXPORT mapReduceBlocksImp(TaskPool &pool, It begin, It end, const std::vector<unsigned int> &segmentNodes, MapFunc &mapFunc, ReduceFunc &reduceFunc) {
+            auto nodeResults = mapReduceNodesImp<ResultType>(pool, begin, end, segmentNodes, mapFunc, reduceFunc);
+            ResultType res{};
+            for (auto &result : nodeResults) {
+                res = reduceFunc(res, result.value);
+            }
+            return res;
         }
     }
 
@@ -67,12 +98,24 @@ namespace blocksci {
             using iterator_category = std::random_access_iterator_tag;
             
             iterator() = default;
-            iterator(BlockHeight height_, DataAccess *access_) : height(height_), access(access_) { }
+            
+            /** If readahead is set, the iterator keeps the transactions of upcoming blocks in the page cache as it advances, @see readAhead() */
+            iterator(BlockHeight height_, DataAccess *access_, bool readahead = false) : height(height_), access(access_) {
+                if (readahead) {
+                    readAhead();
+                }
+            }
             self_type &operator+=(difference_type i) { height += i; return *this; }
             self_type &operator-=(difference_type i) { height -= i; return *this; }
-            self_type &operator++() { ++height; return *this; }
+            self_type &operator++() {
+                ++height;
+                if (height >= readaheadHeight) {
+                    readAhead();
+                }
+                return *this;
+            }
             self_type &operator--() { --height; return *this; }
-            self_type operator++(int) { self_type tmp = *this; ++height; return tmp; }
+            self_type operator++(int) { self_type tmp = *this; this->operator++(); return tmp; }
             self_type operator--(int) { self_type tmp = *this; --height; return tmp; }
             self_type operator+(difference_type i) const { self_type tmp = *this; tmp.height += i; return tmp; }
             self_type operator-(difference_type i) const { self_type tmp = *this; tmp.height -= i; return tmp; }
@@ -91,6 +134,12 @@ namespace blocksci {
         private:
             BlockHeight height;
             DataAccess *access;
+            
+            /** Block height at which the next readahead window is requested */
+            BlockHeight readaheadHeight = std::numeric_limits<BlockHeight>::max();
+            
+            // Request the transactions of the blocks ahead of the current one to be read into memory and schedule the next request
+            void readAhead();
         };
         
         struct Slice {
@@ -102,7 +151,7 @@ namespace blocksci {
         BlockRange(const Slice &x, DataAccess *access_) : sl(x), access(access_) {}
         
         iterator begin() const {
-            return {sl.start, access};
+            return {sl.start, access, access != nullptr && sl.start < sl.stop};
         }
         
         iterator end() const {
@@ -131,15 +180,35 @@ namespace blocksci {
         template <typename ResultType, typename MapFunc, typename ReduceFunc>
         std::enable_if_t<internal::is_callable<MapFunc, BlockRange, int>::value, ResultType>
         mapReduce(MapFunc mapFunc, ReduceFunc reduceFunc) {
-            auto segments = segment(std::thread::hardware_concurrency());
-            return internal::mapReduceBlocksImp<ResultType>(segments.begin(), segments.end(), mapFunc, reduceFunc, 0);
+            auto &pool = TaskPool::shared();
+            auto segments = taskSegments(pool);
+            auto segmentNodes = taskSegmentNodes(segments, pool.nodeCount());
+            return internal::mapReduceBlocksImp<ResultType>(pool, segments.begin(), segments.end(), segmentNodes, mapFunc, reduceFunc);
         }
         
         template <typename ResultType, typename MapFunc, typename ReduceFunc>
         std::enable_if_t<internal::is_callable<MapFunc, BlockRange>::value, ResultType>
         mapReduce(MapFunc mapFunc, ReduceFunc reduceFunc) {
-            auto segments = segment(std::thread::hardware_concurrency());
-            return internal::mapReduceBlocksImp<ResultType>(segments.begin(), segments.end(), [&](const BlockRange &blocks, int) { return mapFunc(blocks); }, reduceFunc, 0);
+            return mapReduce<ResultType>([&](const BlockRange &blocks, int) { return mapFunc(blocks); }, reduceFunc);
+        }
+        
+        /** Like mapReduce, but returns the result of every NUMA node of the shared TaskPool in node order instead of
+         * combining them, each one reduced from the segments assigned to that node by a thread of the node
+         */
+        template <typename ResultType, typename MapFunc, typename ReduceFunc>
+        std::enable_if_t<internal::is_callable<MapFunc, BlockRange>::value, std::vector<ResultType>>
+        mapReducePerNode(MapFunc mapFunc, ReduceFunc reduceFunc) {
+            auto &pool = TaskPool::shared();
+            auto segments = taskSegments(pool);
+            auto segmentNodes = taskSegmentNodes(segments, pool.nodeCount());
+            auto segmentMapFunc = [&](const BlockRange &blocks, int) { return mapFunc(blocks); };
+            auto nodeResults = internal::mapReduceNodesImp<ResultType>(pool, segments.begin(), segments.end(), segmentNodes, segmentMapFunc, reduceFunc);
+            std::vector<ResultType> results;
+            results.reserve(nodeResults.size());
+            for (auto &result : nodeResults) {
+                results.push_back(std::move(result.value));
+            }
+            return results;
         }
         
         template <typename ResultType, typename MapFunc, typename ReduceFunc>
@@ -196,10 +265,20 @@ namespace blocksci {
 
         // Returns a vector of [start, stop) intervals splitting the chain into segments with approximately the same number of segments
         std::vector<BlockRange> segment(unsigned int segmentCount) const;
+
+        // Splits the range into the segments that mapReduce runs as separate tasks, TaskPool::tasksPerThread per thread of the pool
+        std::vector<BlockRange> taskSegments(const TaskPool &pool) const;
+        
+        // Assigns segments to nodes by their position in the whole chain, so a block is processed by the same node on every run
+        std::vector<unsigned int> taskSegmentNodes(const std::vector<BlockRange> &segments, unsigned int nodeCount) const;
+        
+        // Measures how much of the transaction data that mapReduce reads from this range is resident on another NUMA node
+        // than the one its segment is assigned to, together with the task counts of the shared TaskPool
+        NumaAccessReport numaAccessReport() const;
         
         Slice sl;
         
-        DataAccess &getAccess() { return *access; }
+        DataAccess &getAccess() const { return *access; }
         
     private:
         DataAccess *access;
@@ -12,33 +12,127 @@
 #include <blocksci/blocksci_export.h>
 #include <blocksci/address/address_fwd.hpp>
 #include <blocksci/chain/block_range.hpp>
+#include <blocksci/core/warmup.hpp>
 
+#include <chrono>
 #include <map>
+#include <memory>
 #include <type_traits>
 #include <future>
+#include <utility>
+#include <vector>
 
 namespace blocksci {
     struct DataConfiguration;
     class DataAccess;
     
+    /** Represents the blockchain stored in a data directory
+     *
+     * The data is read through a generation of the data directory, which refresh() replaces by a newer one once the
+     * parser has added blocks. snapshot() pins the current generation so that queries can run against a consistent view
+     * of the chain while another thread keeps refreshing.
+     *
+     * Publishing a generation updates the block range of this Blockchain in place. Queries on this Blockchain itself
+     * (size(), operator[], iteration, ...) therefore must not run concurrently with refresh(), only snapshot(),
+     * generation(), isParserRunning() and the configuration getters may. Generations that have been replaced are kept
+     * alive for generationGracePeriod, so objects loaded from this Blockchain before a refresh stay valid that long.
+     */
     class BLOCKSCI_EXPORT Blockchain : public BlockRange {
-        /** Pointer to the DataAccess instance that manages all data access objects (ChainAccess, ScriptAccess etc.) for this chain */
-        std::unique_ptr<DataAccess> access;
+        /** Pointer to the DataAccess instance that manages all data access objects (ChainAccess, ScriptAccess etc.) for this chain
+         *
+         * Shared with the snapshots of the same generation, only accessed through std::atomic_load and std::atomic_store.
+         */
+        std::shared_ptr<DataAccess> access;
+        
+        /** Number of parser updates seen by waitForUpdate */
+        uint64_t seenUpdates = 0;
+        
+        /** Generations replaced by publishGeneration and the time they were replaced, released after generationGracePeriod */
+        std::vector<std::pair<std::chrono::steady_clock::time_point, std::shared_ptr<DataAccess>>> retiredGenerations;
+        
+        explicit Blockchain(std::shared_ptr<DataAccess> access_);
     public:
+        /** Time for which a generation replaced by refresh() is kept alive for the objects that have been loaded from it */
+        static constexpr std::chrono::seconds generationGracePeriod{300};
         
         Blockchain() = default;
         Blockchain(std::unique_ptr<DataAccess> access_);
         explicit Blockchain(const DataConfiguration &config);
         explicit Blockchain(const std::string &configPath);
         Blockchain(const std::string &configPath, BlockHeight maxBlock);
+        Blockchain(Blockchain &&);
+        Blockchain &operator=(Blockchain &&);
         ~Blockchain();
         
         std::string dataLocation() const;
         std::string configLocation() const;
 
+        /** Reloads the data files in place to make new blocks visible (Invalidates current BlockSci objects and snapshots) */
         void reload();
         bool isParserRunning();
         
+        /** Returns a Blockchain that is pinned to the current generation of the data
+         *
+         * The snapshot and all objects loaded from it stay valid and unchanged while this Blockchain is refreshed,
+         * and the generation is released once the last snapshot of it is destroyed. May be called concurrently with refresh().
+         *
+         * @throws ReorgException if errorOnReorg is set and the last block of the generation has been replaced on disk
+         */
+        Blockchain snapshot() const;
+        
+        /** Loads a new generation of the data if the parser has added or replaced blocks since the current one was loaded
+         *
+         * Same as publishGeneration(loadNextGeneration()). The new generation is published atomically, readers of
+         * snapshots are never paused. Objects loaded directly from this Blockchain rather than from a snapshot stay valid
+         * for generationGracePeriod after a new generation has been published.
+         *
+         * Must not be called concurrently with itself, waitForUpdate() or queries on this Blockchain, @see Blockchain
+         *
+         * @return whether a new generation was published
+         */
+        bool refresh();
+        
+        /** Loads the next generation of the data without publishing it, nullptr if the current generation is up to date
+         *
+         * Does not modify this Blockchain and may run concurrently with queries on it, but not with itself or publishGeneration().
+         */
+        std::shared_ptr<DataAccess> loadNextGeneration() const;
+        
+        /** Makes a generation returned by loadNextGeneration() the current one, does nothing if next is nullptr
+         *
+         * Must not be called concurrently with refresh(), waitForUpdate() or queries on this Blockchain, @see Blockchain
+         */
+        void publishGeneration(std::shared_ptr<DataAccess> next);
+        
+        /** Number of generations that have been published before the current one */
+        uint64_t generation() const;
+        
+        /** Waits until the parser has finished updating the data directory or the timeout expires and then refreshes
+         *
+         * Same as publishGeneration(waitForNextGeneration(timeout)), with the same restrictions as refresh().
+         *
+         * @return whether a new generation was published
+         */
+        bool waitForUpdate(std::chrono::milliseconds timeout);
+        
+        /** Waits until the parser has finished updating the data directory or the timeout expires and then loads the
+         * next generation without publishing it, nullptr if the current generation is still up to date
+         *
+         * Parser updates are detected with inotify. Updates that completed before the first call are picked up right away.
+         * Like loadNextGeneration(), this may run concurrently with queries on this Blockchain, but not with itself,
+         * refresh() or publishGeneration().
+         */
+        std::shared_ptr<DataAccess> waitForNextGeneration(std::chrono::milliseconds timeout);
+        
+        /** Reads the data files selected by spec into the page cache in parallel, optionally locking them into memory
+         *
+         * Running this after a reboot makes subsequent queries run at warm-cache speed right away instead of slowly faulting
+         * in the data under load.
+         *
+         * @return throughput and resident fraction of every warmed up file
+         */
+        std::vector<WarmupFileResult> warmup(const WarmupSpec &spec = WarmupSpec{});
+        
         uint32_t addressCount(AddressType::Enum type) const;
     };
     
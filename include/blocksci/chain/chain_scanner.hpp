@@ -0,0 +1,225 @@
+//
+//  chain_scanner.hpp
+//  blocksci
+//
+
+#ifndef blocksci_chain_scanner_hpp
+#define blocksci_chain_scanner_hpp
+
+#include <blocksci/blocksci_export.h>
+#include <blocksci/chain/chain_fwd.hpp>
+#include <blocksci/core/bitcoin_uint256.hpp>
+#include <blocksci/core/raw_block.hpp>
+#include <blocksci/core/raw_transaction.hpp>
+#include <blocksci/core/typedefs.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+namespace blocksci {
+    class DataAccess;
+
+    /** Side columns that a ChainScanner reads in addition to the transaction records, combined with | */
+    struct BLOCKSCI_EXPORT ScanColumn {
+        enum Enum : uint8_t {
+            None = 0,
+            /** Version field of every transaction, chain/tx_version.dat */
+            Version = 1,
+            /** Hash of every transaction, chain/tx_hashes.dat */
+            Hash = 2,
+            /** Sequence number of every input, chain/sequence.dat */
+            Sequence = 4,
+            /** Output number within the spent transaction of every input, chain/input_out_num.dat */
+            SpentOutputNum = 8
+        };
+    };
+
+    /** Contiguous run of Inout records in chain/tx_data.dat */
+    struct BLOCKSCI_EXPORT InoutSpan {
+        const Inout *first = nullptr;
+        const Inout *last = nullptr;
+
+        const Inout *begin() const {
+            return first;
+        }
+
+        const Inout *end() const {
+            return last;
+        }
+
+        size_t size() const {
+            return static_cast<size_t>(last - first);
+        }
+
+        bool empty() const {
+            return first == last;
+        }
+
+        const Inout &operator[](size_t i) const {
+            return first[i];
+        }
+    };
+
+    /** The transaction a ChainScanner is positioned at, as pointers into the chain files
+     *
+     * Pointers to side columns that were not requested are nullptr.
+     */
+    struct BLOCKSCI_EXPORT ScannedTx {
+        const RawTransaction *raw = nullptr;
+        uint32_t txNum = 0;
+        BlockHeight height = 0;
+        /** Blockchain-wide number of the first input of the transaction */
+        uint64_t firstInputNum = 0;
+        /** Blockchain-wide number of the first output of the transaction */
+        uint64_t firstOutputNum = 0;
+        const int32_t *version = nullptr;
+        const uint256 *hash = nullptr;
+        /** Sequence number of each input */
+        const uint32_t *sequenceNumbers = nullptr;
+        /** Output number spent by each input */
+        const uint16_t *spentOutputNums = nullptr;
+
+        InoutSpan inputs() const {
+            return {raw->beginInputs(), raw->endInputs()};
+        }
+
+        InoutSpan outputs() const {
+            return {raw->beginOutputs(), raw->endOutputs()};
+        }
+
+        uint16_t inputCount() const {
+            return raw->inputCount;
+        }
+
+        uint16_t outputCount() const {
+            return raw->outputCount;
+        }
+
+        uint32_t locktime() const {
+            return raw->locktime;
+        }
+
+        bool isCoinbase() const {
+            return raw->inputCount == 0;
+        }
+    };
+
+    /** Cursor that walks the transactions of a range of blocks in chain/tx_data.dat order without building Transaction,
+     * Input or Output objects
+     *
+     * Advancing steps over the RawTransaction record and its inputs and outputs and keeps running totals of the
+     * blockchain-wide input and output numbers, so a scan touches nothing but the transaction data and the side columns
+     * that were asked for. This makes it the fastest way to evaluate simple predicates over the whole chain, for example
+     * in the map function of BlockRange::mapReduce:
+     *
+     *     for (ChainScanner scanner(segment); scanner.next();) {
+     *         count += scanner.tx().locktime() > 0;
+     *     }
+     *
+     * When chain/tx_data.dat is uncompressed, advancing moves the pointer within the mapping and the pointers stay valid as
+     * long as the Blockchain is open. When it is compressed, each transaction is looked up through the chunk cache of the
+     * calling thread, so the pointers of ScannedTx are only valid until the thread reads further compressed data, for
+     * example by the next call to next(). Like the other iterators, the scanner keeps a window of upcoming transactions
+     * in the page cache, @see ChainAccess::prefetchTransactions
+     */
+    class BLOCKSCI_EXPORT ChainScanner {
+    public:
+        /** Scans the transactions of the given blocks, reading the side columns in columns (a combination of ScanColumn) */
+        explicit ChainScanner(const BlockRange &blocks, uint8_t columns = ScanColumn::None);
+
+        /** Scans the transactions [beginTx, endTx) */
+        ChainScanner(DataAccess &access, uint32_t beginTx, uint32_t endTx, uint8_t columns = ScanColumn::None);
+
+        /** Moves to the next transaction, the first call moves to the first one. Returns false once all transactions have
+         * been visited.
+         */
+        bool next() {
+            if (started) {
+                if (current.txNum >= endTx) {
+                    return false;
+                }
+                advance();
+            } else {
+                started = true;
+            }
+            return current.txNum < endTx;
+        }
+
+        const ScannedTx &tx() const {
+            return current;
+        }
+
+        /** The current transaction as a full Transaction object */
+        Transaction transaction() const;
+
+        /** Calls func(const ScannedTx &) for every remaining transaction */
+        template <typename Func>
+        void forEach(Func &&func) {
+            while (next()) {
+                func(current);
+            }
+        }
+
+        uint32_t beginTxIndex() const {
+            return beginTx;
+        }
+
+        uint32_t endTxIndex() const {
+            return endTx;
+        }
+
+    private:
+        DataAccess *access;
+        ScannedTx current;
+        const RawBlock *blocks = nullptr;
+        uint32_t beginTx;
+        uint32_t endTx;
+        uint32_t nextBlockTx = 0;
+        uint32_t readaheadTx = std::numeric_limits<uint32_t>::max();
+        bool started = false;
+        /** Whether the next transaction starts where the current one ends, false if the transaction data is compressed */
+        bool contiguousData = true;
+
+        void advance() {
+            auto raw = current.raw;
+            auto inputCount = raw->inputCount;
+            auto outputCount = raw->outputCount;
+            current.txNum++;
+            if (contiguousData) {
+                current.raw = reinterpret_cast<const RawTransaction *>(reinterpret_cast<const char *>(raw) + raw->serializedSize());
+            } else if (current.txNum < endTx) {
+                loadRaw();
+            }
+            current.firstInputNum += inputCount;
+            current.firstOutputNum += outputCount;
+            if (current.version) {
+                current.version++;
+            }
+            if (current.hash) {
+                current.hash++;
+            }
+            if (current.sequenceNumbers) {
+                current.sequenceNumbers += inputCount;
+            }
+            if (current.spentOutputNums) {
+                current.spentOutputNums += inputCount;
+            }
+            while (current.txNum >= nextBlockTx && current.txNum < endTx) {
+                current.height++;
+                nextBlockTx = blocks[current.height].firstTxIndex + blocks[current.height].txCount;
+            }
+            if (current.txNum >= readaheadTx) {
+                readAhead();
+            }
+        }
+
+        // Request the transactions ahead of the current one to be read into memory and schedule the next request
+        void readAhead();
+
+        // Look up current.raw by txNum, for transaction data that cannot be stepped through
+        void loadRaw();
+    };
+} // namespace blocksci
+
+#endif /* blocksci_chain_scanner_hpp */
@@ -0,0 +1,131 @@
+//
+//  inout_kernels.hpp
+//  blocksci
+//
+
+#ifndef blocksci_inout_kernels_hpp
+#define blocksci_inout_kernels_hpp
+
+#include <blocksci/blocksci_export.h>
+#include <blocksci/chain/chain_scanner.hpp>
+#include <blocksci/core/address_types.hpp>
+#include <blocksci/core/inout.hpp>
+#include <blocksci/core/inout_columns.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace blocksci {
+    class DataAccess;
+
+    /** Instruction sets the inout kernels are implemented for */
+    enum class SimdIsa : uint8_t {
+        Scalar,
+        AVX2,
+        /** AVX-512 F, VL and BW */
+        AVX512
+    };
+
+    BLOCKSCI_EXPORT const char *simdIsaName(SimdIsa isa);
+
+    /** Best instruction set supported by the CPU and the operating system */
+    BLOCKSCI_EXPORT SimdIsa detectedSimdIsa();
+
+    /** Instruction set the kernels currently run with, detectedSimdIsa() unless changed with setActiveSimdIsa */
+    BLOCKSCI_EXPORT SimdIsa activeSimdIsa();
+
+    /** Switches the kernels to the given instruction set, capped at detectedSimdIsa(). Returns the instruction set that
+     * is used from now on. Meant for comparing the implementations, the switch is not synchronized with running kernels.
+     */
+    BLOCKSCI_EXPORT SimdIsa setActiveSimdIsa(SimdIsa isa);
+
+    /** Number of inputs/outputs of each AddressType, indexed by AddressType::Enum */
+    using TypeCounts = std::array<uint64_t, AddressType::size>;
+
+    /** Vectorized aggregates over the values and types of inputs/outputs
+     *
+     * Every kernel exists for runs of Inout records, as found in chain/tx_data.dat (@see InoutSpan), and for the
+     * columnar layout of InoutColumns or any other array of values and types. The records are decoded in registers, so
+     * the value (lowest 60 bits of Inout::other) and type (highest 4 bits) never have to be unpacked one by one. The
+     * implementation is picked at runtime from activeSimdIsa(), runs shorter than a few vectors use the scalar loop.
+     */
+    namespace kernels {
+        /** Writes the value of each Inout to values, which must have room for count entries */
+        BLOCKSCI_EXPORT void extractValues(const Inout *inouts, size_t count, int64_t *values);
+
+        BLOCKSCI_EXPORT int64_t sumValues(const Inout *inouts, size_t count);
+        BLOCKSCI_EXPORT int64_t sumValues(const int64_t *values, size_t count);
+
+        /** Smallest value, std::numeric_limits<int64_t>::max() if count is 0 */
+        BLOCKSCI_EXPORT int64_t minValue(const Inout *inouts, size_t count);
+        BLOCKSCI_EXPORT int64_t minValue(const int64_t *values, size_t count);
+
+        /** Largest value, std::numeric_limits<int64_t>::min() if count is 0 */
+        BLOCKSCI_EXPORT int64_t maxValue(const Inout *inouts, size_t count);
+        BLOCKSCI_EXPORT int64_t maxValue(const int64_t *values, size_t count);
+
+        /** Adds the number of inputs/outputs of each type to counts, entries with an invalid type are not counted */
+        BLOCKSCI_EXPORT void countTypes(const Inout *inouts, size_t count, TypeCounts &counts);
+        BLOCKSCI_EXPORT void countTypes(const uint8_t *types, size_t count, TypeCounts &counts);
+
+        /** Writes the indexes of the entries whose value is greater than threshold to selection in ascending order and
+         * returns how many there are. selection must have room for count entries.
+         */
+        BLOCKSCI_EXPORT size_t selectValuesGreaterThan(const Inout *inouts, size_t count, int64_t threshold, uint32_t *selection);
+        BLOCKSCI_EXPORT size_t selectValuesGreaterThan(const int64_t *values, size_t count, int64_t threshold, uint32_t *selection);
+
+        /** Writes the indexes of the entries whose value is less than threshold to selection in ascending order and
+         * returns how many there are. selection must have room for count entries.
+         */
+        BLOCKSCI_EXPORT size_t selectValuesLessThan(const Inout *inouts, size_t count, int64_t threshold, uint32_t *selection);
+        BLOCKSCI_EXPORT size_t selectValuesLessThan(const int64_t *values, size_t count, int64_t threshold, uint32_t *selection);
+
+        inline int64_t sumValues(const InoutSpan &span) {
+            return sumValues(span.begin(), span.size());
+        }
+
+        inline int64_t sumValues(const InoutColumns &columns) {
+            return sumValues(columns.values, columns.count);
+        }
+
+        inline int64_t minValue(const InoutSpan &span) {
+            return minValue(span.begin(), span.size());
+        }
+
+        inline int64_t minValue(const InoutColumns &columns) {
+            return minValue(columns.values, columns.count);
+        }
+
+        inline int64_t maxValue(const InoutSpan &span) {
+            return maxValue(span.begin(), span.size());
+        }
+
+        inline int64_t maxValue(const InoutColumns &columns) {
+            return maxValue(columns.values, columns.count);
+        }
+
+        inline void countTypes(const InoutSpan &span, TypeCounts &counts) {
+            countTypes(span.begin(), span.size(), counts);
+        }
+
+        inline void countTypes(const InoutColumns &columns, TypeCounts &counts) {
+            countTypes(columns.types, columns.count, counts);
+        }
+
+        /** Sum of the input values of the transactions [beginTx, endTx), read from the Inout columns if they have been
+         * built and from the transaction data otherwise
+         */
+        BLOCKSCI_EXPORT int64_t totalInputValue(DataAccess &access, uint32_t beginTx, uint32_t endTx);
+
+        /** Sum of the output values of the transactions [beginTx, endTx), read from the Inout columns if they have been
+         * built and from the transaction data otherwise
+         */
+        BLOCKSCI_EXPORT int64_t totalOutputValue(DataAccess &access, uint32_t beginTx, uint32_t endTx);
+
+        /** Sum of the fees of the transactions [beginTx, endTx) */
+        BLOCKSCI_EXPORT int64_t totalFee(DataAccess &access, uint32_t beginTx, uint32_t endTx);
+    } // namespace kernels
+} // namespace blocksci
+
+#endif /* blocksci_inout_kernels_hpp */
@@ -0,0 +1,96 @@
+//
+//  numa.hpp
+//  blocksci
+//
+
+#ifndef blocksci_numa_hpp
+#define blocksci_numa_hpp
+
+#include <blocksci/blocksci_export.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace blocksci {
+
+    /** A NUMA node and the CPUs of it that the process may run on */
+    struct BLOCKSCI_EXPORT NumaNode {
+        /** Node number of the operating system */
+        int id;
+        std::vector<unsigned int> cpus;
+    };
+
+    /** The NUMA nodes of the machine, read from /sys/devices/system/node on Linux
+     *
+     * Nodes without CPUs in the affinity mask of the process are left out. On machines without NUMA support the topology
+     * consists of one node with an empty CPU list, which threads are never pinned to.
+     */
+    class BLOCKSCI_EXPORT NumaTopology {
+    public:
+        /** The topology of this machine, read once */
+        static const NumaTopology &system();
+
+        /** A topology with the given nodes, eg. to place the threads of a TaskPool as if it ran on another machine */
+        explicit NumaTopology(std::vector<NumaNode> nodes);
+
+        const std::vector<NumaNode> &nodes() const {
+            return nodeList;
+        }
+
+        size_t nodeCount() const {
+            return nodeList.size();
+        }
+
+        /** Index into nodes() of the node with the given CPU, -1 if it is unknown */
+        int nodeIndexOfCpu(unsigned int cpu) const;
+
+        /** Index into nodes() of the node of the CPU the calling thread is running on, -1 if it is unknown */
+        int currentNodeIndex() const;
+
+        /** Restricts the calling thread to the CPUs of nodes()[nodeIndex], returns false if that is not possible */
+        bool pinCurrentThread(size_t nodeIndex) const;
+
+        /** Writes the operating system node number of every page of [data, data + size) that is resident to nodes,
+         * -1 for pages that are not in memory. Returns false if the kernel does not report page placement.
+         */
+        static bool pageNodes(const void *data, size_t size, std::vector<int> &nodes);
+
+    private:
+        std::vector<NumaNode> nodeList;
+        std::vector<int> cpuNodes;
+
+        NumaTopology();
+
+        void indexCpus();
+    };
+
+    /** How well the chain data touched by BlockRange::mapReduce matches the NUMA nodes that its segments are assigned to
+     *
+     * Pages are counted as remote if they are resident on a different node than the one the segment they belong to is
+     * assigned to, so remotePages / residentPages is the share of memory accesses that crosses the interconnect when
+     * every segment runs on its node. Tasks are counted as remote if they ran on a CPU of another node.
+     */
+    struct BLOCKSCI_EXPORT NumaAccessReport {
+        uint64_t pageCount = 0;
+        uint64_t residentPages = 0;
+        uint64_t remotePages = 0;
+        /** Resident pages per node, in the order of NumaTopology::nodes() */
+        std::vector<uint64_t> nodePages;
+        uint64_t localTasks = 0;
+        uint64_t remoteTasks = 0;
+        /** False if the kernel does not report page placement or the transaction data is compressed, in which case only the task counts are filled in */
+        bool pagePlacementKnown = false;
+
+        double remotePageRatio() const {
+            return residentPages > 0 ? static_cast<double>(remotePages) / static_cast<double>(residentPages) : 0;
+        }
+
+        double remoteTaskRatio() const {
+            auto total = localTasks + remoteTasks;
+            return total > 0 ? static_cast<double>(remoteTasks) / static_cast<double>(total) : 0;
+        }
+    };
+} // namespace blocksci
+
+#endif /* blocksci_numa_hpp */
@@ -0,0 +1,114 @@
+//
+//  task_pool.hpp
+//  blocksci
+//
+
+#ifndef blocksci_task_pool_hpp
+#define blocksci_task_pool_hpp
+
+#include <blocksci/blocksci_export.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace blocksci {
+    class NumaTopology;
+
+    /** Persistent pool of worker threads that runs the tasks of parallel loops with work stealing
+     *
+     * A loop is split into many more tasks than there are threads. The tasks are dealt out to the threads in contiguous
+     * runs, every thread works through its own run in order and threads that run out of work take tasks from the end of
+     * the runs of the others. This keeps all threads busy when the cost per task varies a lot, as it does between the
+     * early and recent parts of the chain.
+     *
+     * The thread that starts a loop works on its tasks as well, so loops can be nested inside tasks without blocking a
+     * worker. Exceptions thrown by a task are rethrown by parallelFor once all tasks of the loop have finished.
+     *
+     * A NUMA aware pool on a machine with several NUMA nodes spreads its workers evenly over the nodes and pins each of
+     * them to the CPUs of its node. parallelForOnNodes then hands each task to the workers of the node it is assigned to,
+     * and idle threads steal from workers of their own node before they steal from other nodes. The calling thread is
+     * not pinned and belongs to no node, it only steals the tasks of parallelForOnNodes.
+     */
+    class BLOCKSCI_EXPORT TaskPool {
+    public:
+        /** Number of tasks per thread that parallel operations split their work into */
+        static constexpr unsigned int tasksPerThread = 16;
+
+        /** Tasks that ran on a CPU of the node they were assigned to, and ones that ran elsewhere */
+        struct NodeStats {
+            uint64_t localTasks;
+            uint64_t remoteTasks;
+        };
+
+        /** Creates a pool whose loops run on threadCount threads including the calling one, 0 for one per hardware thread
+         *
+         * A NUMA aware pool spreads its workers over the nodes of NumaTopology::system().
+         */
+        explicit TaskPool(unsigned int threadCount = 0, bool numaAware = false);
+
+        /** Creates a pool that spreads its workers over the nodes of topology, which must outlive the pool */
+        TaskPool(unsigned int threadCount, const NumaTopology &topology);
+        ~TaskPool();
+
+        TaskPool(const TaskPool &) = delete;
+        TaskPool &operator=(const TaskPool &) = delete;
+
+        /** Number of threads that work on a loop, including the calling one */
+        unsigned int threadCount() const;
+
+        /** Number of NUMA nodes the workers are spread over, at most one per worker. Node n of the pool is topology().nodes()[n]. */
+        unsigned int nodeCount() const;
+
+        /** The topology the workers are placed on, NumaTopology::system() for pools that are not NUMA aware */
+        const NumaTopology &topology() const;
+
+        /** Runs task(i) for every i in [0, taskCount) and returns once all of them have finished */
+        void parallelFor(size_t taskCount, const std::function<void(size_t)> &task);
+
+        /** Runs task(i) for every i in [0, taskNodes.size()), preferably on a thread of node taskNodes[i] % nodeCount() */
+        void parallelForOnNodes(const std::vector<unsigned int> &taskNodes, const std::function<void(size_t)> &task);
+
+        /** Counts of the tasks run by parallelForOnNodes since the pool was created or the counts were reset */
+        NodeStats nodeStats() const;
+        void resetNodeStats();
+
+        /** Runs func(i) for every i in [begin, end) in tasks of grainSize consecutive indexes */
+        template <typename Func>
+        void parallelForRange(size_t begin, size_t end, size_t grainSize, Func &&func) {
+            if (end <= begin) {
+                return;
+            }
+            grainSize = std::max<size_t>(grainSize, 1);
+            auto taskCount = (end - begin + grainSize - 1) / grainSize;
+            parallelFor(taskCount, [&](size_t task) {
+                auto first = begin + task * grainSize;
+                auto last = std::min(end, first + grainSize);
+                for (auto i = first; i < last; i++) {
+                    func(i);
+                }
+            });
+        }
+
+        /** The pool behind BlockRange::mapReduce, map and filter and the clustering, created on first use */
+        static TaskPool &shared();
+
+        /** Replaces the shared pool by one with the given number of threads, 0 for one per hardware thread
+         *
+         * Must not be called while a parallel operation is running.
+         */
+        static void setSharedThreadCount(unsigned int threadCount, bool numaAware = false);
+
+        /** Replaces the shared pool, eg. by one on another topology. Must not be called while a parallel operation is running. */
+        static void setSharedPool(std::unique_ptr<TaskPool> pool);
+
+    private:
+        struct Impl;
+        std::unique_ptr<Impl> impl;
+    };
+} // namespace blocksci
+
+#endif /* blocksci_task_pool_hpp */
@@ -12,15 +12,19 @@
 #include <blocksci/blocksci_export.h>
 
 #include <blocksci/chain/chain_fwd.hpp>
+#include <blocksci/chain/inout_kernels.hpp>
 #include <blocksci/chain/input_range.hpp>
 #include <blocksci/chain/output_range.hpp>
 #include <blocksci/core/raw_transaction.hpp>
 #include <blocksci/core/bitcoin_uint256.hpp>
+#include <blocksci/core/inout_columns.hpp>
 #include <blocksci/core/transaction_data.hpp>
 
 #include <range/v3/utility/optional.hpp>
 
 #include <chrono>
+#include <string>
+#include <vector>
 
 namespace blocksci {
     class uint256;
@@ -56,6 +60,7 @@ namespace blocksci {
         Transaction(uint32_t index, DataAccess &access_);
         
         Transaction(const uint256 &hash, DataAccess &access);
+        /** Transaction with the given hash in hex form, which may be abbreviated to any prefix that is unique in the chain */
         Transaction(const std::string &hash, DataAccess &access);
         
         DataAccess &getAccess() const {
@@ -113,14 +118,7 @@ namespace blocksci {
             if (isCoinbase()) {
                 return 0;
             } else {
-                int64_t total = 0;
-                for (auto input : inputs()) {
-                    total += input.getValue();
-                }
-                for (auto output : outputs()) {
-                    total -= output.getValue();
-                }
-                return total;
+                return kernels::sumValues(inputSpan()) - kernels::sumValues(outputSpan());
             }
         }
         
@@ -144,6 +142,22 @@ namespace blocksci {
             return {data.rawTx->beginInputs(), data.spentOutputNums, data.sequenceNumbers, getBlockHeight(), txNum, inputCount(), maxTxCount, access};
         }
         
+        /** Inout records of this transaction's outputs in chain/tx_data.dat, @see kernels */
+        InoutSpan outputSpan() const {
+            return {data.rawTx->beginOutputs(), data.rawTx->endOutputs()};
+        }
+        
+        /** Inout records of this transaction's inputs in chain/tx_data.dat, @see kernels */
+        InoutSpan inputSpan() const {
+            return {data.rawTx->beginInputs(), data.rawTx->endInputs()};
+        }
+        
+        /** Columnar view of this transaction's inputs, only available if the optional Inout columns have been built */
+        ranges::optional<InoutColumns> inputColumns() const;
+
+        /** Columnar view of this transaction's outputs, only available if the optional Inout columns have been built */
+        ranges::optional<InoutColumns> outputColumns() const;
+        
         bool isCoinbase() const {
             return inputCount() == 0;
         }
@@ -187,6 +201,20 @@ namespace blocksci {
     std::ostream BLOCKSCI_EXPORT &operator<<(std::ostream &os, const Transaction &tx);
     
     bool BLOCKSCI_EXPORT isSegwitMarker(const Transaction &tx);
+    
+    /** Transaction numbers of many transaction hashes at once, nullopt for hashes that are not in the chain
+     *
+     * Much faster than constructing one Transaction per hash for large batches, @see HashIndex::getTxIndexes
+     */
+    std::vector<ranges::optional<uint32_t>> BLOCKSCI_EXPORT getTxIndexes(const std::vector<uint256> &hashes, DataAccess &access, unsigned int threadCount = 1);
+    std::vector<ranges::optional<uint32_t>> BLOCKSCI_EXPORT getTxIndexes(const std::vector<std::string> &hashes, DataAccess &access, unsigned int threadCount = 1);
+    
+    /** Numbers of the transactions whose hash begins with the given hex prefix in ascending order, at most limit of them
+     *
+     * Answered by the memory mapped tx hash index when the parser has built it, otherwise by a scan over all tx hashes.
+     * Throws std::invalid_argument if the prefix is not a hex string.
+     */
+    std::vector<uint32_t> BLOCKSCI_EXPORT getTxIndexesWithPrefix(const std::string &hexPrefix, DataAccess &access, size_t limit = 100);
 } // namespace blocksci
 
 
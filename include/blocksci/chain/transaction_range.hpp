@@ -11,6 +11,8 @@
 #include <blocksci/blocksci_export.h>
 #include <blocksci/chain/transaction.hpp>
 
+#include <limits>
+
 namespace blocksci {
     /** Represents an iterable collection of contiguous Transaction objects */
     class BLOCKSCI_EXPORT TransactionRange {
@@ -27,7 +29,12 @@ namespace blocksci {
             
             iterator() = default;
             
-            iterator(const Transaction &tx_) : tx(tx_) {}
+            /** If readahead is set, the iterator keeps a window of upcoming transactions in the page cache as it advances, @see readAhead() */
+            iterator(const Transaction &tx_, bool readahead = false) : tx(tx_), contiguousData(hasContiguousData(tx_)) {
+                if (readahead) {
+                    readAhead();
+                }
+            }
             
             self_type &operator+=(difference_type i) {
                 if (i > 0) {
@@ -60,10 +67,16 @@ namespace blocksci {
             self_type &operator++() {
                 ++tx.data;
                 ++tx.txNum;
+                if (!contiguousData && tx.txNum < tx.maxTxCount) {
+                    resetTx();
+                }
                 if (tx.txNum == nextBlockFirst) {
                     ++tx.blockHeight;
                     updateNextBlock();
                 }
+                if (tx.txNum >= readaheadTx) {
+                    readAhead();
+                }
                 return *this;
             }
             
@@ -101,6 +114,17 @@ namespace blocksci {
             uint32_t nextBlockFirst = 0;
             uint32_t prevBlockLast = 0;
             
+            /** Transaction number at which the next readahead window is requested */
+            uint32_t readaheadTx = std::numeric_limits<uint32_t>::max();
+            
+            /** Whether the next transaction starts where the current one ends, false if the transaction data is compressed */
+            bool contiguousData = true;
+            
+            static bool hasContiguousData(const Transaction &tx);
+            
+            // Request the transactions ahead of the current one to be read into memory and schedule the next request
+            void readAhead();
+            
             // Reset just data.rawTx based on txIndex
             void resetTx();
             
@@ -122,11 +146,15 @@ namespace blocksci {
             size_type stop;
         };
         
+        /** Ranges with at least this many transactions read ahead while being iterated; smaller ones such as most blocks
+         *  are covered by the readahead of the BlockRange they are iterated from */
+        static constexpr uint32_t readaheadMinSize = 1 << 14;
+        
         TransactionRange() = default;
         TransactionRange(const Slice &slice_, const Transaction &firstTx_) : slice(slice_), firstTx(firstTx_) {}
         
         iterator begin() const {
-            return {firstTx};
+            return {firstTx, size() >= readaheadMinSize};
         }
         
         iterator end() const {
@@ -164,6 +192,12 @@ namespace blocksci {
             return firstTx.getAccess();
         }
         
+        /** Columnar view of the inputs of all transactions in this range, only available if the optional Inout columns have been built */
+        ranges::optional<InoutColumns> inputColumns() const;
+        
+        /** Columnar view of the outputs of all transactions in this range, only available if the optional Inout columns have been built */
+        ranges::optional<InoutColumns> outputColumns() const;
+        
     private:
         Slice slice;
         Transaction firstTx;
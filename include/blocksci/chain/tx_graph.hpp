@@ -0,0 +1,136 @@
+//
+//  tx_graph.hpp
+//  blocksci
+//
+
+#ifndef blocksci_tx_graph_hpp
+#define blocksci_tx_graph_hpp
+
+#include <blocksci/blocksci_export.h>
+#include <blocksci/chain/chain_fwd.hpp>
+#include <blocksci/core/inout.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace blocksci {
+    class DataAccess;
+    class TaskPool;
+
+    /** Edges of the spend graph that a traversal follows */
+    enum class TraversalDirection : uint8_t {
+        /** From a transaction to the transactions spending its outputs */
+        Forward,
+        /** From a transaction to the transactions whose outputs its inputs spend */
+        Backward,
+        /** Both of the above */
+        Both
+    };
+
+    /** Edge of the spend graph, one spent output */
+    struct BLOCKSCI_EXPORT TxEdge {
+        /** Transaction the traversal reached the edge from */
+        uint32_t fromTx;
+        /** Transaction at the other end of the edge */
+        uint32_t toTx;
+        /** Number of the output (forward edges) or input (backward edges) of fromTx the edge runs through */
+        uint16_t inoutNum;
+        /** Forward or Backward */
+        TraversalDirection direction;
+        /** Depth of fromTx, the seeds have depth 0 */
+        uint32_t depth;
+        /** The output or input of fromTx the edge runs through, points into the memory mapped chain data */
+        const Inout *inout;
+    };
+
+    struct BLOCKSCI_EXPORT TraversalOptions {
+        TraversalDirection direction = TraversalDirection::Forward;
+
+        /** Number of hops to expand from the seeds */
+        uint32_t maxDepth = 1;
+
+        /** Stop once this many transactions have been visited, 0 for no limit. The transactions of the last depth are
+         * cut off in ascending tx number order, so the result does not depend on the thread count.
+         */
+        uint64_t maxVisited = 0;
+
+        /** Only edges for which the filter returns true are followed, all edges if it is empty. Called concurrently from
+         * the threads of the pool.
+         */
+        std::function<bool(const TxEdge &)> edgeFilter;
+
+        /** Collect the edges that were followed into TraversalResult::edges */
+        bool collectEdges = false;
+
+        /** Ask the kernel to read the tx_index and tx_data pages of each frontier before expanding it, so that pages that
+         * are not in memory are read in parallel instead of one fault at a time
+         */
+        bool prefetch = true;
+    };
+
+    struct BLOCKSCI_EXPORT TraversalResult {
+        /** Visited transactions ordered by depth and by tx number within a depth, starting with the seeds at depth 0 */
+        std::vector<uint32_t> txNums;
+
+        /** The transactions at depth d are txNums[depthOffsets[d], depthOffsets[d + 1]) */
+        std::vector<size_t> depthOffsets;
+
+        /** Followed edges ordered by depth and by fromTx within a depth, only filled if TraversalOptions::collectEdges is
+         * set. Includes edges to transactions that were reached before.
+         */
+        std::vector<TxEdge> edges;
+
+        /** Whether TraversalOptions::maxVisited stopped the traversal */
+        bool truncated = false;
+
+        /** Number of depths that were reached, including depth 0 */
+        uint32_t depthCount() const {
+            return depthOffsets.empty() ? 0 : static_cast<uint32_t>(depthOffsets.size() - 1);
+        }
+
+        std::vector<uint32_t> txNumsAtDepth(uint32_t depth) const;
+    };
+
+    /** Breadth-first traversal of the transaction spend graph from a set of seed transactions
+     *
+     * Edges are read straight from the linked tx numbers of the Inout records in chain/tx_data.dat, without building
+     * Input, Output or Transaction objects. Every frontier is expanded in parallel on a TaskPool and visited transactions
+     * are marked in a bitset indexed by tx number. The result is the same for any number of threads.
+     *
+     * The bitset takes one bit per transaction of the chain and is kept between runs, so reusing one object for many
+     * traversals avoids allocating it again. An object runs one traversal at a time.
+     */
+    class BLOCKSCI_EXPORT TxGraphTraversal {
+    public:
+        /** A traversal that runs on whatever pool is the shared TaskPool when run is called */
+        explicit TxGraphTraversal(DataAccess &access);
+        TxGraphTraversal(DataAccess &access, TaskPool &pool);
+        ~TxGraphTraversal();
+
+        /** Traverses the graph from the given seed transactions, which may contain duplicates */
+        TraversalResult run(const std::vector<uint32_t> &seeds, const TraversalOptions &options);
+
+    private:
+        DataAccess *access;
+        /** Null for the shared TaskPool */
+        TaskPool *pool;
+        std::unique_ptr<std::atomic<uint64_t>[]> visited;
+        size_t visitedWords = 0;
+
+        bool claim(uint32_t txNum);
+        void release(uint32_t txNum);
+        bool isVisited(uint32_t txNum) const;
+        void prefetchFrontier(const uint32_t *frontier, size_t count) const;
+    };
+
+    /** Traverses the spend graph from the given seed transactions on the shared TaskPool, reusing the TxGraphTraversal that
+     * access keeps so the visited bitset is only allocated once
+     */
+    TraversalResult BLOCKSCI_EXPORT traverseTxGraph(const std::vector<uint32_t> &seeds, const TraversalOptions &options, DataAccess &access);
+} // namespace blocksci
+
+#endif /* blocksci_tx_graph_hpp */
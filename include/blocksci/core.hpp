@@ -13,8 +13,10 @@
 #include <blocksci/core/script_data.hpp>
 #include <blocksci/core/address_types.hpp>
 #include <blocksci/core/inout.hpp>
+#include <blocksci/core/inout_columns.hpp>
 #include <blocksci/core/raw_transaction.hpp>
 #include <blocksci/core/raw_block.hpp>
+#include <blocksci/core/warmup.hpp>
 
 
 #endif /* core_group_header_h */
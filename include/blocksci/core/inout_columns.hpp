@@ -0,0 +1,69 @@
+//
+//  inout_columns.hpp
+//  blocksci
+//
+
+#ifndef inout_columns_hpp
+#define inout_columns_hpp
+
+#include <blocksci/blocksci_export.h>
+#include <blocksci/core/address_types.hpp>
+
+#include <cstdint>
+
+namespace blocksci {
+
+    /** Column oriented view over a contiguous run of inputs or outputs, indexed by blockchain-wide input/output number.
+     *
+     * The columns mirror the fields of the Inout objects stored in chain/tx_data.dat, but every field is stored in its own
+     * file so that scans which only need a single field (eg. output values) do not have to touch the rest of the Inout data.
+     * The view points at position firstNum of each column, ie. values[0] is the value of input/output number firstNum.
+     *
+     * @see blocksci::ChainAccess for the files backing this view
+     */
+    struct BLOCKSCI_EXPORT InoutColumns {
+        /** Value of each input/output, stored in chain/columns/<input|output>_value.dat */
+        const int64_t *values = nullptr;
+
+        /** AddressType::Enum of each input/output, stored in chain/columns/<input|output>_type.dat */
+        const uint8_t *types = nullptr;
+
+        /** scriptNum of each input/output, stored in chain/columns/<input|output>_address_num.dat */
+        const uint32_t *addressNums = nullptr;
+
+        /** Linked tx number of each input/output, stored in chain/columns/<input|output>_linked_tx.dat */
+        const uint32_t *linkedTxNums = nullptr;
+
+        /** Blockchain-wide number of the first input/output in this view */
+        uint64_t firstNum = 0;
+
+        /** Number of inputs/outputs in this view */
+        uint64_t count = 0;
+
+        uint64_t size() const {
+            return count;
+        }
+
+        bool empty() const {
+            return count == 0;
+        }
+
+        int64_t getValue(uint64_t i) const {
+            return values[i];
+        }
+
+        AddressType::Enum getType(uint64_t i) const {
+            return static_cast<AddressType::Enum>(types[i]);
+        }
+
+        uint32_t getAddressNum(uint64_t i) const {
+            return addressNums[i];
+        }
+
+        uint32_t getLinkedTxNum(uint64_t i) const {
+            return linkedTxNums[i];
+        }
+    };
+} // namespace blocksci
+
+#endif /* inout_columns_hpp */
@@ -0,0 +1,76 @@
+//
+//  warmup.hpp
+//  blocksci
+//
+
+#ifndef blocksci_warmup_hpp
+#define blocksci_warmup_hpp
+
+#include <blocksci/blocksci_export.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace blocksci {
+
+    /** Selects the data files that are read into the page cache by Blockchain::warmup
+     *
+     * Paths are either absolute or relative to the data directory. Directories are warmed up recursively.
+     */
+    struct BLOCKSCI_EXPORT WarmupSpec {
+        /** Warm up all files in chain/ */
+        bool chain = true;
+
+        /** Warm up all files in scripts/ */
+        bool scripts = true;
+
+        /** Warm up the hash index (hashIndex/) and the address index (addressesDb/) */
+        bool indexes = false;
+
+        /** Additional files or directories to warm up, eg. the directory of a saved clustering */
+        std::vector<std::string> extraPaths;
+
+        /** Files or directories to lock in memory with mlock after reading them, they are warmed up even if not selected otherwise
+         *
+         * The locks are held until the Blockchain is destroyed. Locking is limited by RLIMIT_MEMLOCK.
+         */
+        std::vector<std::string> lockedPaths;
+
+        /** Number of reader threads, 0 to use one thread per hardware thread */
+        unsigned int threadCount = 0;
+
+        /** Size of every read request in bytes, rounded up to a multiple of the page size */
+        uint64_t readSize = 1 << 20;
+    };
+
+    /** Outcome of warming up a single file */
+    struct BLOCKSCI_EXPORT WarmupFileResult {
+        std::string path;
+
+        /** File size in bytes */
+        uint64_t size = 0;
+
+        /** Number of bytes that were actually read, less than size if reading the file failed */
+        uint64_t bytesRead = 0;
+
+        /** Description of the first error that occurred while reading the file, empty if the whole file was read */
+        std::string error;
+
+        /** Time between the first and the last read of the file */
+        double seconds = 0;
+
+        /** Fraction of the file's pages that are resident in memory after the warmup */
+        double residentFraction = 0;
+
+        /** Whether the file was locked in memory */
+        bool locked = false;
+
+        /** Read throughput in MiB/s */
+        double throughput() const {
+            return seconds > 0 ? static_cast<double>(bytesRead) / (1024 * 1024) / seconds : 0;
+        }
+    };
+} // namespace blocksci
+
+#endif /* blocksci_warmup_hpp */
@@ -8,6 +8,8 @@
 
 #define BLOCKSCI_WITHOUT_SINGLETON
 
+#include "address_prefix_index.hpp"
+
 #include <blocksci/address/address.hpp>
 #include <blocksci/address/equiv_address.hpp>
 #include <blocksci/chain/algorithms.hpp>
@@ -22,13 +24,19 @@
 #include <internal/chain_access.hpp>
 #include <internal/script_access.hpp>
 #include <internal/address_index.hpp>
+#include <internal/balance_history_index.hpp>
 #include <internal/hash_index.hpp>
+#include <internal/memory_view.hpp>
+#include <internal/taproot_index.hpp>
 
 #include <range/v3/view/transform.hpp>
 #include <range/v3/view/unique.hpp>
 #include <range/v3/algorithm/min.hpp>
 
+#include <algorithm>
+#include <array>
 #include <iostream>
+#include <iterator>
 #include <sstream>
 #include <unordered_set>
 
@@ -43,12 +51,23 @@ namespace blocksci {
         return outputs(getOutputPointers(), *access);
     }
     
-    ranges::any_view<Input> Address::getInputs() const {
+    ranges::any_view<InputPointer> Address::getInputPointers() const {
+        auto &index = access->getAddressIndex();
+        if (index.hasInputIndex()) {
+            return index.getInputPointers(*this)
+            | ranges::views::transform([](const InoutPointer &pointer) { return InputPointer(pointer.txNum, pointer.inoutNum); });
+        }
         auto _access = access;
         return getOutputPointers()
-        | ranges::views::transform([_access](const OutputPointer &pointer) { return Output(pointer, *_access).getSpendingInput(); })
+        | ranges::views::transform([_access](const OutputPointer &pointer) { return Output(pointer, *_access).getSpendingInputPointer(); })
         | flatMapOptionals();
     }
+    
+    ranges::any_view<Input> Address::getInputs() const {
+        auto _access = access;
+        return getInputPointers()
+        | ranges::views::transform([_access](const InputPointer &pointer) { return Input(pointer, *_access); });
+    }
 
     ranges::any_view<Transaction> Address::getOutputTransactions() const {
         auto _access = access;
@@ -60,6 +79,13 @@ namespace blocksci {
     
     ranges::any_view<Transaction> Address::getInputTransactions() const {
         auto _access = access;
+        if (_access->getAddressIndex().hasInputIndex()) {
+            // The input index is sorted by txNum, so every spending transaction is one run of pointers
+            return _access->getAddressIndex().getInputPointers(*this)
+            | ranges::views::transform([](const InoutPointer &pointer) -> uint32_t { return pointer.txNum; })
+            | ranges::views::unique
+            | ranges::views::transform([_access](uint32_t txNum) { return Transaction(txNum, _access->getChain().getBlockHeight(txNum), *_access); });
+        }
         Address searchAddress = *this;
         return getOutputPointers()
         | ranges::views::transform([_access, searchAddress](auto pointer) -> ranges::optional<Transaction> {
@@ -207,6 +233,14 @@ namespace blocksci {
     std::vector<Transaction> Address::getInputTransactionsVector() const {
         std::vector<Transaction> result;
         auto _access = access;
+        if (_access->getAddressIndex().hasInputIndex()) {
+            for (const auto &pointer : _access->getAddressIndex().getInputPointers(*this)) {
+                if (result.empty() || result.back().txNum != pointer.txNum) {
+                    result.emplace_back(pointer.txNum, _access->getChain().getBlockHeight(pointer.txNum), *_access);
+                }
+            }
+            return result;
+        }
         Address searchAddress = *this;
         for (auto pointer : getOutputPointers()) {
             auto spendingTx = Output(pointer, *_access).getSpendingTx();
@@ -288,73 +322,185 @@ namespace blocksci {
         return ScriptBase(*this);
     }
     
-    ranges::optional<Address> getAddressFromString(const std::string &addressString, DataAccess &access) {
-        if (addressString.compare(0, access.config.chainConfig.segwitPrefix.size(), access.config.chainConfig.segwitPrefix) == 0) {
-            std::pair<int, std::vector<uint8_t> > decoded = segwit_addr::decode(access.config.chainConfig.segwitPrefix, addressString);
-            if (decoded.first == 0) {
-                // SegWit version 0: P2WPKH or P2WSH
-                if (decoded.second.size() == 20) {
-                    uint160 pubkeyHash(decoded.second.begin(), decoded.second.end());
-                    ranges::optional<uint32_t> addressNum = access.getHashIndex().getWitnessPubkeyHashIndex(pubkeyHash);
-                    if (addressNum) {
-                        return Address{*addressNum, AddressType::WITNESS_PUBKEYHASH, access};
-                    }
-                } else if (decoded.second.size() == 32) {
-                    uint256 scriptHash(decoded.second.begin(), decoded.second.end());
-                    ranges::optional<uint32_t> addressNum = access.getHashIndex().getScriptHashIndex(scriptHash);
-                    if (addressNum) {
-                        return Address{*addressNum, AddressType::WITNESS_SCRIPTHASH, access};
+    namespace {
+        /** Identifier of an address string in the hash index, uint160 identifiers use the first 20 bytes of hash */
+        struct AddressStringKey {
+            AddressType::Enum type;
+            uint256 hash;
+            size_t size;
+
+            MemoryView view() const {
+                return MemoryView{reinterpret_cast<const char *>(hash.begin()), size};
+            }
+        };
+
+        template <typename It>
+        AddressStringKey makeAddressStringKey(AddressType::Enum type, It begin, It end) {
+            AddressStringKey key{type, uint256{}, static_cast<size_t>(std::distance(begin, end))};
+            std::copy(begin, end, key.hash.begin());
+            return key;
+        }
+
+        /** Decodes an address string into the type and identifier under which the hash index stores it */
+        ranges::optional<AddressStringKey> parseAddressString(const std::string &addressString, const DataAccess &access) {
+            if (addressString.compare(0, access.config.chainConfig.segwitPrefix.size(), access.config.chainConfig.segwitPrefix) == 0) {
+                std::pair<int, std::vector<uint8_t> > decoded = segwit_addr::decode(access.config.chainConfig.segwitPrefix, addressString);
+                if (decoded.first == 0) {
+                    // SegWit version 0: P2WPKH or P2WSH
+                    if (decoded.second.size() == 20) {
+                        return makeAddressStringKey(AddressType::WITNESS_PUBKEYHASH, decoded.second.begin(), decoded.second.end());
+                    } else if (decoded.second.size() == 32) {
+                        return makeAddressStringKey(AddressType::WITNESS_SCRIPTHASH, decoded.second.begin(), decoded.second.end());
                     }
+                } else if (decoded.first == 1 && decoded.second.size() == 32) {
+                    // SegWit version 1: Taproot (bc1p...)
+                    return makeAddressStringKey(AddressType::WITNESS_UNKNOWN, decoded.second.begin(), decoded.second.end());
                 }
-            } else if (decoded.first == 1 && decoded.second.size() == 32) {
-                // SegWit version 1: Taproot (bc1p...)
-                uint256 witnessProgram(decoded.second.begin(), decoded.second.end());
-                ranges::optional<uint32_t> addressNum = access.getHashIndex().getWitnessUnknownIndex(witnessProgram);
-                if (addressNum) {
-                    return Address{*addressNum, AddressType::WITNESS_UNKNOWN, access};
-                }
+                return ranges::nullopt;
+            }
+            unsigned int nVersionBytes = access.config.chainConfig.pubkeyPrefix.size();
+            CBitcoinAddress address{addressString, nVersionBytes};
+            uint160 hash;
+            blocksci::AddressType::Enum type;
+            std::tie(hash, type) = address.Get(access.config.chainConfig);
+            if (type == AddressType::Enum::PUBKEYHASH || type == AddressType::Enum::SCRIPTHASH) {
+                return makeAddressStringKey(type, hash.begin(), hash.end());
             }
             return ranges::nullopt;
         }
-        unsigned int nVersionBytes = access.config.chainConfig.pubkeyPrefix.size();
-        CBitcoinAddress address{addressString, nVersionBytes};
-        uint160 hash;
-        blocksci::AddressType::Enum type;
-        std::tie(hash, type) = address.Get(access.config.chainConfig);
-        ranges::optional<uint32_t> addressNum = ranges::nullopt;
-        if (type == AddressType::Enum::PUBKEYHASH) {
-            addressNum = access.getHashIndex().getPubkeyHashIndex(hash);
-        } else if (type == AddressType::Enum::SCRIPTHASH) {
-            addressNum = access.getHashIndex().getScriptHashIndex(hash);
+    } // namespace
+    
+    ranges::optional<Address> getAddressFromString(const std::string &addressString, DataAccess &access) {
+        auto key = parseAddressString(addressString, access);
+        if (!key) {
+            return ranges::nullopt;
         }
+        auto addressNum = access.getHashIndex().lookupAddress(key->type, key->view());
         if (addressNum) {
-            return Address{*addressNum, type, access};
+            return Address{*addressNum, key->type, access};
         } else {
             return ranges::nullopt;
         }
     }
-    
-    template<AddressType::Enum type>
-    std::vector<Address> getAddressesWithPrefixImp(const std::string &prefix, DataAccess &access) {
+
+    std::vector<Address> getAllAddressesFromString(const std::string &addressString, DataAccess &access) {
         std::vector<Address> addresses;
-        auto count = access.getScripts().scriptCount(dedupType(type));
-        for (uint32_t scriptNum = 1; scriptNum <= count; scriptNum++) {
-            ScriptAddress<type> script(scriptNum, access);
-            if (script.addressString().compare(0, prefix.length(), prefix) == 0) {
-                addresses.emplace_back(scriptNum, type, access);
+        auto key = parseAddressString(addressString, access);
+        if (!key) {
+            return addresses;
+        }
+        if (key->type != AddressType::WITNESS_UNKNOWN) {
+            if (auto address = getAddressFromString(addressString, access)) {
+                addresses.push_back(*address);
+            }
+            return addresses;
+        }
+
+        // Scripts that are newer than the taproot index (all of them if there is none) are scanned
+        uint32_t firstUnindexed = 1;
+        if (auto taprootIndex = access.getHashIndex().getTaprootIndex()) {
+            for (auto scriptNum : taprootIndex->findAll(key->hash)) {
+                addresses.emplace_back(scriptNum, AddressType::WITNESS_UNKNOWN, access);
+            }
+            firstUnindexed = static_cast<uint32_t>(taprootIndex->scriptCount() + 1);
+        }
+        auto &scripts = access.getScripts();
+        auto scriptCount = scripts.scriptCount(DedupAddressType::WITNESS_UNKNOWN);
+        for (uint32_t scriptNum = firstUnindexed; scriptNum <= scriptCount; scriptNum++) {
+            auto script = std::get<0>(scripts.getScriptData<DedupAddressType::WITNESS_UNKNOWN>(scriptNum));
+            if (script->witnessVersion == 1 && script->scriptData.size() == key->size && std::equal(script->scriptData.begin(), script->scriptData.end(), key->hash.begin())) {
+                addresses.emplace_back(scriptNum, AddressType::WITNESS_UNKNOWN, access);
+            }
+        }
+        return addresses;
+    }
+
+    std::vector<ranges::optional<Address>> getAddressesFromStrings(const std::vector<std::string> &addressStrings, DataAccess &access, unsigned int threadCount) {
+        std::vector<ranges::optional<Address>> addresses(addressStrings.size());
+        // Strings are grouped by address type so that every type is resolved with one batched lookup
+        std::array<std::vector<size_t>, AddressType::size> positions;
+        std::vector<ranges::optional<AddressStringKey>> keys;
+        keys.reserve(addressStrings.size());
+        for (size_t i = 0; i < addressStrings.size(); i++) {
+            keys.push_back(parseAddressString(addressStrings[i], access));
+            if (keys.back()) {
+                positions[static_cast<size_t>(keys.back()->type)].push_back(i);
+            }
+        }
+        for (size_t typeIndex = 0; typeIndex < positions.size(); typeIndex++) {
+            auto &typePositions = positions[typeIndex];
+            if (typePositions.empty()) {
+                continue;
+            }
+            auto type = static_cast<AddressType::Enum>(typeIndex);
+            std::vector<MemoryView> views;
+            views.reserve(typePositions.size());
+            for (auto i : typePositions) {
+                views.push_back(keys[i]->view());
+            }
+            auto addressNums = access.getHashIndex().lookupAddresses(type, views, threadCount);
+            for (size_t j = 0; j < typePositions.size(); j++) {
+                if (addressNums[j]) {
+                    addresses[typePositions[j]] = Address{*addressNums[j], type, access};
+                }
             }
         }
         return addresses;
     }
+
+    namespace {
+        template <typename Hash>
+        std::vector<ranges::optional<uint32_t>> lookupAddressesImp(AddressType::Enum type, const std::vector<Hash> &hashes, DataAccess &access, unsigned int threadCount) {
+            std::vector<MemoryView> views;
+            views.reserve(hashes.size());
+            for (const auto &hash : hashes) {
+                views.push_back(MemoryView{reinterpret_cast<const char *>(hash.begin()), sizeof(hash)});
+            }
+            return access.getHashIndex().lookupAddresses(type, views, threadCount);
+        }
+    } // namespace
+
+    std::vector<ranges::optional<uint32_t>> lookupAddresses(AddressType::Enum type, const std::vector<uint160> &hashes, DataAccess &access, unsigned int threadCount) {
+        return lookupAddressesImp(type, hashes, access, threadCount);
+    }
+
+    std::vector<ranges::optional<uint32_t>> lookupAddresses(AddressType::Enum type, const std::vector<uint256> &hashes, DataAccess &access, unsigned int threadCount) {
+        return lookupAddressesImp(type, hashes, access, threadCount);
+    }
+
+    std::vector<std::vector<OutputPointer>> getOutputPointers(const std::vector<Address> &addresses, unsigned int threadCount) {
+        std::vector<std::vector<OutputPointer>> results;
+        if (addresses.empty()) {
+            return results;
+        }
+        std::vector<RawAddress> rawAddresses(addresses.begin(), addresses.end());
+        auto inoutPointers = addresses.front().getAccess().getAddressIndex().getOutputPointers(rawAddresses, threadCount);
+        results.reserve(inoutPointers.size());
+        for (auto &pointers : inoutPointers) {
+            std::vector<OutputPointer> outputPointers;
+            outputPointers.reserve(pointers.size());
+            for (const auto &pointer : pointers) {
+                outputPointers.emplace_back(pointer.txNum, pointer.inoutNum);
+            }
+            results.push_back(std::move(outputPointers));
+        }
+        return results;
+    }
     
     std::vector<Address> getAddressesWithPrefix(const std::string &prefix, DataAccess &access) {
-        if (prefix.compare(0, 1, "1") == 0) {
-            return getAddressesWithPrefixImp<AddressType::Enum::PUBKEYHASH>(prefix, access);
-        } else if (prefix.compare(0, 1, "3") == 0) {
-            return getAddressesWithPrefixImp<AddressType::Enum::SCRIPTHASH>(prefix, access);
-        } else {
-            return {};
+        auto index = std::atomic_load(&access.addressPrefixIndex);
+        if (!index) {
+            // Concurrent first calls may each open the index, the last one is kept
+            index = std::make_shared<const AddressPrefixIndex>(access.config.addressPrefixIndexDirectory(), access);
+            std::atomic_store(&access.addressPrefixIndex, index);
         }
+        return index->addressesWithPrefix(prefix);
+    }
+    
+    uint64_t updateAddressPrefixIndex(DataAccess &access, unsigned int threadCount) {
+        auto addedCount = updateAddressPrefixIndex(access.config.addressPrefixIndexDirectory(), access, threadCount);
+        std::atomic_store(&access.addressPrefixIndex, std::shared_ptr<const AddressPrefixIndex>{});
+        return addedCount;
     }
     
     std::string fullTypeImp(const Address &address, DataAccess &access) {
@@ -401,12 +547,31 @@ namespace blocksci {
         return EquivAddress{*this, nestedEquivalent};
     }
 
-    /* Get the balance of the address by:
-     * 1) getting all outputs that are linked to the address, and
-     * 2) adding up all unspent outputs.
+    /* Get the balance of the address by either
+     * 1) looking it up in the balance history index, or
+     * 2) getting all outputs that are linked to the address and adding up all unspent outputs.
      */
     int64_t Address::calculateBalance(BlockHeight height) const {
+        auto balanceIndex = access->getBalanceHistoryIndex();
+        if (balanceIndex != nullptr && balanceIndex->coversHeight(height, access->getChain())) {
+            return balanceIndex->balanceAt(RawAddress{scriptNum, type}, height);
+        }
         return balance(height, outputs(getOutputPointers(), *access));
     }
+
+    std::vector<int64_t> Address::calculateBalanceSeries(const std::vector<BlockHeight> &heights) const {
+        auto balanceIndex = access->getBalanceHistoryIndex();
+        if (balanceIndex != nullptr && std::all_of(heights.begin(), heights.end(), [&](BlockHeight height) { return balanceIndex->coversHeight(height, access->getChain()); })) {
+            return balanceIndex->balanceSeries(RawAddress{scriptNum, type}, heights);
+        }
+        // Load the outputs once for all heights
+        std::vector<Output> addressOutputs = outputs(getOutputPointers(), *access) | ranges::to_vector;
+        std::vector<int64_t> balances;
+        balances.reserve(heights.size());
+        for (auto height : heights) {
+            balances.push_back(balance(height, addressOutputs));
+        }
+        return balances;
+    }
 }
 
@@ -0,0 +1,401 @@
+//
+//  address_prefix_index.cpp
+//  blocksci
+//
+
+#define BLOCKSCI_WITHOUT_SINGLETON
+
+#include "address_prefix_index.hpp"
+
+#include <blocksci/scripts/script_variant.hpp>
+#include <scripts/bitcoin_base58.hpp>
+
+#include <internal/batch_lookup.hpp>
+#include <internal/data_access.hpp>
+#include <internal/dedup_address_info.hpp>
+#include <internal/delta_tables.hpp>
+#include <internal/script_access.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <mutex>
+#include <queue>
+#include <stdexcept>
+
+namespace blocksci {
+
+    namespace {
+        /** The first 8 characters of an address string that vary within its type and the scriptNum of the address */
+        struct PrefixRecord {
+            uint64_t key;
+            uint32_t scriptNum;
+        };
+
+        bool isBech32(AddressType::Enum type) {
+            return type == AddressType::WITNESS_PUBKEYHASH || type == AddressType::WITNESS_SCRIPTHASH || type == AddressType::WITNESS_UNKNOWN;
+        }
+
+        /** The characters every bech32 address string of the type begins with: the human readable part, "1" and the witness version */
+        std::string bech32Start(AddressType::Enum type, const ChainConfiguration &config) {
+            return config.segwitPrefix + "1" + (type == AddressType::WITNESS_UNKNOWN ? "p" : "q");
+        }
+
+        /** Whether a script of the deduplicated type of type has an address of type */
+        bool hasAddress(AddressType::Enum type, uint32_t scriptNum, const ScriptAccess &scripts) {
+            switch (type) {
+                case AddressType::PUBKEYHASH:
+                    // Like ScriptAddress<PUBKEY>::addressString, pubkeys that were only used as P2PK are shown as their P2PKH address
+                    return true;
+                case AddressType::WITNESS_PUBKEYHASH:
+                    return scripts.getScriptData<DedupAddressType::PUBKEY>(scriptNum)->seen(AddressType::WITNESS_PUBKEYHASH);
+                case AddressType::SCRIPTHASH:
+                    return !scripts.getScriptData<DedupAddressType::SCRIPTHASH>(scriptNum)->isSegwit;
+                case AddressType::WITNESS_SCRIPTHASH:
+                    return scripts.getScriptData<DedupAddressType::SCRIPTHASH>(scriptNum)->isSegwit;
+                case AddressType::WITNESS_UNKNOWN: {
+                    auto script = std::get<0>(scripts.getScriptData<DedupAddressType::WITNESS_UNKNOWN>(scriptNum));
+                    return script->witnessVersion == 1 && script->scriptData.size() == 32;
+                }
+                default:
+                    return false;
+            }
+        }
+
+        std::string addressString(AddressType::Enum type, uint32_t scriptNum, DataAccess &access) {
+            switch (type) {
+                case AddressType::PUBKEYHASH:
+                    return ScriptAddress<AddressType::PUBKEYHASH>(scriptNum, access).addressString();
+                case AddressType::WITNESS_PUBKEYHASH:
+                    return ScriptAddress<AddressType::WITNESS_PUBKEYHASH>(scriptNum, access).addressString();
+                case AddressType::SCRIPTHASH:
+                    return ScriptAddress<AddressType::SCRIPTHASH>(scriptNum, access).addressString();
+                case AddressType::WITNESS_SCRIPTHASH:
+                    return ScriptAddress<AddressType::WITNESS_SCRIPTHASH>(scriptNum, access).addressString();
+                case AddressType::WITNESS_UNKNOWN:
+                    return ScriptAddress<AddressType::WITNESS_UNKNOWN>(scriptNum, access).addressString();
+                default:
+                    throw std::runtime_error("Addresses of type " + addressName(type) + " have no address string");
+            }
+        }
+
+        /** Whether base58 address strings with the given version bytes can begin with prefix
+         *
+         * The strings encode the version bytes followed by a 20 byte hash and a 4 byte checksum. Each leading zero byte of
+         * the version becomes a leading "1". Otherwise all strings lie between the encodings of the smallest and the largest
+         * payload, which have the same length for the common versions and then bound the strings lexicographically.
+         */
+        bool couldMatchBase58(const std::vector<unsigned char> &version, const std::string &prefix) {
+            auto zeroCount = static_cast<size_t>(std::find_if(version.begin(), version.end(), [](unsigned char c) { return c != 0; }) - version.begin());
+            std::string ones(zeroCount, '1');
+            auto length = std::min(prefix.size(), ones.size());
+            if (prefix.compare(0, length, ones, 0, length) != 0) {
+                return false;
+            }
+            if (zeroCount == version.size()) {
+                return true;
+            }
+            auto payload = version;
+            payload.resize(version.size() + 24, 0x00);
+            auto lowest = EncodeBase58(payload);
+            std::fill(payload.begin() + static_cast<std::ptrdiff_t>(version.size()), payload.end(), 0xff);
+            auto highest = EncodeBase58(payload);
+            if (lowest.size() != highest.size()) {
+                return true;
+            }
+            length = std::min(prefix.size(), lowest.size());
+            return prefix.compare(0, length, lowest, 0, length) >= 0 && prefix.compare(0, length, highest, 0, length) <= 0;
+        }
+
+        /** Whether address strings of the type can begin with prefix, which saves searching and scanning the other types */
+        bool couldMatch(AddressType::Enum type, const std::string &prefix, const ChainConfiguration &config) {
+            switch (type) {
+                case AddressType::PUBKEYHASH:
+                    return couldMatchBase58(config.pubkeyPrefix, prefix);
+                case AddressType::SCRIPTHASH:
+                    return couldMatchBase58(config.scriptPrefix, prefix);
+                default: {
+                    auto start = bech32Start(type, config);
+                    auto length = std::min(prefix.size(), start.size());
+                    return prefix.compare(0, length, start, 0, length) == 0;
+                }
+            }
+        }
+
+        /** Characters of a bech32 address string that are the same for all addresses of its type are left out of the sort key */
+        size_t sortKeyOffset(AddressType::Enum type, const ChainConfiguration &config) {
+            return isBech32(type) ? bech32Start(type, config).size() : 0;
+        }
+
+        /** 8 characters of the address string from offset on in big endian order, which sorts like the characters */
+        uint64_t sortKey(const std::string &address, size_t offset) {
+            uint64_t key = 0;
+            for (size_t i = offset; i < offset + sizeof(key); i++) {
+                key = (key << 8) | (i < address.size() ? static_cast<uint8_t>(address[i]) : 0);
+            }
+            return key;
+        }
+
+        uint64_t lastScriptTxNum(AddressType::Enum type, uint64_t scriptEnd, const ScriptAccess &scripts) {
+            return scripts.getScriptHeader(static_cast<uint32_t>(scriptEnd - 1), dedupType(type))->txFirstSeen;
+        }
+
+        bool matchesScripts(const AddressPrefixTable &table, AddressType::Enum type, const ScriptAccess &scripts) {
+            auto &header = table.header();
+            auto lastScriptNum = header.scriptEnd - 1;
+            return header.addressType == static_cast<uint32_t>(type) && lastScriptNum <= scripts.scriptCount(dedupType(type)) && lastScriptTxNum(type, header.scriptEnd, scripts) == header.lastScriptTxNum;
+        }
+
+        /** Whether placing the addresses of addedCount scripts among the entries of table by binary search encodes fewer
+         * addresses than encoding those of the table again
+         */
+        bool extendsTable(const AddressPrefixTable &table, uint64_t addedCount) {
+            if (!table.isLoaded()) {
+                return false;
+            }
+            uint64_t searchLength = 1;
+            for (auto count = table.header().entryCount; count > 1; count /= 2) {
+                searchLength++;
+            }
+            return addedCount * searchLength < table.header().scriptEnd - table.header().scriptStart;
+        }
+
+        /** Writes a table of the scripts scriptStart up to but excluding scriptEnd that have an address of the given type
+         *
+         * previous is either not loaded or a table of the scripts from scriptStart on, whose entries are copied, so only
+         * the scripts after it are encoded. Every thread encodes and sorts the addresses of one chunk of these scripts and
+         * the chunks are merged into the file, where each address is placed among the entries of previous by a binary
+         * search.
+         */
+        void writeTable(const std::string &destPath, AddressType::Enum type, uint64_t scriptStart, uint64_t scriptEnd, const AddressPrefixTable &previous, DataAccess &access, unsigned int threadCount) {
+            auto tempPath = destPath + ".tmp";
+            auto scriptBegin = previous.isLoaded() ? previous.header().scriptEnd : scriptStart;
+            auto &scripts = access.getScripts();
+            auto keyOffset = sortKeyOffset(type, access.config.chainConfig);
+            // Ties of the sort key are rare and broken by the full address strings
+            auto recordLess = [&](const PrefixRecord &a, const PrefixRecord &b) {
+                if (a.key != b.key) {
+                    return a.key < b.key;
+                }
+                return addressString(type, a.scriptNum, access) < addressString(type, b.scriptNum, access);
+            };
+
+            std::vector<std::vector<PrefixRecord>> chunks;
+            std::mutex chunksMutex;
+            forEachChunk(scriptEnd - scriptBegin, threadCount, [&](size_t begin, size_t end) {
+                std::vector<PrefixRecord> records;
+                for (auto i = begin; i < end; i++) {
+                    auto scriptNum = static_cast<uint32_t>(scriptBegin + i);
+                    if (hasAddress(type, scriptNum, scripts)) {
+                        records.push_back(PrefixRecord{sortKey(addressString(type, scriptNum, access), keyOffset), scriptNum});
+                    }
+                }
+                std::sort(records.begin(), records.end(), recordLess);
+                std::lock_guard<std::mutex> lock(chunksMutex);
+                chunks.push_back(std::move(records));
+            });
+
+            AddressPrefixTableHeader header;
+            header.magic = AddressPrefixTableHeader::magicValue;
+            header.version = AddressPrefixTableHeader::currentVersion;
+            header.addressType = static_cast<uint32_t>(type);
+            header.scriptStart = scriptStart;
+            header.scriptEnd = scriptEnd;
+            auto previousEntries = previous.isLoaded() ? previous.allEntries() : std::pair<const uint32_t *, const uint32_t *>{nullptr, nullptr};
+            header.entryCount = static_cast<uint64_t>(previousEntries.second - previousEntries.first);
+            for (auto &chunk : chunks) {
+                header.entryCount += chunk.size();
+            }
+            header.lastScriptTxNum = lastScriptTxNum(type, scriptEnd, scripts);
+
+            {
+                std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+                if (!out) {
+                    throw std::runtime_error("Could not create " + tempPath);
+                }
+                out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+                using Cursor = std::pair<const PrefixRecord *, const PrefixRecord *>;
+                auto cursorGreater = [&](const Cursor &a, const Cursor &b) {
+                    return recordLess(*b.first, *a.first);
+                };
+                std::priority_queue<Cursor, std::vector<Cursor>, decltype(cursorGreater)> heap(cursorGreater);
+                for (auto &chunk : chunks) {
+                    if (!chunk.empty()) {
+                        heap.push(Cursor{chunk.data(), chunk.data() + chunk.size()});
+                    }
+                }
+                std::vector<uint32_t> buffer;
+                buffer.reserve(1 << 16);
+                auto addEntry = [&](uint32_t scriptNum) {
+                    buffer.push_back(scriptNum);
+                    if (buffer.size() == buffer.capacity()) {
+                        out.write(reinterpret_cast<const char *>(buffer.data()), static_cast<std::streamsize>(buffer.size() * sizeof(uint32_t)));
+                        buffer.clear();
+                    }
+                };
+                while (!heap.empty()) {
+                    auto cursor = heap.top();
+                    heap.pop();
+                    if (previousEntries.first != previousEntries.second) {
+                        auto address = addressString(type, cursor.first->scriptNum, access);
+                        auto end = std::partition_point(previousEntries.first, previousEntries.second, [&](uint32_t scriptNum) {
+                            return addressString(type, scriptNum, access) < address;
+                        });
+                        std::for_each(previousEntries.first, end, addEntry);
+                        previousEntries.first = end;
+                    }
+                    addEntry(cursor.first->scriptNum);
+                    if (++cursor.first != cursor.second) {
+                        heap.push(cursor);
+                    }
+                }
+                std::for_each(previousEntries.first, previousEntries.second, addEntry);
+                out.write(reinterpret_cast<const char *>(buffer.data()), static_cast<std::streamsize>(buffer.size() * sizeof(uint32_t)));
+                out.flush();
+                if (!out) {
+                    throw std::runtime_error("Error writing " + tempPath);
+                }
+            }
+
+            if (std::rename(tempPath.c_str(), destPath.c_str()) != 0) {
+                throw std::runtime_error("Could not move " + tempPath + " to " + destPath);
+            }
+        }
+    } // namespace
+
+    bool AddressPrefixTable::load(const char *data, int64_t size) {
+        *this = AddressPrefixTable{};
+        if (data == nullptr || size < static_cast<int64_t>(sizeof(AddressPrefixTableHeader))) {
+            return false;
+        }
+        auto header = reinterpret_cast<const AddressPrefixTableHeader *>(data);
+        if (header->magic != AddressPrefixTableHeader::magicValue || header->version != AddressPrefixTableHeader::currentVersion) {
+            return false;
+        }
+        auto expectedSize = sizeof(AddressPrefixTableHeader) + header->entryCount * sizeof(uint32_t);
+        if (static_cast<uint64_t>(size) != expectedSize || header->scriptStart < 1 || header->scriptEnd <= header->scriptStart) {
+            return false;
+        }
+        tableHeader = header;
+        scriptNums = reinterpret_cast<const uint32_t *>(data + sizeof(AddressPrefixTableHeader));
+        return true;
+    }
+
+    AddressPrefixIndex::TypeTables::TypeTables(AddressType::Enum type_, const filesystem::path &directory) :
+    type(type_), baseFile(directory/addressName(type_)), deltaFile(directory/(addressName(type_) + "_delta")) {
+        if (baseFile.size() > 0) {
+            base.load(baseFile.getDataAtOffset(0), baseFile.size());
+        }
+        if (deltaFile.size() > 0) {
+            delta.load(deltaFile.getDataAtOffset(0), deltaFile.size());
+        }
+    }
+
+    const std::vector<AddressType::Enum> &AddressPrefixIndex::indexedTypes() {
+        static const std::vector<AddressType::Enum> types{AddressType::PUBKEYHASH, AddressType::SCRIPTHASH, AddressType::WITNESS_PUBKEYHASH, AddressType::WITNESS_SCRIPTHASH, AddressType::WITNESS_UNKNOWN};
+        return types;
+    }
+
+    AddressPrefixIndex::AddressPrefixIndex(const filesystem::path &directory, DataAccess &access_) : access(&access_) {
+        auto &scripts = access->getScripts();
+        tables.reserve(indexedTypes().size());
+        for (auto type : indexedTypes()) {
+            tables.emplace_back(type, directory);
+            auto &typeTables = tables.back();
+            if (typeTables.base.isLoaded() && (typeTables.base.header().scriptStart != 1 || !matchesScripts(typeTables.base, type, scripts))) {
+                typeTables.base = AddressPrefixTable{};
+            }
+            if (!typeTables.base.isLoaded() || (typeTables.delta.isLoaded() && (typeTables.delta.header().scriptStart != typeTables.base.header().scriptEnd || !matchesScripts(typeTables.delta, type, scripts)))) {
+                typeTables.delta = AddressPrefixTable{};
+            }
+        }
+    }
+
+    uint64_t AddressPrefixIndex::baseScriptCount(AddressType::Enum type) const {
+        for (auto &typeTables : tables) {
+            if (typeTables.type == type) {
+                return typeTables.base.isLoaded() ? typeTables.base.header().scriptEnd - 1 : 0;
+            }
+        }
+        return 0;
+    }
+
+    const AddressPrefixTable &AddressPrefixIndex::deltaTable(AddressType::Enum type) const {
+        for (auto &typeTables : tables) {
+            if (typeTables.type == type) {
+                return typeTables.delta;
+            }
+        }
+        throw std::invalid_argument("Addresses of type " + addressName(type) + " are not in the address prefix index");
+    }
+
+    uint64_t AddressPrefixIndex::scriptCount(AddressType::Enum type) const {
+        for (auto &typeTables : tables) {
+            if (typeTables.type == type && typeTables.delta.isLoaded()) {
+                return typeTables.delta.header().scriptEnd - 1;
+            }
+        }
+        return baseScriptCount(type);
+    }
+
+    std::vector<Address> AddressPrefixIndex::addressesWithPrefix(const std::string &prefix) const {
+        std::vector<Address> addresses;
+        auto &scripts = access->getScripts();
+        for (auto &typeTables : tables) {
+            auto type = typeTables.type;
+            if (!couldMatch(type, prefix, access->config.chainConfig)) {
+                continue;
+            }
+            auto encode = [&](uint32_t scriptNum) {
+                return addressString(type, scriptNum, *access);
+            };
+            for (auto table : {&typeTables.base, &typeTables.delta}) {
+                if (table->isLoaded()) {
+                    auto range = table->prefixRange(prefix, encode);
+                    for (auto it = range.first; it != range.second; ++it) {
+                        addresses.emplace_back(*it, type, *access);
+                    }
+                }
+            }
+            // Scripts added since the last update of the index
+            auto typeScriptCount = scripts.scriptCount(dedupType(type));
+            for (auto scriptNum = static_cast<uint32_t>(scriptCount(type) + 1); scriptNum <= typeScriptCount; scriptNum++) {
+                if (hasAddress(type, scriptNum, scripts) && encode(scriptNum).compare(0, prefix.size(), prefix) == 0) {
+                    addresses.emplace_back(scriptNum, type, *access);
+                }
+            }
+        }
+        return addresses;
+    }
+
+    uint64_t updateAddressPrefixIndex(const filesystem::path &directory, DataAccess &access, unsigned int threadCount) {
+        if (!directory.exists()) {
+            filesystem::create_directory(directory);
+        }
+        // The current tables stay mapped while they are replaced, which does not affect the mappings
+        AddressPrefixIndex index{directory, access};
+        auto &scripts = access.getScripts();
+        uint64_t addedCount = 0;
+        for (auto type : AddressPrefixIndex::indexedTypes()) {
+            uint64_t typeScriptCount = scripts.scriptCount(dedupType(type));
+            auto baseScriptCount = index.baseScriptCount(type);
+            auto indexedScriptCount = index.scriptCount(type);
+            if (typeScriptCount == 0 || indexedScriptCount == typeScriptCount) {
+                continue;
+            }
+            auto basePath = (directory/addressName(type)).str() + ".dat";
+            auto deltaPath = (directory/(addressName(type) + "_delta")).str() + ".dat";
+            if (rebuildsBaseTables(baseScriptCount, typeScriptCount)) {
+                writeTable(basePath, type, 1, typeScriptCount + 1, AddressPrefixTable{}, access, threadCount);
+                std::remove(deltaPath.c_str());
+            } else {
+                auto &delta = index.deltaTable(type);
+                auto extendsDelta = extendsTable(delta, typeScriptCount - indexedScriptCount);
+                writeTable(deltaPath, type, baseScriptCount + 1, typeScriptCount + 1, extendsDelta ? delta : AddressPrefixTable{}, access, threadCount);
+            }
+            addedCount += typeScriptCount - indexedScriptCount;
+        }
+        return addedCount;
+    }
+} // namespace blocksci
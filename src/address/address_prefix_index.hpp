@@ -0,0 +1,142 @@
+//
+//  address_prefix_index.hpp
+//  blocksci
+//
+
+#ifndef address_prefix_index_hpp
+#define address_prefix_index_hpp
+
+#include <blocksci/address/address.hpp>
+#include <blocksci/core/address_types.hpp>
+
+#include <internal/file_mapper.hpp>
+
+#include <wjfilesystem/path.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace blocksci {
+    class DataAccess;
+
+    /** Header of an address prefix table file
+     *
+     * File layout: [AddressPrefixTableHeader][uint32_t scriptNums[entryCount]]
+     *
+     * The table lists the scripts scriptStart up to but excluding scriptEnd of the deduplicated type of addressType that
+     * have an address of addressType, sorted by their address string. Only scriptNums are stored, the strings are encoded
+     * again when the table is searched.
+     */
+    struct AddressPrefixTableHeader {
+        /** "BSCIAPX1" when read as little endian */
+        static constexpr uint64_t magicValue = 0x3158504149435342;
+        static constexpr uint32_t currentVersion = 1;
+
+        uint64_t magic;
+        uint32_t version;
+        uint32_t addressType;
+        uint64_t scriptStart;
+        uint64_t scriptEnd;
+        uint64_t entryCount;
+        /** txFirstSeen of script scriptEnd - 1, used to detect that the indexed scripts have been replaced */
+        uint64_t lastScriptTxNum;
+    };
+
+    /** Read-only view of an address prefix table file, @see AddressPrefixTableHeader */
+    class AddressPrefixTable {
+    public:
+        /** Interprets data as an address prefix table file, returns false and stays empty if it is not a valid one */
+        bool load(const char *data, int64_t size);
+
+        bool isLoaded() const {
+            return tableHeader != nullptr;
+        }
+
+        const AddressPrefixTableHeader &header() const {
+            return *tableHeader;
+        }
+
+        /** The scripts whose address string begins with prefix, addressString(scriptNum) must encode a script of the table */
+        template <typename AddressString>
+        std::pair<const uint32_t *, const uint32_t *> prefixRange(const std::string &prefix, AddressString &&addressString) const {
+            auto begin = scriptNums;
+            auto end = scriptNums + tableHeader->entryCount;
+            // Strings that begin with prefix are not less than prefix and form a contiguous range of the sorted table
+            auto first = std::partition_point(begin, end, [&](uint32_t scriptNum) {
+                return addressString(scriptNum).compare(prefix) < 0;
+            });
+            auto last = std::partition_point(first, end, [&](uint32_t scriptNum) {
+                return addressString(scriptNum).compare(0, prefix.size(), prefix) == 0;
+            });
+            return {first, last};
+        }
+
+        /** All entries of the table */
+        std::pair<const uint32_t *, const uint32_t *> allEntries() const {
+            return {scriptNums, scriptNums + tableHeader->entryCount};
+        }
+
+    private:
+        const AddressPrefixTableHeader *tableHeader = nullptr;
+        const uint32_t *scriptNums = nullptr;
+    };
+
+    /** Memory mapped index that answers getAddressesWithPrefix with two binary searches per address type
+     *
+     * There is one table per address family with a string form: P2PKH, P2SH, P2WPKH, P2WSH and P2TR (witness v1 outputs
+     * with a 32 byte program). A search encodes about log2(n) addresses, so it stays interactive for hundreds of millions
+     * of addresses while taking only 4 bytes per address.
+     *
+     * Every type has a base and a delta table, @see rebuildsBaseTables. Scripts added after the last update are scanned.
+     *
+     * Files: <directory>/<address type>.dat and <directory>/<address type>_delta.dat
+     */
+    class AddressPrefixIndex {
+    public:
+        AddressPrefixIndex(const filesystem::path &directory, DataAccess &access);
+
+        /** All addresses whose string begins with prefix, in string order within each table */
+        std::vector<Address> addressesWithPrefix(const std::string &prefix) const;
+
+        /** Number of scripts of the deduplicated type of the given address type that are covered by the index */
+        uint64_t scriptCount(AddressType::Enum type) const;
+
+        /** Number of scripts covered by the base table of the given address type */
+        uint64_t baseScriptCount(AddressType::Enum type) const;
+
+        /** The delta table of the given address type, which is not loaded if there is none */
+        const AddressPrefixTable &deltaTable(AddressType::Enum type) const;
+
+        /** The address types that have a string form, one table each */
+        static const std::vector<AddressType::Enum> &indexedTypes();
+
+    private:
+        struct TypeTables {
+            AddressType::Enum type;
+            SimpleFileMapper<> baseFile;
+            SimpleFileMapper<> deltaFile;
+            AddressPrefixTable base;
+            AddressPrefixTable delta;
+
+            TypeTables(AddressType::Enum type, const filesystem::path &directory);
+        };
+
+        DataAccess *access;
+        std::vector<TypeTables> tables;
+    };
+
+    /** Brings the address prefix index up to date with the script files, building new delta tables or new base tables
+     *
+     * Addresses are encoded on threadCount threads and sorted in memory, which takes 16 bytes per address that is added
+     * to a table. A new delta table keeps the entries of the current one unless so many scripts were added that encoding
+     * the scripts of both is cheaper than placing the new addresses among the current entries.
+     *
+     * @return the number of scripts that were added to the index
+     */
+    uint64_t updateAddressPrefixIndex(const filesystem::path &directory, DataAccess &access, unsigned int threadCount);
+} // namespace blocksci
+
+#endif /* address_prefix_index_hpp */
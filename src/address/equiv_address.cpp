@@ -14,10 +14,13 @@
 #include <internal/address_info.hpp>
 #include <internal/dedup_address_info.hpp>
 #include <internal/address_index.hpp>
+#include <internal/chain_access.hpp>
 #include <internal/data_access.hpp>
 #include <internal/script_access.hpp>
 
 #include <range/v3/action/sort.hpp>
+#include <range/v3/action/unique.hpp>
+#include <range/v3/range_for.hpp>
 
 #include <sstream>
 
@@ -133,6 +136,16 @@ namespace blocksci {
     }
     
     std::vector<Transaction> EquivAddress::getInputTransactions() const {
+        if (access->getAddressIndex().hasInputIndex()) {
+            std::vector<uint32_t> txNums;
+            for (const auto &address : addresses) {
+                RANGES_FOR(auto pointer, access->getAddressIndex().getInputPointers(address)) {
+                    txNums.push_back(pointer.txNum);
+                }
+            }
+            txNums |= ranges::action::sort | ranges::action::unique;
+            return txNums | ranges::views::transform([this](uint32_t txNum) { return Transaction(txNum, access->getChain().getBlockHeight(txNum), *access); }) | ranges::to_vector;
+        }
         return blocksci::getInputTransactions(getOutputPointers() | ranges::to_vector, *access);
     }
 }
@@ -7,6 +7,8 @@
 //
 
 #include <blocksci/chain/blockchain.hpp>
+#include <internal/chain_access.hpp>
+#include <internal/data_access.hpp>
 
 #include <range/v3/action/push_back.hpp>
 #include <range/v3/view/filter.hpp>
@@ -15,6 +17,25 @@
 
 namespace blocksci {
     
+    void BlockRange::iterator::readAhead() {
+        auto &chain = access->getChain();
+        uint64_t window = chain.readaheadWindow();
+        if (window == 0 || height >= chain.blockCount()) {
+            readaheadHeight = std::numeric_limits<BlockHeight>::max();
+            return;
+        }
+        // Requesting two windows of transactions while moving forward by one keeps a full window of lead over the iterator
+        uint64_t firstTx = chain.getBlock(height)->firstTxIndex;
+        auto prefetchEnd = std::min<uint64_t>(firstTx + 2 * window, std::numeric_limits<uint32_t>::max());
+        chain.prefetchTransactions(static_cast<uint32_t>(firstTx), static_cast<uint32_t>(prefetchEnd));
+        auto nextTx = firstTx + window;
+        if (nextTx < chain.txCount()) {
+            readaheadHeight = std::max(chain.getBlockHeight(static_cast<uint32_t>(nextTx)), height + 1);
+        } else {
+            readaheadHeight = std::numeric_limits<BlockHeight>::max();
+        }
+    }
+    
     std::vector<BlockRange> BlockRange::segment(unsigned int segmentCount) const {
         std::vector<BlockRange> segments;
         
@@ -35,6 +56,10 @@ namespace blocksci {
             auto endIt = std::lower_bound(it, chainEnd, (*it).firstTxIndex() + segmentSize, [](const Block &block, uint32_t txNum) {
                 return block.firstTxIndex() < txNum;
             });
+            // No later block starts a full segment after this one, so the remaining blocks form the last segment
+            if (endIt == chainEnd) {
+                break;
+            }
             auto startBlock = *it;
             auto endBlock = *endIt;
             segments.emplace_back(Slice{startBlock.height(), endBlock.height()}, access);
@@ -49,6 +74,79 @@ namespace blocksci {
         return segments;
     }
     
+    std::vector<BlockRange> BlockRange::taskSegments(const TaskPool &pool) const {
+        auto segmentCount = std::min<uint64_t>(static_cast<uint64_t>(pool.threadCount()) * TaskPool::tasksPerThread, static_cast<uint64_t>(size()));
+        return segment(static_cast<unsigned int>(std::max<uint64_t>(segmentCount, 1)));
+    }
+    
+    std::vector<unsigned int> BlockRange::taskSegmentNodes(const std::vector<BlockRange> &segments, unsigned int nodeCount) const {
+        // The page cache of every node then holds its own shard of the chain instead of whatever it happened to fault in
+        uint64_t chainTxCount = std::max<uint64_t>(access->getChain().txCount(), 1);
+        std::vector<unsigned int> nodes;
+        nodes.reserve(segments.size());
+        for (auto &segment : segments) {
+            uint64_t firstTx = segment.size() > 0 ? segment.firstTxIndex() : 0;
+            nodes.push_back(static_cast<unsigned int>(std::min<uint64_t>(firstTx * nodeCount / chainTxCount, nodeCount - 1)));
+        }
+        return nodes;
+    }
+    
+    NumaAccessReport BlockRange::numaAccessReport() const {
+        auto &pool = TaskPool::shared();
+        auto &topology = pool.topology();
+        auto &chain = access->getChain();
+        auto segments = taskSegments(pool);
+        auto segmentNodes = taskSegmentNodes(segments, pool.nodeCount());
+        
+        NumaAccessReport report;
+        auto stats = pool.nodeStats();
+        report.localTasks = stats.localTasks;
+        report.remoteTasks = stats.remoteTasks;
+        report.nodePages.resize(topology.nodeCount());
+        // Compressed transaction data is decompressed into buffers of the reading thread, so there is no file placement to report
+        report.pagePlacementKnown = chain.hasContiguousTxData();
+        std::vector<int> pageNodes;
+        for (size_t i = 0; report.pagePlacementKnown && i < segments.size(); i++) {
+            auto &segment = segments[i];
+            if (segment.size() == 0 || segment.endTxIndex() <= segment.firstTxIndex()) {
+                continue;
+            }
+            auto dataBegin = reinterpret_cast<const char *>(chain.getTx(segment.firstTxIndex()));
+            auto dataEnd = reinterpret_cast<const char *>(chain.getTx(segment.endTxIndex() - 1));
+            // Transaction data is laid out in tx order, anything else cannot be measured as one span
+            if (dataEnd < dataBegin) {
+                continue;
+            }
+            if (!NumaTopology::pageNodes(dataBegin, static_cast<size_t>(dataEnd - dataBegin) + 1, pageNodes)) {
+                report.pagePlacementKnown = false;
+                break;
+            }
+            auto assignedNode = topology.nodes()[segmentNodes[i]].id;
+            report.pageCount += pageNodes.size();
+            for (auto node : pageNodes) {
+                if (node < 0) {
+                    continue;
+                }
+                report.residentPages++;
+                if (node != assignedNode) {
+                    report.remotePages++;
+                }
+                for (size_t j = 0; j < topology.nodeCount(); j++) {
+                    if (topology.nodes()[j].id == node) {
+                        report.nodePages[j]++;
+                    }
+                }
+            }
+        }
+        if (!report.pagePlacementKnown) {
+            report.pageCount = 0;
+            report.residentPages = 0;
+            report.remotePages = 0;
+            std::fill(report.nodePages.begin(), report.nodePages.end(), 0);
+        }
+        return report;
+    }
+    
     std::vector<Block> BlockRange::filter(std::function<bool(const Block &block)> testFunc)  {
         auto mapFunc = [&testFunc](const BlockRange &segment) -> std::vector<Block> {
             return segment | ranges::views::filter(testFunc) | ranges::to_vector;
@@ -12,8 +12,10 @@
 
 #include <internal/address_info.hpp>
 #include <internal/chain_access.hpp>
+#include <internal/chain_watcher.hpp>
 #include <internal/data_access.hpp>
 #include <internal/script_access.hpp>
+#include <internal/warmup.hpp>
 #include <internal/address_output_range.hpp>
 
 #include <range/v3/numeric/accumulate.hpp>
@@ -22,9 +24,13 @@
 #include <range/v3/view/group_by.hpp>
 #include <range/v3/view/transform.hpp>
 
+#include <algorithm>
+
 namespace blocksci {
     
-    Blockchain::Blockchain(std::unique_ptr<DataAccess> access_) : BlockRange{{0, access_->getChain().blockCount()}, access_.get()}, access(std::move(access_)) {}
+    Blockchain::Blockchain(std::shared_ptr<DataAccess> access_) : BlockRange{{0, access_->getChain().blockCount()}, access_.get()}, access(std::move(access_)) {}
+    
+    Blockchain::Blockchain(std::unique_ptr<DataAccess> access_) : Blockchain(std::shared_ptr<DataAccess>{std::move(access_)}) {}
     
     Blockchain::Blockchain(const DataConfiguration &config) : Blockchain(std::make_unique<DataAccess>(config)) {}
     
@@ -33,14 +39,18 @@ namespace blocksci {
     Blockchain::Blockchain(const std::string &configPath) : Blockchain(configPath, BlockHeight{0}) {}
     
     
+    Blockchain::Blockchain(Blockchain &&) = default;
+    Blockchain &Blockchain::operator=(Blockchain &&) = default;
     Blockchain::~Blockchain() = default;
     
+    constexpr std::chrono::seconds Blockchain::generationGracePeriod;
+    
     std::string Blockchain::dataLocation() const {
-        return access->config.chainConfig.dataDirectory.str();
+        return std::atomic_load(&access)->config.chainConfig.dataDirectory.str();
     }
     
     std::string Blockchain::configLocation() const {
-        return access->config.configPath;
+        return std::atomic_load(&access)->config.configPath;
     }
     
     void Blockchain::reload() {
@@ -48,8 +58,81 @@ namespace blocksci {
         sl.stop = access->getChain().blockCount();
     }
 
+    Blockchain Blockchain::snapshot() const {
+        auto current = std::atomic_load(&access);
+        current->getChain().reorgCheck();
+        return Blockchain{std::move(current)};
+    }
+    
+    bool Blockchain::refresh() {
+        auto next = loadNextGeneration();
+        if (!next) {
+            return false;
+        }
+        publishGeneration(std::move(next));
+        return true;
+    }
+    
+    std::shared_ptr<DataAccess> Blockchain::loadNextGeneration() const {
+        auto current = std::atomic_load(&access);
+        if (!current->isOutdated()) {
+            return nullptr;
+        }
+        return current->nextGeneration();
+    }
+    
+    void Blockchain::publishGeneration(std::shared_ptr<DataAccess> next) {
+        if (!next) {
+            return;
+        }
+        auto now = std::chrono::steady_clock::now();
+        retiredGenerations.erase(std::remove_if(retiredGenerations.begin(), retiredGenerations.end(), [&](const auto &retired) {
+            return now - retired.first >= generationGracePeriod;
+        }), retiredGenerations.end());
+        
+        BlockRange::access = next.get();
+        sl.stop = next->getChain().blockCount();
+        retiredGenerations.emplace_back(now, std::atomic_exchange(&access, std::move(next)));
+    }
+    
+    uint64_t Blockchain::generation() const {
+        return std::atomic_load(&access)->generation;
+    }
+    
+    bool Blockchain::waitForUpdate(std::chrono::milliseconds timeout) {
+        auto next = waitForNextGeneration(timeout);
+        if (!next) {
+            return false;
+        }
+        publishGeneration(std::move(next));
+        return true;
+    }
+    
+    std::shared_ptr<DataAccess> Blockchain::waitForNextGeneration(std::chrono::milliseconds timeout) {
+        auto current = std::atomic_load(&access);
+        if (!current->watcher) {
+            current->watcher = std::make_shared<ChainWatcher>(current->config.pidFilePath());
+            seenUpdates = current->watcher->updateCount();
+        }
+        if (!isParserRunning()) {
+            if (auto next = loadNextGeneration()) {
+                return next;
+            }
+        }
+        seenUpdates = current->watcher->waitForUpdate(seenUpdates, timeout);
+        if (isParserRunning()) {
+            return nullptr;
+        }
+        return loadNextGeneration();
+    }
+    
     bool Blockchain::isParserRunning() {
-        return access->config.pidFilePath().exists();
+        return std::atomic_load(&access)->config.pidFilePath().exists();
+    }
+    
+    std::vector<WarmupFileResult> Blockchain::warmup(const WarmupSpec &spec) {
+        auto current = std::atomic_load(&access);
+        return warmupDataFiles(current->config, spec, *current->lockedFiles);
     }
     
     uint32_t txCount(Blockchain &chain) {
@@ -58,6 +141,6 @@ namespace blocksci {
     }
     
     uint32_t Blockchain::addressCount(AddressType::Enum type) const {
-        return access->getScripts().scriptCount(dedupType(type));
+        return std::atomic_load(&access)->getScripts().scriptCount(dedupType(type));
     }
 } // namespace blocksci
@@ -0,0 +1,67 @@
+//
+//  chain_scanner.cpp
+//  blocksci
+//
+
+#define BLOCKSCI_WITHOUT_SINGLETON
+
+#include <blocksci/chain/chain_scanner.hpp>
+#include <blocksci/chain/block_range.hpp>
+#include <blocksci/chain/transaction.hpp>
+#include <blocksci/chain/transaction_range.hpp>
+
+#include <internal/chain_access.hpp>
+#include <internal/data_access.hpp>
+
+#include <algorithm>
+
+namespace blocksci {
+
+    ChainScanner::ChainScanner(const BlockRange &blocks, uint8_t columns) : ChainScanner(blocks.getAccess(), blocks.size() > 0 ? blocks.firstTxIndex() : 0, blocks.size() > 0 ? blocks.endTxIndex() : 0, columns) {}
+
+    ChainScanner::ChainScanner(DataAccess &access_, uint32_t beginTx_, uint32_t endTx_, uint8_t columns) : access(&access_), beginTx(beginTx_), endTx(endTx_) {
+        auto &chain = access->getChain();
+        endTx = std::min(endTx, static_cast<uint32_t>(chain.txCount()));
+        beginTx = std::min(beginTx, endTx);
+        current.txNum = beginTx;
+        if (beginTx == endTx) {
+            return;
+        }
+
+        auto data = chain.getTxData(beginTx);
+        current.raw = data.rawTx;
+        contiguousData = chain.hasContiguousTxData();
+        current.height = chain.getBlockHeight(beginTx);
+        current.firstInputNum = chain.firstInputNum(beginTx);
+        current.firstOutputNum = chain.firstOutputNum(beginTx);
+        current.version = (columns & ScanColumn::Version) ? data.version : nullptr;
+        current.hash = (columns & ScanColumn::Hash) ? data.hash : nullptr;
+        current.sequenceNumbers = (columns & ScanColumn::Sequence) ? data.sequenceNumbers : nullptr;
+        current.spentOutputNums = (columns & ScanColumn::SpentOutputNum) ? data.spentOutputNums : nullptr;
+
+        blocks = chain.getBlock(0);
+        nextBlockTx = blocks[current.height].firstTxIndex + blocks[current.height].txCount;
+        readAhead();
+    }
+
+    Transaction ChainScanner::transaction() const {
+        return {access->getChain().getTxData(current.txNum), current.txNum, current.height, static_cast<uint32_t>(access->getChain().txCount()), *access};
+    }
+
+    void ChainScanner::loadRaw() {
+        current.raw = access->getChain().getTx(current.txNum);
+    }
+
+    void ChainScanner::readAhead() {
+        auto &chain = access->getChain();
+        uint64_t window = chain.readaheadWindow();
+        if (window == 0 || endTx - current.txNum < TransactionRange::readaheadMinSize) {
+            readaheadTx = std::numeric_limits<uint32_t>::max();
+            return;
+        }
+        // Requesting two windows while moving forward by one keeps a full window of lead over the scanner
+        auto prefetchEnd = std::min<uint64_t>(current.txNum + 2 * window, endTx);
+        chain.prefetchTransactions(current.txNum, static_cast<uint32_t>(prefetchEnd));
+        readaheadTx = static_cast<uint32_t>(std::min<uint64_t>(current.txNum + window, std::numeric_limits<uint32_t>::max()));
+    }
+} // namespace blocksci
@@ -0,0 +1,758 @@
+//
+//  inout_kernels.cpp
+//  blocksci
+//
+
+#define BLOCKSCI_WITHOUT_SINGLETON
+
+#include <blocksci/chain/inout_kernels.hpp>
+
+#include <internal/chain_access.hpp>
+#include <internal/data_access.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <stdexcept>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define BLOCKSCI_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+// The vector kernels are compiled for their instruction set with target attributes and only called after the CPU has
+// been checked, so the library itself still runs on any x86-64 CPU
+#define BLOCKSCI_TARGET_AVX2 __attribute__((target("avx2,popcnt")))
+#define BLOCKSCI_TARGET_AVX512 __attribute__((target("avx512f,avx512vl,avx512bw,popcnt")))
+
+namespace blocksci {
+
+    // The vector kernels load Inout records directly: linkedTxNum and toAddressNum in the low and other in the high
+    // 64 bits of each 16 byte record
+    static_assert(sizeof(Inout) == 16, "Inout kernels depend on the layout of Inout");
+
+    namespace {
+        constexpr uint64_t valueMask = (uint64_t(1) << 60) - 1;
+
+        // Below this count the setup and the horizontal reduction of a vector loop cost more than they save
+        constexpr size_t minVectorCount = 16;
+
+        /* Scalar kernels, used for short runs and on CPUs without AVX2 */
+
+        void extractValuesScalar(const Inout *inouts, size_t count, int64_t *values) {
+            for (size_t i = 0; i < count; i++) {
+                values[i] = inouts[i].getValue();
+            }
+        }
+
+        int64_t sumInoutsScalar(const Inout *inouts, size_t count) {
+            int64_t total = 0;
+            for (size_t i = 0; i < count; i++) {
+                total += inouts[i].getValue();
+            }
+            return total;
+        }
+
+        int64_t sumColumnScalar(const int64_t *values, size_t count) {
+            int64_t total = 0;
+            for (size_t i = 0; i < count; i++) {
+                total += values[i];
+            }
+            return total;
+        }
+
+        template <bool isMax>
+        int64_t extremeIdentity() {
+            return isMax ? std::numeric_limits<int64_t>::min() : std::numeric_limits<int64_t>::max();
+        }
+
+        template <bool isMax>
+        int64_t extremeInoutsScalar(const Inout *inouts, size_t count) {
+            auto result = extremeIdentity<isMax>();
+            for (size_t i = 0; i < count; i++) {
+                auto value = inouts[i].getValue();
+                result = isMax ? std::max(result, value) : std::min(result, value);
+            }
+            return result;
+        }
+
+        template <bool isMax>
+        int64_t extremeColumnScalar(const int64_t *values, size_t count) {
+            auto result = extremeIdentity<isMax>();
+            for (size_t i = 0; i < count; i++) {
+                result = isMax ? std::max(result, values[i]) : std::min(result, values[i]);
+            }
+            return result;
+        }
+
+        void countInoutTypesScalar(const Inout *inouts, size_t count, TypeCounts &counts) {
+            for (size_t i = 0; i < count; i++) {
+                auto type = static_cast<size_t>(inouts[i].getType());
+                if (type < AddressType::size) {
+                    counts[type]++;
+                }
+            }
+        }
+
+        void countColumnTypesScalar(const uint8_t *types, size_t count, TypeCounts &counts) {
+            for (size_t i = 0; i < count; i++) {
+                if (types[i] < AddressType::size) {
+                    counts[types[i]]++;
+                }
+            }
+        }
+
+        // The vector type counts keep a 6 bit counter per type in every 64 bit lane, adding 1 << (6 * type) for each
+        // record. Shifts of invalid types either land in the unused top bits or move the 1 out of the lane. The counters
+        // are folded into the totals before they can overflow.
+        constexpr size_t packedCountBits = 6;
+        constexpr size_t packedCountMaxSteps = (size_t(1) << packedCountBits) - 1;
+        static_assert(AddressType::size * packedCountBits <= 64, "Packed type counters have to fit into 64 bits");
+
+        void addPackedTypeCounts(const uint64_t *lanes, size_t laneCount, TypeCounts &counts) {
+            for (size_t lane = 0; lane < laneCount; lane++) {
+                for (size_t type = 0; type < AddressType::size; type++) {
+                    counts[type] += (lanes[lane] >> (type * packedCountBits)) & packedCountMaxSteps;
+                }
+            }
+        }
+
+        template <bool greater>
+        bool passes(int64_t value, int64_t threshold) {
+            return greater ? value > threshold : value < threshold;
+        }
+
+        // The selection vector kernels write every candidate index and only advance past the ones that pass, which
+        // never writes beyond the current index and avoids a branch per entry
+        template <bool greater>
+        size_t selectInoutsScalar(const Inout *inouts, size_t count, int64_t threshold, uint32_t *selection, size_t first = 0, size_t selected = 0) {
+            for (size_t i = first; i < count; i++) {
+                selection[selected] = static_cast<uint32_t>(i);
+                selected += passes<greater>(inouts[i].getValue(), threshold);
+            }
+            return selected;
+        }
+
+        template <bool greater>
+        size_t selectColumnScalar(const int64_t *values, size_t count, int64_t threshold, uint32_t *selection, size_t first = 0, size_t selected = 0) {
+            for (size_t i = first; i < count; i++) {
+                selection[selected] = static_cast<uint32_t>(i);
+                selected += passes<greater>(values[i], threshold);
+            }
+            return selected;
+        }
+
+        struct KernelTable {
+            SimdIsa isa;
+            void (*extractValues)(const Inout *, size_t, int64_t *);
+            int64_t (*sumInouts)(const Inout *, size_t);
+            int64_t (*sumColumn)(const int64_t *, size_t);
+            int64_t (*minInouts)(const Inout *, size_t);
+            int64_t (*minColumn)(const int64_t *, size_t);
+            int64_t (*maxInouts)(const Inout *, size_t);
+            int64_t (*maxColumn)(const int64_t *, size_t);
+            void (*countInoutTypes)(const Inout *, size_t, TypeCounts &);
+            void (*countColumnTypes)(const uint8_t *, size_t, TypeCounts &);
+            size_t (*selectInoutsGreater)(const Inout *, size_t, int64_t, uint32_t *, size_t, size_t);
+            size_t (*selectColumnGreater)(const int64_t *, size_t, int64_t, uint32_t *, size_t, size_t);
+            size_t (*selectInoutsLess)(const Inout *, size_t, int64_t, uint32_t *, size_t, size_t);
+            size_t (*selectColumnLess)(const int64_t *, size_t, int64_t, uint32_t *, size_t, size_t);
+        };
+
+        const KernelTable scalarKernels = {
+            SimdIsa::Scalar,
+            extractValuesScalar,
+            sumInoutsScalar,
+            sumColumnScalar,
+            extremeInoutsScalar<false>,
+            extremeColumnScalar<false>,
+            extremeInoutsScalar<true>,
+            extremeColumnScalar<true>,
+            countInoutTypesScalar,
+            countColumnTypesScalar,
+            selectInoutsScalar<true>,
+            selectColumnScalar<true>,
+            selectInoutsScalar<false>,
+            selectColumnScalar<false>
+        };
+
+        #ifdef BLOCKSCI_X86_KERNELS
+
+        /* AVX2 kernels, 4 values per vector */
+
+        // The other fields of 4 records, in the order 0, 2, 1, 3 since the unpack works within 128 bit lanes
+        BLOCKSCI_TARGET_AVX2 inline __m256i othersUnorderedAvx2(const Inout *inouts) {
+            auto records = reinterpret_cast<const __m256i *>(inouts);
+            return _mm256_unpackhi_epi64(_mm256_loadu_si256(records), _mm256_loadu_si256(records + 1));
+        }
+
+        BLOCKSCI_TARGET_AVX2 inline __m256i othersAvx2(const Inout *inouts) {
+            return _mm256_permute4x64_epi64(othersUnorderedAvx2(inouts), 0xD8);
+        }
+
+        BLOCKSCI_TARGET_AVX2 inline int64_t reduceAddAvx2(__m256i v) {
+            auto sum = _mm_add_epi64(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+            return _mm_cvtsi128_si64(_mm_add_epi64(sum, _mm_unpackhi_epi64(sum, sum)));
+        }
+
+        template <bool isMax>
+        BLOCKSCI_TARGET_AVX2 inline __m256i pickAvx2(__m256i a, __m256i b) {
+            auto aGreater = _mm256_cmpgt_epi64(a, b);
+            return isMax ? _mm256_blendv_epi8(b, a, aGreater) : _mm256_blendv_epi8(a, b, aGreater);
+        }
+
+        template <bool isMax>
+        BLOCKSCI_TARGET_AVX2 inline int64_t reduceExtremeAvx2(__m256i v) {
+            alignas(32) int64_t lanes[4];
+            _mm256_store_si256(reinterpret_cast<__m256i *>(lanes), v);
+            return isMax ? std::max(std::max(lanes[0], lanes[1]), std::max(lanes[2], lanes[3])) : std::min(std::min(lanes[0], lanes[1]), std::min(lanes[2], lanes[3]));
+        }
+
+        BLOCKSCI_TARGET_AVX2 void extractValuesAvx2(const Inout *inouts, size_t count, int64_t *values) {
+            auto mask = _mm256_set1_epi64x(static_cast<int64_t>(valueMask));
+            size_t i = 0;
+            for (; i + 4 <= count; i += 4) {
+                _mm256_storeu_si256(reinterpret_cast<__m256i *>(values + i), _mm256_and_si256(othersAvx2(inouts + i), mask));
+            }
+            extractValuesScalar(inouts + i, count - i, values + i);
+        }
+
+        BLOCKSCI_TARGET_AVX2 int64_t sumInoutsAvx2(const Inout *inouts, size_t count) {
+            auto mask = _mm256_set1_epi64x(static_cast<int64_t>(valueMask));
+            auto sum0 = _mm256_setzero_si256();
+            auto sum1 = _mm256_setzero_si256();
+            size_t i = 0;
+            for (; i + 8 <= count; i += 8) {
+                sum0 = _mm256_add_epi64(sum0, _mm256_and_si256(othersUnorderedAvx2(inouts + i), mask));
+                sum1 = _mm256_add_epi64(sum1, _mm256_and_si256(othersUnorderedAvx2(inouts + i + 4), mask));
+            }
+            for (; i + 4 <= count; i += 4) {
+                sum0 = _mm256_add_epi64(sum0, _mm256_and_si256(othersUnorderedAvx2(inouts + i), mask));
+            }
+            return reduceAddAvx2(_mm256_add_epi64(sum0, sum1)) + sumInoutsScalar(inouts + i, count - i);
+        }
+
+        BLOCKSCI_TARGET_AVX2 int64_t sumColumnAvx2(const int64_t *values, size_t count) {
+            auto sum0 = _mm256_setzero_si256();
+            auto sum1 = _mm256_setzero_si256();
+            size_t i = 0;
+            for (; i + 8 <= count; i += 8) {
+                sum0 = _mm256_add_epi64(sum0, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(values + i)));
+                sum1 = _mm256_add_epi64(sum1, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(values + i + 4)));
+            }
+            for (; i + 4 <= count; i += 4) {
+                sum0 = _mm256_add_epi64(sum0, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(values + i)));
+            }
+            return reduceAddAvx2(_mm256_add_epi64(sum0, sum1)) + sumColumnScalar(values + i, count - i);
+        }
+
+        template <bool isMax>
+        BLOCKSCI_TARGET_AVX2 int64_t extremeInoutsAvx2(const Inout *inouts, size_t count) {
+            auto mask = _mm256_set1_epi64x(static_cast<int64_t>(valueMask));
+            auto result = _mm256_set1_epi64x(extremeIdentity<isMax>());
+            size_t i = 0;
+            for (; i + 4 <= count; i += 4) {
+                result = pickAvx2<isMax>(result, _mm256_and_si256(othersUnorderedAvx2(inouts + i), mask));
+            }
+            auto tail = extremeInoutsScalar<isMax>(inouts + i, count - i);
+            auto vectorResult = reduceExtremeAvx2<isMax>(result);
+            return isMax ? std::max(vectorResult, tail) : std::min(vectorResult, tail);
+        }
+
+        template <bool isMax>
+        BLOCKSCI_TARGET_AVX2 int64_t extremeColumnAvx2(const int64_t *values, size_t count) {
+            auto result = _mm256_set1_epi64x(extremeIdentity<isMax>());
+            size_t i = 0;
+            for (; i + 4 <= count; i += 4) {
+                result = pickAvx2<isMax>(result, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(values + i)));
+            }
+            auto tail = extremeColumnScalar<isMax>(values + i, count - i);
+            auto vectorResult = reduceExtremeAvx2<isMax>(result);
+            return isMax ? std::max(vectorResult, tail) : std::min(vectorResult, tail);
+        }
+
+        BLOCKSCI_TARGET_AVX2 void countInoutTypesAvx2(const Inout *inouts, size_t count, TypeCounts &counts) {
+            auto one = _mm256_set1_epi64x(1);
+            size_t i = 0;
+            while (i + 4 <= count) {
+                auto packed = _mm256_setzero_si256();
+                for (size_t step = 0; step < packedCountMaxSteps && i + 4 <= count; step++, i += 4) {
+                    auto types = _mm256_srli_epi64(othersUnorderedAvx2(inouts + i), 60);
+                    auto shifts = _mm256_add_epi64(_mm256_slli_epi64(types, 2), _mm256_slli_epi64(types, 1));
+                    packed = _mm256_add_epi64(packed, _mm256_sllv_epi64(one, shifts));
+                }
+                alignas(32) uint64_t lanes[4];
+                _mm256_store_si256(reinterpret_cast<__m256i *>(lanes), packed);
+                addPackedTypeCounts(lanes, 4, counts);
+            }
+            countInoutTypesScalar(inouts + i, count - i, counts);
+        }
+
+        // Byte wide counters per type, folded into the totals with a sum of absolute differences before they can overflow
+        BLOCKSCI_TARGET_AVX2 void countColumnTypesAvx2(const uint8_t *types, size_t count, TypeCounts &counts) {
+            constexpr size_t maxBlockSteps = 255;
+            size_t i = 0;
+            while (i + 32 <= count) {
+                __m256i typeCounts[AddressType::size];
+                for (auto &typeCount : typeCounts) {
+                    typeCount = _mm256_setzero_si256();
+                }
+                for (size_t step = 0; step < maxBlockSteps && i + 32 <= count; step++, i += 32) {
+                    auto chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(types + i));
+                    for (size_t type = 0; type < AddressType::size; type++) {
+                        typeCounts[type] = _mm256_sub_epi8(typeCounts[type], _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8(static_cast<char>(type))));
+                    }
+                }
+                for (size_t type = 0; type < AddressType::size; type++) {
+                    counts[type] += static_cast<uint64_t>(reduceAddAvx2(_mm256_sad_epu8(typeCounts[type], _mm256_setzero_si256())));
+                }
+            }
+            countColumnTypesScalar(types + i, count - i, counts);
+        }
+
+        // For every 4 bit compare mask, the byte shuffle that moves the indexes of the set lanes to the front
+        struct CompressTable {
+            alignas(16) uint8_t shuffles[16][16];
+
+            CompressTable() : shuffles{} {
+                for (unsigned int mask = 0; mask < 16; mask++) {
+                    unsigned int position = 0;
+                    for (unsigned int lane = 0; lane < 4; lane++) {
+                        if (mask & (1u << lane)) {
+                            for (unsigned int byte = 0; byte < 4; byte++) {
+                                shuffles[mask][position * 4 + byte] = static_cast<uint8_t>(lane * 4 + byte);
+                            }
+                            position++;
+                        }
+                    }
+                }
+            }
+        };
+
+        const CompressTable compressTable;
+
+        template <bool greater>
+        BLOCKSCI_TARGET_AVX2 inline size_t storeSelectionAvx2(__m256i values, __m256i threshold, size_t i, uint32_t *selection, size_t selected) {
+            auto compare = greater ? _mm256_cmpgt_epi64(values, threshold) : _mm256_cmpgt_epi64(threshold, values);
+            auto mask = static_cast<unsigned int>(_mm256_movemask_pd(_mm256_castsi256_pd(compare)));
+            auto indexes = _mm_add_epi32(_mm_set1_epi32(static_cast<int>(i)), _mm_setr_epi32(0, 1, 2, 3));
+            auto shuffle = _mm_load_si128(reinterpret_cast<const __m128i *>(compressTable.shuffles[mask]));
+            // Writes all 4 slots, the ones past the selected indexes are overwritten later or lie beyond the result
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(selection + selected), _mm_shuffle_epi8(indexes, shuffle));
+            return selected + static_cast<size_t>(__builtin_popcount(mask));
+        }
+
+        template <bool greater>
+        BLOCKSCI_TARGET_AVX2 size_t selectInoutsAvx2(const Inout *inouts, size_t count, int64_t threshold, uint32_t *selection, size_t, size_t) {
+            auto mask = _mm256_set1_epi64x(static_cast<int64_t>(valueMask));
+            auto thresholds = _mm256_set1_epi64x(threshold);
+            size_t selected = 0;
+            size_t i = 0;
+            for (; i + 4 <= count; i += 4) {
+                selected = storeSelectionAvx2<greater>(_mm256_and_si256(othersAvx2(inouts + i), mask), thresholds, i, selection, selected);
+            }
+            return selectInoutsScalar<greater>(inouts, count, threshold, selection, i, selected);
+        }
+
+        template <bool greater>
+        BLOCKSCI_TARGET_AVX2 size_t selectColumnAvx2(const int64_t *values, size_t count, int64_t threshold, uint32_t *selection, size_t, size_t) {
+            auto thresholds = _mm256_set1_epi64x(threshold);
+            size_t selected = 0;
+            size_t i = 0;
+            for (; i + 4 <= count; i += 4) {
+                selected = storeSelectionAvx2<greater>(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(values + i)), thresholds, i, selection, selected);
+            }
+            return selectColumnScalar<greater>(values, count, threshold, selection, i, selected);
+        }
+
+        const KernelTable avx2Kernels = {
+            SimdIsa::AVX2,
+            extractValuesAvx2,
+            sumInoutsAvx2,
+            sumColumnAvx2,
+            extremeInoutsAvx2<false>,
+            extremeColumnAvx2<false>,
+            extremeInoutsAvx2<true>,
+            extremeColumnAvx2<true>,
+            countInoutTypesAvx2,
+            countColumnTypesAvx2,
+            selectInoutsAvx2<true>,
+            selectColumnAvx2<true>,
+            selectInoutsAvx2<false>,
+            selectColumnAvx2<false>
+        };
+
+        /* AVX-512 kernels, 8 values per vector */
+
+        // The other fields of 8 records in order
+        BLOCKSCI_TARGET_AVX512 inline __m512i othersAvx512(const Inout *inouts) {
+            auto records = reinterpret_cast<const __m512i *>(inouts);
+            auto oddQwords = _mm512_setr_epi64(1, 3, 5, 7, 9, 11, 13, 15);
+            return _mm512_permutex2var_epi64(_mm512_loadu_si512(records), oddQwords, _mm512_loadu_si512(records + 1));
+        }
+
+        BLOCKSCI_TARGET_AVX512 inline __m512i valuesAvx512(const Inout *inouts) {
+            return _mm512_and_si512(othersAvx512(inouts), _mm512_set1_epi64(static_cast<int64_t>(valueMask)));
+        }
+
+        BLOCKSCI_TARGET_AVX512 inline __m512i loadColumnAvx512(const int64_t *values) {
+            return _mm512_loadu_si512(values);
+        }
+
+        BLOCKSCI_TARGET_AVX512 void extractValuesAvx512(const Inout *inouts, size_t count, int64_t *values) {
+            size_t i = 0;
+            for (; i + 8 <= count; i += 8) {
+                _mm512_storeu_si512(values + i, valuesAvx512(inouts + i));
+            }
+            extractValuesScalar(inouts + i, count - i, values + i);
+        }
+
+        BLOCKSCI_TARGET_AVX512 int64_t sumInoutsAvx512(const Inout *inouts, size_t count) {
+            auto sum0 = _mm512_setzero_si512();
+            auto sum1 = _mm512_setzero_si512();
+            size_t i = 0;
+            for (; i + 16 <= count; i += 16) {
+                sum0 = _mm512_add_epi64(sum0, valuesAvx512(inouts + i));
+                sum1 = _mm512_add_epi64(sum1, valuesAvx512(inouts + i + 8));
+            }
+            for (; i + 8 <= count; i += 8) {
+                sum0 = _mm512_add_epi64(sum0, valuesAvx512(inouts + i));
+            }
+            return _mm512_reduce_add_epi64(_mm512_add_epi64(sum0, sum1)) + sumInoutsScalar(inouts + i, count - i);
+        }
+
+        BLOCKSCI_TARGET_AVX512 int64_t sumColumnAvx512(const int64_t *values, size_t count) {
+            auto sum0 = _mm512_setzero_si512();
+            auto sum1 = _mm512_setzero_si512();
+            size_t i = 0;
+            for (; i + 16 <= count; i += 16) {
+                sum0 = _mm512_add_epi64(sum0, loadColumnAvx512(values + i));
+                sum1 = _mm512_add_epi64(sum1, loadColumnAvx512(values + i + 8));
+            }
+            for (; i + 8 <= count; i += 8) {
+                sum0 = _mm512_add_epi64(sum0, loadColumnAvx512(values + i));
+            }
+            return _mm512_reduce_add_epi64(_mm512_add_epi64(sum0, sum1)) + sumColumnScalar(values + i, count - i);
+        }
+
+        template <bool isMax>
+        BLOCKSCI_TARGET_AVX512 inline __m512i pickAvx512(__m512i a, __m512i b) {
+            return isMax ? _mm512_max_epi64(a, b) : _mm512_min_epi64(a, b);
+        }
+
+        template <bool isMax>
+        BLOCKSCI_TARGET_AVX512 inline int64_t reduceExtremeAvx512(__m512i v) {
+            return isMax ? _mm512_reduce_max_epi64(v) : _mm512_reduce_min_epi64(v);
+        }
+
+        template <bool isMax>
+        BLOCKSCI_TARGET_AVX512 int64_t extremeInoutsAvx512(const Inout *inouts, size_t count) {
+            auto result = _mm512_set1_epi64(extremeIdentity<isMax>());
+            size_t i = 0;
+            for (; i + 8 <= count; i += 8) {
+                result = pickAvx512<isMax>(result, valuesAvx512(inouts + i));
+            }
+            auto tail = extremeInoutsScalar<isMax>(inouts + i, count - i);
+            auto vectorResult = reduceExtremeAvx512<isMax>(result);
+            return isMax ? std::max(vectorResult, tail) : std::min(vectorResult, tail);
+        }
+
+        template <bool isMax>
+        BLOCKSCI_TARGET_AVX512 int64_t extremeColumnAvx512(const int64_t *values, size_t count) {
+            auto result = _mm512_set1_epi64(extremeIdentity<isMax>());
+            size_t i = 0;
+            for (; i + 8 <= count; i += 8) {
+                result = pickAvx512<isMax>(result, loadColumnAvx512(values + i));
+            }
+            auto tail = extremeColumnScalar<isMax>(values + i, count - i);
+            auto vectorResult = reduceExtremeAvx512<isMax>(result);
+            return isMax ? std::max(vectorResult, tail) : std::min(vectorResult, tail);
+        }
+
+        BLOCKSCI_TARGET_AVX512 void countInoutTypesAvx512(const Inout *inouts, size_t count, TypeCounts &counts) {
+            auto one = _mm512_set1_epi64(1);
+            size_t i = 0;
+            while (i + 8 <= count) {
+                auto packed = _mm512_setzero_si512();
+                for (size_t step = 0; step < packedCountMaxSteps && i + 8 <= count; step++, i += 8) {
+                    auto types = _mm512_srli_epi64(othersAvx512(inouts + i), 60);
+                    auto shifts = _mm512_add_epi64(_mm512_slli_epi64(types, 2), _mm512_slli_epi64(types, 1));
+                    packed = _mm512_add_epi64(packed, _mm512_sllv_epi64(one, shifts));
+                }
+                alignas(64) uint64_t lanes[8];
+                _mm512_store_si512(lanes, packed);
+                addPackedTypeCounts(lanes, 8, counts);
+            }
+            countInoutTypesScalar(inouts + i, count - i, counts);
+        }
+
+        BLOCKSCI_TARGET_AVX512 void countColumnTypesAvx512(const uint8_t *types, size_t count, TypeCounts &counts) {
+            TypeCounts vectorCounts{};
+            size_t i = 0;
+            for (; i + 64 <= count; i += 64) {
+                auto chunk = _mm512_loadu_si512(types + i);
+                for (size_t type = 0; type < AddressType::size; type++) {
+                    auto matches = _mm512_cmpeq_epi8_mask(chunk, _mm512_set1_epi8(static_cast<char>(type)));
+                    vectorCounts[type] += static_cast<uint64_t>(__builtin_popcountll(matches));
+                }
+            }
+            for (size_t type = 0; type < AddressType::size; type++) {
+                counts[type] += vectorCounts[type];
+            }
+            countColumnTypesScalar(types + i, count - i, counts);
+        }
+
+        template <bool greater>
+        BLOCKSCI_TARGET_AVX512 inline size_t storeSelectionAvx512(__m512i values, __m512i threshold, size_t i, uint32_t *selection, size_t selected) {
+            auto mask = greater ? _mm512_cmpgt_epi64_mask(values, threshold) : _mm512_cmplt_epi64_mask(values, threshold);
+            auto indexes = _mm256_add_epi32(_mm256_set1_epi32(static_cast<int>(i)), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+            // Compressing in a register and storing all 8 slots is much faster than a compressing store on some CPUs
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(selection + selected), _mm256_maskz_compress_epi32(mask, indexes));
+            return selected + static_cast<size_t>(__builtin_popcount(mask));
+        }
+
+        template <bool greater>
+        BLOCKSCI_TARGET_AVX512 size_t selectInoutsAvx512(const Inout *inouts, size_t count, int64_t threshold, uint32_t *selection, size_t, size_t) {
+            auto thresholds = _mm512_set1_epi64(threshold);
+            size_t selected = 0;
+            size_t i = 0;
+            for (; i + 8 <= count; i += 8) {
+                selected = storeSelectionAvx512<greater>(valuesAvx512(inouts + i), thresholds, i, selection, selected);
+            }
+            return selectInoutsScalar<greater>(inouts, count, threshold, selection, i, selected);
+        }
+
+        template <bool greater>
+        BLOCKSCI_TARGET_AVX512 size_t selectColumnAvx512(const int64_t *values, size_t count, int64_t threshold, uint32_t *selection, size_t, size_t) {
+            auto thresholds = _mm512_set1_epi64(threshold);
+            size_t selected = 0;
+            size_t i = 0;
+            for (; i + 8 <= count; i += 8) {
+                selected = storeSelectionAvx512<greater>(loadColumnAvx512(values + i), thresholds, i, selection, selected);
+            }
+            return selectColumnScalar<greater>(values, count, threshold, selection, i, selected);
+        }
+
+        const KernelTable avx512Kernels = {
+            SimdIsa::AVX512,
+            extractValuesAvx512,
+            sumInoutsAvx512,
+            sumColumnAvx512,
+            extremeInoutsAvx512<false>,
+            extremeColumnAvx512<false>,
+            extremeInoutsAvx512<true>,
+            extremeColumnAvx512<true>,
+            countInoutTypesAvx512,
+            countColumnTypesAvx512,
+            selectInoutsAvx512<true>,
+            selectColumnAvx512<true>,
+            selectInoutsAvx512<false>,
+            selectColumnAvx512<false>
+        };
+
+        #endif
+
+        const KernelTable &kernelsFor(SimdIsa isa) {
+            switch (isa) {
+                #ifdef BLOCKSCI_X86_KERNELS
+                case SimdIsa::AVX512:
+                    return avx512Kernels;
+                case SimdIsa::AVX2:
+                    return avx2Kernels;
+                #endif
+                default:
+                    return scalarKernels;
+            }
+        }
+
+        std::atomic<const KernelTable *> activeKernels{nullptr};
+
+        const KernelTable &activeTable() {
+            auto table = activeKernels.load(std::memory_order_relaxed);
+            if (table == nullptr) {
+                table = &kernelsFor(detectedSimdIsa());
+                activeKernels.store(table, std::memory_order_relaxed);
+            }
+            return *table;
+        }
+
+        void checkSelectionCount(size_t count) {
+            if (count > std::numeric_limits<uint32_t>::max()) {
+                throw std::invalid_argument("Selection vectors hold 32 bit indexes, select in chunks of less than 2^32 entries");
+            }
+        }
+    } // namespace
+
+    const char *simdIsaName(SimdIsa isa) {
+        switch (isa) {
+            case SimdIsa::AVX2:
+                return "avx2";
+            case SimdIsa::AVX512:
+                return "avx512";
+            default:
+                return "scalar";
+        }
+    }
+
+    SimdIsa detectedSimdIsa() {
+        static const SimdIsa isa = [] {
+            #ifdef BLOCKSCI_X86_KERNELS
+            __builtin_cpu_init();
+            if (!__builtin_cpu_supports("popcnt")) {
+                return SimdIsa::Scalar;
+            }
+            if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512vl") && __builtin_cpu_supports("avx512bw")) {
+                return SimdIsa::AVX512;
+            }
+            if (__builtin_cpu_supports("avx2")) {
+                return SimdIsa::AVX2;
+            }
+            #endif
+            return SimdIsa::Scalar;
+        }();
+        return isa;
+    }
+
+    SimdIsa activeSimdIsa() {
+        return activeTable().isa;
+    }
+
+    SimdIsa setActiveSimdIsa(SimdIsa isa) {
+        auto &table = kernelsFor(std::min(isa, detectedSimdIsa()));
+        activeKernels.store(&table, std::memory_order_relaxed);
+        return table.isa;
+    }
+
+    namespace kernels {
+        void extractValues(const Inout *inouts, size_t count, int64_t *values) {
+            if (count < minVectorCount) {
+                extractValuesScalar(inouts, count, values);
+            } else {
+                activeTable().extractValues(inouts, count, values);
+            }
+        }
+
+        int64_t sumValues(const Inout *inouts, size_t count) {
+            return count < minVectorCount ? sumInoutsScalar(inouts, count) : activeTable().sumInouts(inouts, count);
+        }
+
+        int64_t sumValues(const int64_t *values, size_t count) {
+            return count < minVectorCount ? sumColumnScalar(values, count) : activeTable().sumColumn(values, count);
+        }
+
+        int64_t minValue(const Inout *inouts, size_t count) {
+            return count < minVectorCount ? extremeInoutsScalar<false>(inouts, count) : activeTable().minInouts(inouts, count);
+        }
+
+        int64_t minValue(const int64_t *values, size_t count) {
+            return count < minVectorCount ? extremeColumnScalar<false>(values, count) : activeTable().minColumn(values, count);
+        }
+
+        int64_t maxValue(const Inout *inouts, size_t count) {
+            return count < minVectorCount ? extremeInoutsScalar<true>(inouts, count) : activeTable().maxInouts(inouts, count);
+        }
+
+        int64_t maxValue(const int64_t *values, size_t count) {
+            return count < minVectorCount ? extremeColumnScalar<true>(values, count) : activeTable().maxColumn(values, count);
+        }
+
+        void countTypes(const Inout *inouts, size_t count, TypeCounts &counts) {
+            if (count < minVectorCount) {
+                countInoutTypesScalar(inouts, count, counts);
+            } else {
+                activeTable().countInoutTypes(inouts, count, counts);
+            }
+        }
+
+        void countTypes(const uint8_t *types, size_t count, TypeCounts &counts) {
+            if (count < minVectorCount) {
+                countColumnTypesScalar(types, count, counts);
+            } else {
+                activeTable().countColumnTypes(types, count, counts);
+            }
+        }
+
+        size_t selectValuesGreaterThan(const Inout *inouts, size_t count, int64_t threshold, uint32_t *selection) {
+            checkSelectionCount(count);
+            return count < minVectorCount ? selectInoutsScalar<true>(inouts, count, threshold, selection) : activeTable().selectInoutsGreater(inouts, count, threshold, selection, 0, 0);
+        }
+
+        size_t selectValuesGreaterThan(const int64_t *values, size_t count, int64_t threshold, uint32_t *selection) {
+            checkSelectionCount(count);
+            return count < minVectorCount ? selectColumnScalar<true>(values, count, threshold, selection) : activeTable().selectColumnGreater(values, count, threshold, selection, 0, 0);
+        }
+
+        size_t selectValuesLessThan(const Inout *inouts, size_t count, int64_t threshold, uint32_t *selection) {
+            checkSelectionCount(count);
+            return count < minVectorCount ? selectInoutsScalar<false>(inouts, count, threshold, selection) : activeTable().selectInoutsLess(inouts, count, threshold, selection, 0, 0);
+        }
+
+        size_t selectValuesLessThan(const int64_t *values, size_t count, int64_t threshold, uint32_t *selection) {
+            checkSelectionCount(count);
+            return count < minVectorCount ? selectColumnScalar<false>(values, count, threshold, selection) : activeTable().selectColumnLess(values, count, threshold, selection, 0, 0);
+        }
+
+        int64_t totalInputValue(DataAccess &access, uint32_t beginTx, uint32_t endTx) {
+            auto &chain = access.getChain();
+            endTx = std::min(endTx, static_cast<uint32_t>(chain.txCount()));
+            if (beginTx >= endTx) {
+                return 0;
+            }
+            if (chain.hasInoutColumns()) {
+                auto firstInput = chain.firstInputNum(beginTx);
+                return sumValues(chain.getInputColumns(firstInput, chain.firstInputNum(endTx) - firstInput));
+            }
+            int64_t total = 0;
+            for (ChainScanner scanner(access, beginTx, endTx); scanner.next();) {
+                total += sumValues(scanner.tx().inputs());
+            }
+            return total;
+        }
+
+        int64_t totalOutputValue(DataAccess &access, uint32_t beginTx, uint32_t endTx) {
+            auto &chain = access.getChain();
+            endTx = std::min(endTx, static_cast<uint32_t>(chain.txCount()));
+            if (beginTx >= endTx) {
+                return 0;
+            }
+            if (chain.hasInoutColumns()) {
+                auto firstOutput = chain.firstOutputNum(beginTx);
+                return sumValues(chain.getOutputColumns(firstOutput, chain.firstOutputNum(endTx) - firstOutput));
+            }
+            int64_t total = 0;
+            for (ChainScanner scanner(access, beginTx, endTx); scanner.next();) {
+                total += sumValues(scanner.tx().outputs());
+            }
+            return total;
+        }
+
+        int64_t totalFee(DataAccess &access, uint32_t beginTx, uint32_t endTx) {
+            auto &chain = access.getChain();
+            endTx = std::min(endTx, static_cast<uint32_t>(chain.txCount()));
+            if (beginTx >= endTx) {
+                return 0;
+            }
+            if (chain.hasInoutColumns()) {
+                // Coinbase transactions have no fee, their outputs are the only ones not paid for by inputs
+                int64_t coinbaseOutputValue = 0;
+                auto lastHeight = chain.getBlockHeight(endTx - 1);
+                for (auto height = chain.getBlockHeight(beginTx); height <= lastHeight; height++) {
+                    auto coinbaseTx = chain.getBlock(height)->firstTxIndex;
+                    if (coinbaseTx >= beginTx && coinbaseTx < endTx) {
+                        auto firstOutput = chain.firstOutputNum(coinbaseTx);
+                        coinbaseOutputValue += sumValues(chain.getOutputColumns(firstOutput, chain.firstOutputNum(coinbaseTx + 1) - firstOutput));
+                    }
+                }
+                return totalInputValue(access, beginTx, endTx) - totalOutputValue(access, beginTx, endTx) + coinbaseOutputValue;
+            }
+            int64_t total = 0;
+            for (ChainScanner scanner(access, beginTx, endTx); scanner.next();) {
+                auto &tx = scanner.tx();
+                if (!tx.isCoinbase()) {
+                    total += sumValues(tx.inputs()) - sumValues(tx.outputs());
+                }
+            }
+            return total;
+        }
+    } // namespace kernels
+} // namespace blocksci
@@ -0,0 +1,187 @@
+//
+//  numa.cpp
+//  blocksci
+//
+
+#define BLOCKSCI_WITHOUT_SINGLETON
+
+#include <blocksci/chain/numa.hpp>
+
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#ifdef __linux__
+#include <dirent.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace blocksci {
+
+    namespace {
+        /** Parses a CPU list like "0-15,32-47" */
+        std::vector<unsigned int> parseCpuList(const std::string &list) {
+            std::vector<unsigned int> cpus;
+            std::stringstream ss(list);
+            std::string part;
+            while (std::getline(ss, part, ',')) {
+                if (part.empty() || part == "\n") {
+                    continue;
+                }
+                auto dash = part.find('-');
+                try {
+                    auto first = static_cast<unsigned int>(std::stoul(part.substr(0, dash)));
+                    auto last = dash == std::string::npos ? first : static_cast<unsigned int>(std::stoul(part.substr(dash + 1)));
+                    for (auto cpu = first; cpu <= last; cpu++) {
+                        cpus.push_back(cpu);
+                    }
+                } catch (const std::exception &) {
+                    return {};
+                }
+            }
+            return cpus;
+        }
+    } // namespace
+
+    NumaTopology::NumaTopology() {
+        #ifdef __linux__
+        cpu_set_t allowed;
+        CPU_ZERO(&allowed);
+        bool haveAffinity = sched_getaffinity(0, sizeof(allowed), &allowed) == 0;
+
+        std::vector<int> nodeIds;
+        if (auto dir = opendir("/sys/devices/system/node")) {
+            while (auto entry = readdir(dir)) {
+                std::string name = entry->d_name;
+                if (name.size() > 4 && name.compare(0, 4, "node") == 0 && std::all_of(name.begin() + 4, name.end(), [](unsigned char c) { return std::isdigit(c) != 0; })) {
+                    nodeIds.push_back(std::stoi(name.substr(4)));
+                }
+            }
+            closedir(dir);
+        }
+        std::sort(nodeIds.begin(), nodeIds.end());
+
+        for (auto id : nodeIds) {
+            std::ifstream file("/sys/devices/system/node/node" + std::to_string(id) + "/cpulist");
+            std::string list;
+            std::getline(file, list);
+            NumaNode node{id, {}};
+            for (auto cpu : parseCpuList(list)) {
+                if (!haveAffinity || (cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed))) {
+                    node.cpus.push_back(cpu);
+                }
+            }
+            if (!node.cpus.empty()) {
+                nodeList.push_back(std::move(node));
+            }
+        }
+        #endif
+        if (nodeList.empty()) {
+            nodeList.push_back(NumaNode{0, {}});
+        }
+        indexCpus();
+    }
+
+    NumaTopology::NumaTopology(std::vector<NumaNode> nodes) : nodeList(std::move(nodes)) {
+        if (nodeList.empty()) {
+            nodeList.push_back(NumaNode{0, {}});
+        }
+        indexCpus();
+    }
+
+    void NumaTopology::indexCpus() {
+        for (size_t i = 0; i < nodeList.size(); i++) {
+            for (auto cpu : nodeList[i].cpus) {
+                if (cpuNodes.size() <= cpu) {
+                    cpuNodes.resize(cpu + 1, -1);
+                }
+                cpuNodes[cpu] = static_cast<int>(i);
+            }
+        }
+    }
+
+    const NumaTopology &NumaTopology::system() {
+        static const NumaTopology topology;
+        return topology;
+    }
+
+    int NumaTopology::nodeIndexOfCpu(unsigned int cpu) const {
+        if (nodeList.size() == 1) {
+            return 0;
+        }
+        return cpu < cpuNodes.size() ? cpuNodes[cpu] : -1;
+    }
+
+    int NumaTopology::currentNodeIndex() const {
+        if (nodeList.size() == 1) {
+            return 0;
+        }
+        #ifdef __linux__
+        auto cpu = sched_getcpu();
+        if (cpu >= 0) {
+            return nodeIndexOfCpu(static_cast<unsigned int>(cpu));
+        }
+        #endif
+        return -1;
+    }
+
+    bool NumaTopology::pinCurrentThread(size_t nodeIndex) const {
+        if (nodeIndex >= nodeList.size() || nodeList[nodeIndex].cpus.empty()) {
+            return false;
+        }
+        #ifdef __linux__
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        for (auto cpu : nodeList[nodeIndex].cpus) {
+            if (cpu < CPU_SETSIZE) {
+                CPU_SET(cpu, &cpus);
+            }
+        }
+        return pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus) == 0;
+        #else
+        return false;
+        #endif
+    }
+
+    bool NumaTopology::pageNodes(const void *data, size_t size, std::vector<int> &nodes) {
+        nodes.clear();
+        #if defined(__linux__) && defined(SYS_move_pages)
+        static const size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        if (data == nullptr || size == 0) {
+            return true;
+        }
+        auto first = reinterpret_cast<uintptr_t>(data) / pageSize * pageSize;
+        auto last = reinterpret_cast<uintptr_t>(data) + size;
+        auto pageCount = (last - first + pageSize - 1) / pageSize;
+        nodes.resize(pageCount);
+        // move_pages without target nodes only reports where the pages are, it takes the pages in batches
+        constexpr size_t batchSize = 4096;
+        std::vector<void *> pages(batchSize);
+        std::vector<int> status(batchSize);
+        for (size_t batchStart = 0; batchStart < pageCount; batchStart += batchSize) {
+            auto count = std::min(batchSize, pageCount - batchStart);
+            for (size_t i = 0; i < count; i++) {
+                pages[i] = reinterpret_cast<void *>(first + (batchStart + i) * pageSize);
+            }
+            if (syscall(SYS_move_pages, 0, count, pages.data(), nullptr, status.data(), 0) != 0) {
+                nodes.clear();
+                return false;
+            }
+            for (size_t i = 0; i < count; i++) {
+                // Pages that are not resident are reported as -ENOENT
+                nodes[batchStart + i] = status[i] >= 0 ? status[i] : -1;
+            }
+        }
+        return true;
+        #else
+        (void)data;
+        (void)size;
+        return false;
+        #endif
+    }
+} // namespace blocksci
@@ -43,6 +43,13 @@ namespace blocksci {
 
     /** Get the Input that spends this Output, if it was spent yet */
     ranges::optional<Input> Output::getSpendingInput() const {
+        if (access->getChain().hasSpendingInputColumn()) {
+            auto inputPointer = getSpendingInputPointer();
+            if (inputPointer) {
+                return Input{*inputPointer, *access};
+            }
+            return ranges::nullopt;
+        }
         auto spendingTx = getSpendingTx();
         if (spendingTx) {
             RANGES_FOR(auto input, spendingTx->inputs()) {
@@ -59,6 +66,10 @@ namespace blocksci {
     ranges::optional<InputPointer> Output::getSpendingInputPointer() const {
         auto index = getSpendingTxIndex();
         if (index) {
+            // The spending input column answers in O(1) instead of scanning all inputs of the spending tx
+            if (auto spendingInputNums = access->getChain().getSpendingInputNums(pointer.txNum)) {
+                return InputPointer{*index, spendingInputNums[pointer.inoutNum]};
+            }
             auto rawTx = access->getChain().getTx(*index);
             auto spentOutNums = access->getChain().getSpentOutputNumbers(*index);
             for (uint16_t i = 0; i < rawTx->inputCount; i++) {
@@ -0,0 +1,343 @@
+//
+//  task_pool.cpp
+//  blocksci
+//
+
+#define BLOCKSCI_WITHOUT_SINGLETON
+
+#include <blocksci/chain/task_pool.hpp>
+#include <blocksci/chain/numa.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+namespace blocksci {
+
+    namespace {
+        /** State of one parallelFor call, lives on the stack of the calling thread until all of its tasks have finished */
+        struct Job {
+            const std::function<void(size_t)> *task;
+            std::mutex mutex;
+            std::condition_variable finished;
+            size_t remaining;
+            std::exception_ptr error;
+        };
+
+        struct TaskRef {
+            Job *job;
+            size_t index;
+            /** Node the task is assigned to, -1 for tasks of parallelFor */
+            int node;
+        };
+
+        struct TaskQueue {
+            std::mutex mutex;
+            std::deque<TaskRef> tasks;
+        };
+    } // namespace
+
+    struct TaskPool::Impl {
+        unsigned int threadCount;
+        const NumaTopology &topology;
+        unsigned int nodeCount = 1;
+        /** One queue per thread, queue 0 belongs to the threads outside of the pool that start loops */
+        std::vector<std::unique_ptr<TaskQueue>> queues;
+        /** The queues of the workers of each node */
+        std::vector<std::vector<size_t>> nodeQueues;
+        /** For every queue the other queues in the order they are stolen from, the ones of the same node first */
+        std::vector<std::vector<size_t>> stealOrder;
+        std::vector<std::thread> workers;
+        std::atomic<size_t> queuedCount{0};
+        std::atomic<uint64_t> localTasks{0};
+        std::atomic<uint64_t> remoteTasks{0};
+        std::mutex sleepMutex;
+        std::condition_variable wakeUp;
+        bool stopping = false;
+
+        Impl(unsigned int threadCount_, const NumaTopology &topology_, bool numaAware);
+        ~Impl();
+
+        void workerLoop(size_t queueNum);
+        size_t ownQueue() const;
+        bool tryPop(size_t queueNum, TaskRef &ref);
+        void push(size_t queueNum, Job &job, const std::vector<size_t> &indexes, size_t begin, size_t end, int node);
+        void runTask(const TaskRef &ref);
+        void run(Job &job, size_t own);
+    };
+
+    namespace {
+        thread_local const void *currentPool = nullptr;
+        thread_local size_t currentQueue = 0;
+    } // namespace
+
+    TaskPool::Impl::Impl(unsigned int threadCount_, const NumaTopology &topology_, bool numaAware) : threadCount(threadCount_), topology(topology_) {
+        // The threads that start loops are not pinned, so only the workers are spread over the nodes
+        auto workerCount = threadCount - 1;
+        if (numaAware && workerCount > 1 && topology.nodeCount() > 1) {
+            nodeCount = std::min(workerCount, static_cast<unsigned int>(topology.nodeCount()));
+        }
+        nodeQueues.resize(nodeCount);
+        std::vector<int> queueNodes{-1};
+        queues.push_back(std::make_unique<TaskQueue>());
+        for (unsigned int i = 1; i < threadCount; i++) {
+            auto node = static_cast<unsigned int>(static_cast<uint64_t>(i - 1) * nodeCount / workerCount);
+            queues.push_back(std::make_unique<TaskQueue>());
+            queueNodes.push_back(static_cast<int>(node));
+            nodeQueues[node].push_back(i);
+        }
+        for (size_t i = 0; i < threadCount; i++) {
+            std::vector<size_t> order;
+            for (size_t j = 1; j < threadCount; j++) {
+                order.push_back((i + j) % threadCount);
+            }
+            std::stable_partition(order.begin(), order.end(), [&](size_t queue) { return queueNodes[queue] == queueNodes[i]; });
+            stealOrder.push_back(std::move(order));
+        }
+        for (unsigned int i = 1; i < threadCount; i++) {
+            auto node = queueNodes[i];
+            workers.emplace_back([this, i, node] {
+                if (nodeCount > 1) {
+                    topology.pinCurrentThread(static_cast<size_t>(node));
+                }
+                workerLoop(i);
+            });
+        }
+    }
+
+    TaskPool::Impl::~Impl() {
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            stopping = true;
+        }
+        wakeUp.notify_all();
+        for (auto &worker : workers) {
+            worker.join();
+        }
+    }
+
+    void TaskPool::Impl::workerLoop(size_t queueNum) {
+        currentPool = this;
+        currentQueue = queueNum;
+        TaskRef ref;
+        while (true) {
+            if (tryPop(queueNum, ref)) {
+                runTask(ref);
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(sleepMutex);
+            wakeUp.wait(lock, [&] { return stopping || queuedCount.load() > 0; });
+            if (stopping && queuedCount.load() == 0) {
+                return;
+            }
+        }
+    }
+
+    size_t TaskPool::Impl::ownQueue() const {
+        return currentPool == this ? currentQueue : 0;
+    }
+
+    bool TaskPool::Impl::tryPop(size_t queueNum, TaskRef &ref) {
+        if (queuedCount.load() == 0) {
+            return false;
+        }
+        {
+            auto &queue = *queues[queueNum];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (!queue.tasks.empty()) {
+                ref = queue.tasks.front();
+                queue.tasks.pop_front();
+                queuedCount--;
+                return true;
+            }
+        }
+        // Stealing from the back leaves the owner the tasks next to the ones it has just run
+        for (auto victim : stealOrder[queueNum]) {
+            auto &queue = *queues[victim];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (!queue.tasks.empty()) {
+                ref = queue.tasks.back();
+                queue.tasks.pop_back();
+                queuedCount--;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void TaskPool::Impl::push(size_t queueNum, Job &job, const std::vector<size_t> &indexes, size_t begin, size_t end, int node) {
+        if (begin == end) {
+            return;
+        }
+        auto &queue = *queues[queueNum];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        for (auto i = begin; i < end; i++) {
+            queue.tasks.push_back(TaskRef{&job, indexes.empty() ? i : indexes[i], node});
+        }
+        queuedCount += end - begin;
+    }
+
+    void TaskPool::Impl::runTask(const TaskRef &ref) {
+        auto &job = *ref.job;
+        if (ref.node >= 0) {
+            if (topology.currentNodeIndex() == ref.node) {
+                localTasks++;
+            } else {
+                remoteTasks++;
+            }
+        }
+        std::exception_ptr error;
+        try {
+            (*job.task)(ref.index);
+        } catch (...) {
+            error = std::current_exception();
+        }
+        // Notifying while holding the lock keeps the job alive until the waiting caller can see remaining == 0
+        std::lock_guard<std::mutex> lock(job.mutex);
+        if (error && !job.error) {
+            job.error = error;
+        }
+        if (--job.remaining == 0) {
+            job.finished.notify_all();
+        }
+    }
+
+    void TaskPool::Impl::run(Job &job, size_t own) {
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+        }
+        wakeUp.notify_all();
+
+        TaskRef ref;
+        while (true) {
+            {
+                std::lock_guard<std::mutex> lock(job.mutex);
+                if (job.remaining == 0) {
+                    break;
+                }
+            }
+            if (tryPop(own, ref)) {
+                runTask(ref);
+                continue;
+            }
+            // All tasks of the job have been taken, wait for the ones still running on other threads
+            std::unique_lock<std::mutex> lock(job.mutex);
+            job.finished.wait(lock, [&] { return job.remaining == 0; });
+            break;
+        }
+
+        if (job.error) {
+            std::rethrow_exception(job.error);
+        }
+    }
+
+    namespace {
+        unsigned int poolThreadCount(unsigned int threadCount) {
+            return threadCount > 0 ? threadCount : std::max(std::thread::hardware_concurrency(), 1u);
+        }
+    } // namespace
+
+    TaskPool::TaskPool(unsigned int threadCount, bool numaAware) : impl(std::make_unique<Impl>(poolThreadCount(threadCount), NumaTopology::system(), numaAware)) {}
+
+    TaskPool::TaskPool(unsigned int threadCount, const NumaTopology &topology) : impl(std::make_unique<Impl>(poolThreadCount(threadCount), topology, true)) {}
+
+    TaskPool::~TaskPool() = default;
+
+    unsigned int TaskPool::threadCount() const {
+        return impl->threadCount;
+    }
+
+    unsigned int TaskPool::nodeCount() const {
+        return impl->nodeCount;
+    }
+
+    const NumaTopology &TaskPool::topology() const {
+        return impl->topology;
+    }
+
+    void TaskPool::parallelFor(size_t taskCount, const std::function<void(size_t)> &task) {
+        if (taskCount == 0) {
+            return;
+        }
+        if (taskCount == 1 || impl->threadCount == 1) {
+            for (size_t i = 0; i < taskCount; i++) {
+                task(i);
+            }
+            return;
+        }
+
+        Job job;
+        job.task = &task;
+        job.remaining = taskCount;
+
+        // Every thread gets a contiguous run of tasks, starting with the run of the calling thread
+        auto own = impl->ownQueue();
+        auto queueCount = impl->queues.size();
+        for (size_t i = 0; i < queueCount; i++) {
+            impl->push((own + i) % queueCount, job, {}, taskCount * i / queueCount, taskCount * (i + 1) / queueCount, -1);
+        }
+        impl->run(job, own);
+    }
+
+    void TaskPool::parallelForOnNodes(const std::vector<unsigned int> &taskNodes, const std::function<void(size_t)> &task) {
+        if (impl->nodeCount == 1) {
+            parallelFor(taskNodes.size(), task);
+            return;
+        }
+        if (taskNodes.empty()) {
+            return;
+        }
+
+        Job job;
+        job.task = &task;
+        job.remaining = taskNodes.size();
+
+        // The tasks of each node are dealt out to the threads of the node in contiguous runs
+        std::vector<std::vector<size_t>> nodeTasks(impl->nodeCount);
+        for (size_t i = 0; i < taskNodes.size(); i++) {
+            nodeTasks[taskNodes[i] % impl->nodeCount].push_back(i);
+        }
+        for (unsigned int node = 0; node < impl->nodeCount; node++) {
+            auto &tasks = nodeTasks[node];
+            auto &queues = impl->nodeQueues[node];
+            for (size_t i = 0; i < queues.size(); i++) {
+                impl->push(queues[i], job, tasks, tasks.size() * i / queues.size(), tasks.size() * (i + 1) / queues.size(), static_cast<int>(node));
+            }
+        }
+        impl->run(job, impl->ownQueue());
+    }
+
+    TaskPool::NodeStats TaskPool::nodeStats() const {
+        return NodeStats{impl->localTasks.load(), impl->remoteTasks.load()};
+    }
+
+    void TaskPool::resetNodeStats() {
+        impl->localTasks = 0;
+        impl->remoteTasks = 0;
+    }
+
+    namespace {
+        std::mutex sharedPoolMutex;
+        std::unique_ptr<TaskPool> sharedPool;
+    } // namespace
+
+    TaskPool &TaskPool::shared() {
+        std::lock_guard<std::mutex> lock(sharedPoolMutex);
+        if (!sharedPool) {
+            sharedPool = std::make_unique<TaskPool>();
+        }
+        return *sharedPool;
+    }
+
+    void TaskPool::setSharedThreadCount(unsigned int threadCount, bool numaAware) {
+        setSharedPool(std::make_unique<TaskPool>(threadCount, numaAware));
+    }
+
+    void TaskPool::setSharedPool(std::unique_ptr<TaskPool> pool) {
+        std::lock_guard<std::mutex> lock(sharedPoolMutex);
+        sharedPool = std::move(pool);
+    }
+} // namespace blocksci
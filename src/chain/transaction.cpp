@@ -20,11 +20,13 @@
 #include <internal/data_access.hpp>
 #include <internal/hash_index.hpp>
 #include <internal/mempool_index.hpp>
+#include <internal/tx_hash_index.hpp>
 
 #include <range/v3/algorithm/any_of.hpp>
 #include <range/v3/view/iota.hpp>
 #include <range/v3/view/zip_with.hpp>
 
+#include <algorithm>
 #include <sstream>
 
 namespace {
@@ -36,6 +38,22 @@ namespace {
             throw blocksci::InvalidHashException();
         }
     }
+
+    uint32_t getTxIndex(const std::string &hash, blocksci::DataAccess &access) {
+        // Anything shorter than a full hash is resolved as an abbreviation, which has to be unambiguous
+        auto hexSize = hash.size() >= 2 && hash[0] == '0' && (hash[1] == 'x' || hash[1] == 'X') ? hash.size() - 2 : hash.size();
+        if (hexSize >= 64) {
+            return getTxIndex(blocksci::uint256S(hash), access.getHashIndex());
+        }
+        auto txNums = blocksci::getTxIndexesWithPrefix(hash, access, 2);
+        if (txNums.empty()) {
+            throw blocksci::InvalidHashException();
+        }
+        if (txNums.size() > 1) {
+            throw std::runtime_error("Tx hash prefix " + hash + " matches more than one transaction");
+        }
+        return txNums[0];
+    }
 }
 
 namespace blocksci {
@@ -47,7 +65,39 @@ namespace blocksci {
     
     Transaction::Transaction(const uint256 &hash, DataAccess &access_) : Transaction(getTxIndex(hash, access_.getHashIndex()), access_) {}
 
-    Transaction::Transaction(const std::string &hash, DataAccess &access_) : Transaction(uint256S(hash), access_) {}
+    Transaction::Transaction(const std::string &hash, DataAccess &access_) : Transaction(getTxIndex(hash, access_), access_) {}
+
+    std::vector<ranges::optional<uint32_t>> getTxIndexes(const std::vector<uint256> &hashes, DataAccess &access, unsigned int threadCount) {
+        return access.getHashIndex().getTxIndexes(hashes, threadCount);
+    }
+
+    std::vector<ranges::optional<uint32_t>> getTxIndexes(const std::vector<std::string> &hashes, DataAccess &access, unsigned int threadCount) {
+        std::vector<uint256> parsed;
+        parsed.reserve(hashes.size());
+        for (auto &hash : hashes) {
+            parsed.push_back(uint256S(hash));
+        }
+        return getTxIndexes(parsed, access, threadCount);
+    }
+
+    std::vector<uint32_t> getTxIndexesWithPrefix(const std::string &hexPrefix, DataAccess &access, size_t limit) {
+        TxHashPrefix prefix{hexPrefix};
+        auto &chain = access.getChain();
+        auto txCount = static_cast<uint32_t>(chain.txCount());
+        std::vector<uint32_t> txNums;
+        if (auto index = access.getHashIndex().getTxHashIndex()) {
+            txNums = index->findByPrefix(prefix, limit);
+            // tx_hashes.dat may list transactions of blocks beyond the loaded ones
+            txNums.erase(std::remove_if(txNums.begin(), txNums.end(), [&](uint32_t txNum) { return txNum >= txCount; }), txNums.end());
+        } else {
+            for (uint32_t txNum = 0; txNum < txCount && txNums.size() < limit; txNum++) {
+                if (prefix.matches(*chain.getTxHash(txNum))) {
+                    txNums.push_back(txNum);
+                }
+            }
+        }
+        return txNums;
+    }
     
     std::string Transaction::toString() const {
         std::stringstream ss;
@@ -93,6 +143,22 @@ namespace blocksci {
         return access->getMempoolIndex().observed(txNum);
     }
     
+    ranges::optional<InoutColumns> Transaction::inputColumns() const {
+        auto &chain = access->getChain();
+        if (!chain.hasInoutColumns()) {
+            return ranges::nullopt;
+        }
+        return chain.getInputColumns(chain.firstInputNum(txNum), inputCount());
+    }
+    
+    ranges::optional<InoutColumns> Transaction::outputColumns() const {
+        auto &chain = access->getChain();
+        if (!chain.hasInoutColumns()) {
+            return ranges::nullopt;
+        }
+        return chain.getOutputColumns(chain.firstOutputNum(txNum), outputCount());
+    }
+    
     Block Transaction::block() const {
         return {getBlockHeight(), *access};
     }
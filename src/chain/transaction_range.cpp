@@ -14,6 +14,10 @@
 
 namespace blocksci {
     
+    bool TransactionRange::iterator::hasContiguousData(const Transaction &tx) {
+        return tx.access == nullptr || tx.access->getChain().hasContiguousTxData();
+    }
+    
     void TransactionRange::iterator::resetTx() {
         tx.data.rawTx = tx.access->getChain().getTx(tx.txNum);
     }
@@ -32,6 +36,19 @@ namespace blocksci {
         nextBlockFirst = tx.blockHeight < tx.access->getChain().blockCount() - BlockHeight{1} ? block->firstTxIndex + static_cast<uint32_t>(block->txCount) : std::numeric_limits<decltype(nextBlockFirst)>::max();
     }
     
+    void TransactionRange::iterator::readAhead() {
+        auto &chain = tx.access->getChain();
+        uint64_t window = chain.readaheadWindow();
+        if (window == 0) {
+            readaheadTx = std::numeric_limits<uint32_t>::max();
+            return;
+        }
+        // Requesting two windows while moving forward by one keeps a full window of lead over the iterator
+        auto prefetchEnd = std::min<uint64_t>(tx.txNum + 2 * window, std::numeric_limits<uint32_t>::max());
+        chain.prefetchTransactions(tx.txNum, static_cast<uint32_t>(prefetchEnd));
+        readaheadTx = static_cast<uint32_t>(std::min<uint64_t>(tx.txNum + window, std::numeric_limits<uint32_t>::max()));
+    }
+    
     TransactionRange::iterator::value_type TransactionRange::iterator::operator[](size_type i) const {
         auto index = tx.txNum + i;
         auto data = tx.getAccess().getChain().getTxData(index);
@@ -46,6 +63,24 @@ namespace blocksci {
         return {data, index, height, firstTx.maxTxCount, firstTx.getAccess()};
     }
     
+    ranges::optional<InoutColumns> TransactionRange::inputColumns() const {
+        auto &chain = getAccess().getChain();
+        if (!chain.hasInoutColumns()) {
+            return ranges::nullopt;
+        }
+        auto firstInput = chain.firstInputNum(slice.start);
+        return chain.getInputColumns(firstInput, chain.firstInputNum(slice.stop) - firstInput);
+    }
+    
+    ranges::optional<InoutColumns> TransactionRange::outputColumns() const {
+        auto &chain = getAccess().getChain();
+        if (!chain.hasInoutColumns()) {
+            return ranges::nullopt;
+        }
+        auto firstOutput = chain.firstOutputNum(slice.start);
+        return chain.getOutputColumns(firstOutput, chain.firstOutputNum(slice.stop) - firstOutput);
+    }
+    
     CPP_assert(ranges::bidirectional_range<TransactionRange>);
     CPP_assert(ranges::bidirectional_iterator<TransactionRange::iterator>);
     CPP_assert(ranges::sized_sentinel_for<TransactionRange::iterator, TransactionRange::iterator>);
@@ -0,0 +1,242 @@
+//
+//  tx_graph.cpp
+//  blocksci
+//
+
+#define BLOCKSCI_WITHOUT_SINGLETON
+
+#include <blocksci/chain/tx_graph.hpp>
+#include <blocksci/chain/task_pool.hpp>
+
+#include <internal/chain_access.hpp>
+#include <internal/data_access.hpp>
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+namespace blocksci {
+
+    namespace {
+        // Transactions further apart than this are advised separately, closer ones are advised as one range so that a
+        // dense frontier does not cost one system call per transaction
+        constexpr uint32_t prefetchGap = 64;
+
+        // How many transactions ahead of the one being expanded the record is requested from the cache
+        constexpr size_t prefetchDistance = 8;
+
+        bool followsForward(TraversalDirection direction) {
+            return direction == TraversalDirection::Forward || direction == TraversalDirection::Both;
+        }
+
+        bool followsBackward(TraversalDirection direction) {
+            return direction == TraversalDirection::Backward || direction == TraversalDirection::Both;
+        }
+    } // namespace
+
+    std::vector<uint32_t> TraversalResult::txNumsAtDepth(uint32_t depth) const {
+        if (depth >= depthCount()) {
+            throw std::out_of_range("Traversal did not reach that depth");
+        }
+        return {txNums.begin() + static_cast<std::ptrdiff_t>(depthOffsets[depth]), txNums.begin() + static_cast<std::ptrdiff_t>(depthOffsets[depth + 1])};
+    }
+
+    TxGraphTraversal::TxGraphTraversal(DataAccess &access_) : access(&access_), pool(nullptr) {}
+
+    TxGraphTraversal::TxGraphTraversal(DataAccess &access_, TaskPool &pool_) : access(&access_), pool(&pool_) {}
+
+    TxGraphTraversal::~TxGraphTraversal() = default;
+
+    bool TxGraphTraversal::claim(uint32_t txNum) {
+        auto bit = uint64_t(1) << (txNum % 64);
+        auto &word = visited[txNum / 64];
+        // Most edges of a dense neighborhood lead to transactions that were already reached, a plain load avoids
+        // taking the cache line exclusively for those
+        if (word.load(std::memory_order_relaxed) & bit) {
+            return false;
+        }
+        return !(word.fetch_or(bit, std::memory_order_relaxed) & bit);
+    }
+
+    void TxGraphTraversal::release(uint32_t txNum) {
+        visited[txNum / 64].fetch_and(~(uint64_t(1) << (txNum % 64)), std::memory_order_relaxed);
+    }
+
+    bool TxGraphTraversal::isVisited(uint32_t txNum) const {
+        return visited[txNum / 64].load(std::memory_order_relaxed) & (uint64_t(1) << (txNum % 64));
+    }
+
+    void TxGraphTraversal::prefetchFrontier(const uint32_t *frontier, size_t count) const {
+        auto &chain = access->getChain();
+        size_t i = 0;
+        while (i < count) {
+            auto runBegin = frontier[i];
+            auto runEnd = runBegin;
+            for (i++; i < count && frontier[i] - runEnd <= prefetchGap; i++) {
+                runEnd = frontier[i];
+            }
+            chain.prefetchTransactions(runBegin, runEnd + 1);
+        }
+    }
+
+    TraversalResult TxGraphTraversal::run(const std::vector<uint32_t> &seeds, const TraversalOptions &options) {
+        auto &chain = access->getChain();
+        auto txCount = static_cast<uint32_t>(chain.txCount());
+        auto &taskPool = pool ? *pool : TaskPool::shared();
+
+        std::vector<uint32_t> frontier = seeds;
+        std::sort(frontier.begin(), frontier.end());
+        frontier.erase(std::unique(frontier.begin(), frontier.end()), frontier.end());
+        if (!frontier.empty() && frontier.back() >= txCount) {
+            throw std::invalid_argument("Seed transaction " + std::to_string(frontier.back()) + " is past the end of the chain");
+        }
+
+        // All bits are clear between runs, so a larger chain only needs a larger bitset
+        auto wordCount = (static_cast<size_t>(txCount) + 63) / 64;
+        if (wordCount > visitedWords) {
+            visited = std::make_unique<std::atomic<uint64_t>[]>(wordCount);
+            for (size_t i = 0; i < wordCount; i++) {
+                visited[i].store(0, std::memory_order_relaxed);
+            }
+            visitedWords = wordCount;
+        }
+
+        TraversalResult result;
+        auto forward = followsForward(options.direction);
+        auto backward = followsBackward(options.direction);
+
+        try {
+            for (auto txNum : frontier) {
+                claim(txNum);
+            }
+            if (options.maxVisited > 0 && frontier.size() > options.maxVisited) {
+                for (auto it = frontier.begin() + static_cast<std::ptrdiff_t>(options.maxVisited); it != frontier.end(); ++it) {
+                    release(*it);
+                }
+                frontier.resize(options.maxVisited);
+                result.truncated = true;
+            }
+            result.txNums = frontier;
+            result.depthOffsets = {0, frontier.size()};
+
+            for (uint32_t depth = 0; depth < options.maxDepth && !frontier.empty() && !result.truncated; depth++) {
+                if (options.prefetch) {
+                    prefetchFrontier(frontier.data(), frontier.size());
+                }
+
+                // Each task expands a contiguous slice of the sorted frontier, so concatenating the task results in task
+                // order keeps the edges ordered by fromTx
+                auto taskCount = std::min(frontier.size(), static_cast<size_t>(taskPool.threadCount()) * TaskPool::tasksPerThread);
+                std::vector<std::vector<uint32_t>> nextParts(taskCount);
+                std::vector<std::vector<TxEdge>> edgeParts(options.collectEdges ? taskCount : 0);
+                taskPool.parallelFor(taskCount, [&](size_t task) {
+                    auto begin = frontier.size() * task / taskCount;
+                    auto end = frontier.size() * (task + 1) / taskCount;
+                    auto &next = nextParts[task];
+                    auto follow = [&](const TxEdge &edge) {
+                        if (options.edgeFilter && !options.edgeFilter(edge)) {
+                            return;
+                        }
+                        if (options.collectEdges) {
+                            edgeParts[task].push_back(edge);
+                        }
+                        if (claim(edge.toTx)) {
+                            next.push_back(edge.toTx);
+                        }
+                    };
+                    for (size_t i = begin; i < end; i++) {
+                        #if defined(__GNUC__) || defined(__clang__)
+                        if (i + prefetchDistance < end) {
+                            __builtin_prefetch(chain.getTx(frontier[i + prefetchDistance]));
+                        }
+                        #endif
+                        auto txNum = frontier[i];
+                        auto tx = chain.getTx(txNum);
+                        if (forward) {
+                            uint16_t outputNum = 0;
+                            for (auto inout = tx->beginOutputs(); inout != tx->endOutputs(); ++inout, ++outputNum) {
+                                // Unspent outputs link to tx 0, outputs spent past the loaded chain beyond txCount
+                                auto linked = inout->getLinkedTxNum();
+                                if (linked != 0 && linked < txCount) {
+                                    follow(TxEdge{txNum, linked, outputNum, TraversalDirection::Forward, depth, inout});
+                                }
+                            }
+                        }
+                        if (backward) {
+                            uint16_t inputNum = 0;
+                            for (auto inout = tx->beginInputs(); inout != tx->endInputs(); ++inout, ++inputNum) {
+                                auto linked = inout->getLinkedTxNum();
+                                if (linked < txCount) {
+                                    follow(TxEdge{txNum, linked, inputNum, TraversalDirection::Backward, depth, inout});
+                                }
+                            }
+                        }
+                    }
+                });
+
+                std::vector<uint32_t> next;
+                size_t nextSize = 0;
+                for (auto &part : nextParts) {
+                    nextSize += part.size();
+                }
+                next.reserve(nextSize);
+                for (auto &part : nextParts) {
+                    next.insert(next.end(), part.begin(), part.end());
+                }
+                std::sort(next.begin(), next.end());
+
+                if (options.maxVisited > 0 && result.txNums.size() + next.size() > options.maxVisited) {
+                    auto keep = static_cast<size_t>(options.maxVisited) - result.txNums.size();
+                    for (size_t i = keep; i < next.size(); i++) {
+                        release(next[i]);
+                    }
+                    next.resize(keep);
+                    result.truncated = true;
+                }
+
+                for (auto &part : edgeParts) {
+                    if (result.truncated) {
+                        part.erase(std::remove_if(part.begin(), part.end(), [&](const TxEdge &edge) {
+                            return !isVisited(edge.toTx);
+                        }), part.end());
+                    }
+                    result.edges.insert(result.edges.end(), part.begin(), part.end());
+                }
+
+                if (!next.empty()) {
+                    result.txNums.insert(result.txNums.end(), next.begin(), next.end());
+                    result.depthOffsets.push_back(result.txNums.size());
+                }
+                frontier = std::move(next);
+            }
+        } catch (...) {
+            // Bits claimed by the failed run are not tracked anywhere, start over with a fresh bitset next time
+            visited.reset();
+            visitedWords = 0;
+            throw;
+        }
+
+        // Wide traversals touch most words anyway, clearing them all is cheaper than clearing bit by bit
+        if (result.txNums.size() > visitedWords / 16) {
+            taskPool.parallelForRange(0, visitedWords, 1 << 16, [&](size_t i) {
+                visited[i].store(0, std::memory_order_relaxed);
+            });
+        } else {
+            for (auto txNum : result.txNums) {
+                release(txNum);
+            }
+        }
+        return result;
+    }
+
+    TraversalResult traverseTxGraph(const std::vector<uint32_t> &seeds, const TraversalOptions &options, DataAccess &access) {
+        // Concurrent calls find the kept traversal taken and run on a temporary one instead of waiting for it
+        auto traversal = std::atomic_exchange(&access.txGraphTraversal, std::shared_ptr<TxGraphTraversal>{});
+        if (!traversal) {
+            traversal = std::make_shared<TxGraphTraversal>(access);
+        }
+        auto result = traversal->run(seeds, options);
+        std::atomic_store(&access.txGraphTraversal, traversal);
+        return result;
+    }
+} // namespace blocksci
@@ -12,6 +12,7 @@
 #include <blocksci/chain/blockchain.hpp>
 #include <blocksci/chain/input.hpp>
 #include <blocksci/chain/range_util.hpp>
+#include <blocksci/chain/task_pool.hpp>
 #include <blocksci/core/dedup_address.hpp>
 #include <blocksci/heuristics/change_address.hpp>
 #include <blocksci/heuristics/tx_identification.hpp>
@@ -29,9 +30,12 @@
 
 #include <range/v3/view/iota.hpp>
 #include <range/v3/range_for.hpp>
+#include <algorithm>
+#include <atomic>
 #include <fstream>
 #include <future>
 #include <map>
+#include <mutex>
 
 namespace {
     template <typename Job>
@@ -46,38 +50,13 @@ namespace {
             return;
         }
         
-        auto segmentSize = total / segmentCount;
-        auto segmentsRemaining = total % segmentCount;
-        std::vector<std::pair<uint32_t, uint32_t>> segments;
-        uint32_t i = 0;
-        while(i < total) {
-            uint32_t startSegment = i;
-            i += segmentSize;
-            if (segmentsRemaining > 0) {
-                i += 1;
-                segmentsRemaining--;
-            }
-            uint32_t endSegment = i;
-            segments.emplace_back(startSegment + start, endSegment + start);
-        }
-        std::vector<std::thread> threads;
-        for (uint32_t i = 0; i < segmentCount - 1; i++) {
-            auto segment = segments[i];
-            threads.emplace_back([segment, &job](){
-                for (uint32_t i = segment.first; i < segment.second; i++) {
-                    job(i);
-                }
-            });
-        }
-        
-        auto segment = segments.back();
-        for (uint32_t i = segment.first; i < segment.second; i++) {
-            job(i);
-        }
-        
-        for (auto &thread : threads) {
-            thread.join();
-        }
+        // Many small tasks instead of one per thread, so threads that finish their part early take over work from the others
+        auto &pool = blocksci::TaskPool::shared();
+        auto taskCount = std::max<uint32_t>(segmentCount, pool.threadCount() * blocksci::TaskPool::tasksPerThread);
+        auto grainSize = std::max<uint32_t>(total / taskCount, 1);
+        pool.parallelForRange(start, end, grainSize, [&job](size_t i) {
+            job(static_cast<uint32_t>(i));
+        });
     }
 }
 
@@ -173,21 +152,23 @@ namespace blocksci {
         
         linkScripthashNested(access, ds);
         
-        auto extract = [&](const BlockRange &blocks, int threadNum) {
-            auto progressThread = static_cast<int>(std::thread::hardware_concurrency()) - 1;
-            auto progressBar = makeProgressBar(blocks.endTxIndex() - blocks.firstTxIndex(), [=]() {});
-            if (threadNum != progressThread) {
-                progressBar.setSilent();
-            }
-            uint32_t txNum = 0;
+        // Segments are processed in any order, so progress is counted over all of them and reported by whichever thread
+        // reaches the next mark
+        auto progressBar = makeProgressBar(chain.endTxIndex() - chain.firstTxIndex(), [=]() {});
+        std::atomic<uint64_t> processedCount{0};
+        std::mutex progressMutex;
+        auto extract = [&](const BlockRange &blocks) {
             for (auto block : blocks) {
                 for (auto tx : block) {
                     auto pairs = processTransaction(tx, changeHeuristic, ignoreCoinJoin);
                     for (auto &pair : pairs) {
                         ds.link_addresses(pair.first, pair.second);
                     }
-                    progressBar.update(txNum);
-                    txNum++;
+                    auto txNum = processedCount++;
+                    if (txNum % 10000 == 0) {
+                        std::lock_guard<std::mutex> lock(progressMutex);
+                        progressBar.update(txNum);
+                    }
                 }
             }
             return 0;
@@ -10,6 +10,8 @@
 
 #include "address_index.hpp"
 #include "address_info.hpp"
+#include "address_output_index.hpp"
+#include "batch_lookup.hpp"
 #include "column_iterator.hpp"
 #include "dedup_address_info.hpp"
 #include "memory_view.hpp"
@@ -18,16 +20,38 @@
 #include <blocksci/core/raw_address.hpp>
 #include <blocksci/core/dedup_address.hpp>
 
+#include <range/v3/view/iota.hpp>
 #include <range/v3/view/transform.hpp>
 #include <range/v3/range_for.hpp>
 
 #include <endian/big_endian.hpp>
 
+#include <algorithm>
+#include <numeric>
 #include <sstream>
 
 namespace blocksci {
 
-    AddressIndex::AddressIndex(const filesystem::path &path, bool readonly) {
+    namespace {
+        /** Key in the default column that marks the input columns as complete, @see AddressIndex::markInputIndexComplete */
+        const std::string inputIndexCompleteKey = "input_index_complete";
+
+        /** Decodes the txNum and inoutNumInTx of an output or input key, @see AddressIndex */
+        InoutPointer decodeInoutKey(const char *keyData) {
+            InoutPointer outPoint;
+            uint8_t txNumData[4];
+            uint8_t inoutNumData[2];
+            keyData += sizeof(uint32_t);  // Skip the scriptNum in the key (first 4 bytes), as it is known already
+            memcpy(txNumData, keyData, 4);
+            keyData += sizeof(txNumData);
+            memcpy(inoutNumData, keyData, 2);
+            endian::big_endian::get(outPoint.txNum, txNumData);
+            endian::big_endian::get(outPoint.inoutNum, inoutNumData);
+            return outPoint;
+        }
+    } // namespace
+
+    AddressIndex::AddressIndex(const filesystem::path &path, bool readonly, std::shared_ptr<const AddressOutputIndex> outputIndex_) : outputIndex(std::move(outputIndex_)) {
         rocksdb::Options options;
         // Optimize RocksDB. This is the easiest way to get RocksDB to perform well
         options.IncreaseParallelism();
@@ -51,6 +75,23 @@ namespace blocksci {
         });
         columnDescriptors.emplace_back(rocksdb::kDefaultColumnFamilyName, rocksdb::ColumnFamilyOptions());
 
+        // The input columns were added later, read-only databases created before them can only be opened without them
+        hasInputColumns = true;
+        if (readonly) {
+            std::vector<std::string> existingColumns;
+            if (rocksdb::DB::ListColumnFamilies(options, path.str(), &existingColumns).ok()) {
+                auto inputColumnName = addressName(AddressType::example) + "_input";
+                hasInputColumns = std::find(existingColumns.begin(), existingColumns.end(), inputColumnName) != existingColumns.end();
+            }
+        }
+        if (hasInputColumns) {
+            blocksci::for_each(AddressType::all(), [&](auto tag) {
+                std::stringstream ss;
+                ss << addressName(tag) << "_input";
+                columnDescriptors.emplace_back(ss.str(), rocksdb::ColumnFamilyOptions{});
+            });
+        }
+
         rocksdb::DB *dbPtr;
         std::vector<rocksdb::ColumnFamilyHandle *> columnHandlePtrs;
         if (readonly) {
@@ -68,6 +109,10 @@ namespace blocksci {
         for (auto handle : columnHandlePtrs) {
             columnHandles.emplace_back(std::unique_ptr<rocksdb::ColumnFamilyHandle>(handle));
         }
+        if (hasInputColumns) {
+            std::string value;
+            inputIndexComplete = db->Get(rocksdb::ReadOptions{}, inputIndexCompleteKey, &value).ok();
+        }
     }
 
     AddressIndex::~AddressIndex() = default;
@@ -86,26 +131,90 @@ namespace blocksci {
         return columnHandles[AddressType::size + static_cast<size_t>(type)];
     }
 
+    const std::unique_ptr<rocksdb::ColumnFamilyHandle> &AddressIndex::getInputColumn(AddressType::Enum type) const {
+        // The input columns follow the output columns, the nested columns and the default column
+        return columnHandles[2 * AddressType::size + 1 + static_cast<size_t>(type)];
+    }
+
+    uint32_t AddressIndex::outputIndexTxCount() const {
+        return outputIndex ? static_cast<uint32_t>(outputIndex->txCount()) : 0;
+    }
+
+    void AddressIndex::appendOutputPointers(rocksdb::Iterator &it, const RawAddress &address, uint32_t txStart, std::vector<InoutPointer> &pointers) {
+        uint8_t startKey[sizeof(uint32_t) + sizeof(uint32_t)];
+        memcpy(startKey, &address.scriptNum, sizeof(address.scriptNum));
+        endian::big_endian::put(txStart, startKey + sizeof(uint32_t));
+        rocksdb::Slice prefix{reinterpret_cast<const char *>(&address.scriptNum), sizeof(address.scriptNum)};
+        for (it.Seek(rocksdb::Slice{reinterpret_cast<const char *>(startKey), sizeof(startKey)}); it.Valid() && it.key().starts_with(prefix); it.Next()) {
+            pointers.push_back(decodeInoutKey(it.key().data()));
+        }
+        if (!it.status().ok()) {
+            throw std::runtime_error{"Address index lookup failed with error: " + it.status().ToString()};
+        }
+    }
+
     ranges::any_view<InoutPointer, ranges::category::forward> AddressIndex::getOutputPointers(const RawAddress &address) const {
+        if (outputIndex) {
+            auto pointers = std::make_shared<std::vector<InoutPointer>>();
+            outputIndex->appendOutputPointers(address, *pointers);
+            appendOutputPointers(*getOutputIterator(address.type), address, outputIndexTxCount(), *pointers);
+            return ranges::views::iota(size_t{0}, pointers->size()) | ranges::views::transform([pointers](size_t i) {
+                return (*pointers)[i];
+            });
+        }
         auto prefixData = reinterpret_cast<const char *>(&address.scriptNum);
         std::vector<char> prefix(prefixData, prefixData + sizeof(address.scriptNum));  // vector with scriptNum bytes
         auto rawOutputPointerRange = ColumnIterator(db.get(), getOutputColumn(address.type).get(), prefix);
         return rawOutputPointerRange | ranges::views::transform([](std::pair<MemoryView, MemoryView> pair) -> InoutPointer {
-            InoutPointer outPoint;
-            uint8_t txNumData[4];
-            uint8_t outputNumData[2];
+            return decodeInoutKey(pair.first.data);
+        });
+    }
 
-            auto &key = pair.first;  // Query result
-            key.data += sizeof(uint32_t);  // Skip the scriptNum in the key (first 4 bytes), as it is known already
-            memcpy(txNumData, key.data, 4);
-            key.data += sizeof(txNumData); // Move the key.data pointer forward
-            memcpy(outputNumData, key.data, 2);
-            endian::big_endian::get(outPoint.txNum, txNumData);
-            endian::big_endian::get(outPoint.inoutNum, outputNumData);
-            return outPoint;
+    ranges::any_view<InoutPointer, ranges::category::forward> AddressIndex::getInputPointers(const RawAddress &address) const {
+        auto prefixData = reinterpret_cast<const char *>(&address.scriptNum);
+        std::vector<char> prefix(prefixData, prefixData + sizeof(address.scriptNum));
+        auto rawInputPointerRange = ColumnIterator(db.get(), getInputColumn(address.type).get(), prefix);
+        return rawInputPointerRange | ranges::views::transform([](std::pair<MemoryView, MemoryView> pair) -> InoutPointer {
+            return decodeInoutKey(pair.first.data);
         });
     }
 
+    std::vector<std::vector<InoutPointer>> AddressIndex::getOutputPointers(const std::vector<RawAddress> &addresses, unsigned int threadCount) const {
+        std::vector<std::vector<InoutPointer>> results(addresses.size());
+        // Sorting by type groups the addresses by column, the scriptNum bytes are the key prefix within a column
+        std::vector<size_t> order(addresses.size());
+        std::iota(order.begin(), order.end(), size_t{0});
+        std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+            const auto &addressA = addresses[a];
+            const auto &addressB = addresses[b];
+            if (addressA.type != addressB.type) {
+                return addressA.type < addressB.type;
+            }
+            return memcmp(&addressA.scriptNum, &addressB.scriptNum, sizeof(addressA.scriptNum)) < 0;
+        });
+
+        auto txStart = outputIndexTxCount();
+        SnapshotGuard snapshot{db.get()};
+        auto readOptions = snapshot.readOptions();
+        forEachChunk(order.size(), threadCount, [&](size_t begin, size_t end) {
+            std::unique_ptr<rocksdb::Iterator> it;
+            ranges::optional<AddressType::Enum> iteratorType;
+            for (auto i = begin; i < end; i++) {
+                const auto &address = addresses[order[i]];
+                if (!iteratorType || *iteratorType != address.type) {
+                    it.reset(db->NewIterator(readOptions, getOutputColumn(address.type).get()));
+                    iteratorType = address.type;
+                }
+                auto &pointers = results[order[i]];
+                if (outputIndex) {
+                    outputIndex->appendOutputPointers(address, pointers);
+                }
+                appendOutputPointers(*it, address, txStart, pointers);
+            }
+        });
+        return results;
+    }
+
     ranges::any_view<RawAddress> AddressIndex::getIncludingMultisigs(const RawAddress &searchAddress) const {
         if (dedupType(searchAddress.type) != DedupAddressType::PUBKEY) {
             return {};
@@ -140,28 +249,82 @@ namespace blocksci {
         writeBatch(batch);
     }
 
-    void AddressIndex::addOutputAddresses(std::vector<std::pair<RawAddress, InoutPointer>> outputCache) {
+    template <typename ColumnFunc>
+    void AddressIndex::addInoutAddresses(const std::vector<std::pair<RawAddress, InoutPointer>> &cache, ColumnFunc &&getColumn) {
         rocksdb::WriteBatch batch;
-        for (auto &pair : outputCache) {
+        for (auto &pair : cache) {
             const RawAddress &address = pair.first;
             const InoutPointer &pointer = pair.second;
             uint8_t txNumData[4];
-            uint8_t outputNumData[2];
+            uint8_t inoutNumData[2];
             endian::big_endian::put(pointer.txNum, txNumData);
-            endian::big_endian::put(pointer.inoutNum, outputNumData);
+            endian::big_endian::put(pointer.inoutNum, inoutNumData);
             std::array<rocksdb::Slice, 3> keyParts = {{
                 rocksdb::Slice(reinterpret_cast<const char *>(&address.scriptNum), sizeof(address.scriptNum)),
                 rocksdb::Slice(reinterpret_cast<const char *>(&txNumData[0]), 4),
-                rocksdb::Slice(reinterpret_cast<const char *>(&outputNumData[0]), 2)
+                rocksdb::Slice(reinterpret_cast<const char *>(&inoutNumData[0]), 2)
             }};
             std::string sliceStr;
             rocksdb::Slice key{rocksdb::SliceParts{keyParts.data(), keyParts.size()}, &sliceStr};
-            auto &outputColumn = getOutputColumn(address.type);
-            batch.Put(outputColumn.get(), key, rocksdb::Slice{});
+            batch.Put(getColumn(address.type).get(), key, rocksdb::Slice{});
         }
         writeBatch(batch);
     }
 
+    void AddressIndex::addOutputAddresses(std::vector<std::pair<RawAddress, InoutPointer>> outputCache) {
+        addInoutAddresses(outputCache, [&](AddressType::Enum type) -> const std::unique_ptr<rocksdb::ColumnFamilyHandle> & {
+            return getOutputColumn(type);
+        });
+    }
+
+    void AddressIndex::addInputAddresses(std::vector<std::pair<RawAddress, InoutPointer>> inputCache) {
+        addInoutAddresses(inputCache, [&](AddressType::Enum type) -> const std::unique_ptr<rocksdb::ColumnFamilyHandle> & {
+            return getInputColumn(type);
+        });
+    }
+
+    void AddressIndex::markInputIndexComplete() {
+        // Input batches are written without WAL, they have to be persisted before the marker
+        for (size_t i = 0; i < AddressType::size; i++) {
+            db->Flush(rocksdb::FlushOptions{}, getInputColumn(static_cast<AddressType::Enum>(i)).get());
+        }
+        rocksdb::WriteOptions options;
+        auto status = db->Put(options, inputIndexCompleteKey, rocksdb::Slice{});
+        if (!status.ok()) {
+            throw std::runtime_error{"Could not update address index with error: " + status.ToString()};
+        }
+        inputIndexComplete = true;
+    }
+
+    rocksdb::Options AddressIndex::sstFileOptions() {
+        // The column families use the default options, in particular the default bytewise comparator
+        return rocksdb::Options{};
+    }
+
+    void AddressIndex::ingestFiles(ColumnKind kind, AddressType::Enum type, const std::vector<std::string> &paths) {
+        if (paths.empty()) {
+            return;
+        }
+        rocksdb::ColumnFamilyHandle *column = nullptr;
+        switch (kind) {
+            case ColumnKind::Output:
+                column = getOutputColumn(type).get();
+                break;
+            case ColumnKind::Nested:
+                column = getNestedColumn(type).get();
+                break;
+            case ColumnKind::Input:
+                column = getInputColumn(type).get();
+                break;
+        }
+        rocksdb::IngestExternalFileOptions options;
+        options.move_files = true;
+        auto status = db->IngestExternalFile(column, paths, options);
+        if (!status.ok()) {
+            throw std::runtime_error{"Could not ingest files into address index with error: " + status.ToString()};
+        }
+    }
+
     /**
      Retrieve a list of dedup addresses that wrap the address.
      It's possible to receive multiple results, since multisig addresses are deduplicated, but their pubkeys might be arranged in different order, leading to different wrapping addresses.
@@ -27,6 +27,7 @@
 namespace blocksci {
     struct DedupAddress;
     class RawAddressOutputRange;
+    class AddressOutputIndex;
 
     /** Provides access to address indexes (RocksDB database)
      *
@@ -58,6 +59,17 @@ namespace blocksci {
      *    Key/value format:
      *        - Keys: uint32_t child scriptNum, DedupAddress (= parent scriptNum, parent script type)
      *        - Value: <empty>
+     *
+     * 3) The third set of tables contains a mapping of addresses to the inputs that spend outputs sent to those addresses,
+     *    so that the inputs of an address are read with one prefix scan instead of following every output to its spending
+     *    transaction. Data directories created before these tables existed get them filled in by the next parser update,
+     *    which stores a marker key in the default column once they cover all transactions of the index.
+     *
+     *    ColumnDescriptors: Every AddressType as its name and "_input" as a suffix, Eg. "pubkeyhash_input"
+     *
+     *    Key/value format:
+     *        - Key: uint32_t scriptNum, uint8_t[4] txNum, uint8_t[2] inputNumInTx
+     *        - Value: <empty>
      */
     class AddressIndex {
         friend class RawAddressOutputRange;
@@ -68,17 +80,40 @@ namespace blocksci {
         /** RocksDB column handles, one for every AddressType and the suffixes "_nested" and "_output", see above for details */
         std::vector<std::unique_ptr<rocksdb::ColumnFamilyHandle>> columnHandles;
 
+        /** Optional memory mapped index that answers output queries up to its txCount() without RocksDB */
+        std::shared_ptr<const AddressOutputIndex> outputIndex;
+
         const std::unique_ptr<rocksdb::ColumnFamilyHandle> &getOutputColumn(AddressType::Enum type) const;
         const std::unique_ptr<rocksdb::ColumnFamilyHandle> &getNestedColumn(AddressType::Enum type) const;
+        const std::unique_ptr<rocksdb::ColumnFamilyHandle> &getInputColumn(AddressType::Enum type) const;
+
+        /** Whether the "_input" columns exist in the database, they are missing in read-only databases created before them */
+        bool hasInputColumns = false;
+
+        /** Whether the "_input" columns cover all transactions of the index, @see markInputIndexComplete */
+        bool inputIndexComplete = false;
+        
+        template <typename ColumnFunc>
+        void addInoutAddresses(const std::vector<std::pair<RawAddress, InoutPointer>> &cache, ColumnFunc &&getColumn);
         
         std::unique_ptr<rocksdb::Iterator> getOutputIterator(AddressType::Enum type) const {
             return std::unique_ptr<rocksdb::Iterator>{db->NewIterator(rocksdb::ReadOptions(), getOutputColumn(type).get())};
         }
         
+        std::unique_ptr<rocksdb::Iterator> getInputIterator(AddressType::Enum type) const {
+            return std::unique_ptr<rocksdb::Iterator>{db->NewIterator(rocksdb::ReadOptions(), getInputColumn(type).get())};
+        }
+        
         std::unique_ptr<rocksdb::Iterator> getNestedIterator(AddressType::Enum type) const {
             return std::unique_ptr<rocksdb::Iterator>{db->NewIterator(rocksdb::ReadOptions(), getNestedColumn(type).get())};
         }
         
+        /** Appends the outputs of the address in transactions from txStart on, as found by it in the output column of its type */
+        static void appendOutputPointers(rocksdb::Iterator &it, const RawAddress &address, uint32_t txStart, std::vector<InoutPointer> &pointers);
+
+        /** Number of transactions whose outputs are answered by outputIndex */
+        uint32_t outputIndexTxCount() const;
+        
         void writeBatch(rocksdb::WriteBatch &batch) {
             rocksdb::WriteOptions options;
             options.disableWAL = true;
@@ -87,11 +122,34 @@ namespace blocksci {
         
     public:
         
-        AddressIndex(const filesystem::path &path, bool readonly);
+        AddressIndex(const filesystem::path &path, bool readonly, std::shared_ptr<const AddressOutputIndex> outputIndex = nullptr);
         ~AddressIndex();
 
-        /** Get InoutPointer objects for all outputs that belong to the given address */
+        /** Get InoutPointer objects for all outputs that belong to the given address
+         *
+         * Outputs covered by the AddressOutputIndex are read from it, only the outputs of later transactions are read
+         * from RocksDB.
+         */
         ranges::any_view<InoutPointer, ranges::category::forward> getOutputPointers(const RawAddress &address) const;
+
+        /** Get the InoutPointers of the outputs of many addresses at once, in the order of the given addresses
+         *
+         * The addresses are visited in key order on a shared snapshot, reusing one iterator per address type, and are
+         * split into threadCount contiguous chunks that are read in parallel. Like the single address version, the
+         * AddressOutputIndex is used for the transactions it covers.
+         */
+        std::vector<std::vector<InoutPointer>> getOutputPointers(const std::vector<RawAddress> &addresses, unsigned int threadCount = 1) const;
+        
+        /** Whether the input index covers all transactions whose outputs are in the index, which getInputPointers requires */
+        bool hasInputIndex() const {
+            return inputIndexComplete;
+        }
+
+        /** Get InoutPointer objects for all inputs that spend outputs of the given address, sorted by txNum and inputNum
+         *
+         * Requires hasInputIndex()
+         */
+        ranges::any_view<InoutPointer, ranges::category::forward> getInputPointers(const RawAddress &address) const;
         
         std::vector<DedupAddress> getNestingScriptHash(const RawAddress &searchAddress) const;
         std::unordered_set<DedupAddress> getPossibleNestedEquivalentUp(const RawAddress &searchAddress) const;
@@ -106,6 +164,31 @@ namespace blocksci {
          */
         void addOutputAddresses(std::vector<std::pair<RawAddress, InoutPointer>> outputCache);
 
+        /** Add a link between the given address and the given input spending one of its outputs to the index
+         *
+         * Key format: scriptNum, txNum, inputNumInTx
+         * Value format: <empty>
+         */
+        void addInputAddresses(std::vector<std::pair<RawAddress, InoutPointer>> inputCache);
+
+        /** Records that the input index covers all transactions whose outputs are in the index */
+        void markInputIndexComplete();
+
+        /** The three sets of columns described above */
+        enum class ColumnKind {
+            Output, Nested, Input
+        };
+
+        /** Options for rocksdb::SstFileWriters whose files are added with ingestFiles */
+        static rocksdb::Options sstFileOptions();
+
+        /** Moves SST files into the column of the given kind and address type, bypassing the memtables
+         *
+         * The keys must have the formats described above. The files must not overlap each other and their entries
+         * replace existing entries with the same keys.
+         */
+        void ingestFiles(ColumnKind kind, AddressType::Enum type, const std::vector<std::string> &paths);
+
         /** Compact the underlying RocksDB database */
         void compactDB();
     };
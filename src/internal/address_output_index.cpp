@@ -0,0 +1,408 @@
+//
+//  address_output_index.cpp
+//  blocksci
+//
+
+#include "address_output_index.hpp"
+#include "address_info.hpp"
+#include "chain_access.hpp"
+#include "delta_tables.hpp"
+
+#include <blocksci/core/inout_pointer.hpp>
+#include <blocksci/core/raw_address.hpp>
+
+#include <mio/mmap.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <tuple>
+
+namespace blocksci {
+
+    namespace {
+        /** Output of the chain sent to an address, as collected while scanning the transactions */
+        struct OutputEntry {
+            uint32_t scriptNum;
+            uint32_t txNum;
+            uint16_t outputNum;
+        };
+
+        size_t varintSize(uint64_t value) {
+            size_t size = 1;
+            while (value >= 0x80) {
+                value >>= 7;
+                size++;
+            }
+            return size;
+        }
+
+        void putVarint(std::vector<char> &buffer, uint64_t value) {
+            while (value >= 0x80) {
+                buffer.push_back(static_cast<char>((value & 0x7F) | 0x80));
+                value >>= 7;
+            }
+            buffer.push_back(static_cast<char>(value));
+        }
+
+        uint64_t getVarint(const uint8_t *&data) {
+            uint64_t value = 0;
+            unsigned int shift = 0;
+            while (*data & 0x80) {
+                value |= static_cast<uint64_t>(*data & 0x7F) << shift;
+                shift += 7;
+                data++;
+            }
+            value |= static_cast<uint64_t>(*data) << shift;
+            data++;
+            return value;
+        }
+
+        template <typename T>
+        void writeValue(std::ofstream &out, const T &value) {
+            out.write(reinterpret_cast<const char *>(&value), sizeof(value));
+        }
+
+        std::string tablePath(const filesystem::path &directory, AddressType::Enum type, const std::string &suffix) {
+            return (directory/(addressName(type) + suffix)).str() + ".dat";
+        }
+
+        /** Writes the table for the given entries, which must be sorted by scriptNum, txNum and outputNum */
+        void writeTable(const std::string &destPath, const OutputEntry *entries, size_t count, uint64_t txStart, uint64_t txEnd, const uint256 &lastTxHash) {
+            auto rowEnd = [&](size_t begin) {
+                auto end = begin;
+                while (end < count && entries[end].scriptNum == entries[begin].scriptNum) {
+                    end++;
+                }
+                return end;
+            };
+            auto rowSize = [&](size_t begin, size_t end) {
+                uint64_t size = 0;
+                uint64_t previousTxNum = txStart;
+                for (auto i = begin; i < end; i++) {
+                    size += varintSize(entries[i].txNum - previousTxNum) + varintSize(entries[i].outputNum);
+                    previousTxNum = entries[i].txNum;
+                }
+                return size;
+            };
+
+            AddressOutputTableHeader header;
+            header.magic = AddressOutputTableHeader::magicValue;
+            header.version = AddressOutputTableHeader::currentVersion;
+            header.txStart = txStart;
+            header.txEnd = txEnd;
+            header.outputCount = count;
+            header.lastTxHash = lastTxHash;
+
+            uint64_t distinctCount = 0;
+            uint64_t payloadSize = 0;
+            for (size_t i = 0; i < count;) {
+                auto end = rowEnd(i);
+                payloadSize += rowSize(i, end);
+                distinctCount++;
+                i = end;
+            }
+            uint64_t slotCount = count > 0 ? uint64_t{entries[count - 1].scriptNum} + 1 : 0;
+            // A dense row costs 8 bytes per possible scriptNum, a sparse row 12 bytes per scriptNum that occurs
+            bool dense = slotCount * 2 <= distinctCount * 3;
+            header.layout = dense ? AddressOutputTableHeader::Dense : AddressOutputTableHeader::Sparse;
+            header.rowCount = dense ? slotCount : distinctCount;
+            header.payloadSize = payloadSize;
+
+            auto tempPath = destPath + ".tmp";
+            {
+                std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+                if (!out) {
+                    throw std::runtime_error("Could not create " + tempPath);
+                }
+                writeValue(out, header);
+                uint64_t offset = 0;
+                if (dense) {
+                    size_t i = 0;
+                    for (uint64_t scriptNum = 0; scriptNum < slotCount; scriptNum++) {
+                        writeValue(out, offset);
+                        if (i < count && entries[i].scriptNum == scriptNum) {
+                            auto end = rowEnd(i);
+                            offset += rowSize(i, end);
+                            i = end;
+                        }
+                    }
+                } else {
+                    for (size_t i = 0; i < count; i = rowEnd(i)) {
+                        writeValue(out, entries[i].scriptNum);
+                    }
+                    if (distinctCount % 2 == 1) {
+                        writeValue(out, uint32_t{0});
+                    }
+                    for (size_t i = 0; i < count;) {
+                        writeValue(out, offset);
+                        auto end = rowEnd(i);
+                        offset += rowSize(i, end);
+                        i = end;
+                    }
+                }
+                writeValue(out, offset);
+
+                std::vector<char> row;
+                for (size_t i = 0; i < count;) {
+                    auto end = rowEnd(i);
+                    row.clear();
+                    uint64_t previousTxNum = txStart;
+                    for (auto j = i; j < end; j++) {
+                        putVarint(row, entries[j].txNum - previousTxNum);
+                        putVarint(row, entries[j].outputNum);
+                        previousTxNum = entries[j].txNum;
+                    }
+                    out.write(row.data(), static_cast<std::streamsize>(row.size()));
+                    i = end;
+                }
+                if (!out) {
+                    throw std::runtime_error("Error writing " + tempPath);
+                }
+            }
+
+            if (std::rename(tempPath.c_str(), destPath.c_str()) != 0) {
+                throw std::runtime_error("Could not move " + tempPath + " to " + destPath);
+            }
+        }
+
+        /** Builds one table per address type for the transactions txStart up to but excluding txEnd
+         *
+         * previous holds zero or more sets of tables, one table per address type, that cover consecutive transactions
+         * from txStart on. Their outputs are copied instead of reading the transactions again. The outputs are collected in
+         * one temporary file per type, the copied ones first, and the new ones are sorted and merged with them in place
+         * while mapped.
+         */
+        void buildTables(const filesystem::path &directory, const std::string &suffix, const ChainAccess &chain, uint64_t txStart, uint64_t txEnd, const std::vector<std::vector<const AddressOutputTable *>> &previous) {
+            auto txBegin = previous.empty() ? txStart : previous.back()[0]->header().txEnd;
+            std::vector<std::string> entryPaths;
+            // Number of entries of every type at the end of each of the previous table sets, which are sorted already
+            std::vector<std::vector<uint64_t>> sortedEnds(AddressType::size);
+            {
+                std::vector<std::ofstream> entryFiles;
+                for (size_t i = 0; i < AddressType::size; i++) {
+                    entryPaths.push_back(tablePath(directory, static_cast<AddressType::Enum>(i), suffix) + ".entries");
+                    entryFiles.emplace_back(entryPaths.back(), std::ios::binary | std::ios::trunc);
+                    if (!entryFiles.back()) {
+                        throw std::runtime_error("Could not create " + entryPaths.back());
+                    }
+                }
+                for (auto &tables : previous) {
+                    for (size_t i = 0; i < AddressType::size; i++) {
+                        tables[i]->forEachOutput([&](uint32_t scriptNum, const InoutPointer &pointer) {
+                            writeValue(entryFiles[i], OutputEntry{scriptNum, pointer.txNum, pointer.inoutNum});
+                        });
+                        sortedEnds[i].push_back((sortedEnds[i].empty() ? 0 : sortedEnds[i].back()) + tables[i]->header().outputCount);
+                    }
+                }
+                for (auto txNum = txBegin; txNum < txEnd; txNum++) {
+                    auto tx = chain.getTx(static_cast<uint32_t>(txNum));
+                    for (uint16_t i = 0; i < tx->outputCount; i++) {
+                        auto &output = tx->getOutput(i);
+                        OutputEntry entry{output.getAddressNum(), static_cast<uint32_t>(txNum), i};
+                        writeValue(entryFiles[static_cast<size_t>(output.getType())], entry);
+                    }
+                }
+                for (size_t i = 0; i < entryFiles.size(); i++) {
+                    entryFiles[i].close();
+                    if (!entryFiles[i]) {
+                        throw std::runtime_error("Error writing " + entryPaths[i]);
+                    }
+                }
+            }
+
+            auto lastTxHash = *chain.getTxHash(static_cast<uint32_t>(txEnd - 1));
+            for (size_t i = 0; i < AddressType::size; i++) {
+                auto destPath = tablePath(directory, static_cast<AddressType::Enum>(i), suffix);
+                auto entryCount = filesystem::path{entryPaths[i]}.file_size() / sizeof(OutputEntry);
+                if (entryCount == 0) {
+                    writeTable(destPath, nullptr, 0, txStart, txEnd, lastTxHash);
+                } else {
+                    mio::basic_mmap<mio::access_mode::write, char> mapped;
+                    std::error_code error;
+                    mapped.map(entryPaths[i], 0, mio::map_entire_file, error);
+                    if (error) {
+                        throw std::runtime_error("Could not map " + entryPaths[i]);
+                    }
+                    auto entries = reinterpret_cast<OutputEntry *>(mapped.data());
+                    auto entryLess = [](const OutputEntry &a, const OutputEntry &b) {
+                        return std::tie(a.scriptNum, a.txNum, a.outputNum) < std::tie(b.scriptNum, b.txNum, b.outputNum);
+                    };
+                    uint64_t sortedEnd = sortedEnds[i].empty() ? 0 : sortedEnds[i].back();
+                    std::sort(entries + sortedEnd, entries + entryCount, entryLess);
+                    uint64_t mergedEnd = sortedEnds[i].empty() ? 0 : sortedEnds[i].front();
+                    for (size_t j = 1; j <= sortedEnds[i].size(); j++) {
+                        auto end = j < sortedEnds[i].size() ? sortedEnds[i][j] : entryCount;
+                        std::inplace_merge(entries, entries + mergedEnd, entries + end, entryLess);
+                        mergedEnd = end;
+                    }
+                    writeTable(destPath, entries, entryCount, txStart, txEnd, lastTxHash);
+                }
+                std::remove(entryPaths[i].c_str());
+            }
+        }
+    } // namespace
+
+    bool AddressOutputTable::load(const char *data, int64_t size) {
+        *this = AddressOutputTable{};
+        if (data == nullptr || size < static_cast<int64_t>(sizeof(AddressOutputTableHeader))) {
+            return false;
+        }
+        auto header = reinterpret_cast<const AddressOutputTableHeader *>(data);
+        if (header->magic != AddressOutputTableHeader::magicValue || header->version != AddressOutputTableHeader::currentVersion || header->layout > AddressOutputTableHeader::Sparse) {
+            return false;
+        }
+        auto position = data + sizeof(AddressOutputTableHeader);
+        uint64_t directorySize = (header->rowCount + 1) * sizeof(uint64_t);
+        if (header->layout == AddressOutputTableHeader::Sparse) {
+            directorySize += (header->rowCount + header->rowCount % 2) * sizeof(uint32_t);
+        }
+        if (static_cast<uint64_t>(size) != sizeof(AddressOutputTableHeader) + directorySize + header->payloadSize) {
+            return false;
+        }
+        if (header->layout == AddressOutputTableHeader::Sparse) {
+            scriptNums = reinterpret_cast<const uint32_t *>(position);
+            position += (header->rowCount + header->rowCount % 2) * sizeof(uint32_t);
+        }
+        offsets = reinterpret_cast<const uint64_t *>(position);
+        payload = reinterpret_cast<const uint8_t *>(offsets + header->rowCount + 1);
+        tableHeader = header;
+        return true;
+    }
+
+    void AddressOutputTable::appendOutputPointers(uint32_t scriptNum, std::vector<InoutPointer> &pointers) const {
+        uint64_t row;
+        if (scriptNums == nullptr) {
+            if (scriptNum >= tableHeader->rowCount) {
+                return;
+            }
+            row = scriptNum;
+        } else {
+            auto end = scriptNums + tableHeader->rowCount;
+            auto it = std::lower_bound(scriptNums, end, scriptNum);
+            if (it == end || *it != scriptNum) {
+                return;
+            }
+            row = static_cast<uint64_t>(it - scriptNums);
+        }
+        auto data = payload + offsets[row];
+        auto rowEnd = payload + offsets[row + 1];
+        auto txNum = tableHeader->txStart;
+        while (data < rowEnd) {
+            txNum += getVarint(data);
+            auto outputNum = getVarint(data);
+            pointers.emplace_back(static_cast<uint32_t>(txNum), static_cast<uint16_t>(outputNum));
+        }
+    }
+
+    void AddressOutputTable::forEachOutput(const std::function<void(uint32_t scriptNum, const InoutPointer &pointer)> &func) const {
+        for (uint64_t row = 0; row < tableHeader->rowCount; row++) {
+            auto scriptNum = static_cast<uint32_t>(scriptNums == nullptr ? row : scriptNums[row]);
+            auto data = payload + offsets[row];
+            auto rowEnd = payload + offsets[row + 1];
+            auto txNum = tableHeader->txStart;
+            while (data < rowEnd) {
+                txNum += getVarint(data);
+                auto outputNum = getVarint(data);
+                func(scriptNum, InoutPointer{static_cast<uint32_t>(txNum), static_cast<uint16_t>(outputNum)});
+            }
+        }
+    }
+
+    AddressOutputIndex::MappedTable::MappedTable(const filesystem::path &path) : file(path) {
+        if (file.size() > 0) {
+            table.load(file.getDataAtOffset(0), file.size());
+        }
+    }
+
+    AddressOutputIndex::TableSet AddressOutputIndex::openTables(const filesystem::path &directory, const std::string &suffix) {
+        TableSet tables;
+        for (size_t i = 0; i < AddressType::size; i++) {
+            tables.emplace_back(directory/(addressName(static_cast<AddressType::Enum>(i)) + suffix));
+        }
+        return tables;
+    }
+
+    AddressOutputIndex::AddressOutputIndex(const filesystem::path &directory, const ChainAccess &chain) {
+        // All tables of a set have to cover the same transactions and end with the same transaction as the chain
+        auto isConsistent = [&](const TableSet &tables, uint64_t txStart) {
+            for (auto &mapped : tables) {
+                if (!mapped.table.isLoaded()) {
+                    return false;
+                }
+                auto &header = mapped.table.header();
+                if (header.txStart != txStart || header.txEnd != tables[0].table.header().txEnd) {
+                    return false;
+                }
+            }
+            auto &header = tables[0].table.header();
+            return header.txEnd > header.txStart && header.txEnd <= chain.txCount() && *chain.getTxHash(static_cast<uint32_t>(header.txEnd - 1)) == header.lastTxHash;
+        };
+        if (!directory.exists()) {
+            return;
+        }
+        base = openTables(directory, "");
+        hasBase = isConsistent(base, 0);
+        if (!hasBase) {
+            base.clear();
+            return;
+        }
+        delta = openTables(directory, "_delta");
+        hasDelta = isConsistent(delta, baseTxCount());
+        if (!hasDelta) {
+            delta.clear();
+        }
+    }
+
+    void AddressOutputIndex::appendOutputPointers(const RawAddress &address, std::vector<InoutPointer> &pointers) const {
+        auto typeIndex = static_cast<size_t>(address.type);
+        if (hasBase) {
+            base[typeIndex].table.appendOutputPointers(address.scriptNum, pointers);
+        }
+        if (hasDelta) {
+            delta[typeIndex].table.appendOutputPointers(address.scriptNum, pointers);
+        }
+    }
+
+    std::vector<const AddressOutputTable *> AddressOutputIndex::tables(const TableSet &set) {
+        std::vector<const AddressOutputTable *> tables;
+        for (auto &mapped : set) {
+            tables.push_back(&mapped.table);
+        }
+        return tables;
+    }
+
+    uint64_t updateAddressOutputIndex(const filesystem::path &directory, const ChainAccess &chain) {
+        if (!directory.exists()) {
+            filesystem::create_directory(directory);
+        }
+        // The current tables stay mapped while the new ones are merged from them, replacing the files does not affect the mappings
+        AddressOutputIndex index{directory, chain};
+        auto baseTxCount = index.baseTxCount();
+        auto indexedTxCount = index.txCount();
+        auto txCount = static_cast<uint64_t>(chain.txCount());
+        if (txCount == 0 || indexedTxCount == txCount) {
+            return 0;
+        }
+
+        // Base tables are merged from both current table sets, a delta table from the current delta tables
+        auto rebuildsBase = rebuildsBaseTables(baseTxCount, txCount);
+        std::vector<std::vector<const AddressOutputTable *>> previous;
+        if (rebuildsBase && index.isGood()) {
+            previous.push_back(index.baseTables());
+        }
+        if (indexedTxCount > baseTxCount) {
+            previous.push_back(index.deltaTables());
+        }
+        if (rebuildsBase) {
+            buildTables(directory, "", chain, 0, txCount, previous);
+            for (size_t i = 0; i < AddressType::size; i++) {
+                std::remove(tablePath(directory, static_cast<AddressType::Enum>(i), "_delta").c_str());
+            }
+        } else {
+            buildTables(directory, "_delta", chain, baseTxCount, txCount, previous);
+        }
+        return txCount - indexedTxCount;
+    }
+} // namespace blocksci
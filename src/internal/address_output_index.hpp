@@ -0,0 +1,160 @@
+//
+//  address_output_index.hpp
+//  blocksci
+//
+
+#ifndef address_output_index_hpp
+#define address_output_index_hpp
+
+#include "file_mapper.hpp"
+
+#include <blocksci/core/address_types.hpp>
+#include <blocksci/core/bitcoin_uint256.hpp>
+#include <blocksci/core/core_fwd.hpp>
+
+#include <wjfilesystem/path.h>
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace blocksci {
+    class ChainAccess;
+
+    /** Header of an address output table file, which lists the outputs of the transactions txStart up to but excluding
+     * txEnd that were sent to addresses of one address type in compressed sparse row form
+     *
+     * Dense layout:  [AddressOutputTableHeader][uint64_t offsets[rowCount + 1]][payload]
+     *     Row r belongs to scriptNum r, so the outputs of an address are found without a search.
+     * Sparse layout: [AddressOutputTableHeader][uint32_t scriptNums[rowCount]][padding to 8 bytes][uint64_t offsets[rowCount + 1]][payload]
+     *     Row r belongs to scriptNums[r], which are sorted, and is found by binary search. Used when only a small part of
+     *     the scriptNums of the type occur in the table, eg. for pubkeys that are mostly used as P2PKH.
+     *
+     * The outputs of row r are stored in payload[offsets[r]] up to payload[offsets[r + 1]], sorted by txNum and
+     * outputNum, as pairs of LEB128 varints (txNum - previous txNum, outputNum). The first txNum is relative to txStart.
+     */
+    struct AddressOutputTableHeader {
+        /** "BSCIAOI1" when read as little endian */
+        static constexpr uint64_t magicValue = 0x31494F4149435342;
+        static constexpr uint32_t currentVersion = 1;
+
+        enum Layout : uint32_t {
+            Dense = 0,
+            Sparse = 1
+        };
+
+        uint64_t magic;
+        uint32_t version;
+        uint32_t layout;
+        uint64_t txStart;
+        uint64_t txEnd;
+        uint64_t rowCount;
+        uint64_t outputCount;
+        uint64_t payloadSize;
+        /** Hash of transaction txEnd - 1, used to detect that the indexed transactions have been replaced */
+        uint256 lastTxHash;
+    };
+
+    /** Read-only view of an address output table file, @see AddressOutputTableHeader */
+    class AddressOutputTable {
+    public:
+        /** Interprets data as an address output table file, returns false and stays empty if it is not a valid one */
+        bool load(const char *data, int64_t size);
+
+        bool isLoaded() const {
+            return tableHeader != nullptr;
+        }
+
+        const AddressOutputTableHeader &header() const {
+            return *tableHeader;
+        }
+
+        /** Appends the outputs sent to the given scriptNum in this table to pointers */
+        void appendOutputPointers(uint32_t scriptNum, std::vector<InoutPointer> &pointers) const;
+
+        /** Calls func for every output of the table in scriptNum, txNum and outputNum order */
+        void forEachOutput(const std::function<void(uint32_t scriptNum, const InoutPointer &pointer)> &func) const;
+
+    private:
+        const AddressOutputTableHeader *tableHeader = nullptr;
+        const uint32_t *scriptNums = nullptr;
+        const uint64_t *offsets = nullptr;
+        const uint8_t *payload = nullptr;
+    };
+
+    /** Memory mapped address to outputs index that answers Address::getOutputPointers without RocksDB prefix scans
+     *
+     * The outputs of an address are stored as one contiguous, delta encoded row per address type, so even addresses with
+     * millions of outputs are read with a few sequential page reads and one varint decode per output, instead of one
+     * RocksDB iterator step and key decode per output.
+     *
+     * The index consists of a base and a delta table per address type, @see rebuildsBaseTables. Outputs of transactions
+     * after txCount() are not in the index and have to be read from the RocksDB address index,
+     * @see AddressIndex::getOutputPointers
+     *
+     * Tables that do not match each other or the chain are ignored.
+     *
+     * Files: <directory>/<address type>.dat and <directory>/<address type>_delta.dat
+     */
+    class AddressOutputIndex {
+    public:
+        AddressOutputIndex(const filesystem::path &directory, const ChainAccess &chain);
+
+        bool isGood() const {
+            return baseTxCount() > 0;
+        }
+
+        /** Number of transactions covered by the base tables */
+        uint64_t baseTxCount() const {
+            return hasBase ? base[0].table.header().txEnd : 0;
+        }
+
+        /** Number of transactions covered by the index */
+        uint64_t txCount() const {
+            return hasDelta ? delta[0].table.header().txEnd : baseTxCount();
+        }
+
+        /** Appends the outputs of the transactions covered by the index that were sent to the given address */
+        void appendOutputPointers(const RawAddress &address, std::vector<InoutPointer> &pointers) const;
+
+        /** The base tables indexed by address type, empty if there are none */
+        std::vector<const AddressOutputTable *> baseTables() const {
+            return tables(base);
+        }
+
+        /** The delta tables indexed by address type, empty if there are none */
+        std::vector<const AddressOutputTable *> deltaTables() const {
+            return tables(delta);
+        }
+
+    private:
+        struct MappedTable {
+            SimpleFileMapper<> file;
+            AddressOutputTable table;
+
+            explicit MappedTable(const filesystem::path &path);
+        };
+
+        using TableSet = std::vector<MappedTable>;
+
+        TableSet base;
+        TableSet delta;
+        bool hasBase = false;
+        bool hasDelta = false;
+
+        static TableSet openTables(const filesystem::path &directory, const std::string &suffix);
+        static std::vector<const AddressOutputTable *> tables(const TableSet &set);
+    };
+
+    /** Brings the address output index up to date with the chain, building new delta tables or new base tables
+     *
+     * The new tables are merged from the current tables and the outputs of the transactions added since the last update,
+     * which are the only transactions that are read.
+     *
+     * @return the number of transactions that were added to the index
+     */
+    uint64_t updateAddressOutputIndex(const filesystem::path &directory, const ChainAccess &chain);
+} // namespace blocksci
+
+#endif /* address_output_index_hpp */
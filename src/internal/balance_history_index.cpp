@@ -0,0 +1,535 @@
+//
+//  balance_history_index.cpp
+//  blocksci
+//
+
+#include "balance_history_index.hpp"
+#include "address_info.hpp"
+#include "batch_lookup.hpp"
+#include "chain_access.hpp"
+#include "delta_tables.hpp"
+
+#include <blocksci/core/raw_address.hpp>
+
+#include <mio/mmap.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <queue>
+#include <stdexcept>
+#include <tuple>
+
+namespace blocksci {
+
+    namespace {
+        /** Change of the balance of an address in one transaction, as collected while scanning the transactions */
+        struct ChangeEntry {
+            uint32_t scriptNum;
+            uint32_t height;
+            int64_t delta;
+        };
+
+        bool changeLess(const ChangeEntry &a, const ChangeEntry &b) {
+            return std::tie(a.scriptNum, a.height) < std::tie(b.scriptNum, b.height);
+        }
+
+        void putVarint(std::vector<char> &buffer, uint64_t value) {
+            while (value >= 0x80) {
+                buffer.push_back(static_cast<char>((value & 0x7F) | 0x80));
+                value >>= 7;
+            }
+            buffer.push_back(static_cast<char>(value));
+        }
+
+        uint64_t getVarint(const uint8_t *&data) {
+            uint64_t value = 0;
+            unsigned int shift = 0;
+            while (*data & 0x80) {
+                value |= static_cast<uint64_t>(*data & 0x7F) << shift;
+                shift += 7;
+                data++;
+            }
+            value |= static_cast<uint64_t>(*data) << shift;
+            data++;
+            return value;
+        }
+
+        uint64_t zigzagEncode(int64_t value) {
+            return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+        }
+
+        int64_t zigzagDecode(uint64_t value) {
+            return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+        }
+
+        template <typename T>
+        void writeValue(std::ofstream &out, const T &value) {
+            out.write(reinterpret_cast<const char *>(&value), sizeof(value));
+        }
+
+        std::string tablePath(const filesystem::path &directory, AddressType::Enum type, const std::string &suffix) {
+            return (directory/(addressName(type) + suffix)).str() + ".dat";
+        }
+
+        uint64_t paddingSize(uint64_t size) {
+            return (8 - size % 8) % 8;
+        }
+
+        /** Writes a table from changes that are added in scriptNum and height order
+         *
+         * The payload is streamed into the table while the rows and checkpoints go to temporary files, which are appended
+         * to the table once all changes have been added.
+         */
+        class TableWriter {
+        public:
+            TableWriter(std::string destPath_, uint64_t txStart, uint64_t txEnd, const uint256 &lastTxHash) :
+            destPath(std::move(destPath_)), tempPath(destPath + ".tmp"), rowsPath(destPath + ".rows"), checkpointsPath(destPath + ".checkpoints"),
+            out(tempPath, std::ios::binary | std::ios::trunc), rowsOut(rowsPath, std::ios::binary | std::ios::trunc), checkpointsOut(checkpointsPath, std::ios::binary | std::ios::trunc) {
+                if (!out || !rowsOut || !checkpointsOut) {
+                    throw std::runtime_error("Could not create " + tempPath);
+                }
+                header = BalanceHistoryTableHeader{};
+                header.magic = BalanceHistoryTableHeader::magicValue;
+                header.version = BalanceHistoryTableHeader::currentVersion;
+                header.checkpointInterval = BalanceHistoryIndex::checkpointInterval;
+                header.txStart = txStart;
+                header.txEnd = txEnd;
+                header.lastTxHash = lastTxHash;
+                writeValue(out, header);
+            }
+
+            void addChange(uint32_t scriptNum, uint32_t height, int64_t delta) {
+                if (!changes.empty() && scriptNum != rowScriptNum) {
+                    writeRow();
+                }
+                rowScriptNum = scriptNum;
+                changes.emplace_back(height, delta);
+            }
+
+            void finish() {
+                if (!changes.empty()) {
+                    writeRow();
+                }
+                rowsOut.close();
+                checkpointsOut.close();
+                if (!rowsOut || !checkpointsOut) {
+                    throw std::runtime_error("Error writing " + rowsPath);
+                }
+                std::vector<char> padding(paddingSize(header.payloadSize), 0);
+                out.write(padding.data(), static_cast<std::streamsize>(padding.size()));
+                for (auto &path : {rowsPath, checkpointsPath}) {
+                    std::ifstream in(path, std::ios::binary);
+                    if (in.peek() != std::ifstream::traits_type::eof()) {
+                        out << in.rdbuf();
+                    }
+                    in.close();
+                    std::remove(path.c_str());
+                }
+                out.seekp(0);
+                writeValue(out, header);
+                out.close();
+                if (!out) {
+                    throw std::runtime_error("Error writing " + tempPath);
+                }
+                if (std::rename(tempPath.c_str(), destPath.c_str()) != 0) {
+                    throw std::runtime_error("Could not move " + tempPath + " to " + destPath);
+                }
+            }
+
+        private:
+            std::string destPath;
+            std::string tempPath;
+            std::string rowsPath;
+            std::string checkpointsPath;
+            std::ofstream out;
+            std::ofstream rowsOut;
+            std::ofstream checkpointsOut;
+            BalanceHistoryTableHeader header;
+
+            uint32_t rowScriptNum = 0;
+            std::vector<std::pair<uint32_t, int64_t>> changes;
+            std::vector<char> buffer;
+
+            void writeRow() {
+                writeValue(rowsOut, BalanceHistoryRow{rowScriptNum, static_cast<uint32_t>(changes.size()), header.checkpointCount});
+                buffer.clear();
+                int64_t balance = 0;
+                uint32_t previousHeight = 0;
+                for (size_t i = 0; i < changes.size(); i++) {
+                    if (i % header.checkpointInterval == 0) {
+                        writeValue(checkpointsOut, BalanceCheckpoint{changes[i].first, 0, balance, header.payloadSize + buffer.size()});
+                        header.checkpointCount++;
+                        previousHeight = changes[i].first;
+                    }
+                    putVarint(buffer, changes[i].first - previousHeight);
+                    putVarint(buffer, zigzagEncode(changes[i].second));
+                    previousHeight = changes[i].first;
+                    balance += changes[i].second;
+                }
+                out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+                header.payloadSize += buffer.size();
+                header.rowCount++;
+                header.changeCount += changes.size();
+                changes.clear();
+            }
+        };
+
+        /** Collects the balance changes caused by the transactions txBegin up to but excluding txEnd in one file per
+         * address type and sorts each file in place while mapped
+         *
+         * Outputs add their value to the balance of their address at the height of their block, inputs subtract the value
+         * of the output they spend at the height of the spending block.
+         */
+        std::vector<std::string> collectChanges(const filesystem::path &directory, const std::string &suffix, const ChainAccess &chain, uint64_t txBegin, uint64_t txEnd) {
+            std::vector<std::string> changePaths;
+            {
+                std::vector<std::ofstream> changeFiles;
+                for (size_t i = 0; i < AddressType::size; i++) {
+                    changePaths.push_back(tablePath(directory, static_cast<AddressType::Enum>(i), suffix) + ".changes." + std::to_string(txBegin));
+                    changeFiles.emplace_back(changePaths.back(), std::ios::binary | std::ios::trunc);
+                    if (!changeFiles.back()) {
+                        throw std::runtime_error("Could not create " + changePaths.back());
+                    }
+                }
+                auto addChange = [&](const Inout &inout, uint32_t height, int64_t sign) {
+                    if (inout.getValue() != 0) {
+                        writeValue(changeFiles[static_cast<size_t>(inout.getType())], ChangeEntry{inout.getAddressNum(), height, sign * inout.getValue()});
+                    }
+                };
+                auto height = chain.getBlockHeight(static_cast<uint32_t>(txBegin));
+                auto block = chain.getBlock(height);
+                for (auto txNum = txBegin; txNum < txEnd; txNum++) {
+                    while (txNum >= uint64_t{block->firstTxIndex} + block->txCount) {
+                        height++;
+                        block = chain.getBlock(height);
+                    }
+                    auto tx = chain.getTx(static_cast<uint32_t>(txNum));
+                    for (uint16_t i = 0; i < tx->inputCount; i++) {
+                        addChange(tx->getInput(i), static_cast<uint32_t>(height), -1);
+                    }
+                    for (uint16_t i = 0; i < tx->outputCount; i++) {
+                        addChange(tx->getOutput(i), static_cast<uint32_t>(height), 1);
+                    }
+                }
+                for (size_t i = 0; i < changeFiles.size(); i++) {
+                    changeFiles[i].close();
+                    if (!changeFiles[i]) {
+                        throw std::runtime_error("Error writing " + changePaths[i]);
+                    }
+                }
+            }
+
+            for (auto &path : changePaths) {
+                auto changeCount = filesystem::path{path}.file_size() / sizeof(ChangeEntry);
+                if (changeCount > 0) {
+                    mio::basic_mmap<mio::access_mode::write, char> mapped;
+                    std::error_code error;
+                    mapped.map(path, 0, mio::map_entire_file, error);
+                    if (error) {
+                        throw std::runtime_error("Could not map " + path);
+                    }
+                    auto changes = reinterpret_cast<ChangeEntry *>(mapped.data());
+                    std::sort(changes, changes + changeCount, changeLess);
+                }
+            }
+            return changePaths;
+        }
+
+        /** Writes the table of one address type by merging the sorted change files of all transaction ranges, summing
+         * the changes of an address within a block
+         */
+        void writeTable(const std::string &destPath, const std::vector<std::string> &changePaths, uint64_t txStart, uint64_t txEnd, const uint256 &lastTxHash) {
+            std::vector<mio::basic_mmap<mio::access_mode::read, char>> mappings;
+            std::vector<std::pair<const ChangeEntry *, const ChangeEntry *>> sources;
+            for (auto &path : changePaths) {
+                auto changeCount = filesystem::path{path}.file_size() / sizeof(ChangeEntry);
+                if (changeCount > 0) {
+                    std::error_code error;
+                    mappings.emplace_back();
+                    mappings.back().map(path, 0, mio::map_entire_file, error);
+                    if (error) {
+                        throw std::runtime_error("Could not map " + path);
+                    }
+                    auto changes = reinterpret_cast<const ChangeEntry *>(mappings.back().data());
+                    sources.emplace_back(changes, changes + changeCount);
+                }
+            }
+
+            auto sourceGreater = [&](size_t a, size_t b) {
+                return changeLess(*sources[b].first, *sources[a].first);
+            };
+            std::priority_queue<size_t, std::vector<size_t>, decltype(sourceGreater)> queue(sourceGreater);
+            for (size_t i = 0; i < sources.size(); i++) {
+                queue.push(i);
+            }
+
+            TableWriter writer{destPath, txStart, txEnd, lastTxHash};
+            bool hasPending = false;
+            ChangeEntry pending{0, 0, 0};
+            while (!queue.empty()) {
+                auto source = queue.top();
+                queue.pop();
+                auto change = *sources[source].first++;
+                if (sources[source].first != sources[source].second) {
+                    queue.push(source);
+                }
+                if (hasPending && change.scriptNum == pending.scriptNum && change.height == pending.height) {
+                    pending.delta += change.delta;
+                    continue;
+                }
+                if (hasPending && pending.delta != 0) {
+                    writer.addChange(pending.scriptNum, pending.height, pending.delta);
+                }
+                pending = change;
+                hasPending = true;
+            }
+            if (hasPending && pending.delta != 0) {
+                writer.addChange(pending.scriptNum, pending.height, pending.delta);
+            }
+            writer.finish();
+        }
+
+        /** Builds one table per address type for the transactions txStart up to but excluding txEnd
+         *
+         * previous holds zero or more sets of tables, one table per address type, that cover consecutive transactions
+         * from txStart on. Their changes are copied to sorted change files that are merged like those of the new
+         * transactions, so only the transactions after the previous tables are read.
+         */
+        void buildTables(const filesystem::path &directory, const std::string &suffix, const ChainAccess &chain, uint64_t txStart, uint64_t txEnd, const std::vector<std::vector<const BalanceHistoryTable *>> &previous, unsigned int threadCount) {
+            auto txBegin = previous.empty() ? txStart : previous.back()[0]->header().txEnd;
+            std::mutex chunkMutex;
+            std::map<uint64_t, std::vector<std::string>> chunkPaths;
+            forEachChunk(txEnd - txBegin, threadCount, [&](size_t begin, size_t end) {
+                auto paths = collectChanges(directory, suffix, chain, txBegin + begin, txBegin + end);
+                std::lock_guard<std::mutex> lock(chunkMutex);
+                chunkPaths[txBegin + begin] = std::move(paths);
+            });
+
+            auto lastTxHash = *chain.getTxHash(static_cast<uint32_t>(txEnd - 1));
+            forEachChunk(AddressType::size, threadCount, [&](size_t begin, size_t end) {
+                for (auto i = begin; i < end; i++) {
+                    auto destPath = tablePath(directory, static_cast<AddressType::Enum>(i), suffix);
+                    std::vector<std::string> changePaths;
+                    for (auto &tables : previous) {
+                        changePaths.push_back(destPath + ".changes.previous." + std::to_string(tables[i]->header().txStart));
+                        std::ofstream out(changePaths.back(), std::ios::binary | std::ios::trunc);
+                        tables[i]->forEachChange([&](uint32_t scriptNum, uint32_t height, int64_t delta) {
+                            writeValue(out, ChangeEntry{scriptNum, height, delta});
+                        });
+                        out.close();
+                        if (!out) {
+                            throw std::runtime_error("Error writing " + changePaths.back());
+                        }
+                    }
+                    for (auto &chunk : chunkPaths) {
+                        changePaths.push_back(chunk.second[i]);
+                    }
+                    writeTable(destPath, changePaths, txStart, txEnd, lastTxHash);
+                    for (auto &path : changePaths) {
+                        std::remove(path.c_str());
+                    }
+                }
+            });
+        }
+    } // namespace
+
+    bool BalanceHistoryTable::load(const char *data, int64_t size) {
+        *this = BalanceHistoryTable{};
+        if (data == nullptr || size < static_cast<int64_t>(sizeof(BalanceHistoryTableHeader))) {
+            return false;
+        }
+        auto header = reinterpret_cast<const BalanceHistoryTableHeader *>(data);
+        if (header->magic != BalanceHistoryTableHeader::magicValue || header->version != BalanceHistoryTableHeader::currentVersion || header->checkpointInterval == 0) {
+            return false;
+        }
+        auto payloadEnd = sizeof(BalanceHistoryTableHeader) + header->payloadSize;
+        auto rowsStart = payloadEnd + paddingSize(payloadEnd);
+        if (static_cast<uint64_t>(size) != rowsStart + header->rowCount * sizeof(BalanceHistoryRow) + header->checkpointCount * sizeof(BalanceCheckpoint)) {
+            return false;
+        }
+        payload = reinterpret_cast<const uint8_t *>(data + sizeof(BalanceHistoryTableHeader));
+        rows = reinterpret_cast<const BalanceHistoryRow *>(data + rowsStart);
+        checkpoints = reinterpret_cast<const BalanceCheckpoint *>(rows + header->rowCount);
+        tableHeader = header;
+        return true;
+    }
+
+    void BalanceHistoryTable::addBalances(uint32_t scriptNum, const std::vector<uint32_t> &heights, std::vector<int64_t> &balances) const {
+        auto rowsEnd = rows + tableHeader->rowCount;
+        auto row = std::lower_bound(rows, rowsEnd, scriptNum, [](const BalanceHistoryRow &r, uint32_t num) {
+            return r.scriptNum < num;
+        });
+        if (row == rowsEnd || row->scriptNum != scriptNum) {
+            return;
+        }
+        uint64_t interval = tableHeader->checkpointInterval;
+        auto first = checkpoints + row->firstCheckpoint;
+        auto last = first + (row->changeCount + interval - 1) / interval;
+        for (size_t i = 0; i < heights.size(); i++) {
+            auto height = heights[i];
+            auto checkpoint = std::upper_bound(first, last, height, [](uint32_t h, const BalanceCheckpoint &c) {
+                return h < c.height;
+            });
+            if (checkpoint == first) {
+                continue;
+            }
+            --checkpoint;
+            auto group = static_cast<uint64_t>(checkpoint - first);
+            auto groupSize = std::min(interval, row->changeCount - group * interval);
+            auto balance = checkpoint->balance;
+            auto changeHeight = uint64_t{checkpoint->height};
+            auto data = payload + checkpoint->payloadOffset;
+            for (uint64_t j = 0; j < groupSize; j++) {
+                changeHeight += getVarint(data);
+                if (changeHeight > height) {
+                    break;
+                }
+                balance += zigzagDecode(getVarint(data));
+            }
+            balances[i] += balance;
+        }
+    }
+
+    void BalanceHistoryTable::forEachChange(const std::function<void(uint32_t scriptNum, uint32_t height, int64_t delta)> &func) const {
+        uint64_t interval = tableHeader->checkpointInterval;
+        for (auto row = rows; row != rows + tableHeader->rowCount; ++row) {
+            uint64_t height = 0;
+            const uint8_t *data = nullptr;
+            for (uint64_t i = 0; i < row->changeCount; i++) {
+                if (i % interval == 0) {
+                    auto &checkpoint = checkpoints[row->firstCheckpoint + i / interval];
+                    height = checkpoint.height;
+                    data = payload + checkpoint.payloadOffset;
+                }
+                height += getVarint(data);
+                auto delta = zigzagDecode(getVarint(data));
+                func(row->scriptNum, static_cast<uint32_t>(height), delta);
+            }
+        }
+    }
+
+    BalanceHistoryIndex::MappedTable::MappedTable(const filesystem::path &path) : file(path) {
+        if (file.size() > 0) {
+            table.load(file.getDataAtOffset(0), file.size());
+        }
+    }
+
+    BalanceHistoryIndex::TableSet BalanceHistoryIndex::openTables(const filesystem::path &directory, const std::string &suffix) {
+        TableSet tables;
+        for (size_t i = 0; i < AddressType::size; i++) {
+            tables.emplace_back(directory/(addressName(static_cast<AddressType::Enum>(i)) + suffix));
+        }
+        return tables;
+    }
+
+    BalanceHistoryIndex::BalanceHistoryIndex(const filesystem::path &directory, const ChainAccess &chain) {
+        // All tables of a set have to cover the same transactions and end with the same transaction as the chain
+        auto isConsistent = [&](const TableSet &tables, uint64_t txStart) {
+            for (auto &mapped : tables) {
+                if (!mapped.table.isLoaded()) {
+                    return false;
+                }
+                auto &header = mapped.table.header();
+                if (header.txStart != txStart || header.txEnd != tables[0].table.header().txEnd) {
+                    return false;
+                }
+            }
+            auto &header = tables[0].table.header();
+            return header.txEnd > header.txStart && header.txEnd <= chain.txCount() && *chain.getTxHash(static_cast<uint32_t>(header.txEnd - 1)) == header.lastTxHash;
+        };
+        if (!directory.exists()) {
+            return;
+        }
+        base = openTables(directory, "");
+        hasBase = isConsistent(base, 0);
+        if (!hasBase) {
+            base.clear();
+            return;
+        }
+        delta = openTables(directory, "_delta");
+        hasDelta = isConsistent(delta, baseTxCount());
+        if (!hasDelta) {
+            delta.clear();
+        }
+    }
+
+    bool BalanceHistoryIndex::coversHeight(BlockHeight height, const ChainAccess &chain) const {
+        auto coveredTxCount = txCount();
+        if (coveredTxCount == 0) {
+            return false;
+        }
+        if (coveredTxCount >= chain.txCount()) {
+            return true;
+        }
+        // The index always ends with a complete block, so it covers every height before the block of its first missing transaction
+        return height >= 0 && height < chain.getBlockHeight(static_cast<uint32_t>(coveredTxCount));
+    }
+
+    int64_t BalanceHistoryIndex::balanceAt(const RawAddress &address, BlockHeight height) const {
+        return balanceSeries(address, {height})[0];
+    }
+
+    std::vector<int64_t> BalanceHistoryIndex::balanceSeries(const RawAddress &address, const std::vector<BlockHeight> &heights) const {
+        std::vector<uint32_t> tableHeights;
+        tableHeights.reserve(heights.size());
+        for (auto height : heights) {
+            tableHeights.push_back(height < 0 ? std::numeric_limits<uint32_t>::max() : static_cast<uint32_t>(height));
+        }
+        std::vector<int64_t> balances(heights.size(), 0);
+        auto typeIndex = static_cast<size_t>(address.type);
+        if (hasBase) {
+            base[typeIndex].table.addBalances(address.scriptNum, tableHeights, balances);
+        }
+        if (hasDelta) {
+            delta[typeIndex].table.addBalances(address.scriptNum, tableHeights, balances);
+        }
+        return balances;
+    }
+
+    std::vector<const BalanceHistoryTable *> BalanceHistoryIndex::tables(const TableSet &set) {
+        std::vector<const BalanceHistoryTable *> tables;
+        for (auto &mapped : set) {
+            tables.push_back(&mapped.table);
+        }
+        return tables;
+    }
+
+    uint64_t updateBalanceHistoryIndex(const filesystem::path &directory, const ChainAccess &chain, unsigned int threadCount) {
+        if (!directory.exists()) {
+            filesystem::create_directory(directory);
+        }
+        // The current tables stay mapped while the new ones are merged from them, replacing the files does not affect the mappings
+        BalanceHistoryIndex index{directory, chain};
+        auto baseTxCount = index.baseTxCount();
+        auto indexedTxCount = index.txCount();
+        auto txCount = static_cast<uint64_t>(chain.txCount());
+        if (txCount == 0 || indexedTxCount == txCount) {
+            return 0;
+        }
+
+        threadCount = std::max(threadCount, 1u);
+        // Base tables are merged from both current table sets, a delta table from the current delta tables
+        auto rebuildsBase = rebuildsBaseTables(baseTxCount, txCount);
+        std::vector<std::vector<const BalanceHistoryTable *>> previous;
+        if (rebuildsBase && index.isGood()) {
+            previous.push_back(index.baseTables());
+        }
+        if (indexedTxCount > baseTxCount) {
+            previous.push_back(index.deltaTables());
+        }
+        if (rebuildsBase) {
+            buildTables(directory, "", chain, 0, txCount, previous, threadCount);
+            for (size_t i = 0; i < AddressType::size; i++) {
+                std::remove(tablePath(directory, static_cast<AddressType::Enum>(i), "_delta").c_str());
+            }
+        } else {
+            buildTables(directory, "_delta", chain, baseTxCount, txCount, previous, threadCount);
+        }
+        return txCount - indexedTxCount;
+    }
+} // namespace blocksci
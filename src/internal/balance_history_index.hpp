@@ -0,0 +1,187 @@
+//
+//  balance_history_index.hpp
+//  blocksci
+//
+
+#ifndef balance_history_index_hpp
+#define balance_history_index_hpp
+
+#include "file_mapper.hpp"
+
+#include <blocksci/core/address_types.hpp>
+#include <blocksci/core/bitcoin_uint256.hpp>
+#include <blocksci/core/core_fwd.hpp>
+#include <blocksci/core/typedefs.hpp>
+
+#include <wjfilesystem/path.h>
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace blocksci {
+    class ChainAccess;
+
+    /** Header of a balance history table file, which lists the balance changes of the addresses of one address type
+     * caused by the transactions txStart up to but excluding txEnd
+     *
+     * File layout: [BalanceHistoryTableHeader][payload][padding to 8 bytes][BalanceHistoryRow rows[rowCount]][BalanceCheckpoint checkpoints[checkpointCount]]
+     *
+     * Rows are sorted by scriptNum. The changes of a row are the per block sums of the values received (outputs) and
+     * spent (inputs) by the address, sorted by height, with blocks in which the balance did not change left out. They
+     * are split into groups of checkpointInterval changes, each starting with a checkpoint that stores the height of its
+     * first change, the balance of the address in this table before that change and the offset of the group in the
+     * payload. A group is stored as pairs of LEB128 varints (height - previous height, zigzag encoded delta), where the
+     * first height is relative to the height of the checkpoint.
+     */
+    struct BalanceHistoryTableHeader {
+        /** "BSCIBHI1" when read as little endian */
+        static constexpr uint64_t magicValue = 0x3149484249435342;
+        static constexpr uint32_t currentVersion = 1;
+
+        uint64_t magic;
+        uint32_t version;
+        uint32_t checkpointInterval;
+        uint64_t txStart;
+        uint64_t txEnd;
+        uint64_t rowCount;
+        uint64_t changeCount;
+        uint64_t checkpointCount;
+        uint64_t payloadSize;
+        /** Hash of transaction txEnd - 1, used to detect that the indexed transactions have been replaced */
+        uint256 lastTxHash;
+    };
+
+    struct BalanceHistoryRow {
+        uint32_t scriptNum;
+        uint32_t changeCount;
+        /** Index of the first checkpoint of the row, the row has ceil(changeCount / checkpointInterval) checkpoints */
+        uint64_t firstCheckpoint;
+    };
+
+    struct BalanceCheckpoint {
+        uint32_t height;
+        uint32_t padding;
+        /** Balance before the change at height */
+        int64_t balance;
+        uint64_t payloadOffset;
+    };
+
+    /** Read-only view of a balance history table file, @see BalanceHistoryTableHeader */
+    class BalanceHistoryTable {
+    public:
+        /** Interprets data as a balance history table file, returns false and stays empty if it is not a valid one */
+        bool load(const char *data, int64_t size);
+
+        bool isLoaded() const {
+            return tableHeader != nullptr;
+        }
+
+        const BalanceHistoryTableHeader &header() const {
+            return *tableHeader;
+        }
+
+        /** Adds the balance changes of scriptNum in this table up to and including the given heights to balances, which
+         * has one entry per height
+         */
+        void addBalances(uint32_t scriptNum, const std::vector<uint32_t> &heights, std::vector<int64_t> &balances) const;
+
+        /** Calls func for every change of the table in scriptNum and height order */
+        void forEachChange(const std::function<void(uint32_t scriptNum, uint32_t height, int64_t delta)> &func) const;
+
+    private:
+        const BalanceHistoryTableHeader *tableHeader = nullptr;
+        const uint8_t *payload = nullptr;
+        const BalanceHistoryRow *rows = nullptr;
+        const BalanceCheckpoint *checkpoints = nullptr;
+    };
+
+    /** Memory mapped index of the balance history of every address that answers Address::calculateBalance without
+     * reading the outputs of the address
+     *
+     * The balance of an address at a height is found with a binary search for the row of the address and one over the
+     * checkpoints of the row, followed by decoding at most checkpointInterval changes. This takes microseconds even for
+     * addresses with millions of outputs, whose balance would otherwise require loading every output and its spending
+     * transaction.
+     *
+     * The index consists of a base and a delta table per address type, @see rebuildsBaseTables. Balances are sums of
+     * changes, so the balance at a height is the sum of the balances in the base and the delta table. Balances at heights
+     * of blocks that are not covered by the index have to be calculated from the outputs, @see coversHeight
+     *
+     * Tables that do not match each other or the chain are ignored.
+     *
+     * Files: <directory>/<address type>.dat and <directory>/<address type>_delta.dat
+     */
+    class BalanceHistoryIndex {
+    public:
+        /** Number of changes between two checkpoints of a row */
+        static constexpr uint32_t checkpointInterval = 32;
+
+        BalanceHistoryIndex(const filesystem::path &directory, const ChainAccess &chain);
+
+        bool isGood() const {
+            return baseTxCount() > 0;
+        }
+
+        /** Number of transactions covered by the base tables */
+        uint64_t baseTxCount() const {
+            return hasBase ? base[0].table.header().txEnd : 0;
+        }
+
+        /** Number of transactions covered by the index */
+        uint64_t txCount() const {
+            return hasDelta ? delta[0].table.header().txEnd : baseTxCount();
+        }
+
+        /** Whether the balances at the given height of the chain can be read from the index, -1 stands for the
+         * end of the chain
+         */
+        bool coversHeight(BlockHeight height, const ChainAccess &chain) const;
+
+        /** Balance of the address after the block at the given height, -1 stands for the end of the chain */
+        int64_t balanceAt(const RawAddress &address, BlockHeight height) const;
+
+        /** Balances of the address after the blocks at the given heights, in the order of the heights */
+        std::vector<int64_t> balanceSeries(const RawAddress &address, const std::vector<BlockHeight> &heights) const;
+
+        /** The base tables indexed by address type, empty if there are none */
+        std::vector<const BalanceHistoryTable *> baseTables() const {
+            return tables(base);
+        }
+
+        /** The delta tables indexed by address type, empty if there are none */
+        std::vector<const BalanceHistoryTable *> deltaTables() const {
+            return tables(delta);
+        }
+
+    private:
+        struct MappedTable {
+            SimpleFileMapper<> file;
+            BalanceHistoryTable table;
+
+            explicit MappedTable(const filesystem::path &path);
+        };
+
+        using TableSet = std::vector<MappedTable>;
+
+        TableSet base;
+        TableSet delta;
+        bool hasBase = false;
+        bool hasDelta = false;
+
+        static TableSet openTables(const filesystem::path &directory, const std::string &suffix);
+        static std::vector<const BalanceHistoryTable *> tables(const TableSet &set);
+    };
+
+    /** Brings the balance history index up to date with the chain, building new delta tables or new base tables
+     *
+     * The transactions added since the last update are split into threadCount ranges whose balance changes are collected
+     * and sorted in parallel and then merged per address type with the changes of the current tables.
+     *
+     * @return the number of transactions that were added to the index
+     */
+    uint64_t updateBalanceHistoryIndex(const filesystem::path &directory, const ChainAccess &chain, unsigned int threadCount);
+} // namespace blocksci
+
+#endif /* balance_history_index_hpp */
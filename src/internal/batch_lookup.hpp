@@ -0,0 +1,95 @@
+//
+//  batch_lookup.hpp
+//  blocksci
+//
+
+#ifndef batch_lookup_hpp
+#define batch_lookup_hpp
+
+#include "memory_view.hpp"
+
+#include <rocksdb/db.h>
+
+#include <algorithm>
+#include <cstring>
+#include <future>
+#include <numeric>
+#include <vector>
+
+namespace blocksci {
+
+    /** Calls func(begin, end) for consecutive chunks of [0, count) on up to threadCount threads
+     *
+     * The calling thread handles the first chunk. Exceptions thrown by a chunk are rethrown once all chunks have finished.
+     */
+    template <typename Func>
+    void forEachChunk(size_t count, unsigned int threadCount, Func &&func) {
+        size_t chunkCount = std::max<size_t>(1, std::min<size_t>(threadCount, count));
+        size_t chunkSize = (count + chunkCount - 1) / chunkCount;
+        std::vector<std::future<void>> handles;
+        for (size_t chunk = 1; chunk < chunkCount; chunk++) {
+            auto begin = std::min(count, chunk * chunkSize);
+            auto end = std::min(count, begin + chunkSize);
+            handles.push_back(std::async(std::launch::async, [&func, begin, end] { func(begin, end); }));
+        }
+        std::exception_ptr error;
+        try {
+            func(size_t{0}, std::min(count, chunkSize));
+        } catch (...) {
+            error = std::current_exception();
+        }
+        for (auto &handle : handles) {
+            try {
+                handle.get();
+            } catch (...) {
+                if (!error) {
+                    error = std::current_exception();
+                }
+            }
+        }
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+
+    /** Positions of keys in the order of RocksDB's default bytewise comparator
+     *
+     * Batched lookups visit keys in this order so that consecutive lookups hit the same index and data blocks.
+     */
+    inline std::vector<size_t> sortedKeyOrder(const std::vector<MemoryView> &keys) {
+        std::vector<size_t> order(keys.size());
+        std::iota(order.begin(), order.end(), size_t{0});
+        std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+            const auto &keyA = keys[a];
+            const auto &keyB = keys[b];
+            auto cmp = std::memcmp(keyA.data, keyB.data, std::min(keyA.size, keyB.size));
+            return cmp < 0 || (cmp == 0 && keyA.size < keyB.size);
+        });
+        return order;
+    }
+
+    /** Snapshot of a RocksDB database that is shared by the threads of one batched lookup and released at the end of it */
+    class SnapshotGuard {
+    public:
+        explicit SnapshotGuard(rocksdb::DB *db_) : db(db_), snapshot(db_->GetSnapshot()) {}
+        SnapshotGuard(const SnapshotGuard &) = delete;
+        SnapshotGuard &operator=(const SnapshotGuard &) = delete;
+        ~SnapshotGuard() {
+            if (snapshot != nullptr) {
+                db->ReleaseSnapshot(snapshot);
+            }
+        }
+
+        rocksdb::ReadOptions readOptions() const {
+            rocksdb::ReadOptions options;
+            options.snapshot = snapshot;
+            return options;
+        }
+
+    private:
+        rocksdb::DB *db;
+        const rocksdb::Snapshot *snapshot;
+    };
+} // namespace blocksci
+
+#endif /* batch_lookup_hpp */
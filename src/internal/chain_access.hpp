@@ -14,6 +14,7 @@
 
 #include <blocksci/core/bitcoin_uint256.hpp>
 #include <blocksci/core/core_fwd.hpp>
+#include <blocksci/core/inout_columns.hpp>
 #include <blocksci/core/raw_block.hpp>
 #include <blocksci/core/raw_transaction.hpp>
 #include <blocksci/core/typedefs.hpp>
@@ -25,6 +26,73 @@
 
 namespace blocksci {
 
+    /** Columnar mirror of the Inout data of either all inputs or all outputs, indexed by blockchain-wide input/output number.
+     *
+     * Every field of Inout is stored in its own file so that scans over a single field only need to read that field.
+     * The columns are optional and only exist if they have been built with the parser's build-columns command.
+     *
+     * Files: - chain/columns/<prefix>_value.dat: [<int64_t value>, ...]
+     *        - chain/columns/<prefix>_type.dat: [<uint8_t addressType>, ...]
+     *        - chain/columns/<prefix>_address_num.dat: [<uint32_t scriptNum>, ...]
+     *        - chain/columns/<prefix>_linked_tx.dat: [<uint32_t linkedTxNum>, ...]
+     */
+    class InoutColumnMapper {
+        FixedSizeFileMapper<int64_t> valueFile;
+        FixedSizeFileMapper<uint8_t> typeFile;
+        FixedSizeFileMapper<uint32_t> addressNumFile;
+        FixedSizeFileMapper<uint32_t> linkedTxNumFile;
+
+    public:
+        explicit InoutColumnMapper(const filesystem::path &pathPrefix) :
+        valueFile(valueFilePath(pathPrefix)),
+        typeFile(typeFilePath(pathPrefix)),
+        addressNumFile(addressNumFilePath(pathPrefix)),
+        linkedTxNumFile(linkedTxNumFilePath(pathPrefix)) {}
+
+        static filesystem::path valueFilePath(const filesystem::path &pathPrefix) {
+            return filesystem::path{pathPrefix.str() + "_value"};
+        }
+
+        static filesystem::path typeFilePath(const filesystem::path &pathPrefix) {
+            return filesystem::path{pathPrefix.str() + "_type"};
+        }
+
+        static filesystem::path addressNumFilePath(const filesystem::path &pathPrefix) {
+            return filesystem::path{pathPrefix.str() + "_address_num"};
+        }
+
+        static filesystem::path linkedTxNumFilePath(const filesystem::path &pathPrefix) {
+            return filesystem::path{pathPrefix.str() + "_linked_tx"};
+        }
+
+        /** Number of inputs/outputs that are available in all four columns */
+        OffsetType size() const {
+            return std::min({valueFile.size(), typeFile.size(), addressNumFile.size(), linkedTxNumFile.size()});
+        }
+
+        InoutColumns getColumns(uint64_t firstNum, uint64_t count) const {
+            InoutColumns columns;
+            columns.firstNum = firstNum;
+            columns.count = count;
+            if (count > 0) {
+                auto index = static_cast<OffsetType>(firstNum);
+                assert(index + static_cast<OffsetType>(count) <= size());
+                columns.values = valueFile[index];
+                columns.types = typeFile[index];
+                columns.addressNums = addressNumFile[index];
+                columns.linkedTxNums = linkedTxNumFile[index];
+            }
+            return columns;
+        }
+
+        void reload() {
+            valueFile.reload();
+            typeFile.reload();
+            addressNumFile.reload();
+            linkedTxNumFile.reload();
+        }
+    };
+
     /** Provides data access for blocks, transactions, inputs, and outputs.
      *
      * The files here represent the core data about blocks and transactions.
@@ -42,6 +110,7 @@ namespace blocksci {
          * Raw data format: [<RawBlock>, <RawBlock>, ...]
          */
         FixedSizeFileMapper<RawBlock> blockFile;
+        FileInfo blockFileInfo;
 
         /** Stores the coinbase data for every block, indexed by block height.
          *
@@ -61,6 +130,7 @@ namespace blocksci {
          *
          * Files: - chain/tx_data.dat: actual data
          *        - chain/tx_index.dat: index file that stores the offset for every transaction
+         *        - chain/tx_index_ef.dat: optional compact Elias-Fano encoding of tx_index.dat that is used instead of it if present
          * Raw data format: [<RawTransaction>, <Inout list>, <RawTransaction>, <Inout list>, ...]
          */
         IndexedFileMapper<mio::access_mode::read, RawTransaction> txFile;
@@ -107,6 +177,44 @@ namespace blocksci {
          */
         FixedSizeFileMapper<uint256> txHashesFile;
 
+        /** Sampled directory that stores the height of the block containing every 2^txHeightDirectoryShift-th transaction,
+         * indexed by tx number >> txHeightDirectoryShift. Narrows the search in getBlockHeight to the few blocks between two entries.
+         *
+         * File: chain/tx_height.dat
+         * Raw data format: [<uint32_t heightOfTx0>, <uint32_t heightOfTx256>, <uint32_t heightOfTx512>, ...]
+         */
+        FixedSizeFileMapper<uint32_t> txHeightDirectory;
+
+        /** Number of entries of txHeightDirectory that match the block file, 0 if the directory is missing or outdated */
+        OffsetType txHeightDirectoryEntries = 0;
+
+        /** Optional columnar mirror of the Inout data of all inputs, indexed by blockchain-wide input number.
+         *
+         * Files: chain/columns/input_{value,type,address_num,linked_tx}.dat
+         */
+        InoutColumnMapper inputColumns;
+
+        /** Optional columnar mirror of the Inout data of all outputs, indexed by blockchain-wide output number.
+         *
+         * Files: chain/columns/output_{value,type,address_num,linked_tx}.dat
+         */
+        InoutColumnMapper outputColumns;
+
+        /** Optional column with the position of the spending input within the inputs of the spending tx for every output,
+         * indexed by blockchain-wide output number. Only meaningful for spent outputs. Built and maintained together with
+         * the Inout columns.
+         *
+         * File: chain/columns/output_spending_input.dat
+         * Raw data format: [<uint16_t spendingInputNum>, ...]
+         */
+        FixedSizeFileMapper<uint16_t> outputSpendingInputFile;
+
+        /** Whether the Inout columns exist and cover all loaded inputs and outputs */
+        bool inoutColumnsLoaded = false;
+
+        /** Whether the spending input column exists and covers all loaded outputs */
+        bool spendingInputColumnLoaded = false;
+
         /** Hash of the last loaded block */
         uint256 lastBlockHash;
         const uint256 *lastBlockHashDisk = nullptr;
@@ -123,11 +231,8 @@ namespace blocksci {
 
         bool errorOnReorg = false;
 
-        void reorgCheck() const {
-            if (errorOnReorg && lastBlockHash != *lastBlockHashDisk) {
-                throw ReorgException();
-            }
-        }
+        /** Number of transactions that iterators over the chain read ahead of their current position, 0 disables readahead */
+        uint32_t readaheadTxCount = defaultReadaheadTxCount;
 
         void setup() {
             if (blocksIgnored <= 0) {
@@ -151,11 +256,55 @@ namespace blocksci {
                 ss << "Block data corrupted. Tx file has " << txFile.size() << " transaction, but max tx to load is tx " << _maxLoadedTx;
                 throw std::runtime_error(ss.str());
             }
+
+            // The directory is written after the blocks, so it is only used if its last entry agrees with the block file
+            txHeightDirectoryEntries = 0;
+            auto directoryEntries = txHeightDirectory.size();
+            if (directoryEntries > 0) {
+                auto lastHeight = static_cast<OffsetType>(*txHeightDirectory[directoryEntries - 1]);
+                auto lastTxNum = static_cast<uint64_t>(directoryEntries - 1) << txHeightDirectoryShift;
+                if (lastHeight < blockFile.size() && blockContainsTx(*blockFile[lastHeight], lastTxNum)) {
+                    txHeightDirectoryEntries = directoryEntries;
+                }
+            }
+
+            inoutColumnsLoaded = inputColumns.size() >= static_cast<OffsetType>(inputCount()) && outputColumns.size() >= static_cast<OffsetType>(outputCount());
+            spendingInputColumnLoaded = _maxLoadedTx > 0 && outputSpendingInputFile.size() >= static_cast<OffsetType>(outputCount());
         }
 
     public:
+        static constexpr uint32_t defaultReadaheadTxCount = 1 << 16;
+
+        /** Every 2^txHeightDirectoryShift-th transaction has an entry in chain/tx_height.dat */
+        static constexpr uint32_t txHeightDirectoryShift = 8;
+
+        /** Whether the last loaded block has been replaced on disk since the files were loaded, eg. by a reorg */
+        bool hasReorged() const {
+            return lastBlockHashDisk != nullptr && lastBlockHash != *lastBlockHashDisk;
+        }
+
+        /** Whether the block file has grown or shrunk since the files were loaded, which is only relevant if the number of loaded blocks is not fixed */
+        bool hasNewBlocks() const {
+            return blocksIgnored <= 0 && blockFileInfo.exists() && blockFileInfo.size() / static_cast<OffsetType>(sizeof(RawBlock)) != blockFile.size();
+        }
+
+        /** Throws ReorgException if errorOnReorg is set and the chain has reorged
+         *
+         * This is checked when a snapshot of the chain is taken, @see Blockchain::snapshot, rather than on every access.
+         */
+        void reorgCheck() const {
+            if (errorOnReorg && hasReorged()) {
+                throw ReorgException();
+            }
+        }
+
+        static bool blockContainsTx(const RawBlock &block, uint64_t txNum) {
+            return block.firstTxIndex <= txNum && txNum < static_cast<uint64_t>(block.firstTxIndex) + block.txCount;
+        }
+
         explicit ChainAccess(const filesystem::path &baseDirectory, BlockHeight blocksIgnored, bool errorOnReorg) :
         blockFile(blockFilePath(baseDirectory)),
+        blockFileInfo(blockFilePath(baseDirectory).str() + ".dat"),
         blockCoinbaseFile(blockCoinbaseFilePath(baseDirectory)),
         txFile(txFilePath(baseDirectory)),
         txVersionFile(txVersionFilePath(baseDirectory)),
@@ -164,6 +313,10 @@ namespace blocksci {
         inputSpentOutputFile(inputSpentOutNumFilePath(baseDirectory)),
         sequenceFile(sequenceFilePath(baseDirectory)),
         txHashesFile(txHashesFilePath(baseDirectory)),
+        txHeightDirectory(txHeightDirectoryFilePath(baseDirectory)),
+        inputColumns(inputColumnsPrefix(baseDirectory)),
+        outputColumns(outputColumnsPrefix(baseDirectory)),
+        outputSpendingInputFile(outputSpendingInputFilePath(baseDirectory)),
         blocksIgnored(blocksIgnored),
         errorOnReorg(errorOnReorg) {
             setup();
@@ -205,14 +358,44 @@ namespace blocksci {
             return baseDirectory/"input_out_num";
         }
 
+        static filesystem::path txHeightDirectoryFilePath(const filesystem::path &baseDirectory) {
+            return baseDirectory/"tx_height";
+        }
+
+        static filesystem::path inoutColumnsDirectory(const filesystem::path &baseDirectory) {
+            return baseDirectory/"columns";
+        }
+
+        static filesystem::path inputColumnsPrefix(const filesystem::path &baseDirectory) {
+            return inoutColumnsDirectory(baseDirectory)/"input";
+        }
+
+        static filesystem::path outputColumnsPrefix(const filesystem::path &baseDirectory) {
+            return inoutColumnsDirectory(baseDirectory)/"output";
+        }
+
+        static filesystem::path outputSpendingInputFilePath(const filesystem::path &baseDirectory) {
+            return filesystem::path{outputColumnsPrefix(baseDirectory).str() + "_spending_input"};
+        }
+
         BlockHeight getBlockHeight(uint32_t txIndex) const {
-            reorgCheck();
             if (errorOnReorg && txIndex >= _maxLoadedTx) {
                 throw std::out_of_range("Transaction index out of range");
             }
             auto blockBegin = blockFile[0];
             auto blockEnd = blockFile[static_cast<OffsetType>(maxHeight) - 1] + 1;
-            auto it = std::upper_bound(blockBegin, blockEnd, txIndex, [](uint32_t index, const RawBlock &b) {
+            auto searchBegin = blockBegin;
+            auto searchEnd = blockEnd;
+            auto entry = static_cast<OffsetType>(txIndex >> txHeightDirectoryShift);
+            if (entry < txHeightDirectoryEntries) {
+                // The block of txIndex lies between the blocks of this entry's and the next entry's transaction
+                auto lastBlock = static_cast<OffsetType>(maxHeight) - 1;
+                searchBegin = blockBegin + std::min(static_cast<OffsetType>(*txHeightDirectory[entry]), lastBlock);
+                if (entry + 1 < txHeightDirectoryEntries) {
+                    searchEnd = blockBegin + std::min(static_cast<OffsetType>(*txHeightDirectory[entry + 1]), lastBlock) + 1;
+                }
+            }
+            auto it = std::upper_bound(searchBegin, searchEnd, txIndex, [](uint32_t index, const RawBlock &b) {
                 return index < b.firstTxIndex;
             });
             it--;
@@ -220,38 +403,37 @@ namespace blocksci {
         }
 
         const RawBlock *getBlock(BlockHeight blockHeight) const {
-            reorgCheck();
             return blockFile[static_cast<OffsetType>(blockHeight)];
         }
 
         const uint256 *getTxHash(uint32_t index) const {
-            reorgCheck();
             return txHashesFile[index];
         }
 
         const RawTransaction *getTx(uint32_t index) const {
-            reorgCheck();
             return txFile.getData(index);
         }
 
+        /** Whether the transactions lie back to back in memory, so that the next one starts where the previous one ends.
+         * Not the case if chain/tx_data is compressed, every transaction has to be read with getTx then. */
+        bool hasContiguousTxData() const {
+            return !txFile.isCompressed();
+        }
+
         const int32_t *getTxVersion(uint32_t index) const {
-            reorgCheck();
             return txVersionFile[index];
         }
 
         const uint32_t *getSequenceNumbers(uint32_t index) const {
-            reorgCheck();
             return sequenceFile[static_cast<OffsetType>(*txFirstInputFile[index])];
         }
 
         const uint16_t *getSpentOutputNumbers(uint32_t index) const {
-            reorgCheck();
             return inputSpentOutputFile[static_cast<OffsetType>(*txFirstInputFile[index])];
         }
 
         /** Get TxData object for given tx number */
         TxData getTxData(uint32_t index) const {
-            reorgCheck();
             // Blockchain-wide number of first input for the given tx
             auto firstInputNum = static_cast<OffsetType>(*txFirstInputFile[index]);
             const uint16_t *inputsSpent = nullptr;
@@ -269,10 +451,81 @@ namespace blocksci {
             };
         }
 
+        /** Blockchain-wide number of the first input of the given tx, txCount() maps to inputCount() */
+        uint64_t firstInputNum(uint32_t index) const {
+            if (index == _maxLoadedTx) {
+                return inputCount();
+            }
+            return *txFirstInputFile[index];
+        }
+
+        /** Blockchain-wide number of the first output of the given tx, txCount() maps to outputCount() */
+        uint64_t firstOutputNum(uint32_t index) const {
+            if (index == _maxLoadedTx) {
+                return outputCount();
+            }
+            return *txFirstOutputFile[index];
+        }
+
+        /** Whether the optional Inout columns (chain/columns/) are available for all loaded inputs and outputs */
+        bool hasInoutColumns() const {
+            return inoutColumnsLoaded;
+        }
+
+        /** Get the columnar view of count inputs starting at the blockchain-wide input number firstInput */
+        InoutColumns getInputColumns(uint64_t firstInput, uint64_t count) const {
+            return inputColumns.getColumns(firstInput, count);
+        }
+
+        /** Get the columnar view of count outputs starting at the blockchain-wide output number firstOutput */
+        InoutColumns getOutputColumns(uint64_t firstOutput, uint64_t count) const {
+            return outputColumns.getColumns(firstOutput, count);
+        }
+
+        /** Whether the optional spending input column (chain/columns/output_spending_input.dat) covers all loaded outputs */
+        bool hasSpendingInputColumn() const {
+            return spendingInputColumnLoaded;
+        }
+
+        /** Positions of the inputs that spend the outputs of the given tx within their spending transactions, indexed by
+         * output number. Entries of unspent outputs are meaningless. nullptr if the spending input column is not available. */
+        const uint16_t *getSpendingInputNums(uint32_t index) const {
+            if (!spendingInputColumnLoaded) {
+                return nullptr;
+            }
+            return outputSpendingInputFile[static_cast<OffsetType>(*txFirstOutputFile[index])];
+        }
+
         size_t txCount() const {
             return _maxLoadedTx;
         }
 
+        uint32_t readaheadWindow() const {
+            return readaheadTxCount;
+        }
+
+        void setReadaheadWindow(uint32_t txCount) {
+            readaheadTxCount = txCount;
+        }
+
+        /** Asks the kernel to read the core data of the transactions [beginTx, endTx) into the page cache in the background */
+        void prefetchTransactions(uint32_t beginTx, uint32_t endTx) const {
+            endTx = std::min(endTx, _maxLoadedTx);
+            if (beginTx < endTx) {
+                txFile.adviseRange(AccessHint::WillNeed, beginTx, endTx);
+            }
+        }
+
+        /** Faults in the files that are touched by almost every query (blocks, transactions and their first input/output numbers)
+         * so that they are fully resident, optionally backed by transparent huge pages */
+        void populateHotFiles(bool hugePages) {
+            blockFile.populate(hugePages);
+            txHeightDirectory.populate(hugePages);
+            txFile.populate(hugePages);
+            txFirstInputFile.populate(hugePages);
+            txFirstOutputFile.populate(hugePages);
+        }
+
         uint64_t inputCount() const {
             if (_maxLoadedTx > 0) {
                 auto lastTx = getTx(_maxLoadedTx - 1);
@@ -314,7 +567,11 @@ namespace blocksci {
             txVersionFile.reload();
             inputSpentOutputFile.reload();
             txHashesFile.reload();
+            txHeightDirectory.reload();
             sequenceFile.reload();
+            inputColumns.reload();
+            outputColumns.reload();
+            outputSpendingInputFile.reload();
             setup();
         }
     };
@@ -0,0 +1,94 @@
+//
+//  chain_watcher.cpp
+//  blocksci
+//
+
+#include "chain_watcher.hpp"
+
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+namespace blocksci {
+
+    ChainWatcher::ChainWatcher(const filesystem::path &pidFilePath) {
+        auto path = pidFilePath.str();
+        auto separator = path.rfind('/');
+        directory = separator == std::string::npos ? "." : path.substr(0, separator);
+        pidFileName = separator == std::string::npos ? path : path.substr(separator + 1);
+
+        inotifyFd = inotify_init1(IN_CLOEXEC | IN_NONBLOCK);
+        if (inotifyFd < 0) {
+            throw std::runtime_error("Could not initialize inotify: " + std::string(strerror(errno)));
+        }
+        if (inotify_add_watch(inotifyFd, directory.c_str(), IN_DELETE | IN_MOVED_FROM) < 0) {
+            close(inotifyFd);
+            throw std::runtime_error("Could not watch " + directory + ": " + std::string(strerror(errno)));
+        }
+        stopFd = eventfd(0, EFD_CLOEXEC);
+        if (stopFd < 0) {
+            close(inotifyFd);
+            throw std::runtime_error("Could not create eventfd: " + std::string(strerror(errno)));
+        }
+        thread = std::thread(&ChainWatcher::run, this);
+    }
+
+    ChainWatcher::~ChainWatcher() {
+        uint64_t stop = 1;
+        auto written = write(stopFd, &stop, sizeof(stop));
+        (void)written;
+        thread.join();
+        close(stopFd);
+        close(inotifyFd);
+    }
+
+    void ChainWatcher::run() {
+        alignas(inotify_event) char buffer[4096];
+        pollfd fds[2] = {{inotifyFd, POLLIN, 0}, {stopFd, POLLIN, 0}};
+        while (true) {
+            if (poll(fds, 2, -1) < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return;
+            }
+            if (fds[1].revents != 0) {
+                return;
+            }
+            uint64_t completed = 0;
+            ssize_t length;
+            while ((length = read(inotifyFd, buffer, sizeof(buffer))) > 0) {
+                for (ssize_t pos = 0; pos < length;) {
+                    auto event = reinterpret_cast<const inotify_event *>(buffer + pos);
+                    if (event->len > 0 && pidFileName == event->name) {
+                        completed++;
+                    }
+                    pos += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+                }
+            }
+            if (completed > 0) {
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    updates += completed;
+                }
+                updated.notify_all();
+            }
+        }
+    }
+
+    uint64_t ChainWatcher::updateCount() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return updates;
+    }
+
+    uint64_t ChainWatcher::waitForUpdate(uint64_t knownUpdates, std::chrono::milliseconds timeout) const {
+        std::unique_lock<std::mutex> lock(mutex);
+        updated.wait_for(lock, timeout, [&] { return updates > knownUpdates; });
+        return updates;
+    }
+} // namespace blocksci
@@ -0,0 +1,55 @@
+//
+//  chain_watcher.hpp
+//  blocksci
+//
+
+#ifndef chain_watcher_hpp
+#define chain_watcher_hpp
+
+#include <wjfilesystem/path.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+namespace blocksci {
+
+    /** Watches a data directory with inotify and records every completed parser update
+     *
+     * The parser holds a pid file in the data directory while it updates the data (@see DataConfiguration::pidFilePath)
+     * and removes it once the data is consistent again, so the removal of the pid file is counted as a completed update.
+     */
+    class ChainWatcher {
+    public:
+        explicit ChainWatcher(const filesystem::path &pidFilePath);
+        ChainWatcher(const ChainWatcher &) = delete;
+        ChainWatcher &operator=(const ChainWatcher &) = delete;
+        ~ChainWatcher();
+
+        /** Number of parser updates that have completed since the watcher was started */
+        uint64_t updateCount() const;
+
+        /** Waits until more than knownUpdates parser updates have completed or the timeout expires
+         *
+         * @return the number of completed updates
+         */
+        uint64_t waitForUpdate(uint64_t knownUpdates, std::chrono::milliseconds timeout) const;
+
+    private:
+        std::string directory;
+        std::string pidFileName;
+        int inotifyFd = -1;
+        int stopFd = -1;
+        std::thread thread;
+
+        mutable std::mutex mutex;
+        mutable std::condition_variable updated;
+        uint64_t updates = 0;
+
+        void run();
+    };
+} // namespace blocksci
+
+#endif /* chain_watcher_hpp */
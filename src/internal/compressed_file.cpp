@@ -0,0 +1,223 @@
+//
+//  compressed_file.cpp
+//  blocksci
+//
+
+#include "compressed_file.hpp"
+
+#include <lz4.h>
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+namespace blocksci {
+
+    namespace {
+        /** Decompressed chunks firstChunk to lastChunk of one file, stored contiguously */
+        struct CachedChunks {
+            uint64_t fileId;
+            uint64_t firstChunk;
+            uint64_t lastChunk;
+            std::unique_ptr<char[]> data;
+
+            uint64_t chunkCount() const {
+                return lastChunk - firstChunk + 1;
+            }
+        };
+
+        /** Chunks decompressed by this thread, most recently used first */
+        thread_local std::vector<CachedChunks> chunkCache;
+
+        std::atomic<size_t> cacheChunkLimit{16};
+        std::atomic<uint64_t> nextFileId{0};
+
+        size_t pageSize() {
+            static const size_t size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+            return size;
+        }
+
+        CompressedFileHeader readHeader(const mio::basic_mmap<mio::access_mode::read, char> &file, const filesystem::path &path) {
+            CompressedFileHeader header;
+            if (file.length() < sizeof(header)) {
+                throw std::runtime_error("Compressed file " + path.str() + " is truncated");
+            }
+            memcpy(&header, file.data(), sizeof(header));
+            if (header.magic != CompressedFileHeader::magicValue || header.version != CompressedFileHeader::currentVersion) {
+                throw std::runtime_error("File " + path.str() + " is not a supported compressed BlockSci data file");
+            }
+            auto offsetTableEnd = sizeof(header) + (header.chunkCount + 1) * sizeof(uint64_t);
+            if (file.length() < offsetTableEnd || header.chunkSize == 0 || header.chunkSize % pageSize() != 0) {
+                throw std::runtime_error("Compressed file " + path.str() + " has an invalid header");
+            }
+            return header;
+        }
+
+        void checkChunkSize(uint32_t chunkSize) {
+            if (chunkSize == 0 || chunkSize % pageSize() != 0 || chunkSize > LZ4_MAX_INPUT_SIZE) {
+                std::stringstream ss;
+                ss << "Compressed chunk size must be a multiple of the page size (" << pageSize() << " bytes) and at most " << LZ4_MAX_INPUT_SIZE << " bytes";
+                throw std::runtime_error(ss.str());
+            }
+        }
+    } // namespace
+
+    filesystem::path compressedFilePath(const filesystem::path &pathPrefix) {
+        return filesystem::path{pathPrefix.str() + ".lz4"};
+    }
+
+    CompressedFileMapping::CompressedFileMapping(const filesystem::path &path_) : fileId(nextFileId++), path(path_) {
+        std::error_code error;
+        compressedFile.map(path.str(), 0, mio::map_entire_file, error);
+        if (error) {
+            throw std::runtime_error("Could not open compressed file " + path.str() + ": " + error.message());
+        }
+        header = readHeader(compressedFile, path);
+        chunkOffsets = reinterpret_cast<const uint64_t *>(compressedFile.data() + sizeof(header));
+        if (chunkOffsets[header.chunkCount] > compressedFile.length()) {
+            throw std::runtime_error("Compressed file " + path.str() + " is truncated");
+        }
+    }
+
+    size_t CompressedFileMapping::threadCacheChunks() {
+        return cacheChunkLimit.load();
+    }
+
+    void CompressedFileMapping::setThreadCacheChunks(size_t chunks) {
+        // Scripts are read as two parts that may each straddle two chunks, and both have to stay in the cache together
+        cacheChunkLimit.store(std::max<size_t>(chunks, 4));
+    }
+
+    size_t CompressedFileMapping::uncompressedChunkLength(uint64_t chunk) const {
+        auto start = chunk * header.chunkSize;
+        return static_cast<size_t>(std::min<uint64_t>(header.chunkSize, header.uncompressedSize - start));
+    }
+
+    void CompressedFileMapping::decompressChunk(uint64_t chunk, char *destination) const {
+        auto compressedLength = static_cast<int>(chunkOffsets[chunk + 1] - chunkOffsets[chunk]);
+        auto expectedLength = static_cast<int>(uncompressedChunkLength(chunk));
+        if (chunkOffsets[chunk] > chunkOffsets[chunk + 1] || LZ4_decompress_safe(compressedFile.data() + chunkOffsets[chunk], destination, compressedLength, expectedLength) != expectedLength) {
+            std::stringstream ss;
+            ss << "Chunk " << chunk << " of compressed file " << path.str() << " is corrupted";
+            throw std::runtime_error(ss.str());
+        }
+    }
+
+    const char *CompressedFileMapping::read(int64_t offset, int64_t length) const {
+        auto start = static_cast<uint64_t>(offset);
+        auto end = std::min(start + static_cast<uint64_t>(std::max<int64_t>(length, 1)), header.uncompressedSize);
+        if (start >= end) {
+            throw std::out_of_range("Read beyond the end of compressed file " + path.str());
+        }
+        auto firstChunk = start / header.chunkSize;
+        auto lastChunk = (end - 1) / header.chunkSize;
+
+        auto &cache = chunkCache;
+        for (size_t i = 0; i < cache.size(); i++) {
+            auto &entry = cache[i];
+            if (entry.fileId == fileId && entry.firstChunk <= firstChunk && entry.lastChunk >= lastChunk) {
+                std::rotate(cache.begin(), cache.begin() + static_cast<std::ptrdiff_t>(i), cache.begin() + static_cast<std::ptrdiff_t>(i) + 1);
+                return cache.front().data.get() + (start - cache.front().firstChunk * header.chunkSize);
+            }
+        }
+
+        CachedChunks loaded{fileId, firstChunk, lastChunk, nullptr};
+        loaded.data = std::make_unique<char[]>(static_cast<size_t>(loaded.chunkCount()) * header.chunkSize);
+        for (auto chunk = firstChunk; chunk <= lastChunk; chunk++) {
+            decompressChunk(chunk, loaded.data.get() + (chunk - firstChunk) * header.chunkSize);
+        }
+
+        // Drop the least recently used chunks until the new ones fit, which always keeps at least the new entry
+        auto limit = cacheChunkLimit.load(std::memory_order_relaxed);
+        auto cachedChunks = loaded.chunkCount();
+        size_t kept = 0;
+        while (kept < cache.size() && cachedChunks + cache[kept].chunkCount() <= limit) {
+            cachedChunks += cache[kept].chunkCount();
+            kept++;
+        }
+        cache.resize(kept);
+        cache.insert(cache.begin(), std::move(loaded));
+        return cache.front().data.get() + (start - firstChunk * header.chunkSize);
+    }
+
+    void compressFile(const filesystem::path &source, const filesystem::path &destination, uint32_t chunkSize) {
+        checkChunkSize(chunkSize);
+        auto sourceSize = static_cast<uint64_t>(source.file_size());
+
+        mio::basic_mmap<mio::access_mode::read, char> sourceFile;
+        if (sourceSize > 0) {
+            std::error_code error;
+            sourceFile.map(source.str(), 0, mio::map_entire_file, error);
+            if (error) {
+                throw std::runtime_error("Could not open " + source.str() + ": " + error.message());
+            }
+        }
+
+        CompressedFileHeader header;
+        header.magic = CompressedFileHeader::magicValue;
+        header.version = CompressedFileHeader::currentVersion;
+        header.chunkSize = chunkSize;
+        header.uncompressedSize = sourceSize;
+        header.chunkCount = (sourceSize + chunkSize - 1) / chunkSize;
+
+        std::vector<uint64_t> chunkOffsets(header.chunkCount + 1);
+        std::ofstream out(destination.str(), std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char *>(chunkOffsets.data()), static_cast<std::streamsize>(chunkOffsets.size() * sizeof(uint64_t)));
+
+        uint64_t offset = sizeof(header) + chunkOffsets.size() * sizeof(uint64_t);
+        std::vector<char> compressed(static_cast<size_t>(LZ4_compressBound(static_cast<int>(chunkSize))));
+        for (uint64_t chunk = 0; chunk < header.chunkCount; chunk++) {
+            auto start = chunk * chunkSize;
+            auto length = static_cast<int>(std::min<uint64_t>(chunkSize, sourceSize - start));
+            auto compressedLength = LZ4_compress_default(sourceFile.data() + start, compressed.data(), length, static_cast<int>(compressed.size()));
+            if (compressedLength <= 0) {
+                throw std::runtime_error("Failed to compress " + source.str());
+            }
+            chunkOffsets[chunk] = offset;
+            out.write(compressed.data(), compressedLength);
+            offset += static_cast<uint64_t>(compressedLength);
+        }
+        chunkOffsets[header.chunkCount] = offset;
+
+        out.seekp(sizeof(header));
+        out.write(reinterpret_cast<const char *>(chunkOffsets.data()), static_cast<std::streamsize>(chunkOffsets.size() * sizeof(uint64_t)));
+        out.close();
+        if (!out) {
+            throw std::runtime_error("Failed to write " + destination.str());
+        }
+    }
+
+    void decompressFile(const filesystem::path &source, const filesystem::path &destination) {
+        mio::basic_mmap<mio::access_mode::read, char> sourceFile;
+        std::error_code error;
+        sourceFile.map(source.str(), 0, mio::map_entire_file, error);
+        if (error) {
+            throw std::runtime_error("Could not open " + source.str() + ": " + error.message());
+        }
+        auto header = readHeader(sourceFile, source);
+        auto chunkOffsets = reinterpret_cast<const uint64_t *>(sourceFile.data() + sizeof(header));
+
+        std::ofstream out(destination.str(), std::ios::binary | std::ios::trunc);
+        std::vector<char> chunkData(header.chunkSize);
+        for (uint64_t chunk = 0; chunk < header.chunkCount; chunk++) {
+            auto start = chunk * header.chunkSize;
+            auto expectedLength = static_cast<int>(std::min<uint64_t>(header.chunkSize, header.uncompressedSize - start));
+            auto compressedLength = static_cast<int>(chunkOffsets[chunk + 1] - chunkOffsets[chunk]);
+            if (chunkOffsets[chunk + 1] > sourceFile.length() || LZ4_decompress_safe(sourceFile.data() + chunkOffsets[chunk], chunkData.data(), compressedLength, expectedLength) != expectedLength) {
+                throw std::runtime_error("Compressed file " + source.str() + " is corrupted");
+            }
+            out.write(chunkData.data(), expectedLength);
+        }
+        out.close();
+        if (!out) {
+            throw std::runtime_error("Failed to write " + destination.str());
+        }
+    }
+} // namespace blocksci
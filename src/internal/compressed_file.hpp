@@ -0,0 +1,113 @@
+//
+//  compressed_file.hpp
+//  blocksci
+//
+
+#ifndef compressed_file_hpp
+#define compressed_file_hpp
+
+#include <mio/mmap.hpp>
+
+#include <wjfilesystem/path.h>
+
+#include <cstdint>
+#include <memory>
+
+namespace blocksci {
+
+    /** Header of a block-compressed data file
+     *
+     * File layout: [CompressedFileHeader][uint64_t chunkOffsets[chunkCount + 1]][LZ4 chunk 0][LZ4 chunk 1]...
+     *
+     * chunkOffsets[i] is the offset of compressed chunk i in the file and chunkOffsets[chunkCount] is the end of the
+     * last chunk. Every chunk except the last one decompresses to exactly chunkSize bytes.
+     */
+    struct CompressedFileHeader {
+        /** "BSCILZ41" when read as little endian */
+        static constexpr uint64_t magicValue = 0x31345a4c49435342;
+        static constexpr uint32_t currentVersion = 1;
+        static constexpr uint32_t defaultChunkSize = 1 << 20;
+
+        uint64_t magic;
+        uint32_t version;
+        uint32_t chunkSize;
+        uint64_t uncompressedSize;
+        uint64_t chunkCount;
+    };
+
+    /** Read-only access to a block-compressed data file
+     *
+     * The compressed file is memory mapped and its chunks are decompressed on request by read(), into a small cache of
+     * decompressed chunks that every thread keeps for itself. Reads of bytes that lie in two or more chunks get a buffer
+     * with all of these chunks, so every read returns one contiguous range. Nothing is shared between threads, so reads
+     * never wait for each other, and the address space of the process only ever contains regular heap buffers that
+     * system calls can read from like any other memory.
+     *
+     * A pointer returned by read() stays valid until the calling thread has read threadCacheChunks() other chunks of
+     * any compressed file, after which its buffer may be reused. Code that walks a compressed file has to call read()
+     * for every element instead of advancing a pointer from one element to the next.
+     *
+     * @see SimpleFileMapper<mio::access_mode::read>, which uses this class if only the compressed version of a file exists
+     */
+    class CompressedFileMapping {
+    public:
+        explicit CompressedFileMapping(const filesystem::path &path);
+        CompressedFileMapping(const CompressedFileMapping &) = delete;
+        CompressedFileMapping &operator=(const CompressedFileMapping &) = delete;
+
+        int64_t size() const {
+            return static_cast<int64_t>(header.uncompressedSize);
+        }
+
+        uint32_t chunkSize() const {
+            return header.chunkSize;
+        }
+
+        uint64_t chunkCount() const {
+            return header.chunkCount;
+        }
+
+        /** Size of the compressed file on disk */
+        int64_t compressedSize() const {
+            return static_cast<int64_t>(compressedFile.length());
+        }
+
+        /** Pointer to the uncompressed bytes [offset, offset + length), which must lie within the file
+         *
+         * Decompresses the chunks holding the range into the cache of the calling thread unless they are already there.
+         * Throws std::runtime_error if a chunk is corrupted.
+         */
+        const char *read(int64_t offset, int64_t length) const;
+
+        /** Number of decompressed chunks that every thread keeps, at least 4 */
+        static size_t threadCacheChunks();
+        static void setThreadCacheChunks(size_t chunks);
+
+    private:
+        mio::basic_mmap<mio::access_mode::read, char> compressedFile;
+        CompressedFileHeader header;
+        const uint64_t *chunkOffsets = nullptr;
+
+        /** Identifies the chunks of this file in the thread caches, never reused by another file */
+        uint64_t fileId;
+
+        filesystem::path path;
+
+        size_t uncompressedChunkLength(uint64_t chunk) const;
+        void decompressChunk(uint64_t chunk, char *destination) const;
+    };
+
+    /** Path of the block-compressed version of the data file pathPrefix.dat */
+    filesystem::path compressedFilePath(const filesystem::path &pathPrefix);
+
+    /** Writes a block-compressed copy of source to destination using chunks of chunkSize uncompressed bytes
+     *
+     * chunkSize must be a multiple of the system page size.
+     */
+    void compressFile(const filesystem::path &source, const filesystem::path &destination, uint32_t chunkSize = CompressedFileHeader::defaultChunkSize);
+
+    /** Writes the uncompressed contents of the block-compressed file source to destination */
+    void decompressFile(const filesystem::path &source, const filesystem::path &destination);
+} // namespace blocksci
+
+#endif /* compressed_file_hpp */
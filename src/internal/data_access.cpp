@@ -10,10 +10,50 @@
 #include "chain_access.hpp"
 #include "script_access.hpp"
 #include "address_index.hpp"
+#include "address_output_index.hpp"
+#include "balance_history_index.hpp"
 #include "hash_index.hpp"
 #include "mempool_index.hpp"
+#include "compressed_file.hpp"
+#include "chain_watcher.hpp"
+#include "taproot_index.hpp"
+#include "tx_hash_index.hpp"
 
 namespace blocksci {
+
+    namespace {
+        std::shared_ptr<const TxHashIndex> openTxHashIndex(const DataConfiguration &config) {
+            auto index = std::make_shared<TxHashIndex>(config.txHashIndexFilePath(), config.chainDirectory());
+            if (!index->isGood()) {
+                return nullptr;
+            }
+            return index;
+        }
+
+        std::shared_ptr<const TaprootIndex> openTaprootIndex(const DataConfiguration &config, const ScriptAccess &scripts) {
+            auto index = std::make_shared<TaprootIndex>(config.taprootIndexFilePath(), scripts);
+            if (!index->isGood()) {
+                return nullptr;
+            }
+            return index;
+        }
+
+        std::shared_ptr<const AddressOutputIndex> openAddressOutputIndex(const DataConfiguration &config, const ChainAccess &chain) {
+            auto index = std::make_shared<AddressOutputIndex>(config.addressOutputIndexDirectory(), chain);
+            if (!index->isGood()) {
+                return nullptr;
+            }
+            return index;
+        }
+
+        std::shared_ptr<const BalanceHistoryIndex> openBalanceHistoryIndex(const DataConfiguration &config, const ChainAccess &chain) {
+            auto index = std::make_shared<BalanceHistoryIndex>(config.balanceHistoryIndexDirectory(), chain);
+            if (!index->isGood()) {
+                return nullptr;
+            }
+            return index;
+        }
+    } // namespace
     
     DataAccess::DataAccess() = default;
 
@@ -21,9 +61,18 @@ namespace blocksci {
     config(std::move(config_)),
     chain{std::make_unique<ChainAccess>(config.chainDirectory(), config.blocksIgnored, config.errorOnReorg)},
     scripts{std::make_unique<ScriptAccess>(config.scriptsDirectory())},
-    addressIndex{std::make_unique<AddressIndex>(config.addressDBFilePath(), true)},
-    hashIndex{std::make_unique<HashIndex>(config.hashIndexFilePath(), true)},
-    mempoolIndex{std::make_unique<MempoolIndex>(config.mempoolDirectory())} {}
+    addressIndex{std::make_shared<AddressIndex>(config.addressDBFilePath(), true, openAddressOutputIndex(config, *chain))},
+    hashIndex{std::make_shared<HashIndex>(config.hashIndexFilePath(), true, openTxHashIndex(config), openTaprootIndex(config, *scripts))},
+    mempoolIndex{std::make_unique<MempoolIndex>(config.mempoolDirectory())},
+    balanceHistoryIndex{openBalanceHistoryIndex(config, *chain)} {
+        if (config.storage.cacheChunks > 0) {
+            CompressedFileMapping::setThreadCacheChunks(config.storage.cacheChunks);
+        }
+        chain->setReadaheadWindow(config.storage.readaheadTxes);
+        if (config.storage.populateHotFiles) {
+            chain->populateHotFiles(config.storage.hugePages);
+        }
+    }
     
     DataAccess::DataAccess(DataAccess &&) = default;
     DataAccess &DataAccess::operator=(DataAccess &&) = default;
@@ -31,7 +80,39 @@ namespace blocksci {
 
     void DataAccess::reload() {
         chain->reload();
+        if (config.storage.populateHotFiles) {
+            chain->populateHotFiles(config.storage.hugePages);
+        }
         scripts->reload();
         mempoolIndex->reload();
+        balanceHistoryIndex = openBalanceHistoryIndex(config, *chain);
+        std::atomic_store(&addressPrefixIndex, std::shared_ptr<const AddressPrefixIndex>{});
+    }
+
+    bool DataAccess::isOutdated() const {
+        return chain->hasReorged() || chain->hasNewBlocks();
+    }
+
+    std::unique_ptr<DataAccess> DataAccess::nextGeneration() const {
+        auto next = std::make_unique<DataAccess>();
+        next->config = config;
+        // The copies share the file mappings with this generation and extend them in place, so only new data gets mapped
+        next->chain = std::make_unique<ChainAccess>(*chain);
+        next->chain->reload();
+        next->scripts = std::make_unique<ScriptAccess>(*scripts);
+        next->scripts->reload();
+        next->mempoolIndex = std::make_unique<MempoolIndex>(*mempoolIndex);
+        next->mempoolIndex->reload();
+        next->addressIndex = addressIndex;
+        next->hashIndex = hashIndex;
+        // The parser may have extended the balance history index since, opening it again is cheap
+        next->balanceHistoryIndex = openBalanceHistoryIndex(config, *next->chain);
+        next->watcher = watcher;
+        next->lockedFiles = lockedFiles;
+        next->generation = generation + 1;
+        if (config.storage.populateHotFiles) {
+            next->chain->populateHotFiles(config.storage.hugePages);
+        }
+        return next;
     }
 }
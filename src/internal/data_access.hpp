@@ -10,6 +10,7 @@
 #define data_access_hpp
 
 #include "data_configuration.hpp"
+#include "warmup.hpp"
 
 #include <memory>
 
@@ -19,6 +20,10 @@ namespace blocksci {
     class AddressIndex;
     class HashIndex;
     class MempoolIndex;
+    class BalanceHistoryIndex;
+    class AddressPrefixIndex;
+    class ChainWatcher;
+    class TxGraphTraversal;
 
     /** This class wraps and manages all data and index access classes
      *     - ChainAccess: Provides data access for blocks, transactions, inputs, and outputs
@@ -28,6 +33,10 @@ namespace blocksci {
      *     - MempoolIndex: Provides data access to the mempool index (when a transaction has been first seen)
      *
      *     - DataConfiguration: Loads and holds blockchain configuration files, needed to load blockchains
+     *
+     * A DataAccess represents one generation of the data directory. New generations are created with nextGeneration()
+     * and share the RocksDB indexes and the file mappings with the previous one. The mappings only ever grow in place,
+     * so readers of the previous generation are not affected. @see Blockchain::refresh
      */
     class DataAccess {
     public:
@@ -62,7 +71,7 @@ namespace blocksci {
          *
          * Directory: addressesDb/
          */
-        std::unique_ptr<AddressIndex> addressIndex;
+        std::shared_ptr<AddressIndex> addressIndex;
 
         /** Provides access to hash indexes (RocksDB database)
          *
@@ -70,7 +79,7 @@ namespace blocksci {
          *
          * Directory: hashIndex/
          */
-        std::unique_ptr<HashIndex> hashIndex;
+        std::shared_ptr<HashIndex> hashIndex;
 
         /** Provides access to the mempool index, which stores the timestamp of when a transaction has been
          * first seen. Only relevant when BlockSci's mempool_recorder is enabled (= running).
@@ -78,6 +87,36 @@ namespace blocksci {
          * Directory: mempool/
          */
         std::unique_ptr<MempoolIndex> mempoolIndex;
+
+        /** Memory mapped balance history of all addresses, null if the parser has not built it or it does not match the chain
+         *
+         * Directory: balance_history_index/
+         */
+        std::shared_ptr<const BalanceHistoryIndex> balanceHistoryIndex;
+
+        /** Memory mapped address prefix index, opened on the first call of getAddressesWithPrefix and opened again after
+         *  the index has been updated or the data has been reloaded. It is part of the blocksci library, so it is not opened
+         *  here. Access it with std::atomic_load and std::atomic_store.
+         *
+         * Directory: address_prefix_index/
+         */
+        std::shared_ptr<const AddressPrefixIndex> addressPrefixIndex;
+
+        /** Traversal reused by traverseTxGraph, which keeps its visited bitset between calls. Created on first use by the
+         *  blocksci library and taken out while a traversal runs. Access it with std::atomic_exchange and std::atomic_store.
+         */
+        std::shared_ptr<TxGraphTraversal> txGraphTraversal;
+
+        /** Files locked into memory by Blockchain::warmup, shared by all generations and unlocked when the last of them is
+         *  destroyed */
+        std::shared_ptr<LockedMappings> lockedFiles = std::make_shared<LockedMappings>();
+
+        /** Number of generations loaded before this one, @see nextGeneration */
+        uint64_t generation = 0;
+
+        /** Optional inotify watcher that records completed parser updates, created on first use and shared by all
+         *  generations, @see Blockchain::waitForUpdate */
+        std::shared_ptr<ChainWatcher> watcher;
         
         DataAccess();
         explicit DataAccess(DataConfiguration config_);
@@ -97,6 +136,10 @@ namespace blocksci {
             return *mempoolIndex;
         }
 
+        const BalanceHistoryIndex *getBalanceHistoryIndex() const {
+            return balanceHistoryIndex.get();
+        }
+
         AddressIndex &getAddressIndex() {
             return *addressIndex;
         }
@@ -107,7 +150,18 @@ namespace blocksci {
         
         operator DataConfiguration() const { return config; }
         
+        /** Reloads the data files in place, which invalidates all objects that have been loaded from this DataAccess */
         void reload();
+
+        /** Whether blocks have been added to or replaced in the data directory since this generation was loaded */
+        bool isOutdated() const;
+
+        /** Loads the current state of the data directory as a new, independent generation
+         *
+         * The file mappings are extended in place and shared with this generation, which stays usable for as long as it exists.
+         * Reloading in place costs time proportional to the data added since this generation was loaded.
+         */
+        std::unique_ptr<DataAccess> nextGeneration() const;
     };
 }
 
@@ -8,6 +8,8 @@
 
 #include "data_configuration.hpp"
 
+#include "dedup_address_info.hpp"
+
 #include <nlohmann/json.hpp>
 
 #include <fstream>
@@ -21,7 +23,42 @@ namespace blocksci {
         checkVersion(jsonConf);
         
         ChainConfiguration chainConfig = jsonConf.at("chainConfig");
-        return {configPath, chainConfig, errorOnReorg, blocksIgnored};
+        DataConfiguration config{configPath, chainConfig, errorOnReorg, blocksIgnored};
+        if (jsonConf.find("storage") != jsonConf.end()) {
+            config.storage = jsonConf.at("storage");
+        }
+        return config;
+    }
+
+    void to_json(json& j, const StorageConfiguration& p) {
+        j = json{
+            {"compressedFiles", p.compressedFiles},
+            {"chunkSize", p.chunkSize},
+            {"cacheChunks", p.cacheChunks},
+            {"readaheadTxes", p.readaheadTxes},
+            {"populateHotFiles", p.populateHotFiles},
+            {"hugePages", p.hugePages}
+        };
+    }
+
+    void from_json(const json& j, StorageConfiguration& p) {
+        StorageConfiguration defaults;
+        p.compressedFiles = j.value("compressedFiles", defaults.compressedFiles);
+        p.chunkSize = j.value("chunkSize", defaults.chunkSize);
+        p.cacheChunks = j.value("cacheChunks", defaults.cacheChunks);
+        p.readaheadTxes = j.value("readaheadTxes", defaults.readaheadTxes);
+        p.populateHotFiles = j.value("populateHotFiles", defaults.populateHotFiles);
+        p.hugePages = j.value("hugePages", defaults.hugePages);
+    }
+
+    std::vector<std::string> compressibleDataFiles() {
+        std::vector<std::string> files{"chain/tx_data"};
+        for (auto type : DedupAddressType::allArray()) {
+            auto name = "scripts/" + dedupAddressName(type);
+            files.push_back(name);
+            files.push_back(name + "_data");
+        }
+        return files;
     }
     
     void createDirectory(const filesystem::path &dir) {
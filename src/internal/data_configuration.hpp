@@ -25,6 +25,38 @@ namespace blocksci {
     nlohmann::json loadConfig(const std::string &configFilePath);
     void checkVersion(const nlohmann::json &jsonConf);
 
+    /** Settings for how data files are stored and mapped, loaded from the optional "storage" section of the config file
+     *
+     * Compressed files are read transparently, @see CompressedFileMapping. The files are converted with the
+     * compress-files command of the parser, which compresses every listed file and decompresses every other one.
+     */
+    struct StorageConfiguration {
+        /** Data files that are stored block-compressed, given relative to the data directory and without the .dat extension, eg. "chain/tx_data" */
+        std::vector<std::string> compressedFiles;
+
+        /** Number of uncompressed bytes per compressed chunk, must be a multiple of the page size */
+        uint32_t chunkSize = 1 << 20;
+
+        /** Number of decompressed chunks that every thread keeps in memory across all compressed files, 0 to use the library default
+         *
+         * Objects read from a compressed file, eg. a Transaction, point into these chunks and stay valid until their
+         * thread has read this many other chunks.
+         */
+        uint64_t cacheChunks = 0;
+
+        /** Number of transactions that iterators read ahead of their position, 0 disables readahead */
+        uint32_t readaheadTxes = 1 << 16;
+
+        /** Fault in the hot chain files (blocks, transactions, first input/output numbers) when the chain is loaded */
+        bool populateHotFiles = false;
+
+        /** Ask for transparent huge pages when populating the hot chain files */
+        bool hugePages = false;
+    };
+
+    void to_json(nlohmann::json& j, const StorageConfiguration& p);
+    void from_json(const nlohmann::json& j, StorageConfiguration& p);
+
     /** Loads and holds blockchain configuration files, needed to load blockchains */
     struct DataConfiguration {
         DataConfiguration() {}
@@ -39,6 +71,8 @@ namespace blocksci {
 
         /** Configuration of an individual chain, eg. coinName, dataDirectory, segwitActivationHeight etc. */
         ChainConfiguration chainConfig;
+
+        StorageConfiguration storage;
         
         bool isNull() const {
             return chainConfig.dataDirectory.empty();
@@ -64,6 +98,31 @@ namespace blocksci {
             return chainConfig.dataDirectory/"hashIndex";
         }
         
+        /** Path prefix of the memory mapped tx hash index, @see TxHashIndex */
+        filesystem::path txHashIndexFilePath() const {
+            return chainConfig.dataDirectory/"tx_hash_index";
+        }
+        
+        /** Path prefix of the memory mapped taproot output key index, @see TaprootIndex */
+        filesystem::path taprootIndexFilePath() const {
+            return chainConfig.dataDirectory/"taproot_index";
+        }
+        
+        /** Directory of the address string prefix index, @see AddressPrefixIndex */
+        filesystem::path addressPrefixIndexDirectory() const {
+            return chainConfig.dataDirectory/"address_prefix_index";
+        }
+        
+        /** Directory of the memory mapped address to outputs index, @see AddressOutputIndex */
+        filesystem::path addressOutputIndexDirectory() const {
+            return chainConfig.dataDirectory/"address_output_index";
+        }
+        
+        /** Directory of the memory mapped balance history index, @see BalanceHistoryIndex */
+        filesystem::path balanceHistoryIndexDirectory() const {
+            return chainConfig.dataDirectory/"balance_history_index";
+        }
+        
         filesystem::path pidFilePath() const {
             return chainConfig.dataDirectory/"blocksci_parser.pid";
         }
@@ -77,6 +136,9 @@ namespace blocksci {
         }
     };
     
+    /** Files that may be stored block-compressed, relative to the data directory and without the .dat extension */
+    std::vector<std::string> compressibleDataFiles();
+
     DataConfiguration loadBlockchainConfig(const std::string &configPath, bool errorOnReorg, BlockHeight blocksIgnored);
 }
 
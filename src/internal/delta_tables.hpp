@@ -0,0 +1,34 @@
+//
+//  delta_tables.hpp
+//  blocksci
+//
+
+#ifndef delta_tables_hpp
+#define delta_tables_hpp
+
+#include <cstdint>
+
+namespace blocksci {
+
+    /** Whether an index update builds new base tables rather than a new delta table
+     *
+     * The memory mapped indexes that the parser keeps up to date (TxHashIndex, AddressOutputIndex, TaprootIndex and
+     * BalanceHistoryIndex) consist of base tables that cover the transactions or scripts from the first one and delta
+     * tables that cover those added since, so a lookup searches at most two tables. An update merges the current delta
+     * table with the transactions or scripts added after its end, so it reads only the new data. Once the delta would
+     * cover more than an eighth of the base, the update builds new base tables and removes the delta. The
+     * AddressPrefixIndex, which is only updated by updateAddressPrefixIndex, follows the same rule.
+     *
+     * Every table records the range it covers and the last transaction or script it contains, so tables that no longer
+     * match the chain, eg. after a reorg, are ignored and rebuilt. Tables are written to temporary files and moved into
+     * place, so readers never see a partially written table and keep using the tables they have mapped.
+     *
+     * @param baseCount number of transactions or scripts covered by the base tables, 0 if there are none
+     * @param count number of transactions or scripts the index will cover after the update
+     */
+    inline bool rebuildsBaseTables(uint64_t baseCount, uint64_t count) {
+        return baseCount == 0 || count - baseCount > baseCount / 8;
+    }
+} // namespace blocksci
+
+#endif /* delta_tables_hpp */
@@ -9,18 +9,31 @@
 #ifndef file_mapper_hpp
 #define file_mapper_hpp
 
+#include "compressed_file.hpp"
+#include "growable_mapping.hpp"
+#include "offset_index.hpp"
+
 #include <mio/mmap.hpp>
 
 #include <wjfilesystem/path.h>
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
 #include <array>
 #include <cassert>
 #include <fstream>
 #include <cstring>
 #include <limits>
+#include <memory>
+#include <stdexcept>
 #include <string>
 #include <vector>
 #include <tuple>
+#include <type_traits>
+#include <utility>
 
 namespace blocksci {
     template<mio::access_mode mode = mio::access_mode::read>
@@ -86,6 +99,90 @@ namespace blocksci {
         }
     };
     
+    /** Access pattern hints for memory-mapped files, passed on to the kernel with madvise and posix_fadvise */
+    enum class AccessHint {
+        /** Default readahead behavior */
+        Normal,
+        /** Data is read in ascending order, enables aggressive readahead and early release of pages behind the reader */
+        Sequential,
+        /** Data is read in random order, disables readahead */
+        Random,
+        /** Data is needed soon and is read into the page cache in the background */
+        WillNeed,
+        /** Data is not needed in the near future and its pages may be dropped from memory */
+        DontNeed
+    };
+
+    /** Applies hint to [offset, offset + length) of a mapping of the whole file fd that starts at mapStart
+     *
+     * fd may be -1 in which case only the mapping is advised.
+     */
+    inline void adviseMapping(const char *mapStart, OffsetType mapLength, int fd, AccessHint hint, OffsetType offset, OffsetType length) {
+        if (mapStart == nullptr || offset >= mapLength || length <= 0) {
+            return;
+        }
+        length = std::min(length, mapLength - offset);
+        static const OffsetType pageSize = static_cast<OffsetType>(sysconf(_SC_PAGESIZE));
+        auto alignedOffset = offset - offset % pageSize;
+        auto addr = const_cast<char *>(mapStart) + alignedOffset;
+        auto alignedLength = static_cast<size_t>(length + offset - alignedOffset);
+        int memoryAdvice = MADV_NORMAL;
+        int fileAdvice = POSIX_FADV_NORMAL;
+        switch (hint) {
+            case AccessHint::Normal:
+                break;
+            case AccessHint::Sequential:
+                memoryAdvice = MADV_SEQUENTIAL;
+                fileAdvice = POSIX_FADV_SEQUENTIAL;
+                break;
+            case AccessHint::Random:
+                memoryAdvice = MADV_RANDOM;
+                fileAdvice = POSIX_FADV_RANDOM;
+                break;
+            case AccessHint::WillNeed:
+                memoryAdvice = MADV_WILLNEED;
+                fileAdvice = POSIX_FADV_WILLNEED;
+                break;
+            case AccessHint::DontNeed:
+                memoryAdvice = MADV_DONTNEED;
+                fileAdvice = POSIX_FADV_DONTNEED;
+                break;
+        }
+        madvise(addr, alignedLength, memoryAdvice);
+        if (fd >= 0) {
+            posix_fadvise(fd, offset, length, fileAdvice);
+        }
+    }
+
+    /** Faults in all pages of a mapping up front (like MAP_POPULATE), optionally asking for transparent huge pages first */
+    inline void populateMapping(const char *mapStart, OffsetType mapLength, bool hugePages) {
+        if (mapStart == nullptr || mapLength <= 0) {
+            return;
+        }
+        auto addr = const_cast<char *>(mapStart);
+        auto length = static_cast<size_t>(mapLength);
+        #ifdef MADV_HUGEPAGE
+        if (hugePages) {
+            madvise(addr, length, MADV_HUGEPAGE);
+        }
+        #else
+        (void)hugePages;
+        #endif
+        #ifdef MADV_POPULATE_READ
+        if (madvise(addr, length, MADV_POPULATE_READ) == 0) {
+            return;
+        }
+        #endif
+        // Fallback for kernels older than 5.14: start readahead for the whole file and touch every page
+        madvise(addr, length, MADV_WILLNEED);
+        static const size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        volatile char sink = 0;
+        for (size_t i = 0; i < length; i += pageSize) {
+            sink = mapStart[i];
+        }
+        (void)sink;
+    }
+
     template <mio::access_mode mode>
     struct SimpleFileMapperBase {
         
@@ -129,50 +226,149 @@ namespace blocksci {
         }
     };
 
+    /** Read-only memory mapping of a data file
+     *
+     * The file is mapped into a reserved address range that leaves room for it to grow, @see GrowableFileMapping,
+     * so reloading a file that has been appended to only maps the new data and keeps pointers into it valid.
+     *
+     * If pathPrefix.dat does not exist but a block-compressed version of it does (@see compressedFilePath), the
+     * compressed file is opened instead. Its data is only available through getDataAtOffset(offset, length), which
+     * decompresses the requested range into the chunk cache of the calling thread, @see CompressedFileMapping
+     */
     template <>
     struct SimpleFileMapper<mio::access_mode::read> {
     private:
-        mio::basic_mmap<mio::access_mode::read, char> file;
+        /** Mapping of the uncompressed file, shared between copies of this mapper */
+        std::shared_ptr<GrowableFileMapping> file;
+        /** Compressed version of the file, only set if the uncompressed one does not exist */
+        std::shared_ptr<CompressedFileMapping> compressedFile;
         FileInfo fileInfo;
+        FileInfo compressedFileInfo;
+        const char *dataPtr = nullptr;
+        OffsetType dataSize = 0;
+        /** Whole-file access pattern, reapplied whenever the file is remapped */
+        AccessHint accessPattern = AccessHint::Normal;
+        
+        void updateData() {
+            dataPtr = file ? file->data() : nullptr;
+            dataSize = file ? static_cast<OffsetType>(file->length()) : 0;
+        }
     public:
         
-        SimpleFileMapper(const filesystem::path &path_) : fileInfo(path_.str() + ".dat") {
+        SimpleFileMapper(const filesystem::path &path_) : fileInfo(path_.str() + ".dat"), compressedFileInfo(compressedFilePath(path_)) {
             openFile();
         }
         
+        /** Copies share the mapping of the file. Reloading a copy extends the shared mapping in place, which leaves the
+         *  data visible through other copies unchanged, or replaces the copy's mapping by a new one. */
+        SimpleFileMapper(const SimpleFileMapper &) = default;
+        SimpleFileMapper &operator=(const SimpleFileMapper &) = default;
+        
         void openFile() {
-            std::error_code error;
-            file.map(fileInfo.path.str(), 0, mio::map_entire_file, error);
-//            if(error) {
-//                throw error;
-//            }
+            if (!fileInfo.exists() && compressedFileInfo.exists()) {
+                file.reset();
+                compressedFile = std::make_shared<CompressedFileMapping>(compressedFileInfo.path);
+                dataPtr = nullptr;
+                dataSize = compressedFile->size();
+                return;
+            }
+            compressedFile.reset();
+            auto mapping = std::make_shared<GrowableFileMapping>();
+            if (mapping->map(fileInfo.path.str())) {
+                file = std::move(mapping);
+            } else {
+                file.reset();
+            }
+            updateData();
+            if (accessPattern != AccessHint::Normal) {
+                adviseRange(accessPattern, 0, dataSize);
+            }
+        }
+        
+        /** Sets the access pattern (Normal, Sequential or Random) of the whole file or applies WillNeed/DontNeed to the whole file */
+        void advise(AccessHint hint) {
+            if (hint == AccessHint::Normal || hint == AccessHint::Sequential || hint == AccessHint::Random) {
+                accessPattern = hint;
+            }
+            adviseRange(hint, 0, dataSize);
+        }
+        
+        void adviseRange(AccessHint hint, OffsetType offset, OffsetType length) const {
+            // Compressed files are read through the chunk cache, the kernel's view of them says nothing about what will be read
+            if (compressedFile) {
+                return;
+            }
+            adviseMapping(dataPtr, dataSize, file ? file->file_handle() : -1, hint, offset, length);
+        }
+        
+        /** Fault in the whole file now instead of on first access, @see populateMapping */
+        void populate(bool hugePages) {
+            if (!compressedFile) {
+                populateMapping(dataPtr, dataSize, hugePages);
+            }
         }
         
         bool isGood() const {
-            return file.is_open();
+            return file != nullptr || compressedFile != nullptr;
+        }
+        
+        bool isCompressed() const {
+            return compressedFile != nullptr;
         }
         
+        /** Pointer to the data at offset, only for uncompressed files */
         const char *getDataAtOffset(OffsetType offset) const {
             if (offset == InvalidFileIndex) {
                 return nullptr;
             }
+            if (compressedFile) {
+                throw std::logic_error("Reading compressed file " + compressedFileInfo.path.str() + " requires the length of the data");
+            }
             assert(offset < size());
-            return &file[offset];
+            return dataPtr + offset;
+        }
+        
+        /** Pointer to the length bytes at offset, which are decompressed first if the file is compressed
+         *
+         * Pointers into compressed files stay valid until the calling thread has read
+         * CompressedFileMapping::threadCacheChunks() other chunks.
+         */
+        const char *getDataAtOffset(OffsetType offset, OffsetType length) const {
+            if (offset == InvalidFileIndex) {
+                return nullptr;
+            }
+            assert(offset + length <= size());
+            if (compressedFile) {
+                return compressedFile->read(offset, length);
+            }
+            return dataPtr + offset;
         }
         
         OffsetType size() const {
-            return file.length();
+            return dataSize;
         }
         
         void reload() {
             if (fileInfo.exists()) {
-                if (!file.is_open() || fileInfo.size() != file.size()) {
+                auto oldSize = dataSize;
+                if (!compressedFile && file && file->extend()) {
+                    updateData();
+                    if (accessPattern != AccessHint::Normal && dataSize > oldSize) {
+                        adviseRange(accessPattern, oldSize, dataSize - oldSize);
+                    }
+                } else {
                     openFile();
                 }
-            } else {
-                if (file.is_open()) {
-                    file.unmap();
+            } else if (compressedFileInfo.exists()) {
+                // Compressed files are never appended to, so they only need to be mapped once
+                if (!compressedFile) {
+                    openFile();
                 }
+            } else {
+                file.reset();
+                compressedFile.reset();
+                dataPtr = nullptr;
+                dataSize = 0;
             }
         }
     };
@@ -247,6 +443,19 @@ namespace blocksci {
             clearBuffer();
         }
         
+        void advise(AccessHint hint) {
+            adviseRange(hint, 0, fileSize());
+        }
+        
+        /** Applies hint to the part of [offset, offset + length) that has already been written to the file */
+        void adviseRange(AccessHint hint, OffsetType offset, OffsetType length) const {
+            adviseMapping(file.is_open() ? file.data() : nullptr, fileSize(), file.is_open() ? file.file_handle() : -1, hint, offset, length);
+        }
+        
+        void populate(bool hugePages) {
+            populateMapping(file.is_open() ? file.data() : nullptr, fileSize(), hugePages);
+        }
+        
         OffsetType getWriteOffset() const {
             return writePos;
         }
@@ -336,6 +545,15 @@ namespace blocksci {
             }
         }
         
+        const char *getDataAtOffset(OffsetType offset, OffsetType) const {
+            return getDataAtOffset(offset);
+        }
+        
+        /** Files are only compressed after parsing, and compressed files are never written to */
+        bool isCompressed() const {
+            return false;
+        }
+        
         OffsetType fileSize() const {
             return file.length();
         }
@@ -399,7 +617,7 @@ namespace blocksci {
         
         const_pointer operator[](OffsetType index) const {
             assert(index < size());
-            const char *pos = dataFile.getDataAtOffset(getPos(index));
+            const char *pos = dataFile.getDataAtOffset(getPos(index), static_cast<OffsetType>(sizeof(T)));
             return reinterpret_cast<const_pointer>(pos);
         }
         
@@ -430,6 +648,19 @@ namespace blocksci {
             dataFile.reload();
         }
         
+        void advise(AccessHint hint) {
+            dataFile.advise(hint);
+        }
+        
+        /** Applies hint to the elements [beginIndex, endIndex) */
+        void adviseRange(AccessHint hint, OffsetType beginIndex, OffsetType endIndex) const {
+            dataFile.adviseRange(hint, getPos(beginIndex), getPos(endIndex) - getPos(beginIndex));
+        }
+        
+        void populate(bool hugePages) {
+            dataFile.populate(hugePages);
+        }
+        
         void clearBuffer() {
             dataFile.clearBuffer();
         }
@@ -498,6 +729,10 @@ namespace blocksci {
      * Indexing: separate index file is needed, as the size of each item is variable and the access approach
      *           of SimpleFileMapper is not applicable.
      *           Access pattern is like dataFile[indexFile[index]], given that dataFile[] access is byte-wise
+     *
+     * If a compact Elias-Fano version of the index file exists (eg. chain/tx_index_ef.dat, @see updateOffsetIndex), read-only
+     * mappers of single-element files look up offsets in it instead of in the much larger index file. Elements appended
+     * after the compact index was built are still looked up in the index file.
      */
     template <mio::access_mode mode, typename... T>
     struct IndexedFileMapper {
@@ -507,6 +742,30 @@ namespace blocksci {
         static constexpr size_t indexCount = sizeof...(T);
         SimpleFileMapper<mode> dataFile;
         FixedSizeFileMapper<FileIndex<indexCount>, mode> indexFile;
+        filesystem::path offsetIndexPrefix;
+        std::shared_ptr<SimpleFileMapper<mio::access_mode::read>> offsetIndexFile;
+        OffsetIndex offsetIndex;
+        
+        void openOffsetIndex() {
+            offsetIndex = OffsetIndex{};
+            if (mode != mio::access_mode::read || indexCount != 1) {
+                return;
+            }
+            if (offsetIndexFile) {
+                // The file may still be in use by copies of this mapper, so it is reloaded through a copy of its own
+                offsetIndexFile = std::make_shared<SimpleFileMapper<mio::access_mode::read>>(*offsetIndexFile);
+                offsetIndexFile->reload();
+            } else {
+                offsetIndexFile = std::make_shared<SimpleFileMapper<mio::access_mode::read>>(offsetIndexPrefix);
+            }
+            if (offsetIndexFile->size() > 0 && offsetIndex.load(offsetIndexFile->getDataAtOffset(0), offsetIndexFile->size())) {
+                // A compact index that does not match the index file, eg. because the chain was truncated after it was built, is ignored
+                auto count = static_cast<OffsetType>(offsetIndex.size());
+                if (count > indexFile.size() || (count > 0 && offsetIndex[static_cast<uint64_t>(count - 1)] != (*indexFile[count - 1])[0])) {
+                    offsetIndex = OffsetIndex{};
+                }
+            }
+        }
         
         void writeNewImp(const char *valuePos, OffsetType amountToWrite) {
             assert(amountToWrite % static_cast<OffsetType>(alignof(nth_element<0>)) == 0);
@@ -530,9 +789,42 @@ namespace blocksci {
             
         }
         
+        /** Length of the element at offset, elements of single-element files end where the next one begins */
+        template<size_t indexNum>
+        OffsetType elementLength(uint32_t index, OffsetType offset, std::true_type) const {
+            auto end = index + 1 < size() ? getOffset(index + 1) : dataFile.size();
+            return end - offset;
+        }
+        
+        /** Length of the element at offset, given by the realSize() of its fixed-size head */
+        template<size_t indexNum>
+        OffsetType elementLength(uint32_t, OffsetType offset, std::false_type) const {
+            using Element = nth_element<indexNum>;
+            auto headLength = std::min(static_cast<OffsetType>(sizeof(Element)), dataFile.size() - offset);
+            auto head = reinterpret_cast<const Element *>(dataFile.getDataAtOffset(offset, headLength));
+            return static_cast<OffsetType>(head->realSize());
+        }
+        
+        /** Pointer to the element at offset, whose length is only needed to read it from a compressed data file */
+        template<size_t indexNum>
+        const char *elementData(uint32_t index, OffsetType offset) const {
+            if (offset == InvalidFileIndex || !dataFile.isCompressed()) {
+                return dataFile.getDataAtOffset(offset);
+            }
+            return dataFile.getDataAtOffset(offset, elementLength<indexNum>(index, offset, std::integral_constant<bool, indexCount == 1>{}));
+        }
+        
+        template<size_t... indexNums>
+        std::array<const char *, indexCount> elementsData(uint32_t index, const FileIndex<indexCount> &offsets, std::index_sequence<indexNums...>) const {
+            return {{elementData<indexNums>(index, offsets[indexNums])...}};
+        }
+        
         template<size_t indexNum = 0>
         OffsetType getOffset(uint32_t index) const {
             static_assert(indexNum < sizeof...(T), "Trying to fetch index out of bounds");
+            if (indexNum == 0 && index < offsetIndex.size()) {
+                return offsetIndex[index];
+            }
             auto indexData = indexFile[index];
             auto offset = (*indexData)[indexNum];
             assert(offset < dataFile.size() || offset == InvalidFileIndex);
@@ -540,12 +832,49 @@ namespace blocksci {
         }
         
     public:
-        explicit IndexedFileMapper(const filesystem::path &pathPrefix) : dataFile(pathPrefix.str() + "_data"), indexFile(pathPrefix.str() + "_index") {
+        explicit IndexedFileMapper(const filesystem::path &pathPrefix) : dataFile(pathPrefix.str() + "_data"), indexFile(pathPrefix.str() + "_index"), offsetIndexPrefix(offsetIndexPath(pathPrefix.str() + "_index")) {
+            openOffsetIndex();
         }
         
         void reload() {
             indexFile.reload();
             dataFile.reload();
+            openOffsetIndex();
+        }
+        
+        /** Number of elements whose offsets are looked up in the compact offset index */
+        OffsetType offsetIndexSize() const {
+            return static_cast<OffsetType>(offsetIndex.size());
+        }
+        
+        void advise(AccessHint hint) {
+            indexFile.advise(hint);
+            dataFile.advise(hint);
+        }
+        
+        /** Applies hint to the elements [beginIndex, endIndex), covering both their index entries and their data */
+        void adviseRange(AccessHint hint, uint32_t beginIndex, uint32_t endIndex) const {
+            auto count = static_cast<uint32_t>(size());
+            endIndex = std::min(endIndex, count);
+            if (beginIndex >= endIndex) {
+                return;
+            }
+            // Index entries covered by the compact offset index are never read
+            auto compactCount = static_cast<uint32_t>(std::min<uint64_t>(offsetIndex.size(), endIndex));
+            indexFile.adviseRange(hint, std::max(beginIndex, compactCount), endIndex);
+            auto dataBegin = getOffset(beginIndex);
+            auto dataEnd = endIndex < count ? getOffset(endIndex) : dataFile.size();
+            dataFile.adviseRange(hint, dataBegin, dataEnd - dataBegin);
+        }
+        
+        void populate(bool hugePages) {
+            if (offsetIndexFile) {
+                offsetIndexFile->populate(hugePages);
+            }
+            if (offsetIndex.size() < static_cast<uint64_t>(size())) {
+                indexFile.populate(hugePages);
+            }
+            dataFile.populate(hugePages);
         }
         
         void clearBuffer() {
@@ -554,6 +883,9 @@ namespace blocksci {
         }
         
         FileIndex<sizeof...(T)> getOffsets(uint32_t index) const {
+            if (index < offsetIndex.size()) {
+                return {{offsetIndex[index]}};
+            }
             return *indexFile[index];
         }
         
@@ -565,6 +897,11 @@ namespace blocksci {
             return indexFile.fileSize();
         }
         
+        /** Whether the elements are read from a compressed data file, in which case they are not stored contiguously in memory */
+        bool isCompressed() const {
+            return dataFile.isCompressed();
+        }
+        
         void truncate(uint32_t index) {
             if (index < size()) {
                 auto offsets = getOffsets(index);
@@ -611,8 +948,7 @@ namespace blocksci {
         template<size_t indexNum = 0>
         add_const_ptr_t<nth_element<indexNum>> getDataAtIndex(uint32_t index) const {
             assert(index < size());
-            auto offset = getOffset<indexNum>(index);
-            auto pointer = dataFile.getDataAtOffset(offset);
+            auto pointer = elementData<indexNum>(index, getOffset<indexNum>(index));
             return reinterpret_cast<add_const_ptr_t<nth_element<indexNum>>>(pointer);
         }
         
@@ -627,11 +963,7 @@ namespace blocksci {
         template <size_t Z = sizeof...(T)>
         auto getData(std::enable_if_t<(Z > 1), uint32_t> index) const {
             assert(index < size());
-            auto offsets = getOffsets(index);
-            std::array<const char *, sizeof...(T)> pointers;
-            for (size_t i = 0; i < sizeof...(T); i++) {
-                pointers[i] = dataFile.getDataAtOffset(offsets[i]);
-            }
+            auto pointers = elementsData(index, getOffsets(index), std::make_index_sequence<indexCount>{});
             return tuple_cast<T...>(pointers);
         }
         
@@ -0,0 +1,123 @@
+//
+//  growable_mapping.cpp
+//  blocksci
+//
+
+#include "growable_mapping.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <system_error>
+
+namespace blocksci {
+
+    namespace {
+        size_t pageSize() {
+            static const size_t size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+            return size;
+        }
+
+        size_t roundToPages(size_t size) {
+            return (size + pageSize() - 1) / pageSize() * pageSize();
+        }
+
+        /** Address space reserved for a file of the given size, leaves room for the file to double or to grow by 1 GiB */
+        size_t reservationFor(size_t size) {
+            return roundToPages(std::max(size * 2, size + (size_t{1} << 30)));
+        }
+    } // namespace
+
+    GrowableFileMapping::~GrowableFileMapping() {
+        unmap();
+    }
+
+    bool GrowableFileMapping::map(const std::string &path_) {
+        unmap();
+        path = path_;
+        return openAndMap();
+    }
+
+    bool GrowableFileMapping::openAndMap() {
+        fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat info;
+        if (fstat(fd, &info) != 0 || info.st_size <= 0) {
+            close(fd);
+            fd = -1;
+            return false;
+        }
+        device = static_cast<uint64_t>(info.st_dev);
+        inode = static_cast<uint64_t>(info.st_ino);
+        fileSize = static_cast<size_t>(info.st_size);
+        reservedSize = reservationFor(fileSize);
+        void *reservation = mmap(nullptr, reservedSize, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if (reservation == MAP_FAILED) {
+            close(fd);
+            fd = -1;
+            return false;
+        }
+        base = static_cast<char *>(reservation);
+        mappedSize = 0;
+        try {
+            mapRange(fileSize);
+        } catch (...) {
+            unmap();
+            throw;
+        }
+        return true;
+    }
+
+    void GrowableFileMapping::mapRange(size_t newSize) {
+        auto newMappedSize = roundToPages(newSize);
+        if (newMappedSize > mappedSize) {
+            // The last page that was mapped before already shows the bytes appended to it, so only whole new pages are mapped
+            void *range = mmap(base + mappedSize, newMappedSize - mappedSize, PROT_READ, MAP_SHARED | MAP_FIXED, fd, static_cast<off_t>(mappedSize));
+            if (range == MAP_FAILED) {
+                throw std::system_error(errno, std::generic_category(), "Could not map " + path);
+            }
+            mappedSize = newMappedSize;
+        }
+        fileSize = newSize;
+    }
+
+    bool GrowableFileMapping::extend() {
+        if (base == nullptr) {
+            return false;
+        }
+        struct stat info;
+        if (stat(path.c_str(), &info) != 0 || info.st_size <= 0) {
+            return false;
+        }
+        auto newSize = static_cast<size_t>(info.st_size);
+        // Readers of older generations may still use the data past the end of a truncated file, so a shrunk file gets a
+        // new mapping instead of losing the tail of this one
+        if (static_cast<uint64_t>(info.st_dev) != device || static_cast<uint64_t>(info.st_ino) != inode || newSize < fileSize || newSize > reservedSize) {
+            return false;
+        }
+        if (newSize != fileSize) {
+            mapRange(newSize);
+        }
+        return true;
+    }
+
+    void GrowableFileMapping::unmap() {
+        if (base != nullptr) {
+            munmap(base, reservedSize);
+            base = nullptr;
+        }
+        if (fd >= 0) {
+            close(fd);
+            fd = -1;
+        }
+        reservedSize = 0;
+        mappedSize = 0;
+        fileSize = 0;
+    }
+} // namespace blocksci
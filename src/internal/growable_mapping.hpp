@@ -0,0 +1,87 @@
+//
+//  growable_mapping.hpp
+//  blocksci
+//
+
+#ifndef growable_mapping_hpp
+#define growable_mapping_hpp
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace blocksci {
+
+    /** Read-only memory mapping of a file that grows by appending, eg. the chain files while the parser adds blocks
+     *
+     * The mapping lives at the start of a reserved address range that is larger than the file. When the file grows,
+     * only the newly appended pages are mapped into the reservation, so existing pointers into the file stay valid and the
+     * page tables of the data that is already mapped are left untouched. Following the chain tip therefore costs time
+     * proportional to the new data rather than to the size of the file.
+     *
+     * If the file is truncated, outgrows its reservation or is replaced by a different file, it has to be mapped again by a
+     * new GrowableFileMapping. Because extending never moves or shrinks the mapping, it can be shared by readers of an
+     * older generation of the data while a newer generation extends it, @see DataAccess::nextGeneration
+     */
+    class GrowableFileMapping {
+    public:
+        GrowableFileMapping() = default;
+        GrowableFileMapping(const GrowableFileMapping &) = delete;
+        GrowableFileMapping &operator=(const GrowableFileMapping &) = delete;
+        ~GrowableFileMapping();
+
+        /** Maps the file at path, returns false and stays closed if the file does not exist or is empty
+         *
+         * @throws std::system_error if the file could not be mapped into the reservation
+         */
+        bool map(const std::string &path);
+
+        /** Extends the mapping in place to the current size of the file
+         *
+         * @return false if the file has been removed, replaced, truncated or has outgrown the reservation, in which case the
+         *         mapping is left unchanged and the file has to be mapped again
+         * @throws std::system_error if the appended pages could not be mapped
+         */
+        bool extend();
+
+        void unmap();
+
+        bool is_open() const {
+            return base != nullptr;
+        }
+
+        const char *data() const {
+            return base;
+        }
+
+        size_t length() const {
+            return fileSize;
+        }
+
+        size_t size() const {
+            return fileSize;
+        }
+
+        int file_handle() const {
+            return fd;
+        }
+
+    private:
+        std::string path;
+        int fd = -1;
+        uint64_t device = 0;
+        uint64_t inode = 0;
+        char *base = nullptr;
+        /** Size of the reserved address range */
+        size_t reservedSize = 0;
+        /** Length of the mapped part at the start of the reservation, a multiple of the page size. It never shrinks, as
+         *  readers of older generations may still use all of it. */
+        size_t mappedSize = 0;
+        size_t fileSize = 0;
+
+        bool openAndMap();
+        void mapRange(size_t newSize);
+    };
+} // namespace blocksci
+
+#endif /* growable_mapping_hpp */
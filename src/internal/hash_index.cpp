@@ -7,7 +7,10 @@
 //
 
 #include "hash_index.hpp"
+#include "batch_lookup.hpp"
 #include "column_iterator.hpp"
+#include "taproot_index.hpp"
+#include "tx_hash_index.hpp"
 
 #include <blocksci/core/bitcoin_uint256.hpp>
 
@@ -19,6 +22,8 @@
 #include <rocksdb/table_properties.h>
 
 #include <array>
+#include <numeric>
+#include <string>
 //
 //namespace {
 //    void OptimizeForPointLookup(rocksdb::ColumnFamilyOptions &options, std::shared_ptr<rocksdb::Cache> cache) {
@@ -33,8 +38,30 @@
 //};
 
 namespace blocksci {
+
+    namespace {
+        /** Number of keys passed to one MultiGet call */
+        constexpr size_t multiGetBatchSize = 1024;
+
+        template <typename T>
+        struct IDTypeSize {
+            static constexpr size_t value = sizeof(T);
+        };
+
+        template <>
+        struct IDTypeSize<void> {
+            static constexpr size_t value = 0;
+        };
+
+        template <AddressType::Enum type>
+        struct AddressKeySizeFunctor {
+            static constexpr size_t f() {
+                return IDTypeSize<typename AddressInfo<type>::IDType>::value;
+            }
+        };
+    } // namespace
     
-    HashIndex::HashIndex(const filesystem::path &path, bool readonly) {
+    HashIndex::HashIndex(const filesystem::path &path, bool readonly, std::shared_ptr<const TxHashIndex> txHashIndex_, std::shared_ptr<const TaprootIndex> taprootIndex_) : txHashIndex(std::move(txHashIndex_)), taprootIndex(std::move(taprootIndex_)) {
         rocksdb::Options options;
         // Optimize RocksDB. This is the easiest way to get RocksDB to perform well
         options.IncreaseParallelism();
@@ -93,6 +120,31 @@ namespace blocksci {
         writeBatch(batch);
     }
     
+    rocksdb::Options HashIndex::sstFileOptions() {
+        // The column families use the default options, in particular the default bytewise comparator
+        return rocksdb::Options{};
+    }
+
+    void HashIndex::ingestFiles(rocksdb::ColumnFamilyHandle *column, const std::vector<std::string> &paths) {
+        if (paths.empty()) {
+            return;
+        }
+        rocksdb::IngestExternalFileOptions options;
+        options.move_files = true;
+        auto status = db->IngestExternalFile(column, paths, options);
+        if (!status.ok()) {
+            throw std::runtime_error{"Could not ingest files into hash index with error: " + status.ToString()};
+        }
+    }
+
+    void HashIndex::ingestTxFiles(const std::vector<std::string> &paths) {
+        ingestFiles(getTxColumn().get(), paths);
+    }
+
+    void HashIndex::ingestAddressFiles(AddressType::Enum type, const std::vector<std::string> &paths) {
+        ingestFiles(getColumn(type).get(), paths);
+    }
+    
     uint32_t HashIndex::countColumn(AddressType::Enum type) {
         uint32_t keyCount = 0;
         auto it = getIterator(type);
@@ -136,10 +188,123 @@ namespace blocksci {
     }
 
     ranges::optional<uint32_t> HashIndex::getTxIndex(const uint256 &txHash) {
+        // Transactions that are newer than the mapped index are only found in RocksDB
+        if (txHashIndex) {
+            if (auto txNum = txHashIndex->find(txHash)) {
+                return txNum;
+            }
+        }
         return getMatch(getTxColumn().get(), txHash);
     }
     
+    std::vector<ranges::optional<uint32_t>> HashIndex::getTxIndexes(const std::vector<uint256> &txHashes, unsigned int threadCount) {
+        std::vector<ranges::optional<uint32_t>> results(txHashes.size());
+        std::vector<size_t> missing;
+        if (txHashIndex) {
+            for (size_t i = 0; i < txHashes.size(); i++) {
+                results[i] = txHashIndex->find(txHashes[i]);
+                if (!results[i]) {
+                    missing.push_back(i);
+                }
+            }
+        } else {
+            missing.resize(txHashes.size());
+            std::iota(missing.begin(), missing.end(), size_t{0});
+        }
+
+        std::vector<MemoryView> keys;
+        keys.reserve(missing.size());
+        for (auto i : missing) {
+            keys.push_back(MemoryView{reinterpret_cast<const char *>(&txHashes[i]), sizeof(uint256)});
+        }
+        auto found = multiGet(getTxColumn().get(), keys, threadCount);
+        for (size_t i = 0; i < missing.size(); i++) {
+            results[missing[i]] = found[i];
+        }
+        return results;
+    }
+
+    std::vector<ranges::optional<uint32_t>> HashIndex::lookupAddresses(AddressType::Enum type, const std::vector<MemoryView> &keys, unsigned int threadCount) {
+        auto keySize = addressKeySize(type);
+        for (const auto &key : keys) {
+            if (key.size != keySize) {
+                throw std::runtime_error("Address identifiers of type " + addressName(type) + " must be " + std::to_string(keySize) + " bytes long");
+            }
+        }
+        if (type != AddressType::WITNESS_UNKNOWN || !taprootIndex) {
+            return multiGet(getColumn(type).get(), keys, threadCount);
+        }
+
+        // Output keys of scripts that are newer than the mapped index are only found in RocksDB
+        std::vector<ranges::optional<uint32_t>> results(keys.size());
+        std::vector<size_t> missing;
+        for (size_t i = 0; i < keys.size(); i++) {
+            uint256 outputKey;
+            std::memcpy(outputKey.begin(), keys[i].data, keys[i].size);
+            results[i] = taprootIndex->find(outputKey);
+            if (!results[i]) {
+                missing.push_back(i);
+            }
+        }
+        std::vector<MemoryView> missingKeys;
+        missingKeys.reserve(missing.size());
+        for (auto i : missing) {
+            missingKeys.push_back(keys[i]);
+        }
+        auto found = multiGet(getColumn(type).get(), missingKeys, threadCount);
+        for (size_t i = 0; i < missing.size(); i++) {
+            results[missing[i]] = found[i];
+        }
+        return results;
+    }
+
+    size_t HashIndex::addressKeySize(AddressType::Enum type) {
+        static constexpr auto table = make_static_table<AddressType, AddressKeySizeFunctor>();
+        return table.at(static_cast<size_t>(type));
+    }
+
+    std::vector<ranges::optional<uint32_t>> HashIndex::multiGet(rocksdb::ColumnFamilyHandle *column, const std::vector<MemoryView> &keys, unsigned int threadCount) {
+        std::vector<ranges::optional<uint32_t>> results(keys.size());
+        if (keys.empty()) {
+            return results;
+        }
+        auto order = sortedKeyOrder(keys);
+        SnapshotGuard snapshot{db.get()};
+        auto readOptions = snapshot.readOptions();
+        forEachChunk(order.size(), threadCount, [&](size_t begin, size_t end) {
+            std::vector<rocksdb::Slice> slices;
+            std::vector<std::string> values;
+            for (auto batchBegin = begin; batchBegin < end; batchBegin += multiGetBatchSize) {
+                auto batchEnd = std::min(end, batchBegin + multiGetBatchSize);
+                slices.clear();
+                for (auto i = batchBegin; i < batchEnd; i++) {
+                    const auto &key = keys[order[i]];
+                    slices.emplace_back(key.data, key.size);
+                }
+                std::vector<rocksdb::ColumnFamilyHandle *> columns(slices.size(), column);
+                auto statuses = db->MultiGet(readOptions, columns, slices, &values);
+                for (size_t j = 0; j < statuses.size(); j++) {
+                    if (statuses[j].ok() && values[j].size() >= sizeof(uint32_t)) {
+                        uint32_t value;
+                        memcpy(&value, values[j].data(), sizeof(value));
+                        results[order[batchBegin + j]] = value;
+                    } else if (!statuses[j].ok() && !statuses[j].IsNotFound()) {
+                        throw std::runtime_error{"Hash index lookup failed with error: " + statuses[j].ToString()};
+                    }
+                }
+            }
+        });
+        return results;
+    }
+    
     ranges::optional<uint32_t> HashIndex::lookupAddressImpl(blocksci::AddressType::Enum type, const char *data, size_t size) {
+        if (type == AddressType::WITNESS_UNKNOWN && taprootIndex && size == sizeof(uint256)) {
+            uint256 outputKey;
+            std::memcpy(outputKey.begin(), data, size);
+            if (auto scriptNum = taprootIndex->find(outputKey)) {
+                return scriptNum;
+            }
+        }
         return getAddressMatch(type, data, size);
     }
 
@@ -19,11 +19,14 @@
 
 #include <wjfilesystem/path.h>
 
+#include <string>
 #include <vector>
 #include <cstdint>
 #include <cstring>
 
 namespace blocksci {
+    class TaprootIndex;
+    class TxHashIndex;
 
     /** Provides access to hash indexes (RocksDB database)
      *
@@ -46,6 +49,9 @@ namespace blocksci {
      *         + Value: uint32_t scriptNum
      *
      * Directory: hashIndex/
+     *
+     * Tx hash lookups are answered by the memory mapped TxHashIndex first if one is attached, and taproot output key
+     * (WITNESS_UNKNOWN) lookups by the memory mapped TaprootIndex.
      */
     class HashIndex {
         /** Pointer to the RocksDB instance */
@@ -53,9 +59,19 @@ namespace blocksci {
 
         /** RocksDB column handles, one for each address type, @see blocksci::AddressType::Enum */
         std::vector<std::unique_ptr<rocksdb::ColumnFamilyHandle>> columnHandles;
+
+        /** Memory mapped tx hash index used before the "T" column family, nullptr if there is none */
+        std::shared_ptr<const TxHashIndex> txHashIndex;
+
+        /** Memory mapped taproot index used before the WITNESS_UNKNOWN column family, nullptr if there is none */
+        std::shared_ptr<const TaprootIndex> taprootIndex;
         
         ranges::optional<uint32_t> lookupAddressImpl(AddressType::Enum type, const char *data, size_t size);
+
+        /** Looks up all keys in key order with MultiGet on one snapshot, @see getTxIndexes */
+        std::vector<ranges::optional<uint32_t>> multiGet(rocksdb::ColumnFamilyHandle *column, const std::vector<MemoryView> &keys, unsigned int threadCount);
         void addAddressesImpl(AddressType::Enum type, std::vector<std::pair<MemoryView, MemoryView>> dataViews);
+        void ingestFiles(rocksdb::ColumnFamilyHandle *column, const std::vector<std::string> &paths);
         
         template <typename T>
         ranges::optional<uint32_t> getMatch(rocksdb::ColumnFamilyHandle *handle, const T &t) {
@@ -141,7 +157,7 @@ namespace blocksci {
         
     public:
         
-        HashIndex(const filesystem::path &path, bool readonly);
+        HashIndex(const filesystem::path &path, bool readonly, std::shared_ptr<const TxHashIndex> txHashIndex = nullptr, std::shared_ptr<const TaprootIndex> taprootIndex = nullptr);
         ~HashIndex();
 
         template<AddressType::Enum type>
@@ -149,6 +165,11 @@ namespace blocksci {
             return lookupAddressImpl(type, reinterpret_cast<const char *>(&hash), sizeof(hash));
         }
 
+        /** Get the scriptNum for the identifier of the given address type, stored in key */
+        ranges::optional<uint32_t> lookupAddress(AddressType::Enum type, const MemoryView &key) {
+            return lookupAddressImpl(type, key.data, key.size);
+        }
+
         /** Get the scriptNum for the given public key hash (P2PKH) */
         ranges::optional<uint32_t> getPubkeyHashIndex(const uint160 &pubkeyhash);
 
@@ -159,11 +180,54 @@ namespace blocksci {
         ranges::optional<uint32_t> getScriptHashIndex(const uint160 &scripthash);
         ranges::optional<uint32_t> getScriptHashIndex(const uint256 &scripthash);
 
-        /** Get the scriptNum for the given witness unknown program (Taproot) */
+        /** Get the scriptNum for the given witness unknown program (Taproot)
+         *
+         * Every output to a taproot address has its own script. Output keys in the TaprootIndex resolve to the first of
+         * them, @see TaprootIndex::findAll for all of them.
+         */
         ranges::optional<uint32_t> getWitnessUnknownIndex(const uint256 &witnessProgram);
+
+        /** The attached tx hash index, nullptr if there is none */
+        const TxHashIndex *getTxHashIndex() const {
+            return txHashIndex.get();
+        }
+
+        /** The attached taproot index, nullptr if there is none */
+        const TaprootIndex *getTaprootIndex() const {
+            return taprootIndex.get();
+        }
       
         /** Get the tx number for the given transaction hash */
         ranges::optional<uint32_t> getTxIndex(const uint256 &txHash);
+
+        /** Get the tx numbers for many transaction hashes at once, nullopt for hashes that are not in the index
+         *
+         * Hashes not found in the mapped TxHashIndex are sorted and looked up with RocksDB MultiGet on a shared
+         * snapshot, which gives far better block cache locality than one Get per hash. The sorted keys are split into
+         * threadCount contiguous chunks that are looked up in parallel.
+         */
+        std::vector<ranges::optional<uint32_t>> getTxIndexes(const std::vector<uint256> &txHashes, unsigned int threadCount = 1);
+
+        /** Get the scriptNums for many identifiers of the given address type at once, @see getTxIndexes
+         *
+         * Taproot output keys are answered by the TaprootIndex first, like tx hashes by the TxHashIndex.
+         *
+         * Every key must be addressKeySize(type) bytes long.
+         */
+        std::vector<ranges::optional<uint32_t>> lookupAddresses(AddressType::Enum type, const std::vector<MemoryView> &keys, unsigned int threadCount = 1);
+
+        template<AddressType::Enum type>
+        std::vector<ranges::optional<uint32_t>> lookupAddresses(const std::vector<typename AddressInfo<type>::IDType> &hashes, unsigned int threadCount = 1) {
+            std::vector<MemoryView> keys;
+            keys.reserve(hashes.size());
+            for (const auto &hash : hashes) {
+                keys.push_back(MemoryView{reinterpret_cast<const char *>(&hash), sizeof(hash)});
+            }
+            return lookupAddresses(type, keys, threadCount);
+        }
+
+        /** Size of the identifiers of the given address type in the index, 0 for types that are not indexed by hash */
+        static size_t addressKeySize(AddressType::Enum type);
         
         uint32_t countColumn(AddressType::Enum type);
         uint32_t countTxes();
@@ -181,6 +245,18 @@ namespace blocksci {
 
         /** Add a mapping from tx hash to tx number to the hash index for all given rows */
         void addTxes(std::vector<std::pair<uint256, uint32_t>> rows);
+
+        /** Options for rocksdb::SstFileWriters whose files are added with ingestTxFiles or ingestAddressFiles */
+        static rocksdb::Options sstFileOptions();
+
+        /** Moves SST files with tx hash -> tx number entries into the "T" column family, bypassing the memtables
+         *
+         * The files must not overlap each other. Their entries replace existing entries with the same keys.
+         */
+        void ingestTxFiles(const std::vector<std::string> &paths);
+
+        /** Moves SST files with identifier -> scriptNum entries into the column family of the address type, @see ingestTxFiles */
+        void ingestAddressFiles(AddressType::Enum type, const std::vector<std::string> &paths);
         
         ranges::any_view<std::pair<MemoryView, MemoryView>> getRawAddressRange(AddressType::Enum type);
         
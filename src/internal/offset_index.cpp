@@ -0,0 +1,192 @@
+//
+//  offset_index.cpp
+//  blocksci
+//
+
+#include "offset_index.hpp"
+
+#include <mio/mmap.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+namespace blocksci {
+
+    namespace {
+        /** Elements and universe of a new index are sized this much beyond the current data, so that the following updates
+         * can append in place. The index is rebuilt with new headroom once it is used up.
+         */
+        constexpr uint64_t headroomDivisor = 4;
+        constexpr uint64_t minHeadroom = 1 << 16;
+
+        /** Number of trailing elements of an existing index compared with the plain index file before appending to it. A
+         * reorg rewrites the offsets of the transactions after the fork point, which then no longer match.
+         */
+        constexpr uint64_t verifiedTailLength = 1 << 16;
+
+        /** Pointers into the sections of a memory mapped index file */
+        struct OffsetIndexSections {
+            OffsetIndexHeader *header;
+            uint64_t *lowWords;
+            uint64_t *highWords;
+            uint64_t *samples;
+
+            explicit OffsetIndexSections(char *data) : header(reinterpret_cast<OffsetIndexHeader *>(data)) {
+                lowWords = reinterpret_cast<uint64_t *>(data + sizeof(OffsetIndexHeader));
+                highWords = lowWords + header->lowWordCount;
+                samples = highWords + header->highWordCount;
+            }
+
+            /** Whether the sections have room for elements up to end, the last of which is lastOffset */
+            bool fits(uint64_t end, int64_t lastOffset) const {
+                if (end == 0) {
+                    return true;
+                }
+                auto lowBitCount = end * header->lowBits;
+                auto highPosition = (static_cast<uint64_t>(lastOffset) >> header->lowBits) + end - 1;
+                // One low word beyond the last element stays unused, @see buildIndexFile
+                return (lowBitCount + 63) / 64 + 1 <= header->lowWordCount && highPosition < header->highWordCount * 64 && (end + OffsetIndexHeader::sampleRate - 1) / OffsetIndexHeader::sampleRate <= header->sampleCount;
+            }
+
+            /** Encodes offsets [begin, end) and then publishes them by raising the element count
+             *
+             * Encoding only sets bits that are clear in an index of begin elements, so readers that loaded the index
+             * before never see any of their elements change.
+             */
+            void append(const int64_t *offsets, uint64_t begin, uint64_t end) {
+                auto lowBits = header->lowBits;
+                auto lowMask = lowBits > 0 ? (uint64_t{1} << lowBits) - 1 : 0;
+                for (uint64_t i = begin; i < end; i++) {
+                    auto offset = static_cast<uint64_t>(offsets[i]);
+                    if (lowBits > 0) {
+                        auto bitPos = i * lowBits;
+                        auto wordNum = bitPos / 64;
+                        auto shift = bitPos % 64;
+                        auto low = offset & lowMask;
+                        lowWords[wordNum] |= low << shift;
+                        if (shift + lowBits > 64) {
+                            lowWords[wordNum + 1] |= low >> (64 - shift);
+                        }
+                    }
+                    auto position = (offset >> lowBits) + i;
+                    highWords[position / 64] |= uint64_t{1} << (position % 64);
+                    if (i % OffsetIndexHeader::sampleRate == 0) {
+                        samples[i / OffsetIndexHeader::sampleRate] = position;
+                    }
+                }
+                std::atomic_thread_fence(std::memory_order_release);
+                header->count = end;
+            }
+        };
+
+        void checkSorted(const int64_t *offsets, uint64_t begin, uint64_t end, const std::string &sourcePath) {
+            for (uint64_t i = std::max<uint64_t>(begin, 1); i < end; i++) {
+                if (offsets[i] < offsets[i - 1]) {
+                    std::stringstream ss;
+                    ss << "Offsets in " << sourcePath << " are not sorted at element " << i;
+                    throw std::runtime_error(ss.str());
+                }
+            }
+        }
+
+        void syncMapping(mio::basic_mmap<mio::access_mode::write, char> &mapping, const std::string &path) {
+            std::error_code error;
+            mapping.sync(error);
+            if (error) {
+                throw std::runtime_error("Error writing " + path + ": " + error.message());
+            }
+        }
+
+        /** Writes a new index of the given offsets with headroom for later appends to path */
+        void buildIndexFile(const int64_t *offsets, uint64_t count, const std::string &path) {
+            uint64_t universe = count > 0 ? static_cast<uint64_t>(offsets[count - 1]) + 1 : 0;
+            auto headroom = std::max(minHeadroom, count / headroomDivisor);
+            auto countCapacity = count + headroom;
+            // Later offsets are expected to grow at the average rate seen so far
+            auto universeCapacity = universe + (universe / std::max<uint64_t>(count, 1) + 1) * headroom;
+
+            uint32_t lowBits = 0;
+            while ((universeCapacity / countCapacity) >> (lowBits + 1) > 0) {
+                lowBits++;
+            }
+
+            OffsetIndexHeader header;
+            header.magic = OffsetIndexHeader::magicValue;
+            header.version = OffsetIndexHeader::currentVersion;
+            header.lowBits = lowBits;
+            header.count = 0;
+            // One extra low word lets lookups read the word after the last element without a bounds check
+            header.lowWordCount = (countCapacity * lowBits + 63) / 64 + 1;
+            header.highWordCount = (countCapacity + (universeCapacity >> lowBits) + 1 + 63) / 64;
+            header.sampleCount = (countCapacity + OffsetIndexHeader::sampleRate - 1) / OffsetIndexHeader::sampleRate;
+
+            {
+                std::ofstream out(path, std::ios::binary | std::ios::trunc);
+                if (!out) {
+                    throw std::runtime_error("Could not create " + path);
+                }
+                out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+            }
+            filesystem::path{path}.resize_file(sizeof(header) + (header.lowWordCount + header.highWordCount + header.sampleCount) * sizeof(uint64_t));
+
+            mio::basic_mmap<mio::access_mode::write, char> mapping;
+            std::error_code error;
+            mapping.map(path, 0, mio::map_entire_file, error);
+            if (error) {
+                throw std::runtime_error("Could not open " + path + ": " + error.message());
+            }
+            OffsetIndexSections{mapping.data()}.append(offsets, 0, count);
+            syncMapping(mapping, path);
+        }
+    } // namespace
+
+    filesystem::path offsetIndexPath(const filesystem::path &indexPrefix) {
+        return filesystem::path{indexPrefix.str() + "_ef"};
+    }
+
+    uint64_t updateOffsetIndex(const filesystem::path &indexPrefix) {
+        auto sourcePath = indexPrefix.str() + ".dat";
+        auto destPath = offsetIndexPath(indexPrefix).str() + ".dat";
+        auto tempPath = destPath + ".tmp";
+
+        mio::basic_mmap<mio::access_mode::read, char> source;
+        std::error_code error;
+        source.map(sourcePath, 0, mio::map_entire_file, error);
+        if (error) {
+            throw std::runtime_error("Could not open " + sourcePath + " to build its offset index");
+        }
+        auto offsets = reinterpret_cast<const int64_t *>(source.data());
+        uint64_t count = source.length() / sizeof(int64_t);
+
+        if (filesystem::path{destPath}.exists()) {
+            mio::basic_mmap<mio::access_mode::write, char> existing;
+            existing.map(destPath, 0, mio::map_entire_file, error);
+            OffsetIndex index;
+            if (!error && index.load(existing.data(), static_cast<int64_t>(existing.length()))) {
+                auto indexedCount = index.size();
+                bool matches = indexedCount <= count;
+                for (uint64_t i = indexedCount - std::min(indexedCount, verifiedTailLength); matches && i < indexedCount; i++) {
+                    matches = index[i] == offsets[i];
+                }
+                OffsetIndexSections sections{existing.data()};
+                if (matches && sections.fits(count, count > 0 ? offsets[count - 1] : 0)) {
+                    checkSorted(offsets, indexedCount, count, sourcePath);
+                    sections.append(offsets, indexedCount, count);
+                    syncMapping(existing, destPath);
+                    return count - indexedCount;
+                }
+            }
+        }
+
+        checkSorted(offsets, 0, count, sourcePath);
+        buildIndexFile(offsets, count, tempPath);
+        if (std::rename(tempPath.c_str(), destPath.c_str()) != 0) {
+            throw std::runtime_error("Could not move " + tempPath + " to " + destPath);
+        }
+        return count;
+    }
+} // namespace blocksci
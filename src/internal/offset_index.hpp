@@ -0,0 +1,143 @@
+//
+//  offset_index.hpp
+//  blocksci
+//
+
+#ifndef offset_index_hpp
+#define offset_index_hpp
+
+#include <wjfilesystem/path.h>
+
+#include <cstdint>
+
+namespace blocksci {
+
+    /** Header of an Elias-Fano encoded offset index
+     *
+     * File layout: [OffsetIndexHeader][uint64_t lowWords[lowWordCount]][uint64_t highWords[highWordCount]][uint64_t samples[sampleCount]]
+     *
+     * Every offset is split into its lowBits least significant bits, which are stored bit-packed in lowWords, and the
+     * remaining high part h, which is stored in unary as a set bit at position h + i of highWords for the i-th offset.
+     * samples[k] is the position of the set bit of offset k * sampleRate in highWords.
+     */
+    struct OffsetIndexHeader {
+        /** "BSCIEFO1" when read as little endian */
+        static constexpr uint64_t magicValue = 0x314f464549435342;
+        static constexpr uint32_t currentVersion = 1;
+        static constexpr uint32_t sampleRate = 128;
+
+        uint64_t magic;
+        uint32_t version;
+        uint32_t lowBits;
+        uint64_t count;
+        uint64_t lowWordCount;
+        uint64_t highWordCount;
+        uint64_t sampleCount;
+    };
+
+    /** Read-only view of an Elias-Fano encoded sequence of non-decreasing file offsets
+     *
+     * Uses about 2 + log2(averageElementSize) bits per offset instead of the 64 bits of a plain index file, so the index
+     * of the transaction file stays cache and page cache resident under random access. Lookups take constant time: a
+     * sample gives the position of a nearby offset in the high bits and the remainder is found by popcount.
+     *
+     * @see IndexedFileMapper, which uses this index if <pathPrefix>_index_ef.dat exists
+     */
+    class OffsetIndex {
+    public:
+        OffsetIndex() = default;
+
+        /** Interprets data as an offset index file, returns false and stays empty if it is not a valid one */
+        bool load(const char *data, int64_t size) {
+            *this = OffsetIndex{};
+            if (data == nullptr || size < static_cast<int64_t>(sizeof(OffsetIndexHeader))) {
+                return false;
+            }
+            auto header = reinterpret_cast<const OffsetIndexHeader *>(data);
+            auto expectedSize = sizeof(OffsetIndexHeader) + (header->lowWordCount + header->highWordCount + header->sampleCount) * sizeof(uint64_t);
+            if (header->magic != OffsetIndexHeader::magicValue || header->version != OffsetIndexHeader::currentVersion || header->lowBits >= 64 || static_cast<uint64_t>(size) != expectedSize) {
+                return false;
+            }
+            lowBits = header->lowBits;
+            lowMask = (uint64_t{1} << lowBits) - 1;
+            elementCount = header->count;
+            lowWords = reinterpret_cast<const uint64_t *>(data + sizeof(OffsetIndexHeader));
+            highWords = lowWords + header->lowWordCount;
+            samples = highWords + header->highWordCount;
+            return true;
+        }
+
+        uint64_t size() const {
+            return elementCount;
+        }
+
+        int64_t operator[](uint64_t index) const {
+            auto high = highPosition(index) - index;
+            return static_cast<int64_t>((high << lowBits) | lowPart(index));
+        }
+
+    private:
+        const uint64_t *lowWords = nullptr;
+        const uint64_t *highWords = nullptr;
+        const uint64_t *samples = nullptr;
+        uint64_t elementCount = 0;
+        uint64_t lowMask = 0;
+        uint32_t lowBits = 0;
+
+        static unsigned int selectInWord(uint64_t word, unsigned int rank) {
+            for (unsigned int i = 0; i < rank; i++) {
+                word &= word - 1;
+            }
+            return static_cast<unsigned int>(__builtin_ctzll(word));
+        }
+
+        uint64_t lowPart(uint64_t index) const {
+            if (lowBits == 0) {
+                return 0;
+            }
+            auto bitPos = index * lowBits;
+            auto wordNum = bitPos / 64;
+            auto shift = bitPos % 64;
+            auto value = lowWords[wordNum] >> shift;
+            if (shift + lowBits > 64) {
+                value |= lowWords[wordNum + 1] << (64 - shift);
+            }
+            return value & lowMask;
+        }
+
+        /** Position of the set bit belonging to index in highWords */
+        uint64_t highPosition(uint64_t index) const {
+            auto sampleNum = index / OffsetIndexHeader::sampleRate;
+            auto remaining = static_cast<unsigned int>(index % OffsetIndexHeader::sampleRate);
+            auto position = samples[sampleNum];
+            auto wordNum = position / 64;
+            auto word = highWords[wordNum] & (~uint64_t{0} << (position % 64));
+            while (true) {
+                auto ones = static_cast<unsigned int>(__builtin_popcountll(word));
+                if (remaining < ones) {
+                    break;
+                }
+                remaining -= ones;
+                word = highWords[++wordNum];
+            }
+            return wordNum * 64 + selectInWord(word, remaining);
+        }
+    };
+
+    /** Path prefix of the Elias-Fano offset index belonging to the plain index file <indexPrefix>.dat */
+    filesystem::path offsetIndexPath(const filesystem::path &indexPrefix);
+
+    /** Brings the offset index <offsetIndexPath(indexPrefix)>.dat up to date with the plain offset index <indexPrefix>.dat,
+     * which must contain non-decreasing offsets
+     *
+     * A new index is written with headroom beyond the current offsets and moved into place, so readers never see a
+     * partially written file. Later updates encode only the offsets appended since and add them in place, which readers
+     * of the shorter index are not affected by. The index is rebuilt if the headroom is used up or the offsets it holds
+     * no longer match the plain file, eg. after a reorg.
+     *
+     * @return the number of offsets that were encoded
+     */
+    uint64_t updateOffsetIndex(const filesystem::path &indexPrefix);
+} // namespace blocksci
+
+#endif /* offset_index_hpp */
@@ -0,0 +1,244 @@
+//
+//  taproot_index.cpp
+//  blocksci
+//
+
+#include "taproot_index.hpp"
+#include "delta_tables.hpp"
+#include "script_access.hpp"
+
+#include <blocksci/core/script_data.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <tuple>
+
+namespace blocksci {
+
+    namespace {
+        bool entryLess(const TaprootTableEntry &a, const TaprootTableEntry &b) {
+            auto cmp = a.outputKey.Compare(b.outputKey);
+            return cmp < 0 || (cmp == 0 && a.scriptNum < b.scriptNum);
+        }
+
+        /** About 8 entries per bucket, like the tx hash index */
+        uint32_t bucketBitsFor(uint64_t count) {
+            uint32_t bits = 1;
+            while (bits < 32 && (count >> (bits + 3)) > 0) {
+                bits++;
+            }
+            return bits;
+        }
+
+        const WitnessUnknownScriptData *witnessUnknownScript(const ScriptAccess &scripts, uint32_t scriptNum) {
+            return std::get<0>(scripts.getScriptData<DedupAddressType::WITNESS_UNKNOWN>(scriptNum));
+        }
+
+        /** The first 32 bytes of the program of the script, zero padded */
+        uint256 leadingScriptData(const WitnessUnknownScriptData &script) {
+            uint256 data;
+            std::copy_n(script.scriptData.begin(), std::min<size_t>(script.scriptData.size(), data.size()), data.begin());
+            return data;
+        }
+
+        bool matchesScripts(const TaprootTable &table, const ScriptAccess &scripts) {
+            auto lastScriptNum = table.header().scriptEnd - 1;
+            if (lastScriptNum < 1 || lastScriptNum > scripts.scriptCount(DedupAddressType::WITNESS_UNKNOWN)) {
+                return false;
+            }
+            auto script = witnessUnknownScript(scripts, static_cast<uint32_t>(lastScriptNum));
+            return script->txFirstSeen == table.header().lastScriptTxNum && leadingScriptData(*script) == table.header().lastScriptData;
+        }
+
+        /** Taproot outputs among the scripts scriptStart up to but excluding scriptEnd, sorted like a table */
+        std::vector<TaprootTableEntry> collectEntries(const ScriptAccess &scripts, uint64_t scriptStart, uint64_t scriptEnd) {
+            std::vector<TaprootTableEntry> entries;
+            for (auto scriptNum = scriptStart; scriptNum < scriptEnd; scriptNum++) {
+                auto script = witnessUnknownScript(scripts, static_cast<uint32_t>(scriptNum));
+                if (script->witnessVersion == 1 && script->scriptData.size() == 32) {
+                    TaprootTableEntry entry;
+                    std::copy_n(script->scriptData.begin(), 32, entry.outputKey.begin());
+                    entry.scriptNum = static_cast<uint32_t>(scriptNum);
+                    entries.push_back(entry);
+                }
+            }
+            std::sort(entries.begin(), entries.end(), entryLess);
+            return entries;
+        }
+
+        using EntryRange = std::pair<const TaprootTableEntry *, const TaprootTableEntry *>;
+
+        /** Writes a table for the scripts scriptStart up to but excluding scriptEnd by merging the given sorted ranges */
+        void writeTable(const std::string &destPath, const ScriptAccess &scripts, uint64_t scriptStart, uint64_t scriptEnd, std::vector<EntryRange> sources) {
+            auto tempPath = destPath + ".tmp";
+            uint64_t count = 0;
+            for (auto &source : sources) {
+                count += static_cast<uint64_t>(source.second - source.first);
+            }
+            auto lastScript = witnessUnknownScript(scripts, static_cast<uint32_t>(scriptEnd - 1));
+
+            TaprootTableHeader header;
+            header.magic = TaprootTableHeader::magicValue;
+            header.version = TaprootTableHeader::currentVersion;
+            header.bucketBits = bucketBitsFor(count);
+            header.scriptStart = scriptStart;
+            header.scriptEnd = scriptEnd;
+            header.entryCount = count;
+            header.lastScriptTxNum = lastScript->txFirstSeen;
+            header.lastScriptData = leadingScriptData(*lastScript);
+
+            auto bucketBits = header.bucketBits;
+            std::vector<uint32_t> bucketStarts((uint64_t{1} << bucketBits) + 1, 0);
+            {
+                std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+                if (!out) {
+                    throw std::runtime_error("Could not create " + tempPath);
+                }
+                out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+                // The sources cover disjoint scripts, so a k-way merge of the sorted sources is sorted as well
+                std::vector<TaprootTableEntry> buffer;
+                buffer.reserve(1 << 16);
+                while (true) {
+                    EntryRange *next = nullptr;
+                    for (auto &source : sources) {
+                        if (source.first != source.second && (next == nullptr || entryLess(*source.first, *next->first))) {
+                            next = &source;
+                        }
+                    }
+                    if (next == nullptr) {
+                        break;
+                    }
+                    bucketStarts[(TaprootTable::prefix(next->first->outputKey) >> (64 - bucketBits)) + 1]++;
+                    buffer.push_back(*next->first++);
+                    if (buffer.size() == buffer.capacity()) {
+                        out.write(reinterpret_cast<const char *>(buffer.data()), static_cast<std::streamsize>(buffer.size() * sizeof(TaprootTableEntry)));
+                        buffer.clear();
+                    }
+                }
+                out.write(reinterpret_cast<const char *>(buffer.data()), static_cast<std::streamsize>(buffer.size() * sizeof(TaprootTableEntry)));
+
+                for (size_t bucket = 1; bucket < bucketStarts.size(); bucket++) {
+                    bucketStarts[bucket] += bucketStarts[bucket - 1];
+                }
+                out.write(reinterpret_cast<const char *>(bucketStarts.data()), static_cast<std::streamsize>(bucketStarts.size() * sizeof(uint32_t)));
+                out.flush();
+                if (!out) {
+                    throw std::runtime_error("Error writing " + tempPath);
+                }
+            }
+
+            if (std::rename(tempPath.c_str(), destPath.c_str()) != 0) {
+                throw std::runtime_error("Could not move " + tempPath + " to " + destPath);
+            }
+        }
+    } // namespace
+
+    bool TaprootTable::load(const char *data, int64_t size) {
+        *this = TaprootTable{};
+        if (data == nullptr || size < static_cast<int64_t>(sizeof(TaprootTableHeader))) {
+            return false;
+        }
+        auto header = reinterpret_cast<const TaprootTableHeader *>(data);
+        if (header->magic != TaprootTableHeader::magicValue || header->version != TaprootTableHeader::currentVersion || header->bucketBits < 1 || header->bucketBits > 32) {
+            return false;
+        }
+        auto bucketCount = uint64_t{1} << header->bucketBits;
+        auto expectedSize = sizeof(TaprootTableHeader) + header->entryCount * sizeof(TaprootTableEntry) + (bucketCount + 1) * sizeof(uint32_t);
+        if (static_cast<uint64_t>(size) != expectedSize || header->scriptStart < 1 || header->scriptEnd <= header->scriptStart) {
+            return false;
+        }
+        tableHeader = header;
+        entries = reinterpret_cast<const TaprootTableEntry *>(data + sizeof(TaprootTableHeader));
+        bucketStarts = reinterpret_cast<const uint32_t *>(entries + header->entryCount);
+        return true;
+    }
+
+    std::pair<const TaprootTableEntry *, const TaprootTableEntry *> TaprootTable::equalRange(const uint256 &outputKey) const {
+        auto bucket = prefix(outputKey) >> (64 - tableHeader->bucketBits);
+        auto keyLess = [](const TaprootTableEntry &entry, const uint256 &key) {
+            return entry.outputKey < key;
+        };
+        auto keyGreater = [](const uint256 &key, const TaprootTableEntry &entry) {
+            return key < entry.outputKey;
+        };
+        auto first = std::lower_bound(entries + bucketStarts[bucket], entries + bucketStarts[bucket + 1], outputKey, keyLess);
+        auto last = std::upper_bound(first, entries + bucketStarts[bucket + 1], outputKey, keyGreater);
+        return {first, last};
+    }
+
+    TaprootIndex::TaprootIndex(const filesystem::path &prefix, const ScriptAccess &scripts) :
+    baseFile(prefix), deltaFile(taprootIndexDeltaPath(prefix)) {
+        if (baseFile.size() > 0 && base.load(baseFile.getDataAtOffset(0), baseFile.size())) {
+            if (base.header().scriptStart != 1 || !matchesScripts(base, scripts)) {
+                base = TaprootTable{};
+            }
+        }
+        if (base.isLoaded() && deltaFile.size() > 0 && delta.load(deltaFile.getDataAtOffset(0), deltaFile.size())) {
+            if (delta.header().scriptStart != base.header().scriptEnd || !matchesScripts(delta, scripts)) {
+                delta = TaprootTable{};
+            }
+        }
+    }
+
+    ranges::optional<uint32_t> TaprootIndex::find(const uint256 &outputKey) const {
+        for (auto table : {&base, &delta}) {
+            if (table->isLoaded()) {
+                auto range = table->equalRange(outputKey);
+                if (range.first != range.second) {
+                    return range.first->scriptNum;
+                }
+            }
+        }
+        return ranges::nullopt;
+    }
+
+    std::vector<uint32_t> TaprootIndex::findAll(const uint256 &outputKey) const {
+        std::vector<uint32_t> scriptNums;
+        // All scripts of the base table precede those of the delta table
+        for (auto table : {&base, &delta}) {
+            if (table->isLoaded()) {
+                auto range = table->equalRange(outputKey);
+                for (auto it = range.first; it != range.second; ++it) {
+                    scriptNums.push_back(it->scriptNum);
+                }
+            }
+        }
+        return scriptNums;
+    }
+
+    filesystem::path taprootIndexDeltaPath(const filesystem::path &prefix) {
+        return filesystem::path{prefix.str() + "_delta"};
+    }
+
+    uint64_t updateTaprootIndex(const filesystem::path &prefix, const ScriptAccess &scripts) {
+        // The current tables stay mapped while the new ones are merged from them, replacing the files does not affect the mappings
+        TaprootIndex index{prefix, scripts};
+        auto baseScriptCount = index.baseScriptCount();
+        auto indexedScriptCount = index.scriptCount();
+        uint64_t scriptCount = scripts.scriptCount(DedupAddressType::WITNESS_UNKNOWN);
+        if (scriptCount == 0 || indexedScriptCount == scriptCount) {
+            return 0;
+        }
+
+        auto newEntries = collectEntries(scripts, indexedScriptCount + 1, scriptCount + 1);
+        std::vector<EntryRange> sources{{newEntries.data(), newEntries.data() + newEntries.size()}};
+        if (index.deltaTable().isLoaded()) {
+            sources.push_back(index.deltaTable().allEntries());
+        }
+
+        auto deltaPath = taprootIndexDeltaPath(prefix).str() + ".dat";
+        if (rebuildsBaseTables(baseScriptCount, scriptCount)) {
+            if (index.baseTable().isLoaded()) {
+                sources.push_back(index.baseTable().allEntries());
+            }
+            writeTable(prefix.str() + ".dat", scripts, 1, scriptCount + 1, sources);
+            std::remove(deltaPath.c_str());
+        } else {
+            writeTable(deltaPath, scripts, baseScriptCount + 1, scriptCount + 1, sources);
+        }
+        return scriptCount - indexedScriptCount;
+    }
+} // namespace blocksci
@@ -0,0 +1,159 @@
+//
+//  taproot_index.hpp
+//  blocksci
+//
+
+#ifndef taproot_index_hpp
+#define taproot_index_hpp
+
+#include "file_mapper.hpp"
+
+#include <blocksci/core/bitcoin_uint256.hpp>
+
+#include <range/v3/utility/optional.hpp>
+
+#include <wjfilesystem/path.h>
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace blocksci {
+    class ScriptAccess;
+
+    /** Header of a taproot key table file
+     *
+     * File layout: [TaprootTableHeader][TaprootTableEntry entries[entryCount]][uint32_t bucketStarts[2^bucketBits + 1]]
+     *
+     * Entries are sorted by output key and scriptNum. The top bucketBits bits of an output key select a bucket, so the
+     * entries of bucket b are entries[bucketStarts[b]] up to entries[bucketStarts[b + 1]].
+     */
+    struct TaprootTableHeader {
+        /** "BSCITPR1" when read as little endian */
+        static constexpr uint64_t magicValue = 0x3152505449435342;
+        static constexpr uint32_t currentVersion = 1;
+
+        uint64_t magic;
+        uint32_t version;
+        uint32_t bucketBits;
+        /** The table contains the taproot outputs among the WITNESS_UNKNOWN scripts scriptStart up to but excluding scriptEnd */
+        uint64_t scriptStart;
+        uint64_t scriptEnd;
+        uint64_t entryCount;
+        /** txFirstSeen and the first 32 bytes of the program of script scriptEnd - 1, used to detect that the indexed
+         * scripts have been replaced */
+        uint64_t lastScriptTxNum;
+        uint256 lastScriptData;
+    };
+
+    struct TaprootTableEntry {
+        uint256 outputKey;
+        uint32_t scriptNum;
+    };
+
+    /** Read-only view of a taproot key table file, @see TaprootTableHeader */
+    class TaprootTable {
+    public:
+        /** The leading 8 bytes of a key in big endian order, which sorts like the key itself */
+        static uint64_t prefix(const uint256 &key) {
+            uint64_t value = 0;
+            for (size_t i = 0; i < sizeof(value); i++) {
+                value = (value << 8) | key.begin()[i];
+            }
+            return value;
+        }
+
+        /** Interprets data as a taproot key table file, returns false and stays empty if it is not a valid one */
+        bool load(const char *data, int64_t size);
+
+        bool isLoaded() const {
+            return tableHeader != nullptr;
+        }
+
+        const TaprootTableHeader &header() const {
+            return *tableHeader;
+        }
+
+        /** All entries of the table */
+        std::pair<const TaprootTableEntry *, const TaprootTableEntry *> allEntries() const {
+            return {entries, entries + tableHeader->entryCount};
+        }
+
+        /** The entries with the given output key, in ascending scriptNum order */
+        std::pair<const TaprootTableEntry *, const TaprootTableEntry *> equalRange(const uint256 &outputKey) const;
+
+    private:
+        const TaprootTableHeader *tableHeader = nullptr;
+        const TaprootTableEntry *entries = nullptr;
+        const uint32_t *bucketStarts = nullptr;
+    };
+
+    /** Memory mapped index from taproot output key (the 32 byte program of a witness v1 output) to the
+     * WITNESS_UNKNOWN scripts that carry it
+     *
+     * WITNESS_UNKNOWN scripts are not deduplicated by the parser, so every output to a taproot address creates a new
+     * script and one output key maps to all of them. A lookup reads a single bucket of about 8 entries.
+     *
+     * The index consists of a base and a delta table, @see rebuildsBaseTables. Scripts after scriptCount() are not in
+     * the index and have to be looked up in the RocksDB hash index, @see HashIndex::getWitnessUnknownIndex
+     *
+     * Files: <prefix>.dat and <prefix>_delta.dat
+     */
+    class TaprootIndex {
+    public:
+        TaprootIndex(const filesystem::path &prefix, const ScriptAccess &scripts);
+
+        /** The first script with the given output key */
+        ranges::optional<uint32_t> find(const uint256 &outputKey) const;
+
+        /** All scripts with the given output key in ascending order */
+        std::vector<uint32_t> findAll(const uint256 &outputKey) const;
+
+        bool isGood() const {
+            return base.isLoaded();
+        }
+
+        /** Number of WITNESS_UNKNOWN scripts covered by the base table */
+        uint64_t baseScriptCount() const {
+            return base.isLoaded() ? base.header().scriptEnd - 1 : 0;
+        }
+
+        /** Number of WITNESS_UNKNOWN scripts covered by the index */
+        uint64_t scriptCount() const {
+            return delta.isLoaded() ? delta.header().scriptEnd - 1 : baseScriptCount();
+        }
+
+        const TaprootTable &baseTable() const {
+            return base;
+        }
+
+        const TaprootTable &deltaTable() const {
+            return delta;
+        }
+
+        /** Number of taproot outputs in the index */
+        uint64_t entryCount() const {
+            return (base.isLoaded() ? base.header().entryCount : 0) + (delta.isLoaded() ? delta.header().entryCount : 0);
+        }
+
+    private:
+        SimpleFileMapper<> baseFile;
+        SimpleFileMapper<> deltaFile;
+        TaprootTable base;
+        TaprootTable delta;
+    };
+
+    /** Path prefix of the delta table of the taproot index with the given prefix */
+    filesystem::path taprootIndexDeltaPath(const filesystem::path &prefix);
+
+    /** Brings the taproot index up to date with the WITNESS_UNKNOWN scripts, building a new delta table or a new base table
+     *
+     * The new table is merged from the current tables and the scripts added since the last update, which are the only
+     * scripts that are read.
+     *
+     * @return the number of scripts that were added to the index
+     */
+    uint64_t updateTaprootIndex(const filesystem::path &prefix, const ScriptAccess &scripts);
+} // namespace blocksci
+
+#endif /* taproot_index_hpp */
@@ -0,0 +1,251 @@
+//
+//  tx_hash_index.cpp
+//  blocksci
+//
+
+#include "tx_hash_index.hpp"
+#include "batch_lookup.hpp"
+#include "bitcoin_uint256_hex.hpp"
+#include "chain_access.hpp"
+#include "delta_tables.hpp"
+
+#include <mio/mmap.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <tuple>
+#include <vector>
+
+namespace blocksci {
+
+    namespace {
+        /** About 8 entries per bucket keeps the bucket directory at half a byte per transaction */
+        uint32_t bucketBitsFor(uint64_t count) {
+            uint32_t bits = 1;
+            while (bits < 32 && (count >> (bits + 3)) > 0) {
+                bits++;
+            }
+            return bits;
+        }
+
+        /** Builds the table of the transactions txStart up to but excluding txEnd
+         *
+         * previous is either not loaded or a table with the given bucketBits that covers the transactions from txStart
+         * on, whose entries are copied instead of reading their hashes again.
+         */
+        void buildTable(const std::string &destPath, const FixedSizeFileMapper<uint256> &txHashes, uint64_t txStart, uint64_t txEnd, uint32_t bucketBits, const TxHashTable &previous, unsigned int threadCount) {
+            auto tempPath = destPath + ".tmp";
+            auto count = txEnd - txStart;
+            auto txBegin = previous.isLoaded() ? previous.header().txEnd : txStart;
+
+            TxHashTableHeader header;
+            header.magic = TxHashTableHeader::magicValue;
+            header.version = TxHashTableHeader::currentVersion;
+            header.bucketBits = bucketBits;
+            header.txStart = txStart;
+            header.txEnd = txEnd;
+            header.entryCount = count;
+            header.lastTxHash = *txHashes[static_cast<OffsetType>(txEnd - 1)];
+
+            auto bucketCount = uint64_t{1} << bucketBits;
+            auto keyOf = [&](uint64_t txNum) {
+                return TxHashTable::key(*txHashes[static_cast<OffsetType>(txNum)]);
+            };
+            auto previousSize = [&](uint64_t bucket) {
+                if (!previous.isLoaded()) {
+                    return uint32_t{0};
+                }
+                auto range = previous.bucket(bucket);
+                return static_cast<uint32_t>(range.second - range.first);
+            };
+
+            // Counting sort by bucket. Keys are uniformly distributed, so the threads rarely touch the same counter
+            std::vector<std::atomic<uint32_t>> positions(bucketCount);
+            forEachChunk(txEnd - txBegin, threadCount, [&](size_t begin, size_t end) {
+                for (auto txNum = txBegin + begin; txNum < txBegin + end; txNum++) {
+                    positions[keyOf(txNum) >> (64 - bucketBits)].fetch_add(1, std::memory_order_relaxed);
+                }
+            });
+            std::vector<uint32_t> bucketStarts(bucketCount + 1, 0);
+            for (uint64_t bucket = 0; bucket < bucketCount; bucket++) {
+                auto copiedCount = previousSize(bucket);
+                bucketStarts[bucket + 1] = bucketStarts[bucket] + copiedCount + positions[bucket].load(std::memory_order_relaxed);
+                positions[bucket].store(bucketStarts[bucket] + copiedCount, std::memory_order_relaxed);
+            }
+
+            auto directorySize = (bucketCount + 1) * sizeof(uint32_t);
+            auto fileSize = sizeof(TxHashTableHeader) + directorySize + count * sizeof(TxHashTableEntry);
+            {
+                std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+                if (!out) {
+                    throw std::runtime_error("Could not create " + tempPath);
+                }
+                out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+                out.write(reinterpret_cast<const char *>(bucketStarts.data()), static_cast<std::streamsize>(directorySize));
+                out.seekp(static_cast<std::streamoff>(fileSize - 1));
+                out.write("", 1);
+                if (!out) {
+                    throw std::runtime_error("Error writing " + tempPath);
+                }
+            }
+
+            {
+                mio::basic_mmap<mio::access_mode::write, char> output;
+                std::error_code error;
+                output.map(tempPath, 0, mio::map_entire_file, error);
+                if (error) {
+                    throw std::runtime_error("Could not map " + tempPath);
+                }
+                // The entries are scattered directly into the mapped output file and each bucket is sorted afterwards,
+                // so the order in which the threads claim positions does not matter
+                auto entries = reinterpret_cast<TxHashTableEntry *>(output.data() + sizeof(TxHashTableHeader) + directorySize);
+                forEachChunk(txEnd - txBegin, threadCount, [&](size_t begin, size_t end) {
+                    for (auto txNum = txBegin + begin; txNum < txBegin + end; txNum++) {
+                        auto hashKey = keyOf(txNum);
+                        auto &entry = entries[positions[hashKey >> (64 - bucketBits)].fetch_add(1, std::memory_order_relaxed)];
+                        entry.fingerprint = static_cast<uint32_t>((hashKey << bucketBits) >> 32);
+                        entry.txNum = static_cast<uint32_t>(txNum);
+                    }
+                });
+                forEachChunk(bucketCount, threadCount, [&](size_t begin, size_t end) {
+                    for (auto bucket = begin; bucket < end; bucket++) {
+                        if (previous.isLoaded()) {
+                            auto range = previous.bucket(bucket);
+                            std::copy(range.first, range.second, entries + bucketStarts[bucket]);
+                        }
+                        std::sort(entries + bucketStarts[bucket], entries + bucketStarts[bucket + 1], [](const TxHashTableEntry &a, const TxHashTableEntry &b) {
+                            return std::tie(a.fingerprint, a.txNum) < std::tie(b.fingerprint, b.txNum);
+                        });
+                    }
+                });
+                output.sync(error);
+                if (error) {
+                    throw std::runtime_error("Error writing " + tempPath);
+                }
+            }
+
+            if (std::rename(tempPath.c_str(), destPath.c_str()) != 0) {
+                throw std::runtime_error("Could not move " + tempPath + " to " + destPath);
+            }
+        }
+    } // namespace
+
+    TxHashIndex::TxHashIndex(const filesystem::path &prefix, const filesystem::path &chainDirectory) :
+    baseFile(prefix), deltaFile(txHashIndexDeltaPath(prefix)), txHashes(ChainAccess::txHashesFilePath(chainDirectory)) {
+        if (baseFile.size() > 0 && base.load(baseFile.getDataAtOffset(0), baseFile.size())) {
+            if (base.header().txStart != 0 || !matchesChain(base)) {
+                base = TxHashTable{};
+            }
+        }
+        if (base.isLoaded() && deltaFile.size() > 0 && delta.load(deltaFile.getDataAtOffset(0), deltaFile.size())) {
+            if (delta.header().txStart != base.header().txEnd || !matchesChain(delta)) {
+                delta = TxHashTable{};
+            }
+        }
+    }
+
+    TxHashPrefix::TxHashPrefix(const std::string &hexPrefix) {
+        auto begin = hexPrefix.size() >= 2 && hexPrefix[0] == '0' && (hexPrefix[1] == 'x' || hexPrefix[1] == 'X') ? 2 : 0;
+        hexDigits = hexPrefix.substr(begin);
+        if (hexDigits.size() > 64) {
+            throw std::invalid_argument("Tx hash prefix " + hexPrefix + " is longer than a tx hash");
+        }
+        uint64_t keyPrefix = 0;
+        for (size_t i = 0; i < hexDigits.size(); i++) {
+            auto digit = HexDigit(hexDigits[i]);
+            if (digit < 0) {
+                throw std::invalid_argument("Tx hash prefix " + hexPrefix + " is not a hex string");
+            }
+            hexDigits[i] = static_cast<char>(std::tolower(static_cast<unsigned char>(hexDigits[i])));
+            if (i < 2 * sizeof(uint64_t)) {
+                keyPrefix |= static_cast<uint64_t>(digit) << (60 - 4 * i);
+            }
+        }
+        auto prefixBits = 4 * std::min<size_t>(hexDigits.size(), 2 * sizeof(uint64_t));
+        auto freeBits = prefixBits == 0 ? ~uint64_t{0} : (prefixBits == 64 ? 0 : ~uint64_t{0} >> prefixBits);
+        low = keyPrefix;
+        high = keyPrefix | freeBits;
+    }
+
+    std::vector<uint32_t> TxHashIndex::findByPrefix(const TxHashPrefix &prefix, size_t limit) const {
+        // The tables are sorted by key rather than txNum, so the matches are collected in a max-heap of the limit lowest
+        // txNums seen so far, which keeps short prefixes with millions of matches from materializing all of them
+        std::vector<uint32_t> txNums;
+        if (limit == 0) {
+            return txNums;
+        }
+        for (auto table : {&base, &delta}) {
+            // All transactions of the delta come after those of the base
+            if (!table->isLoaded() || txNums.size() == limit) {
+                continue;
+            }
+            auto range = table->keyRange(prefix.lowKey(), prefix.highKey());
+            // Entries only store the leading key bits, longer prefixes are confirmed against the hash
+            bool confirm = 4 * prefix.hex().size() > table->storedKeyBits();
+            for (auto it = range.first; it != range.second; ++it) {
+                if (txNums.size() == limit && it->txNum >= txNums.front()) {
+                    continue;
+                }
+                if (confirm && !prefix.matches(*txHashes[it->txNum])) {
+                    continue;
+                }
+                if (txNums.size() == limit) {
+                    std::pop_heap(txNums.begin(), txNums.end());
+                    txNums.back() = it->txNum;
+                } else {
+                    txNums.push_back(it->txNum);
+                }
+                std::push_heap(txNums.begin(), txNums.end());
+            }
+        }
+        std::sort_heap(txNums.begin(), txNums.end());
+        // Transactions that the parser has not added to the index yet follow those in the index
+        auto hashCount = static_cast<uint64_t>(txHashes.size());
+        for (auto txNum = txCount(); txNum < hashCount && txNums.size() < limit; txNum++) {
+            if (prefix.matches(*txHashes[static_cast<OffsetType>(txNum)])) {
+                txNums.push_back(static_cast<uint32_t>(txNum));
+            }
+        }
+        return txNums;
+    }
+
+    bool TxHashIndex::matchesChain(const TxHashTable &table) const {
+        auto txEnd = table.header().txEnd;
+        return txEnd > 0 && txEnd <= static_cast<uint64_t>(txHashes.size()) && *txHashes[static_cast<OffsetType>(txEnd - 1)] == table.header().lastTxHash;
+    }
+
+    filesystem::path txHashIndexDeltaPath(const filesystem::path &prefix) {
+        return filesystem::path{prefix.str() + "_delta"};
+    }
+
+    uint64_t updateTxHashIndex(const filesystem::path &prefix, const filesystem::path &chainDirectory, unsigned int threadCount) {
+        // The current tables stay mapped while the new one is built from them, replacing the files does not affect the mappings
+        TxHashIndex index{prefix, chainDirectory};
+        auto baseTxCount = index.baseTxCount();
+        auto indexedTxCount = index.txCount();
+
+        FixedSizeFileMapper<uint256> txHashes(ChainAccess::txHashesFilePath(chainDirectory));
+        auto txCount = static_cast<uint64_t>(txHashes.size());
+        if (txCount == 0 || indexedTxCount == txCount) {
+            return 0;
+        }
+
+        threadCount = std::max(threadCount, 1u);
+        auto deltaPath = txHashIndexDeltaPath(prefix).str() + ".dat";
+        if (rebuildsBaseTables(baseTxCount, txCount)) {
+            buildTable(prefix.str() + ".dat", txHashes, 0, txCount, bucketBitsFor(txCount), TxHashTable{}, threadCount);
+            std::remove(deltaPath.c_str());
+        } else {
+            // The buckets are sized for the largest delta table, so the entries of the current one keep their bucket
+            auto bucketBits = bucketBitsFor(baseTxCount / 8);
+            auto &delta = index.deltaTable();
+            auto extendsDelta = delta.isLoaded() && delta.header().bucketBits == bucketBits;
+            buildTable(deltaPath, txHashes, baseTxCount, txCount, bucketBits, extendsDelta ? delta : TxHashTable{}, threadCount);
+        }
+        return txCount - indexedTxCount;
+    }
+} // namespace blocksci
@@ -0,0 +1,283 @@
+//
+//  tx_hash_index.hpp
+//  blocksci
+//
+
+#ifndef tx_hash_index_hpp
+#define tx_hash_index_hpp
+
+#include "file_mapper.hpp"
+
+#include <blocksci/core/bitcoin_uint256.hpp>
+
+#include <range/v3/utility/optional.hpp>
+
+#include <wjfilesystem/path.h>
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace blocksci {
+
+    /** Header of a tx hash table file
+     *
+     * File layout: [TxHashTableHeader][uint32_t bucketStarts[2^bucketBits + 1]][TxHashTableEntry entries[entryCount]]
+     *
+     * The first 8 bytes of the hex form of a tx hash form its 64 bit key, so keys sort like the hex strings. The top
+     * bucketBits bits of the key select a bucket and the following 32 bits are stored as the fingerprint of the entry.
+     * Entries are sorted by bucket, fingerprint and txNum, so bucket b consists of entries[bucketStarts[b]] up to
+     * entries[bucketStarts[b + 1]] and the transactions whose hash begins with a given hex prefix form one contiguous
+     * range of entries.
+     */
+    struct TxHashTableHeader {
+        /** "BSCITXH1" when read as little endian */
+        static constexpr uint64_t magicValue = 0x3148585449435342;
+        /** Version 1 used the first 8 bytes of the hash in memory order as key, which does not allow prefix searches */
+        static constexpr uint32_t currentVersion = 2;
+
+        uint64_t magic;
+        uint32_t version;
+        uint32_t bucketBits;
+        /** The table contains the transactions txStart up to but excluding txEnd */
+        uint64_t txStart;
+        uint64_t txEnd;
+        uint64_t entryCount;
+        /** Hash of transaction txEnd - 1, used to detect that the indexed transactions have been replaced */
+        uint256 lastTxHash;
+    };
+
+    struct TxHashTableEntry {
+        uint32_t fingerprint;
+        uint32_t txNum;
+    };
+
+    /** Read-only view of a tx hash table file, @see TxHashTableHeader */
+    class TxHashTable {
+    public:
+        /** The first 8 bytes of the hex form of the hash as big endian number
+         *
+         * The hex form of a hash lists its bytes in reverse memory order, so these are the last 8 bytes in memory read as
+         * a little endian number.
+         */
+        static uint64_t key(const uint256 &hash) {
+            uint64_t value;
+            std::memcpy(&value, hash.begin() + hash.size() - sizeof(value), sizeof(value));
+            return value;
+        }
+
+        /** Interprets data as a tx hash table file, returns false and stays empty if it is not a valid one */
+        bool load(const char *data, int64_t size) {
+            *this = TxHashTable{};
+            if (data == nullptr || size < static_cast<int64_t>(sizeof(TxHashTableHeader))) {
+                return false;
+            }
+            auto header = reinterpret_cast<const TxHashTableHeader *>(data);
+            if (header->magic != TxHashTableHeader::magicValue || header->version != TxHashTableHeader::currentVersion || header->bucketBits < 1 || header->bucketBits > 32) {
+                return false;
+            }
+            auto bucketCount = uint64_t{1} << header->bucketBits;
+            auto expectedSize = sizeof(TxHashTableHeader) + (bucketCount + 1) * sizeof(uint32_t) + header->entryCount * sizeof(TxHashTableEntry);
+            if (static_cast<uint64_t>(size) != expectedSize || header->entryCount != header->txEnd - header->txStart) {
+                return false;
+            }
+            tableHeader = header;
+            bucketStarts = reinterpret_cast<const uint32_t *>(data + sizeof(TxHashTableHeader));
+            entries = reinterpret_cast<const TxHashTableEntry *>(bucketStarts + bucketCount + 1);
+            return true;
+        }
+
+        bool isLoaded() const {
+            return tableHeader != nullptr;
+        }
+
+        const TxHashTableHeader &header() const {
+            return *tableHeader;
+        }
+
+        /** Number of key bits stored in the table, keys that only differ in later bits have to be told apart by their hash */
+        unsigned int storedKeyBits() const {
+            return tableHeader->bucketBits + 32;
+        }
+
+        /** The entries whose stored key bits lie between those of lowKey and highKey, both inclusive */
+        std::pair<const TxHashTableEntry *, const TxHashTableEntry *> keyRange(uint64_t lowKey, uint64_t highKey) const {
+            auto bucketBits = tableHeader->bucketBits;
+            auto lowBucket = lowKey >> (64 - bucketBits);
+            auto highBucket = highKey >> (64 - bucketBits);
+            auto first = lowerBound(entries + bucketStarts[lowBucket], bucketStarts[lowBucket + 1] - bucketStarts[lowBucket], fingerprint(lowKey));
+            auto last = lowerBound(entries + bucketStarts[highBucket], bucketStarts[highBucket + 1] - bucketStarts[highBucket], fingerprint(highKey), true);
+            return {first, last};
+        }
+
+        /** The entries of bucket b */
+        std::pair<const TxHashTableEntry *, const TxHashTableEntry *> bucket(uint64_t b) const {
+            return {entries + bucketStarts[b], entries + bucketStarts[b + 1]};
+        }
+
+        /** Finds the transaction with the given hash, hashOf(txNum) must return the hash of a transaction in the table
+         *
+         * A few early transactions share their hash with a later one (BIP30), like the RocksDB index the last of them is returned.
+         */
+        template <typename HashOf>
+        ranges::optional<uint32_t> find(const uint256 &hash, HashOf &&hashOf) const {
+            auto hashKey = key(hash);
+            auto range = keyRange(hashKey, hashKey);
+            // Entries with equal fingerprints are sorted by txNum, so the first match from the back is the last transaction
+            for (auto it = range.second; it != range.first;) {
+                --it;
+                // Equal fingerprints are confirmed against the full hash, which also rules out false positives
+                if (hashOf(it->txNum) == hash) {
+                    return it->txNum;
+                }
+            }
+            return ranges::nullopt;
+        }
+
+    private:
+        const TxHashTableHeader *tableHeader = nullptr;
+        const uint32_t *bucketStarts = nullptr;
+        const TxHashTableEntry *entries = nullptr;
+
+        uint32_t fingerprint(uint64_t hashKey) const {
+            return static_cast<uint32_t>((hashKey << tableHeader->bucketBits) >> 32);
+        }
+
+        /** First of the count entries from first whose fingerprint is not less than (or if orEqual is set, greater than)
+         * the given one
+         *
+         * The loop has a fixed number of iterations for a given count and its only data dependent step compiles to a
+         * conditional move, so it does not suffer from branch mispredictions like std::lower_bound.
+         */
+        static const TxHashTableEntry *lowerBound(const TxHashTableEntry *first, uint32_t count, uint32_t value, bool orEqual = false) {
+            if (count == 0) {
+                return first;
+            }
+            while (count > 1) {
+                auto half = count / 2;
+                auto probe = first[half - 1].fingerprint;
+                first = (probe < value || (orEqual && probe == value)) ? first + half : first;
+                count -= half;
+            }
+            auto last = first->fingerprint;
+            return first + static_cast<size_t>(last < value || (orEqual && last == value));
+        }
+    };
+
+    /** A prefix of the hex form of tx hashes, as used to abbreviate them */
+    class TxHashPrefix {
+    public:
+        /** Parses up to 64 hex digits, optionally preceded by 0x, throws std::invalid_argument for anything else */
+        explicit TxHashPrefix(const std::string &hexPrefix);
+
+        const std::string &hex() const {
+            return hexDigits;
+        }
+
+        /** Smallest key of a hash with the prefix */
+        uint64_t lowKey() const {
+            return low;
+        }
+
+        /** Largest key of a hash with the prefix */
+        uint64_t highKey() const {
+            return high;
+        }
+
+        bool matches(const uint256 &hash) const {
+            auto hashKey = TxHashTable::key(hash);
+            if (hashKey < low || hashKey > high) {
+                return false;
+            }
+            return hexDigits.size() <= 2 * sizeof(uint64_t) || hash.GetHex().compare(0, hexDigits.size(), hexDigits) == 0;
+        }
+
+    private:
+        std::string hexDigits;
+        uint64_t low;
+        uint64_t high;
+    };
+
+    /** Memory mapped index from tx hash to tx number that answers lookups without going through RocksDB
+     *
+     * The index consists of a base and a delta table, @see rebuildsBaseTables. Together they take about 8.5 bytes per
+     * transaction. A lookup searches one bucket of about 8 entries and confirms the match against chain/tx_hashes.dat.
+     * Since keys sort like hex strings, abbreviated hashes are resolved with the same search, @see findByPrefix
+     *
+     * Tables whose transactions no longer match the chain are ignored, so hashes that are not found have to be looked up
+     * in the RocksDB hash index, @see HashIndex::getTxIndex
+     *
+     * Files: <prefix>.dat and <prefix>_delta.dat
+     */
+    class TxHashIndex {
+    public:
+        TxHashIndex(const filesystem::path &prefix, const filesystem::path &chainDirectory);
+
+        ranges::optional<uint32_t> find(const uint256 &hash) const {
+            auto hashOf = [&](uint32_t txNum) -> const uint256 & {
+                return *txHashes[txNum];
+            };
+            // The delta covers the later transactions, which win over earlier ones with the same hash
+            if (delta.isLoaded()) {
+                if (auto txNum = delta.find(hash, hashOf)) {
+                    return txNum;
+                }
+            }
+            if (base.isLoaded()) {
+                return base.find(hash, hashOf);
+            }
+            return ranges::nullopt;
+        }
+
+        /** Numbers of the first limit transactions whose hash begins with the prefix, in ascending order
+         *
+         * Searches both tables and scans the transactions of chain/tx_hashes.dat that are not covered by the index yet.
+         */
+        std::vector<uint32_t> findByPrefix(const TxHashPrefix &prefix, size_t limit) const;
+
+        bool isGood() const {
+            return base.isLoaded();
+        }
+
+        /** Number of transactions covered by the base table */
+        uint64_t baseTxCount() const {
+            return base.isLoaded() ? base.header().txEnd : 0;
+        }
+
+        /** Number of transactions covered by the index */
+        uint64_t txCount() const {
+            return delta.isLoaded() ? delta.header().txEnd : baseTxCount();
+        }
+
+        const TxHashTable &deltaTable() const {
+            return delta;
+        }
+
+    private:
+        SimpleFileMapper<> baseFile;
+        SimpleFileMapper<> deltaFile;
+        FixedSizeFileMapper<uint256> txHashes;
+        TxHashTable base;
+        TxHashTable delta;
+
+        bool matchesChain(const TxHashTable &table) const;
+    };
+
+    /** Path prefix of the delta table of the tx hash index with the given prefix */
+    filesystem::path txHashIndexDeltaPath(const filesystem::path &prefix);
+
+    /** Brings the tx hash index up to date with chain/tx_hashes.dat, building a new delta table or a new base table
+     *
+     * The new hashes are read on threadCount threads, once to count the entries of every bucket and once to place the
+     * entries, after which the buckets are sorted in parallel. A new delta table copies the buckets of the current one,
+     * which has the same number of buckets. A new base table has more buckets than the current tables, whose entries
+     * only store the leading key bits, so it is built from all hashes.
+     *
+     * @return the number of transactions that were added to the index
+     */
+    uint64_t updateTxHashIndex(const filesystem::path &prefix, const filesystem::path &chainDirectory, unsigned int threadCount = 1);
+} // namespace blocksci
+
+#endif /* tx_hash_index_hpp */
@@ -0,0 +1,246 @@
+//
+//  warmup.cpp
+//  blocksci
+//
+
+#include "warmup.hpp"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <thread>
+#include <unordered_set>
+
+namespace blocksci {
+
+    namespace {
+        using Clock = std::chrono::steady_clock;
+
+        /** Amount of data a reader thread takes at once, large enough to keep the per-task overhead negligible */
+        constexpr uint64_t taskSize = uint64_t{64} << 20;
+
+        using ReadBuffer = std::unique_ptr<char, decltype(&free)>;
+
+        struct ReadTask {
+            size_t fileIndex;
+            uint64_t offset;
+            uint64_t length;
+            /** Number of bytes read, less than length if error is set */
+            uint64_t bytesRead;
+            /** Set if the task could not read all of its data */
+            std::string error;
+            Clock::time_point start;
+            Clock::time_point end;
+        };
+
+        uint64_t pageSize() {
+            static const uint64_t size = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+            return size;
+        }
+
+        filesystem::path resolvePath(const DataConfiguration &config, const std::string &path) {
+            if (!path.empty() && path[0] == '/') {
+                return filesystem::path{path};
+            }
+            return config.chainConfig.dataDirectory/path;
+        }
+
+        /** Appends path if it is a regular file or all regular files below it if it is a directory */
+        void listFiles(const std::string &path, std::vector<std::string> &files) {
+            struct stat info;
+            if (stat(path.c_str(), &info) != 0) {
+                return;
+            }
+            if (S_ISREG(info.st_mode)) {
+                files.push_back(path);
+            } else if (S_ISDIR(info.st_mode)) {
+                auto dir = opendir(path.c_str());
+                if (dir == nullptr) {
+                    return;
+                }
+                std::vector<std::string> entries;
+                while (auto entry = readdir(dir)) {
+                    std::string name{entry->d_name};
+                    if (name != "." && name != "..") {
+                        entries.push_back(path + "/" + name);
+                    }
+                }
+                closedir(dir);
+                std::sort(entries.begin(), entries.end());
+                for (auto &entry : entries) {
+                    listFiles(entry, files);
+                }
+            }
+        }
+
+        ReadBuffer allocateReadBuffer(uint64_t readSize) {
+            void *buffer = nullptr;
+            if (posix_memalign(&buffer, pageSize(), readSize) != 0) {
+                throw std::bad_alloc();
+            }
+            return ReadBuffer{static_cast<char *>(buffer), &free};
+        }
+
+        /** Reads the data of task into buffer, recording how much was read and why reading stopped early */
+        void readTask(const std::string &path, ReadTask &task, char *buffer, uint64_t readSize) {
+            task.start = Clock::now();
+            int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd < 0) {
+                task.error = std::string{"Could not open file: "} + strerror(errno);
+                return;
+            }
+            posix_fadvise(fd, static_cast<off_t>(task.offset), static_cast<off_t>(task.length), POSIX_FADV_SEQUENTIAL);
+            while (task.bytesRead < task.length) {
+                auto amount = static_cast<size_t>(std::min(readSize, task.length - task.bytesRead));
+                auto bytesRead = pread(fd, buffer, amount, static_cast<off_t>(task.offset + task.bytesRead));
+                if (bytesRead < 0 && errno == EINTR) {
+                    continue;
+                }
+                if (bytesRead < 0) {
+                    task.error = std::string{"Read failed: "} + strerror(errno);
+                    break;
+                }
+                if (bytesRead == 0) {
+                    task.error = "File is shorter than when the warmup started";
+                    break;
+                }
+                task.bytesRead += static_cast<uint64_t>(bytesRead);
+            }
+            close(fd);
+            task.end = Clock::now();
+        }
+
+        void readTasks(const std::vector<WarmupFileResult> &files, std::vector<ReadTask> &tasks, std::atomic<size_t> &nextTask, char *buffer, uint64_t readSize) {
+            while (true) {
+                auto taskNum = nextTask.fetch_add(1);
+                if (taskNum >= tasks.size()) {
+                    break;
+                }
+                auto &task = tasks[taskNum];
+                readTask(files[task.fileIndex].path, task, buffer, readSize);
+            }
+        }
+
+        double residentFraction(const mio::basic_mmap<mio::access_mode::read, char> &mapping) {
+            auto pageCount = (mapping.length() + pageSize() - 1) / pageSize();
+            std::vector<unsigned char> residency(pageCount);
+            if (mincore(const_cast<char *>(mapping.data()), mapping.length(), residency.data()) != 0) {
+                return 0;
+            }
+            auto residentPages = std::count_if(residency.begin(), residency.end(), [](unsigned char page) { return (page & 1) != 0; });
+            return static_cast<double>(residentPages) / static_cast<double>(pageCount);
+        }
+    } // namespace
+
+    std::vector<WarmupFileResult> warmupDataFiles(const DataConfiguration &config, const WarmupSpec &spec, LockedMappings &lockedMappings) {
+        std::vector<std::string> paths;
+        if (spec.chain) {
+            listFiles(config.chainDirectory().str(), paths);
+        }
+        if (spec.scripts) {
+            listFiles(config.scriptsDirectory().str(), paths);
+        }
+        if (spec.indexes) {
+            listFiles(config.hashIndexFilePath().str(), paths);
+            listFiles(config.addressDBFilePath().str(), paths);
+        }
+        for (auto &path : spec.extraPaths) {
+            listFiles(resolvePath(config, path).str(), paths);
+        }
+        std::vector<std::string> lockedPaths;
+        for (auto &path : spec.lockedPaths) {
+            listFiles(resolvePath(config, path).str(), lockedPaths);
+        }
+        paths.insert(paths.end(), lockedPaths.begin(), lockedPaths.end());
+
+        std::vector<WarmupFileResult> results;
+        std::unordered_set<std::string> seen;
+        for (auto &path : paths) {
+            if (seen.insert(path).second) {
+                WarmupFileResult result;
+                result.path = path;
+                result.size = static_cast<uint64_t>(filesystem::path{path}.file_size());
+                results.push_back(result);
+            }
+        }
+
+        auto readSize = std::max(pageSize(), (spec.readSize + pageSize() - 1) / pageSize() * pageSize());
+        std::vector<ReadTask> tasks;
+        for (size_t i = 0; i < results.size(); i++) {
+            for (uint64_t offset = 0; offset < results[i].size; offset += taskSize) {
+                tasks.push_back({i, offset, std::min(taskSize, results[i].size - offset), 0, {}, {}, {}});
+            }
+        }
+
+        auto threadCount = spec.threadCount > 0 ? spec.threadCount : std::max(1u, std::thread::hardware_concurrency());
+        threadCount = static_cast<unsigned int>(std::min<size_t>(threadCount, std::max<size_t>(tasks.size(), 1)));
+        // Buffers are allocated up front so that a failed allocation is reported to the caller instead of ending a reader thread
+        std::vector<ReadBuffer> buffers;
+        for (unsigned int i = 0; i < threadCount; i++) {
+            buffers.push_back(allocateReadBuffer(readSize));
+        }
+        std::atomic<size_t> nextTask{0};
+        std::vector<std::thread> threads;
+        for (unsigned int i = 0; i < threadCount; i++) {
+            threads.emplace_back(readTasks, std::cref(results), std::ref(tasks), std::ref(nextTask), buffers[i].get(), readSize);
+        }
+        for (auto &thread : threads) {
+            thread.join();
+        }
+
+        std::vector<Clock::time_point> firstRead(results.size(), Clock::time_point::max());
+        std::vector<Clock::time_point> lastRead(results.size(), Clock::time_point::min());
+        for (auto &task : tasks) {
+            auto &result = results[task.fileIndex];
+            result.bytesRead += task.bytesRead;
+            if (!task.error.empty() && result.error.empty()) {
+                result.error = task.error;
+            }
+            // Only tasks that read data count towards the time spent reading
+            if (task.bytesRead > 0) {
+                firstRead[task.fileIndex] = std::min(firstRead[task.fileIndex], task.start);
+                lastRead[task.fileIndex] = std::max(lastRead[task.fileIndex], task.end);
+            }
+        }
+
+        std::unordered_set<std::string> toLock(lockedPaths.begin(), lockedPaths.end());
+        for (size_t i = 0; i < results.size(); i++) {
+            auto &result = results[i];
+            if (lastRead[i] > firstRead[i]) {
+                result.seconds = std::chrono::duration<double>(lastRead[i] - firstRead[i]).count();
+            }
+            if (result.size == 0) {
+                result.residentFraction = 1;
+                continue;
+            }
+            mio::basic_mmap<mio::access_mode::read, char> mapping;
+            std::error_code error;
+            mapping.map(result.path, 0, mio::map_entire_file, error);
+            if (error) {
+                if (result.error.empty()) {
+                    result.error = "Could not map file: " + error.message();
+                }
+                continue;
+            }
+            if (toLock.find(result.path) != toLock.end() && mlock(mapping.data(), mapping.length()) == 0) {
+                result.locked = true;
+            }
+            result.residentFraction = residentFraction(mapping);
+            if (result.locked) {
+                lockedMappings.push_back(std::move(mapping));
+            }
+        }
+        return results;
+    }
+} // namespace blocksci
@@ -0,0 +1,31 @@
+//
+//  warmup.hpp
+//  blocksci
+//
+
+#ifndef internal_warmup_hpp
+#define internal_warmup_hpp
+
+#include "data_configuration.hpp"
+
+#include <blocksci/core/warmup.hpp>
+
+#include <mio/mmap.hpp>
+
+#include <vector>
+
+namespace blocksci {
+
+    /** Memory mappings of files that have been locked into memory with mlock, the locks are released when they are unmapped */
+    using LockedMappings = std::vector<mio::basic_mmap<mio::access_mode::read, char>>;
+
+    /** Reads the files selected by spec into the page cache using parallel large aligned reads
+     *
+     * The files in spec.lockedPaths are locked into memory afterwards and their mappings appended to lockedMappings.
+     *
+     * @return one result per file, in the order the files were selected
+     */
+    std::vector<WarmupFileResult> warmupDataFiles(const DataConfiguration &config, const WarmupSpec &spec, LockedMappings &lockedMappings);
+} // namespace blocksci
+
+#endif /* internal_warmup_hpp */
@@ -0,0 +1,109 @@
+//
+//  test_address_prefix.cpp
+//  blocksci_unittest
+//
+
+#include "unit_test.h"
+
+#include <internal/address_info.hpp>
+#include <internal/data_access.hpp>
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace blocksci {
+
+class AddressPrefixTest : public BlockSciTest {
+
+protected:
+    filesystem::path indexDirectory;
+    bool ownsIndex = false;
+
+    void SetUp() override {
+        indexDirectory = chain.getAccess().config.addressPrefixIndexDirectory();
+        if(indexDirectory.exists()) {
+            GTEST_SKIP() << "The test data already has an address prefix index, which would be used for the scan";
+        }
+        ownsIndex = true;
+    }
+
+    void TearDown() override {
+        if(!ownsIndex) {
+            return;
+        }
+        for(auto type : {AddressType::PUBKEYHASH, AddressType::SCRIPTHASH, AddressType::WITNESS_PUBKEYHASH, AddressType::WITNESS_SCRIPTHASH, AddressType::WITNESS_UNKNOWN}) {
+            std::remove(((indexDirectory/addressName(type)).str() + ".dat").c_str());
+            std::remove(((indexDirectory/(addressName(type) + "_delta")).str() + ".dat").c_str());
+        }
+        rmdir(indexDirectory.str().c_str());
+    }
+
+    std::string addressString(const Address &address) {
+        auto &access = chain.getAccess();
+        switch(address.type) {
+            case AddressType::PUBKEYHASH:
+                return ScriptAddress<AddressType::PUBKEYHASH>(address.scriptNum, access).addressString();
+            case AddressType::SCRIPTHASH:
+                return ScriptAddress<AddressType::SCRIPTHASH>(address.scriptNum, access).addressString();
+            case AddressType::WITNESS_PUBKEYHASH:
+                return ScriptAddress<AddressType::WITNESS_PUBKEYHASH>(address.scriptNum, access).addressString();
+            case AddressType::WITNESS_SCRIPTHASH:
+                return ScriptAddress<AddressType::WITNESS_SCRIPTHASH>(address.scriptNum, access).addressString();
+            case AddressType::WITNESS_UNKNOWN:
+                return ScriptAddress<AddressType::WITNESS_UNKNOWN>(address.scriptNum, access).addressString();
+            default:
+                ADD_FAILURE() << "Unexpected address type " << addressName(address.type);
+                return "";
+        }
+    }
+
+    std::vector<Address> sorted(std::vector<Address> addresses) {
+        std::sort(addresses.begin(), addresses.end());
+        return addresses;
+    }
+};
+
+
+TEST_F(AddressPrefixTest, IndexMatchesScan) {
+    // Single characters cover every address family, longer prefixes of the addresses found narrow the search down. "0"
+    // is neither base58 nor bech32.
+    std::vector<std::string> prefixes;
+    for(auto c : std::string{"123456789ABCDEFGHJKLMNPQRSTUVWXYZabcdefghijkmnopqrstuvwxyz0"}) {
+        prefixes.emplace_back(1, c);
+    }
+    std::set<std::string> longerPrefixes;
+    for(auto &prefix : std::vector<std::string>(prefixes)) {
+        auto addresses = getAddressesWithPrefix(prefix, chain.getAccess());
+        for(size_t i = 0; i < addresses.size(); i += std::max<size_t>(1, addresses.size() / 5)) {
+            auto address = addressString(addresses[i]);
+            ASSERT_EQ(address.compare(0, prefix.size(), prefix), 0);
+            for(size_t length : {3u, 5u, 8u}) {
+                longerPrefixes.insert(address.substr(0, length));
+            }
+            longerPrefixes.insert(address);
+        }
+    }
+    prefixes.insert(prefixes.end(), longerPrefixes.begin(), longerPrefixes.end());
+    ASSERT_FALSE(longerPrefixes.empty());
+
+    std::vector<std::vector<Address>> scanned;
+    for(auto &prefix : prefixes) {
+        scanned.push_back(sorted(getAddressesWithPrefix(prefix, chain.getAccess())));
+    }
+
+    ASSERT_GT(updateAddressPrefixIndex(chain.getAccess(), 2), 0u);
+    ASSERT_TRUE(indexDirectory.exists());
+    for(size_t i = 0; i < prefixes.size(); i++) {
+        ASSERT_EQ(sorted(getAddressesWithPrefix(prefixes[i], chain.getAccess())), scanned[i]) << "prefix " << prefixes[i];
+    }
+
+    // A second update finds nothing to add
+    ASSERT_EQ(updateAddressPrefixIndex(chain.getAccess(), 2), 0u);
+}
+
+} // namespace blocksci
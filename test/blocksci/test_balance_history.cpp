@@ -0,0 +1,107 @@
+//
+//  test_balance_history.cpp
+//  blocksci_unittest
+//
+
+#include "unit_test.h"
+
+#include <internal/address_info.hpp>
+#include <internal/balance_history_index.hpp>
+#include <internal/data_access.hpp>
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+namespace blocksci {
+
+class BalanceHistoryTest : public BlockSciTest {
+
+protected:
+    filesystem::path indexDirectory;
+    bool ownsIndex = false;
+
+    void SetUp() override {
+        indexDirectory = chain.getAccess().config.balanceHistoryIndexDirectory();
+        if(indexDirectory.exists()) {
+            GTEST_SKIP() << "The test data already has a balance history index";
+        }
+        ownsIndex = true;
+    }
+
+    void TearDown() override {
+        if(!ownsIndex) {
+            return;
+        }
+        for(size_t i = 0; i < AddressType::size; i++) {
+            auto name = addressName(static_cast<AddressType::Enum>(i));
+            std::remove(((indexDirectory/name).str() + ".dat").c_str());
+            std::remove(((indexDirectory/(name + "_delta")).str() + ".dat").c_str());
+        }
+        rmdir(indexDirectory.str().c_str());
+    }
+
+    /** Updates the index with the blocks before maxBlock */
+    void updateIndex(BlockHeight maxBlock) {
+        Blockchain truncated{configFilePath, maxBlock};
+        ASSERT_GT(updateBalanceHistoryIndex(indexDirectory, truncated.getAccess().getChain(), 2), 0u);
+        BalanceHistoryIndex index{indexDirectory, truncated.getAccess().getChain()};
+        ASSERT_EQ(index.txCount(), truncated.endTxIndex());
+    }
+
+    /** Addresses that received outputs in blocks spread over the chain */
+    std::vector<Address> sampleAddresses() {
+        std::vector<Address> addresses;
+        auto step = std::max<BlockHeight>(1, static_cast<BlockHeight>(chain.size()) / 40);
+        for(BlockHeight height = 0; height < static_cast<BlockHeight>(chain.size()); height += step) {
+            for(auto tx : chain[height]) {
+                for(auto output : tx.outputs()) {
+                    addresses.push_back(output.getAddress());
+                }
+                break;
+            }
+        }
+        return addresses;
+    }
+};
+
+
+TEST_F(BalanceHistoryTest, MatchesOutputs) {
+    // The base covers enough transactions for the rest of the chain to go into the delta, which is extended once
+    auto endHeight = static_cast<BlockHeight>(chain.size());
+    auto txCount = chain.endTxIndex();
+    auto baseEnd = endHeight;
+    while(baseEnd > 1 && (txCount - chain[baseEnd - 1].firstTxIndex()) * 8 <= chain[baseEnd - 1].firstTxIndex()) {
+        baseEnd--;
+    }
+    auto deltaEnd = (baseEnd + endHeight) / 2;
+    ASSERT_LT(baseEnd, deltaEnd);
+    ASSERT_LT(deltaEnd, endHeight);
+
+    updateIndex(baseEnd);
+    updateIndex(deltaEnd);
+    ASSERT_GT(updateBalanceHistoryIndex(indexDirectory, chain.getAccess().getChain(), 2), 0u);
+    {
+        BalanceHistoryIndex index{indexDirectory, chain.getAccess().getChain()};
+        ASSERT_EQ(index.baseTxCount(), chain[baseEnd].firstTxIndex());
+        ASSERT_EQ(index.txCount(), txCount);
+    }
+    chain.reload();
+    ASSERT_NE(chain.getAccess().getBalanceHistoryIndex(), nullptr);
+
+    std::vector<BlockHeight> heights{0, baseEnd / 2, baseEnd - 1, baseEnd, (baseEnd + deltaEnd) / 2, deltaEnd - 1, deltaEnd, endHeight - 1, -1};
+    auto addresses = sampleAddresses();
+    ASSERT_FALSE(addresses.empty());
+    for(auto &address : addresses) {
+        std::vector<int64_t> expected;
+        for(auto height : heights) {
+            expected.push_back(balance(height, address.getOutputs()));
+            ASSERT_EQ(address.calculateBalance(height), expected.back()) << address.toString() << " at height " << height;
+        }
+        ASSERT_EQ(address.calculateBalanceSeries(heights), expected) << address.toString();
+    }
+}
+
+} // namespace blocksci
@@ -0,0 +1,104 @@
+//
+//  test_chain_scanner.cpp
+//  blocksci_unittest
+//
+
+#include "unit_test.h"
+
+#include <blocksci/chain/chain_scanner.hpp>
+
+namespace blocksci {
+
+class ChainScannerTest : public BlockSciTest {
+
+protected:
+    static constexpr uint8_t allColumns = ScanColumn::Version | ScanColumn::Hash | ScanColumn::Sequence | ScanColumn::SpentOutputNum;
+
+    /**
+     Compares every field of the scanned transaction with the Transaction object of the same number.
+     */
+    void expectMatches(const ScannedTx &scanned, const Transaction &tx, uint64_t firstInputNum, uint64_t firstOutputNum) {
+        ASSERT_EQ(scanned.txNum, tx.txNum);
+        ASSERT_EQ(scanned.height, tx.getBlockHeight());
+        ASSERT_EQ(scanned.firstInputNum, firstInputNum);
+        ASSERT_EQ(scanned.firstOutputNum, firstOutputNum);
+        ASSERT_EQ(*scanned.version, tx.getVersion());
+        ASSERT_EQ(*scanned.hash, tx.getHash());
+        ASSERT_EQ(scanned.inputCount(), tx.inputCount());
+        ASSERT_EQ(scanned.outputCount(), tx.outputCount());
+        ASSERT_EQ(scanned.locktime(), tx.locktime());
+        ASSERT_EQ(scanned.isCoinbase(), tx.isCoinbase());
+
+        auto outputs = scanned.outputs();
+        auto txOutputs = tx.outputSpan();
+        ASSERT_EQ(outputs.size(), txOutputs.size());
+        for(size_t i = 0; i < outputs.size(); i++) {
+            ASSERT_TRUE(outputs[i] == txOutputs[i]) << "output " << i;
+        }
+
+        auto inputs = scanned.inputs();
+        auto txInputs = tx.inputSpan();
+        ASSERT_EQ(inputs.size(), txInputs.size());
+        size_t i = 0;
+        for(auto input : tx.inputs()) {
+            ASSERT_TRUE(inputs[i] == txInputs[i]) << "input " << i;
+            ASSERT_EQ(scanned.sequenceNumbers[i], input.sequenceNumber());
+            ASSERT_EQ(scanned.spentOutputNums[i], input.getSpentOutputPointer().inoutNum);
+            i++;
+        }
+        ASSERT_EQ(i, inputs.size());
+    }
+};
+
+
+TEST_F(ChainScannerTest, MatchesTransactionsFromMidBlock) {
+    // Start after the first transaction of a block and end in the middle of a block several blocks later
+    BlockHeight startHeight = 0;
+    while(startHeight + 4 < static_cast<BlockHeight>(chain.size()) && chain[startHeight].size() < 2) {
+        startHeight++;
+    }
+    ASSERT_LT(startHeight + 4, static_cast<BlockHeight>(chain.size()));
+    auto beginTx = chain[startHeight].firstTxIndex() + 1;
+    auto endBlock = chain[startHeight + 4];
+    auto endTx = endBlock.firstTxIndex() + (endBlock.size() + 1) / 2;
+
+    auto &access = chain.getAccess();
+    ChainScanner scanner{access, beginTx, endTx, allColumns};
+    ASSERT_EQ(scanner.beginTxIndex(), beginTx);
+    ASSERT_EQ(scanner.endTxIndex(), endTx);
+    uint64_t firstInputNum = 0;
+    uint64_t firstOutputNum = 0;
+    for(uint32_t txNum = 0; txNum < endTx; txNum++) {
+        Transaction tx{txNum, access};
+        if(txNum >= beginTx) {
+            ASSERT_TRUE(scanner.next()) << "tx " << txNum;
+            expectMatches(scanner.tx(), tx, firstInputNum, firstOutputNum);
+            ASSERT_TRUE(scanner.transaction() == tx);
+        }
+        firstInputNum += tx.inputCount();
+        firstOutputNum += tx.outputCount();
+    }
+    ASSERT_FALSE(scanner.next());
+    ASSERT_FALSE(scanner.next());
+}
+
+TEST_F(ChainScannerTest, EmptyRange) {
+    auto &access = chain.getAccess();
+    auto txNum = chain[1].firstTxIndex();
+    ChainScanner scanner{access, txNum, txNum, allColumns};
+    ASSERT_EQ(scanner.beginTxIndex(), scanner.endTxIndex());
+    ASSERT_FALSE(scanner.next());
+    ASSERT_FALSE(scanner.next());
+
+    size_t visited = 0;
+    ChainScanner{chain[BlockRange::Slice{2, 2}], allColumns}.forEach([&](const ScannedTx &) { visited++; });
+    ASSERT_EQ(visited, 0u);
+
+    // Ranges beyond the end of the chain are clamped to it
+    auto txCount = chain[static_cast<BlockHeight>(chain.size()) - 1].endTxIndex();
+    ChainScanner beyond{access, txCount + 5, txCount + 10};
+    ASSERT_EQ(beyond.beginTxIndex(), txCount);
+    ASSERT_FALSE(beyond.next());
+}
+
+} // namespace blocksci
@@ -0,0 +1,194 @@
+//
+//  test_compressed_file.cpp
+//  blocksci_unittest
+//
+
+#include <internal/compressed_file.hpp>
+#include <internal/file_mapper.hpp>
+
+#include "gtest/gtest.h"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace blocksci {
+
+class CompressedFileTest : public ::testing::Test {
+
+protected:
+    std::string filePrefix;
+    std::string sourcePath;
+    std::string compressedPath;
+    std::string decompressedPath;
+    std::vector<char> contents;
+    uint32_t chunkSize = static_cast<uint32_t>(sysconf(_SC_PAGESIZE));
+    size_t previousCacheChunks = 0;
+
+    void SetUp() override {
+        filePrefix = ::testing::TempDir() + "blocksci_compressed_" + std::to_string(getpid()) + "_" + ::testing::UnitTest::GetInstance()->current_test_info()->name();
+        sourcePath = filePrefix + ".dat";
+        compressedPath = compressedFilePath(filePrefix).str();
+        decompressedPath = filePrefix + "_decompressed.dat";
+        previousCacheChunks = CompressedFileMapping::threadCacheChunks();
+    }
+
+    void TearDown() override {
+        CompressedFileMapping::setThreadCacheChunks(previousCacheChunks);
+        unlink(sourcePath.c_str());
+        unlink(compressedPath.c_str());
+        unlink(decompressedPath.c_str());
+    }
+
+    /**
+     Writes and compresses a file of the given number of chunks, the last one only partly filled. The data mixes
+     compressible runs with noise so that the chunks have different compressed lengths.
+     */
+    void writeFile(size_t chunkCount) {
+        contents.resize(chunkCount * chunkSize - chunkSize / 3);
+        std::mt19937 rng(42);
+        for(size_t i = 0; i < contents.size(); i++) {
+            contents[i] = (i / 97) % 3 == 0 ? static_cast<char>(rng()) : static_cast<char>(i / 4096);
+        }
+        std::ofstream out(sourcePath, std::ios::binary | std::ios::trunc);
+        out.write(contents.data(), static_cast<std::streamsize>(contents.size()));
+        out.close();
+        compressFile(sourcePath, compressedPath, chunkSize);
+    }
+};
+
+
+TEST_F(CompressedFileTest, ReadsChunksOnRequest) {
+    writeFile(5);
+    CompressedFileMapping mapping{compressedPath};
+    ASSERT_EQ(mapping.size(), static_cast<int64_t>(contents.size()));
+    ASSERT_EQ(mapping.chunkCount(), 5u);
+    ASSERT_EQ(mapping.chunkSize(), chunkSize);
+
+    // Read backwards so that every chunk is first read in the middle of the range
+    for(size_t i = contents.size(); i-- > 0;) {
+        ASSERT_EQ(*mapping.read(static_cast<int64_t>(i), 1), contents[i]);
+    }
+}
+
+TEST_F(CompressedFileTest, ReadsAcrossChunkBoundaries) {
+    writeFile(4);
+    CompressedFileMapping mapping{compressedPath};
+    for(size_t chunk = 1; chunk < mapping.chunkCount(); chunk++) {
+        auto start = chunk * chunkSize - 8;
+        ASSERT_EQ(memcmp(mapping.read(static_cast<int64_t>(start), 16), contents.data() + start, 16), 0);
+    }
+    ASSERT_EQ(memcmp(mapping.read(0, mapping.size()), contents.data(), contents.size()), 0);
+}
+
+TEST_F(CompressedFileTest, EvictsLeastRecentlyUsedChunks) {
+    CompressedFileMapping::setThreadCacheChunks(1);
+    auto limit = CompressedFileMapping::threadCacheChunks();
+    ASSERT_GE(limit, 4u);
+
+    // Every pass reads more chunks than the cache holds, so each chunk is evicted and decompressed again
+    writeFile(limit * 2 + 3);
+    CompressedFileMapping mapping{compressedPath};
+    for(int pass = 0; pass < 3; pass++) {
+        for(size_t i = 0; i < contents.size(); i += 512) {
+            ASSERT_EQ(*mapping.read(static_cast<int64_t>(i), 1), contents[i]);
+        }
+    }
+
+    // A pointer stays valid while fewer than limit other chunks are read, even if it is used in between
+    auto first = mapping.read(0, chunkSize);
+    for(size_t chunk = 1; chunk < limit; chunk++) {
+        mapping.read(static_cast<int64_t>(chunk * chunkSize), 1);
+        ASSERT_EQ(mapping.read(0, 1), first);
+    }
+    ASSERT_EQ(memcmp(first, contents.data(), chunkSize), 0);
+}
+
+TEST_F(CompressedFileTest, ConcurrentReadersWithSmallCache) {
+    CompressedFileMapping::setThreadCacheChunks(1);
+    writeFile(CompressedFileMapping::threadCacheChunks() + 5);
+    CompressedFileMapping mapping{compressedPath};
+
+    std::atomic<size_t> mismatches{0};
+    std::vector<std::thread> threads;
+    for(unsigned int t = 0; t < std::max(2u, std::thread::hardware_concurrency()); t++) {
+        threads.emplace_back([&, t]() {
+            std::mt19937 rng(t);
+            for(int read = 0; read < 2000; read++) {
+                auto start = rng() % (contents.size() - 64);
+                if(memcmp(mapping.read(static_cast<int64_t>(start), 64), contents.data() + start, 64) != 0) {
+                    mismatches++;
+                }
+            }
+        });
+    }
+    for(auto &thread : threads) {
+        thread.join();
+    }
+    ASSERT_EQ(mismatches.load(), 0u);
+}
+
+TEST_F(CompressedFileTest, ThrowsOnCorruptedChunk) {
+    writeFile(3);
+    {
+        // An LZ4 block of 0xff bytes announces more literals than the block holds
+        std::fstream file(compressedPath, std::ios::binary | std::ios::in | std::ios::out);
+        CompressedFileHeader header;
+        std::vector<uint64_t> chunkOffsets(4);
+        file.read(reinterpret_cast<char *>(&header), sizeof(header));
+        file.read(reinterpret_cast<char *>(chunkOffsets.data()), static_cast<std::streamsize>(chunkOffsets.size() * sizeof(uint64_t)));
+        std::vector<char> garbage(chunkOffsets[2] - chunkOffsets[1], static_cast<char>(0xff));
+        file.seekp(static_cast<std::streamoff>(chunkOffsets[1]));
+        file.write(garbage.data(), static_cast<std::streamsize>(garbage.size()));
+    }
+    CompressedFileMapping mapping{compressedPath};
+    ASSERT_EQ(*mapping.read(0, 1), contents[0]);
+    ASSERT_THROW(mapping.read(chunkSize, 1), std::runtime_error);
+    ASSERT_THROW(mapping.read(chunkSize - 8, 16), std::runtime_error);
+    ASSERT_EQ(*mapping.read(2 * chunkSize, 1), contents[2 * chunkSize]);
+}
+
+TEST_F(CompressedFileTest, FileMapperReadsCompressedFile) {
+    writeFile(3);
+    unlink(sourcePath.c_str());
+    SimpleFileMapper<mio::access_mode::read> mapper{filePrefix};
+    ASSERT_TRUE(mapper.isGood());
+    ASSERT_TRUE(mapper.isCompressed());
+    ASSERT_EQ(mapper.size(), static_cast<OffsetType>(contents.size()));
+    for(size_t start = 0; start + 100 < contents.size(); start += 1000) {
+        ASSERT_EQ(memcmp(mapper.getDataAtOffset(static_cast<OffsetType>(start), 100), contents.data() + start, 100), 0);
+    }
+    ASSERT_EQ(mapper.getDataAtOffset(InvalidFileIndex, 1), nullptr);
+    // Without a length the mapper cannot tell which chunks to decompress
+    ASSERT_THROW(mapper.getDataAtOffset(0), std::logic_error);
+}
+
+TEST_F(CompressedFileTest, DecompressFileRestoresSource) {
+    writeFile(3);
+    decompressFile(compressedPath, decompressedPath);
+    std::ifstream in(decompressedPath, std::ios::binary);
+    std::vector<char> restored{std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+    ASSERT_EQ(restored, contents);
+}
+
+TEST_F(CompressedFileTest, RejectsInvalidFiles) {
+    {
+        std::ofstream out(compressedPath, std::ios::binary | std::ios::trunc);
+        out << "not a compressed file, but long enough to hold a header";
+    }
+    ASSERT_THROW(CompressedFileMapping{compressedPath}, std::runtime_error);
+    ASSERT_THROW(decompressFile(compressedPath, decompressedPath), std::runtime_error);
+
+    writeFile(2);
+    ASSERT_THROW(compressFile(sourcePath, compressedPath, chunkSize + 1), std::runtime_error);
+}
+
+} // namespace blocksci
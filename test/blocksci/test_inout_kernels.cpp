@@ -0,0 +1,176 @@
+//
+//  test_inout_kernels.cpp
+//  blocksci_unittest
+//
+
+#include "unit_test.h"
+
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+namespace blocksci {
+
+class InoutKernelsTest : public BlockSciTest {
+
+public:
+
+    /**
+     Collects the Inout records of all outputs on the chain in one array, so the kernels get long runs.
+     */
+    std::vector<Inout> outputsOnChain() {
+        std::vector<Inout> inouts;
+        for(auto block : chain) {
+            for(auto tx : block) {
+                auto span = tx.outputSpan();
+                inouts.insert(inouts.end(), span.begin(), span.end());
+            }
+        }
+        return inouts;
+    }
+
+    /**
+     Runs func once with every instruction set the CPU supports and restores the detected one.
+     */
+    template <typename Func>
+    void forEachIsa(Func func) {
+        for(auto isa : {SimdIsa::Scalar, SimdIsa::AVX2, SimdIsa::AVX512}) {
+            if(isa > detectedSimdIsa()) {
+                break;
+            }
+            ASSERT_EQ(setActiveSimdIsa(isa), isa);
+            func(isa);
+        }
+        setActiveSimdIsa(detectedSimdIsa());
+    }
+};
+
+
+TEST_F(InoutKernelsTest, InoutAggregates) {
+    auto inouts = outputsOnChain();
+    ASSERT_TRUE(inouts.size() > 16);
+
+    int64_t sum = 0;
+    int64_t minValue = std::numeric_limits<int64_t>::max();
+    int64_t maxValue = std::numeric_limits<int64_t>::min();
+    TypeCounts typeCounts{};
+    std::vector<int64_t> values;
+    for(auto &inout : inouts) {
+        sum += inout.getValue();
+        minValue = std::min(minValue, inout.getValue());
+        maxValue = std::max(maxValue, inout.getValue());
+        typeCounts[inout.getType()]++;
+        values.push_back(inout.getValue());
+    }
+
+    // Every prefix length exercises a different split between vector loop and scalar tail
+    forEachIsa([&](SimdIsa) {
+        for(size_t count = inouts.size() - 16; count <= inouts.size(); count++) {
+            std::vector<int64_t> extracted(count);
+            kernels::extractValues(inouts.data(), count, extracted.data());
+            ASSERT_TRUE(std::equal(extracted.begin(), extracted.end(), values.begin()));
+        }
+        ASSERT_EQ(kernels::sumValues(inouts.data(), inouts.size()), sum);
+        ASSERT_EQ(kernels::minValue(inouts.data(), inouts.size()), minValue);
+        ASSERT_EQ(kernels::maxValue(inouts.data(), inouts.size()), maxValue);
+        TypeCounts kernelTypeCounts{};
+        kernels::countTypes(inouts.data(), inouts.size(), kernelTypeCounts);
+        ASSERT_EQ(kernelTypeCounts, typeCounts);
+    });
+}
+
+TEST_F(InoutKernelsTest, ColumnAggregates) {
+    auto inouts = outputsOnChain();
+    std::vector<int64_t> values;
+    std::vector<uint8_t> types;
+    for(auto &inout : inouts) {
+        values.push_back(inout.getValue());
+        types.push_back(static_cast<uint8_t>(inout.getType()));
+    }
+
+    setActiveSimdIsa(SimdIsa::Scalar);
+    auto sum = kernels::sumValues(values.data(), values.size());
+    auto minValue = kernels::minValue(values.data(), values.size());
+    auto maxValue = kernels::maxValue(values.data(), values.size());
+    TypeCounts typeCounts{};
+    kernels::countTypes(types.data(), types.size(), typeCounts);
+    EXPECT_EQ(sum, kernels::sumValues(inouts.data(), inouts.size()));
+
+    forEachIsa([&](SimdIsa) {
+        ASSERT_EQ(kernels::sumValues(values.data(), values.size()), sum);
+        ASSERT_EQ(kernels::minValue(values.data(), values.size()), minValue);
+        ASSERT_EQ(kernels::maxValue(values.data(), values.size()), maxValue);
+        TypeCounts kernelTypeCounts{};
+        kernels::countTypes(types.data(), types.size(), kernelTypeCounts);
+        ASSERT_EQ(kernelTypeCounts, typeCounts);
+    });
+}
+
+TEST_F(InoutKernelsTest, SelectValues) {
+    auto inouts = outputsOnChain();
+    std::vector<int64_t> values;
+    for(auto &inout : inouts) {
+        values.push_back(inout.getValue());
+    }
+    auto threshold = kernels::sumValues(values.data(), values.size()) / static_cast<int64_t>(values.size());
+
+    std::vector<uint32_t> greater;
+    std::vector<uint32_t> less;
+    for(uint32_t i = 0; i < values.size(); i++) {
+        if(values[i] > threshold) {
+            greater.push_back(i);
+        }
+        if(values[i] < threshold) {
+            less.push_back(i);
+        }
+    }
+    EXPECT_TRUE(greater.size() > 0);
+
+    forEachIsa([&](SimdIsa) {
+        std::vector<uint32_t> selection(values.size());
+        selection.resize(kernels::selectValuesGreaterThan(inouts.data(), inouts.size(), threshold, selection.data()));
+        ASSERT_EQ(selection, greater);
+        selection.resize(values.size());
+        selection.resize(kernels::selectValuesGreaterThan(values.data(), values.size(), threshold, selection.data()));
+        ASSERT_EQ(selection, greater);
+        selection.resize(values.size());
+        selection.resize(kernels::selectValuesLessThan(inouts.data(), inouts.size(), threshold, selection.data()));
+        ASSERT_EQ(selection, less);
+        selection.resize(values.size());
+        selection.resize(kernels::selectValuesLessThan(values.data(), values.size(), threshold, selection.data()));
+        ASSERT_EQ(selection, less);
+    });
+}
+
+TEST_F(InoutKernelsTest, RangeTotals) {
+    int64_t inputValue = 0;
+    int64_t outputValue = 0;
+    int64_t feeValue = 0;
+    for(auto block : chain) {
+        for(auto tx : block) {
+            int64_t txFee = 0;
+            for(auto input : tx.inputs()) {
+                inputValue += input.getValue();
+                txFee += input.getValue();
+            }
+            for(auto output : tx.outputs()) {
+                outputValue += output.getValue();
+                txFee -= output.getValue();
+            }
+            if(!tx.isCoinbase()) {
+                ASSERT_EQ(tx.fee(), txFee);
+                feeValue += txFee;
+            }
+        }
+    }
+
+    forEachIsa([&](SimdIsa) {
+        ASSERT_EQ(totalInputValue(chain), inputValue);
+        ASSERT_EQ(totalOutputValue(chain), outputValue);
+        ASSERT_EQ(totalFee(chain), feeValue);
+        auto block = chain[chain.size() - 1];
+        ASSERT_EQ(totalFee(block), ranges::accumulate(fees(block), int64_t{0}));
+    });
+}
+
+} // namespace blocksci
@@ -0,0 +1,130 @@
+//
+//  test_offset_index.cpp
+//  blocksci_unittest
+//
+
+#include <internal/offset_index.hpp>
+
+#include "gtest/gtest.h"
+
+#include <unistd.h>
+
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace blocksci {
+
+class OffsetIndexTest : public ::testing::Test {
+
+protected:
+    std::string indexPrefix;
+    std::string plainPath;
+    std::string compactPath;
+    std::vector<int64_t> offsets;
+    std::mt19937 rng{7};
+
+    void SetUp() override {
+        indexPrefix = ::testing::TempDir() + "blocksci_offsets_" + std::to_string(getpid()) + "_" + ::testing::UnitTest::GetInstance()->current_test_info()->name();
+        plainPath = indexPrefix + ".dat";
+        compactPath = offsetIndexPath(indexPrefix).str() + ".dat";
+    }
+
+    void TearDown() override {
+        unlink(plainPath.c_str());
+        unlink(compactPath.c_str());
+    }
+
+    /** Appends count offsets with gaps that average averageGap to the plain index file */
+    void appendOffsets(size_t count, int64_t averageGap) {
+        std::uniform_int_distribution<int64_t> gap(0, 2 * averageGap);
+        for(size_t i = 0; i < count; i++) {
+            offsets.push_back(offsets.empty() ? 0 : offsets.back() + gap(rng));
+        }
+        writePlainFile();
+    }
+
+    void writePlainFile() {
+        std::ofstream out(plainPath, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char *>(offsets.data()), static_cast<std::streamsize>(offsets.size() * sizeof(int64_t)));
+    }
+
+    std::vector<char> readCompactFile() {
+        std::ifstream in(compactPath, std::ios::binary);
+        return {std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+    }
+
+    void expectMatches(const std::vector<char> &data) {
+        OffsetIndex index;
+        ASSERT_TRUE(index.load(data.data(), static_cast<int64_t>(data.size())));
+        ASSERT_EQ(index.size(), offsets.size());
+        for(uint64_t i = 0; i < offsets.size(); i++) {
+            ASSERT_EQ(index[i], offsets[i]) << "at element " << i;
+        }
+    }
+};
+
+
+TEST_F(OffsetIndexTest, BuildsIndex) {
+    appendOffsets(10000, 300);
+    ASSERT_EQ(updateOffsetIndex(indexPrefix), offsets.size());
+    expectMatches(readCompactFile());
+}
+
+TEST_F(OffsetIndexTest, ExtendsIndexInPlace) {
+    appendOffsets(20000, 300);
+    updateOffsetIndex(indexPrefix);
+    auto before = readCompactFile();
+
+    appendOffsets(1000, 300);
+    ASSERT_EQ(updateOffsetIndex(indexPrefix), 1000u);
+    auto after = readCompactFile();
+    ASSERT_EQ(after.size(), before.size());
+    expectMatches(after);
+
+    // A reader of the old index sees the same elements as before the update
+    OffsetIndex oldIndex;
+    ASSERT_TRUE(oldIndex.load(before.data(), static_cast<int64_t>(before.size())));
+    ASSERT_EQ(oldIndex.size(), 20000u);
+    for(uint64_t i = 0; i < oldIndex.size(); i++) {
+        ASSERT_EQ(oldIndex[i], offsets[i]);
+    }
+
+    ASSERT_EQ(updateOffsetIndex(indexPrefix), 0u);
+    expectMatches(readCompactFile());
+}
+
+TEST_F(OffsetIndexTest, RebuildsOnceHeadroomIsUsedUp) {
+    appendOffsets(1000, 300);
+    updateOffsetIndex(indexPrefix);
+    auto size = readCompactFile().size();
+
+    // Much larger gaps than before leave the universe reserved for later offsets
+    appendOffsets(1000, 300000);
+    ASSERT_EQ(updateOffsetIndex(indexPrefix), offsets.size());
+    auto rebuilt = readCompactFile();
+    ASSERT_NE(rebuilt.size(), size);
+    expectMatches(rebuilt);
+}
+
+TEST_F(OffsetIndexTest, RebuildsAfterRewrittenOffsets) {
+    appendOffsets(5000, 300);
+    updateOffsetIndex(indexPrefix);
+
+    // Like a reorg, drop the tail and append different offsets
+    offsets.resize(4000);
+    appendOffsets(1500, 500);
+    ASSERT_EQ(updateOffsetIndex(indexPrefix), offsets.size());
+    expectMatches(readCompactFile());
+}
+
+TEST_F(OffsetIndexTest, RejectsUnsortedOffsets) {
+    appendOffsets(100, 300);
+    std::swap(offsets[10], offsets[50]);
+    writePlainFile();
+    ASSERT_THROW(updateOffsetIndex(indexPrefix), std::runtime_error);
+}
+
+} // namespace blocksci
@@ -0,0 +1,196 @@
+//
+//  test_task_pool.cpp
+//  blocksci_unittest
+//
+
+#include "unit_test.h"
+
+#include <blocksci/chain/numa.hpp>
+#include <blocksci/chain/task_pool.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace blocksci {
+
+class TaskPoolTest : public BlockSciTest {
+
+protected:
+    static constexpr unsigned int threadCount = 4;
+
+    void SetUp() override {
+        TaskPool::setSharedThreadCount(threadCount);
+    }
+
+    void TearDown() override {
+        TaskPool::setSharedThreadCount(0);
+    }
+
+    /** Three nodes without CPUs, so workers are spread over nodes but not pinned */
+    static const NumaTopology &fakeTopology() {
+        static const NumaTopology topology{{NumaNode{0, {}}, NumaNode{1, {}}, NumaNode{2, {}}}};
+        return topology;
+    }
+
+    /** Sleeps for up to a millisecond, so tasks finish in a different order than they were started */
+    static void jitter(std::mt19937 &rng) {
+        std::this_thread::sleep_for(std::chrono::microseconds(rng() % 1000));
+    }
+};
+
+
+TEST_F(TaskPoolTest, ParallelForRethrowsAfterAllTasks) {
+    TaskPool pool{threadCount, false};
+    std::atomic<size_t> finished{0};
+    ASSERT_THROW(pool.parallelFor(1000, [&](size_t i) {
+        if(i == 500) {
+            throw std::runtime_error("task failed");
+        }
+        finished++;
+    }), std::runtime_error);
+    ASSERT_EQ(finished.load(), 999u);
+
+    // The pool keeps working after a failed loop
+    finished = 0;
+    pool.parallelFor(1000, [&](size_t) { finished++; });
+    ASSERT_EQ(finished.load(), 1000u);
+}
+
+TEST_F(TaskPoolTest, MapReduceRethrows) {
+    auto failingHeight = static_cast<BlockHeight>(chain.size()) / 2;
+    ASSERT_THROW(chain.mapReduce<int64_t>([&](const BlockRange &blocks) -> int64_t {
+        for(auto block : blocks) {
+            if(block.height() == failingHeight) {
+                throw std::runtime_error("map failed");
+            }
+        }
+        return static_cast<int64_t>(blocks.size());
+    }, [](int64_t a, int64_t b) { return a + b; }), std::runtime_error);
+
+    ASSERT_THROW(chain.mapReduce<int64_t>([](const BlockRange &blocks) {
+        return static_cast<int64_t>(blocks.size());
+    }, [](int64_t a, int64_t b) -> int64_t {
+        if(a > 0 && b > 0) {
+            throw std::runtime_error("reduce failed");
+        }
+        return a + b;
+    }), std::runtime_error);
+
+    auto blockCount = chain.mapReduce<int64_t>([](const BlockRange &blocks) {
+        return static_cast<int64_t>(blocks.size());
+    }, [](int64_t a, int64_t b) { return a + b; });
+    ASSERT_EQ(blockCount, static_cast<int64_t>(chain.size()));
+}
+
+TEST_F(TaskPoolTest, NestedParallelFor) {
+    // Every thread of the pool ends up waiting on an inner loop, which only finishes if the waiting threads run its tasks
+    TaskPool pool{threadCount, false};
+    std::vector<std::atomic<int>> counts(64 * 64);
+    pool.parallelFor(64, [&](size_t outer) {
+        pool.parallelFor(64, [&](size_t inner) {
+            counts[outer * 64 + inner]++;
+        });
+    });
+    for(auto &count : counts) {
+        ASSERT_EQ(count.load(), 1);
+    }
+}
+
+TEST_F(TaskPoolTest, MapReduceFoldsInSegmentOrder) {
+    // Concatenating is not commutative, so any other order than the one of the segments changes the result
+    std::vector<BlockHeight> expected;
+    for(BlockHeight height = 0; height < static_cast<BlockHeight>(chain.size()); height++) {
+        expected.push_back(height);
+    }
+    ASSERT_GT(chain.size(), threadCount * TaskPool::tasksPerThread);
+
+    for(int run = 0; run < 3; run++) {
+        auto heights = chain.mapReduce<std::vector<BlockHeight>>([&](const BlockRange &blocks, int segment) {
+            std::mt19937 rng{static_cast<uint32_t>(segment + run)};
+            jitter(rng);
+            std::vector<BlockHeight> segmentHeights;
+            for(auto block : blocks) {
+                segmentHeights.push_back(block.height());
+            }
+            return segmentHeights;
+        }, [](std::vector<BlockHeight> a, const std::vector<BlockHeight> &b) {
+            a.insert(a.end(), b.begin(), b.end());
+            return a;
+        });
+        ASSERT_EQ(heights, expected) << "run " << run;
+    }
+}
+
+TEST_F(TaskPoolTest, SpreadsOnlyWorkersOverNodes) {
+    // The calling thread belongs to no node, so a pool needs a worker per node
+    ASSERT_EQ(TaskPool(1, fakeTopology()).nodeCount(), 1u);
+    ASSERT_EQ(TaskPool(2, fakeTopology()).nodeCount(), 1u);
+    ASSERT_EQ(TaskPool(3, fakeTopology()).nodeCount(), 2u);
+    ASSERT_EQ(TaskPool(4, fakeTopology()).nodeCount(), 3u);
+    ASSERT_EQ(TaskPool(16, fakeTopology()).nodeCount(), 3u);
+    ASSERT_EQ(TaskPool(16).nodeCount(), 1u);
+
+    TaskPool pool{4, fakeTopology()};
+    std::vector<unsigned int> taskNodes;
+    for(unsigned int i = 0; i < 300; i++) {
+        taskNodes.push_back(i % 5);
+    }
+    std::vector<std::atomic<int>> counts(taskNodes.size());
+    pool.parallelForOnNodes(taskNodes, [&](size_t i) { counts[i]++; });
+    for(auto &count : counts) {
+        ASSERT_EQ(count.load(), 1);
+    }
+    auto stats = pool.nodeStats();
+    ASSERT_EQ(stats.localTasks + stats.remoteTasks, taskNodes.size());
+}
+
+TEST_F(TaskPoolTest, MapReducePerNodeFoldsInSegmentOrder) {
+    TaskPool::setSharedPool(std::make_unique<TaskPool>(7, fakeTopology()));
+    auto &pool = TaskPool::shared();
+    ASSERT_EQ(pool.nodeCount(), 3u);
+
+    // Every node folds the segments assigned to it in segment order, and the nodes cover the chain in node order
+    auto segments = chain.taskSegments(pool);
+    auto segmentNodes = chain.taskSegmentNodes(segments, pool.nodeCount());
+    ASSERT_GT(segments.size(), pool.threadCount());
+    std::vector<std::vector<BlockHeight>> expected(pool.nodeCount());
+    for(size_t i = 0; i < segments.size(); i++) {
+        ASSERT_LT(segmentNodes[i], pool.nodeCount());
+        if(i > 0) {
+            ASSERT_GE(segmentNodes[i], segmentNodes[i - 1]);
+        }
+        for(auto block : segments[i]) {
+            expected[segmentNodes[i]].push_back(block.height());
+        }
+    }
+
+    std::mt19937 rng{5};
+    std::mutex rngMutex;
+    for(int run = 0; run < 3; run++) {
+        auto nodeHeights = chain.mapReducePerNode<std::vector<BlockHeight>>([&](const BlockRange &blocks) {
+            std::mt19937 taskRng;
+            {
+                std::lock_guard<std::mutex> lock(rngMutex);
+                taskRng.seed(rng());
+            }
+            jitter(taskRng);
+            std::vector<BlockHeight> heights;
+            for(auto block : blocks) {
+                heights.push_back(block.height());
+            }
+            return heights;
+        }, [](std::vector<BlockHeight> a, const std::vector<BlockHeight> &b) {
+            a.insert(a.end(), b.begin(), b.end());
+            return a;
+        });
+        ASSERT_EQ(nodeHeights, expected) << "run " << run;
+    }
+}
+
+} // namespace blocksci
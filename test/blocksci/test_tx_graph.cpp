@@ -0,0 +1,179 @@
+//
+//  test_tx_graph.cpp
+//  blocksci_unittest
+//
+
+#include "unit_test.h"
+
+#include <internal/data_access.hpp>
+
+#include <algorithm>
+#include <set>
+#include <vector>
+
+namespace blocksci {
+
+class TxGraphTest : public BlockSciTest {
+
+public:
+
+    /**
+     Breadth-first search over Input and Output objects, the reference for TxGraphTraversal.
+     */
+    TraversalResult naiveTraversal(const std::vector<uint32_t> &seeds, const TraversalOptions &options) {
+        std::set<uint32_t> visited(seeds.begin(), seeds.end());
+        std::vector<uint32_t> frontier(visited.begin(), visited.end());
+        TraversalResult result;
+        result.txNums = frontier;
+        result.depthOffsets = {0, frontier.size()};
+        for(uint32_t depth = 0; depth < options.maxDepth && !frontier.empty(); depth++) {
+            std::set<uint32_t> next;
+            for(auto txNum : frontier) {
+                auto tx = Transaction(txNum, chain.getAccess());
+                if(options.direction != TraversalDirection::Backward) {
+                    for(auto output : tx.outputs()) {
+                        auto spendingTx = output.getSpendingTx();
+                        if(spendingTx && !visited.count(spendingTx->txNum)) {
+                            next.insert(spendingTx->txNum);
+                        }
+                    }
+                }
+                if(options.direction != TraversalDirection::Forward) {
+                    for(auto input : tx.inputs()) {
+                        auto spentTxNum = input.getSpentTx().txNum;
+                        if(!visited.count(spentTxNum)) {
+                            next.insert(spentTxNum);
+                        }
+                    }
+                }
+            }
+            if(next.empty()) {
+                break;
+            }
+            visited.insert(next.begin(), next.end());
+            result.txNums.insert(result.txNums.end(), next.begin(), next.end());
+            result.depthOffsets.push_back(result.txNums.size());
+            frontier.assign(next.begin(), next.end());
+        }
+        return result;
+    }
+
+    /**
+     The transactions of the first blocks that spend or are spent, good seeds in both directions.
+     */
+    std::vector<uint32_t> linkedTransactions() {
+        std::vector<uint32_t> seeds;
+        for(auto block : chain) {
+            for(auto tx : block) {
+                bool linked = tx.inputCount() > 0;
+                for(auto output : tx.outputs()) {
+                    linked |= output.isSpent();
+                }
+                if(linked) {
+                    seeds.push_back(tx.txNum);
+                }
+            }
+            if(seeds.size() > 20) {
+                break;
+            }
+        }
+        return seeds;
+    }
+};
+
+
+TEST_F(TxGraphTest, MatchesNaiveTraversal) {
+    auto seeds = linkedTransactions();
+    ASSERT_FALSE(seeds.empty());
+    TxGraphTraversal traversal{chain.getAccess()};
+
+    for(auto direction : {TraversalDirection::Forward, TraversalDirection::Backward, TraversalDirection::Both}) {
+        for(uint32_t maxDepth : {0u, 1u, 3u, 20u}) {
+            TraversalOptions options;
+            options.direction = direction;
+            options.maxDepth = maxDepth;
+            auto expected = naiveTraversal(seeds, options);
+            // Running twice checks that the visited bits are cleared between runs
+            for(int run = 0; run < 2; run++) {
+                auto result = traversal.run(seeds, options);
+                ASSERT_EQ(result.txNums, expected.txNums);
+                ASSERT_EQ(result.depthOffsets, expected.depthOffsets);
+                ASSERT_FALSE(result.truncated);
+            }
+        }
+    }
+}
+
+TEST_F(TxGraphTest, EdgesAndFilter) {
+    auto seeds = linkedTransactions();
+    TraversalOptions options;
+    options.direction = TraversalDirection::Both;
+    options.maxDepth = 5;
+    options.collectEdges = true;
+    auto result = traverseTxGraph(seeds, options, chain.getAccess());
+
+    std::set<uint32_t> visited(result.txNums.begin(), result.txNums.end());
+    for(size_t i = 0; i < result.edges.size(); i++) {
+        auto &edge = result.edges[i];
+        ASSERT_TRUE(visited.count(edge.fromTx));
+        ASSERT_TRUE(visited.count(edge.toTx));
+        auto tx = Transaction(edge.fromTx, chain.getAccess());
+        if(edge.direction == TraversalDirection::Forward) {
+            ASSERT_EQ(tx.outputs()[edge.inoutNum].getSpendingTx()->txNum, edge.toTx);
+        } else {
+            ASSERT_EQ(tx.inputs()[edge.inoutNum].getSpentTx().txNum, edge.toTx);
+        }
+        if(i > 0) {
+            auto &previous = result.edges[i - 1];
+            ASSERT_TRUE(std::make_pair(previous.depth, previous.fromTx) <= std::make_pair(edge.depth, edge.fromTx));
+        }
+    }
+
+    // Rejecting every edge leaves only the seeds
+    options.edgeFilter = [](const TxEdge &) { return false; };
+    auto filtered = traverseTxGraph(seeds, options, chain.getAccess());
+    ASSERT_EQ(filtered.depthCount(), 1u);
+    ASSERT_EQ(filtered.txNumsAtDepth(0), result.txNumsAtDepth(0));
+    ASSERT_TRUE(filtered.edges.empty());
+}
+
+TEST_F(TxGraphTest, MaxVisited) {
+    auto seeds = linkedTransactions();
+    TraversalOptions options;
+    options.direction = TraversalDirection::Both;
+    options.maxDepth = 20;
+    auto full = traverseTxGraph(seeds, options, chain.getAccess());
+    ASSERT_TRUE(full.txNums.size() > seeds.size() + 1);
+
+    options.maxVisited = full.txNums.size() - 1;
+    auto truncated = traverseTxGraph(seeds, options, chain.getAccess());
+    ASSERT_TRUE(truncated.truncated);
+    ASSERT_EQ(truncated.txNums.size(), options.maxVisited);
+    ASSERT_TRUE(std::equal(truncated.txNums.begin(), truncated.txNums.end(), full.txNums.begin()));
+
+    ASSERT_THROW(traverseTxGraph({static_cast<uint32_t>(chain.endTxIndex())}, options, chain.getAccess()), std::invalid_argument);
+}
+
+TEST_F(TxGraphTest, ReusesTraversalOfDataAccess) {
+    auto seeds = linkedTransactions();
+    TraversalOptions options;
+    options.direction = TraversalDirection::Both;
+    options.maxDepth = 3;
+    auto &access = chain.getAccess();
+    auto first = traverseTxGraph(seeds, options, access);
+    auto traversal = access.txGraphTraversal;
+    ASSERT_NE(traversal, nullptr);
+
+    auto second = traverseTxGraph(seeds, options, access);
+    ASSERT_EQ(access.txGraphTraversal, traversal);
+    ASSERT_EQ(second.txNums, first.txNums);
+    ASSERT_EQ(second.depthOffsets, first.depthOffsets);
+
+    // A failed run leaves no traversal behind, the next call creates a new one
+    ASSERT_THROW(traverseTxGraph({static_cast<uint32_t>(chain.endTxIndex())}, options, access), std::invalid_argument);
+    ASSERT_EQ(access.txGraphTraversal, nullptr);
+    ASSERT_EQ(traverseTxGraph(seeds, options, access).txNums, first.txNums);
+    ASSERT_NE(access.txGraphTraversal, nullptr);
+}
+
+} // namespace blocksci
@@ -0,0 +1,203 @@
+//
+//  test_tx_hash_index.cpp
+//  blocksci_unittest
+//
+
+#include <internal/tx_hash_index.hpp>
+
+#include "gtest/gtest.h"
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace blocksci {
+
+class TxHashIndexTest : public ::testing::Test {
+
+protected:
+    filesystem::path chainDirectory;
+    filesystem::path indexPrefix;
+    std::vector<uint256> hashes;
+    std::mt19937 rng{11};
+
+    void SetUp() override {
+        chainDirectory = filesystem::path{::testing::TempDir() + "blocksci_tx_hashes_" + std::to_string(getpid()) + "_" + ::testing::UnitTest::GetInstance()->current_test_info()->name()};
+        mkdir(chainDirectory.str().c_str(), 0755);
+        indexPrefix = chainDirectory/"tx_hash_index";
+    }
+
+    void TearDown() override {
+        for(auto &path : {(chainDirectory/"tx_hashes").str(), indexPrefix.str(), txHashIndexDeltaPath(indexPrefix).str()}) {
+            unlink((path + ".dat").c_str());
+        }
+        rmdir(chainDirectory.str().c_str());
+    }
+
+    /** Appends count random hashes to chain/tx_hashes.dat */
+    void appendHashes(size_t count) {
+        for(size_t i = 0; i < count; i++) {
+            uint256 hash;
+            for(auto it = hash.begin(); it != hash.end(); ++it) {
+                *it = static_cast<uint8_t>(rng());
+            }
+            hashes.push_back(hash);
+        }
+        std::ofstream out((chainDirectory/"tx_hashes").str() + ".dat", std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char *>(hashes.data()), static_cast<std::streamsize>(hashes.size() * sizeof(uint256)));
+    }
+
+    std::vector<char> readFile(const filesystem::path &prefix) {
+        std::ifstream in(prefix.str() + ".dat", std::ios::binary);
+        return {std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+    }
+
+    /** The transactions whose hash begins with the hex digits, found by comparing every hash */
+    std::vector<uint32_t> scan(const std::string &hex) {
+        std::vector<uint32_t> txNums;
+        for(uint32_t txNum = 0; txNum < hashes.size(); txNum++) {
+            if(hashes[txNum].GetHex().compare(0, hex.size(), hex) == 0) {
+                txNums.push_back(txNum);
+            }
+        }
+        return txNums;
+    }
+
+    /** Checks findByPrefix against a scan for short and long prefixes and several limits */
+    void expectFindsPrefixes(const TxHashIndex &index) {
+        std::vector<std::string> prefixes{"", "a", "3f", "c07", "ffff"};
+        for(auto txNum : {0u, 777u, static_cast<uint32_t>(hashes.size() - 1)}) {
+            auto hex = hashes[txNum].GetHex();
+            for(size_t length : {5u, 9u, 16u, 17u, 64u}) {
+                prefixes.push_back(hex.substr(0, length));
+            }
+        }
+        for(auto &hex : prefixes) {
+            auto expected = scan(hex);
+            for(size_t limit : {size_t{0}, size_t{1}, size_t{7}, size_t{100}, expected.size(), hashes.size()}) {
+                auto first = std::vector<uint32_t>(expected.begin(), expected.begin() + static_cast<std::ptrdiff_t>(std::min(limit, expected.size())));
+                ASSERT_EQ(index.findByPrefix(TxHashPrefix{hex}, limit), first) << "prefix " << hex << " limit " << limit;
+            }
+        }
+    }
+
+    void expectFindsAll() {
+        TxHashIndex index{indexPrefix, chainDirectory};
+        ASSERT_EQ(index.txCount(), hashes.size());
+        for(uint32_t txNum = 0; txNum < hashes.size(); txNum++) {
+            auto found = index.find(hashes[txNum]);
+            ASSERT_TRUE(found) << "tx " << txNum;
+            ASSERT_EQ(*found, txNum);
+        }
+        ASSERT_FALSE(index.find(uint256{}));
+    }
+};
+
+
+TEST_F(TxHashIndexTest, FindsEveryTransaction) {
+    appendHashes(5000);
+    ASSERT_EQ(updateTxHashIndex(indexPrefix, chainDirectory, 3), 5000u);
+    expectFindsAll();
+    ASSERT_EQ(updateTxHashIndex(indexPrefix, chainDirectory, 3), 0u);
+}
+
+TEST_F(TxHashIndexTest, ExtendsDelta) {
+    appendHashes(16000);
+    updateTxHashIndex(indexPrefix, chainDirectory, 2);
+    for(int update = 0; update < 3; update++) {
+        appendHashes(500);
+        ASSERT_EQ(updateTxHashIndex(indexPrefix, chainDirectory, 2), 500u);
+        TxHashIndex index{indexPrefix, chainDirectory};
+        ASSERT_EQ(index.baseTxCount(), 16000u);
+        expectFindsAll();
+    }
+
+    // Extending the delta table gives the same table as building it from the end of the base
+    auto extended = readFile(txHashIndexDeltaPath(indexPrefix));
+    unlink((txHashIndexDeltaPath(indexPrefix).str() + ".dat").c_str());
+    ASSERT_EQ(updateTxHashIndex(indexPrefix, chainDirectory, 2), 1500u);
+    ASSERT_EQ(readFile(txHashIndexDeltaPath(indexPrefix)), extended);
+}
+
+TEST_F(TxHashIndexTest, RebuildsBaseOnceDeltaOutgrowsIt) {
+    appendHashes(8000);
+    updateTxHashIndex(indexPrefix, chainDirectory, 2);
+    appendHashes(900);
+    updateTxHashIndex(indexPrefix, chainDirectory, 2);
+    ASSERT_EQ(TxHashIndex(indexPrefix, chainDirectory).baseTxCount(), 8000u);
+
+    appendHashes(200);
+    updateTxHashIndex(indexPrefix, chainDirectory, 2);
+    TxHashIndex index{indexPrefix, chainDirectory};
+    ASSERT_EQ(index.baseTxCount(), hashes.size());
+    ASSERT_FALSE(index.deltaTable().isLoaded());
+    expectFindsAll();
+}
+
+TEST_F(TxHashIndexTest, FindsFirstTransactionsWithPrefix) {
+    appendHashes(20000);
+    updateTxHashIndex(indexPrefix, chainDirectory, 2);
+    appendHashes(500);
+    updateTxHashIndex(indexPrefix, chainDirectory, 2);
+    // Transactions that are not in the index yet are found as well
+    appendHashes(300);
+    TxHashIndex index{indexPrefix, chainDirectory};
+    ASSERT_TRUE(index.deltaTable().isLoaded());
+    ASSERT_EQ(index.txCount(), 20500u);
+    expectFindsPrefixes(index);
+    ASSERT_THROW(TxHashPrefix{"0xabg"}, std::invalid_argument);
+}
+
+TEST_F(TxHashIndexTest, FindsLastTransactionWithDuplicateHash) {
+    // Like the BIP30 duplicates of the early chain, later transactions repeat the hash of earlier ones, in the base
+    // table and across the base and the delta table
+    appendHashes(3000);
+    hashes[2500] = hashes[100];
+    appendHashes(0);
+    updateTxHashIndex(indexPrefix, chainDirectory, 2);
+    appendHashes(200);
+    hashes[3100] = hashes[200];
+    appendHashes(0);
+    updateTxHashIndex(indexPrefix, chainDirectory, 2);
+
+    TxHashIndex index{indexPrefix, chainDirectory};
+    ASSERT_TRUE(index.deltaTable().isLoaded());
+    for(auto txNums : {std::make_pair(100u, 2500u), std::make_pair(200u, 3100u)}) {
+        auto found = index.find(hashes[txNums.first]);
+        ASSERT_TRUE(found);
+        ASSERT_EQ(*found, txNums.second);
+        ASSERT_EQ(index.findByPrefix(TxHashPrefix{hashes[txNums.first].GetHex()}, 10), (std::vector<uint32_t>{txNums.first, txNums.second}));
+    }
+}
+
+TEST_F(TxHashIndexTest, IgnoresVersion1Table) {
+    appendHashes(3000);
+    updateTxHashIndex(indexPrefix, chainDirectory, 2);
+    auto table = readFile(indexPrefix);
+    auto &header = *reinterpret_cast<TxHashTableHeader *>(table.data());
+    header.version = 1;
+    {
+        std::ofstream out(indexPrefix.str() + ".dat", std::ios::binary | std::ios::trunc);
+        out.write(table.data(), static_cast<std::streamsize>(table.size()));
+    }
+
+    // Version 1 keys do not sort like the hex strings, so the table is not used and every hash is scanned
+    {
+        TxHashIndex index{indexPrefix, chainDirectory};
+        ASSERT_FALSE(index.isGood());
+        ASSERT_EQ(index.txCount(), 0u);
+        expectFindsPrefixes(index);
+    }
+
+    ASSERT_EQ(updateTxHashIndex(indexPrefix, chainDirectory, 2), 3000u);
+    ASSERT_TRUE(TxHashIndex(indexPrefix, chainDirectory).isGood());
+    expectFindsAll();
+}
+
+} // namespace blocksci
@@ -9,12 +9,19 @@
 
 #include "address_db.hpp"
 #include "raw_address_visitor.hpp"
+#include "sst_file_builder.hpp"
 
 #include <blocksci/core/address_type_meta.hpp>
 #include <blocksci/core/inout_pointer.hpp>
 
 #include <internal/address_info.hpp>
 
+#include <endian/big_endian.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
 using blocksci::RawAddress;
 using blocksci::DedupAddress;
 using blocksci::InoutPointer;
@@ -23,22 +30,27 @@ using blocksci::DedupAddressType;
 
 AddressDB::AddressDB(const ParserConfigurationBase &config_, const filesystem::path &path) : ParserIndex(config_, "addressDB"), db(path, false) {
     outputCache.reserve(cacheSize);
+    inputCache.reserve(cacheSize);
     nestedCache.reserve(cacheSize);
 }
 
 AddressDB::~AddressDB() {
     clearNestedCache();
     clearOutputCache();
+    clearInputCache();
 }
 
-void AddressDB::processTx(const blocksci::RawTransaction *tx, uint32_t txNum, const blocksci::ChainAccess &, const blocksci::ScriptAccess &scripts) {
+/** Passes every entry of the address index that tx adds to visitor.addAddressNested, visitor.addAddressInput and
+ * visitor.addAddressOutput */
+template <typename Visitor>
+void visitIndexedAddresses(const blocksci::RawTransaction *tx, uint32_t txNum, const blocksci::ScriptAccess &scripts, Visitor &visitor) {
     std::unordered_set<RawAddress> addedAddresses;
     std::function<bool(const RawAddress &)> visitFunc = [&](const RawAddress &a) {
         if (dedupType(a.type) == DedupAddressType::SCRIPTHASH && addedAddresses.find(a) == addedAddresses.end()) {
             addedAddresses.insert(a);
             auto scriptHash = scripts.getScriptData<DedupAddressType::SCRIPTHASH>(a.scriptNum);
             if (scriptHash->txFirstSpent == txNum) {
-                addAddressNested(scriptHash->wrappedAddress, DedupAddress{a.scriptNum, DedupAddressType::SCRIPTHASH});
+                visitor.addAddressNested(scriptHash->wrappedAddress, DedupAddress{a.scriptNum, DedupAddressType::SCRIPTHASH});
                 return true;
             } else {
                 return false;
@@ -48,17 +60,25 @@ void AddressDB::processTx(const blocksci::RawTransaction *tx, uint32_t txNum, co
         }
     };
     auto inputs = ranges::make_subrange(tx->beginInputs(), tx->endInputs());
+    uint16_t inputNum = 0;
     for (auto &input : inputs) {
-        visit(RawAddress{input.getAddressNum(), input.getType()}, visitFunc, scripts);
+        RawAddress address{input.getAddressNum(), input.getType()};
+        visit(address, visitFunc, scripts);
+        visitor.addAddressInput(address, InoutPointer{txNum, inputNum});
+        inputNum++;
     }
     
     for (uint16_t i = 0; i < tx->outputCount; i++) {
         auto &output = tx->getOutput(i);
         auto pointer = InoutPointer{txNum, i};
-        addAddressOutput(blocksci::RawAddress{output.getAddressNum(), output.getType()}, pointer);
+        visitor.addAddressOutput(blocksci::RawAddress{output.getAddressNum(), output.getType()}, pointer);
     }
 }
 
+void AddressDB::processTx(const blocksci::RawTransaction *tx, uint32_t txNum, const blocksci::ChainAccess &, const blocksci::ScriptAccess &scripts) {
+    visitIndexedAddresses(tx, txNum, scripts, *this);
+}
+
 void AddressDB::addAddressNested(const blocksci::RawAddress &childAddress, const blocksci::DedupAddress &parentAddress) {
     nestedCache.emplace_back(childAddress, parentAddress);
     if (nestedCache.size() >= cacheSize) {
@@ -82,3 +102,183 @@ void AddressDB::clearOutputCache() {
     db.addOutputAddresses(std::move(outputCache));
     outputCache.clear();
 }
+
+void AddressDB::addAddressInput(const blocksci::RawAddress &address, const blocksci::InoutPointer &pointer) {
+    inputCache.emplace_back(address, pointer);
+    if (inputCache.size() >= cacheSize) {
+        clearInputCache();
+    }
+}
+
+void AddressDB::clearInputCache() {
+    db.addInputAddresses(std::move(inputCache));
+    inputCache.clear();
+}
+
+void AddressDB::completeInputIndex() {
+    if (db.hasInputIndex()) {
+        return;
+    }
+    if (latestState.txCount > 0) {
+        blocksci::ChainAccess chain{config.dataConfig.chainDirectory(), config.dataConfig.blocksIgnored, config.dataConfig.errorOnReorg};
+        std::cout << "Adding inputs of " << latestState.txCount << " indexed txes to the address index\n";
+        auto progress = blocksci::makeProgressBar(latestState.txCount, [=]() {});
+        for (uint32_t txNum = 0; txNum < latestState.txCount; txNum++) {
+            auto tx = chain.getTx(txNum);
+            for (uint16_t i = 0; i < tx->inputCount; i++) {
+                auto &input = tx->getInput(i);
+                addAddressInput(RawAddress{input.getAddressNum(), input.getType()}, InoutPointer{txNum, i});
+            }
+            progress.update(txNum);
+        }
+        clearInputCache();
+    }
+    db.markInputIndexComplete();
+}
+
+namespace {
+    using ColumnKind = blocksci::AddressIndex::ColumnKind;
+
+    /** Entry of a bulk address index build
+     *
+     * column identifies the column kind and address type, @see columnOf. The key is stored in the format of the
+     * address index (scriptNum, big endian txNum, big endian inoutNum or child scriptNum, parent DedupAddress) and
+     * padded with zeros.
+     */
+    struct BulkAddressIndexRow {
+        uint8_t column;
+        uint8_t key[12];
+    };
+
+    constexpr size_t inoutKeySize = sizeof(uint32_t) + sizeof(uint32_t) + sizeof(uint16_t);
+    constexpr size_t nestedKeySize = sizeof(uint32_t) + sizeof(DedupAddress);
+    static_assert(nestedKeySize <= sizeof(BulkAddressIndexRow::key), "Nested key does not fit into a bulk address index row");
+
+    constexpr uint8_t columnOf(ColumnKind kind, blocksci::AddressType::Enum type) {
+        return static_cast<uint8_t>(static_cast<size_t>(kind) * blocksci::AddressType::size + static_cast<size_t>(type));
+    }
+
+    constexpr size_t bulkColumnCount = columnOf(ColumnKind::Input, static_cast<blocksci::AddressType::Enum>(blocksci::AddressType::size - 1)) + 1;
+
+    struct BulkAddressIndexRowCompare {
+        bool operator()(const BulkAddressIndexRow &a, const BulkAddressIndexRow &b) const {
+            if (a.column != b.column) {
+                return a.column < b.column;
+            }
+            return std::memcmp(a.key, b.key, sizeof(a.key)) < 0;
+        }
+    };
+
+    using BulkAddressIndexRunWriter = SortedRunWriter<BulkAddressIndexRow, BulkAddressIndexRowCompare>;
+
+    /** Receives the entries of the transactions of one shard from visitIndexedAddresses */
+    struct BulkAddressIndexShard {
+        BulkAddressIndexRunWriter &rows;
+
+        void addInout(ColumnKind kind, const RawAddress &address, const InoutPointer &pointer) {
+            BulkAddressIndexRow row{};
+            row.column = columnOf(kind, address.type);
+            std::memcpy(row.key, &address.scriptNum, sizeof(address.scriptNum));
+            endian::big_endian::put(pointer.txNum, row.key + sizeof(uint32_t));
+            endian::big_endian::put(pointer.inoutNum, row.key + 2 * sizeof(uint32_t));
+            rows.add(row);
+        }
+
+        void addAddressOutput(const RawAddress &address, const InoutPointer &pointer) {
+            addInout(ColumnKind::Output, address, pointer);
+        }
+
+        void addAddressInput(const RawAddress &address, const InoutPointer &pointer) {
+            addInout(ColumnKind::Input, address, pointer);
+        }
+
+        void addAddressNested(const RawAddress &childAddress, const DedupAddress &parentAddress) {
+            BulkAddressIndexRow row{};
+            row.column = columnOf(ColumnKind::Nested, childAddress.type);
+            std::memcpy(row.key, &childAddress.scriptNum, sizeof(childAddress.scriptNum));
+            std::memcpy(row.key + sizeof(uint32_t), &parentAddress, sizeof(parentAddress));
+            rows.add(row);
+        }
+    };
+
+    /** Memory used for the sorted runs of all shards together */
+    constexpr size_t bulkRunMemory = size_t{4} << 30;
+
+    /** Targeted number of entries per SST file of the largest columns */
+    constexpr uint64_t bulkRowsPerFile = uint64_t{1} << 22;
+} // namespace
+
+void AddressDB::runBulkUpdate(const State &state, unsigned int threadCount) {
+    blocksci::ChainAccess chain{config.dataConfig.chainDirectory(), config.dataConfig.blocksIgnored, config.dataConfig.errorOnReorg};
+    blocksci::ScriptAccess scripts{config.dataConfig.scriptsDirectory()};
+
+    // Entries still cached by the incremental path must not be written after the ingested files
+    clearNestedCache();
+    clearOutputCache();
+    clearInputCache();
+
+    threadCount = std::max(threadCount, 1u);
+    auto firstTxNum = latestState.txCount;
+    if (firstTxNum < state.txCount) {
+        auto newCount = state.txCount - firstTxNum;
+        auto workDirectory = config.parserDirectory()/"addressIndexBulk";
+        if (!workDirectory.exists()) {
+            filesystem::create_directory(workDirectory);
+        }
+
+        std::cout << "Bulk loading address index with " << newCount << " txes on " << threadCount << " threads\n";
+
+        // Phase 1: every shard emits the (scriptNum, txNum, inoutNum) entries of a contiguous range of transactions
+        // and sorts them into runs
+        auto runPaths = sortInRuns<BulkAddressIndexRow, BulkAddressIndexRowCompare>(workDirectory, newCount, threadCount, bulkRunMemory, [&](size_t begin, size_t end, BulkAddressIndexRunWriter &writer) {
+            BulkAddressIndexShard shard{writer};
+            for (auto i = begin; i < end; i++) {
+                auto txNum = static_cast<uint32_t>(firstTxNum + i);
+                visitIndexedAddresses(chain.getTx(txNum), txNum, scripts, shard);
+            }
+        });
+
+        // Phase 2: every partition, a range of keys of one column, is merged from all runs into its own SST file.
+        // The key starts with the little endian scriptNum, so its leading bits spread the addresses evenly.
+        auto entryCount = (chain.firstInputNum(state.txCount) - chain.firstInputNum(firstTxNum)) + (chain.firstOutputNum(state.txCount) - chain.firstOutputNum(firstTxNum));
+        auto partitionBits = partitionBitsFor(entryCount, bulkRowsPerFile);
+        auto partitionsPerColumn = size_t{1} << partitionBits;
+        auto partitionOf = [&](const BulkAddressIndexRow &row) {
+            return (static_cast<size_t>(row.column) << partitionBits) | leadingKeyBits(row.key, partitionBits);
+        };
+        std::vector<std::string> sstPaths;
+        {
+            SortedRuns<BulkAddressIndexRow> runs{std::move(runPaths)};
+            std::cout << "Writing address index files\n";
+            sstPaths = writeSstPartitions(runs, bulkColumnCount * partitionsPerColumn, threadCount, workDirectory, blocksci::AddressIndex::sstFileOptions(), BulkAddressIndexRowCompare{}, partitionOf, [](const BulkAddressIndexRow &row, SstPartitionWriter &writer) {
+                auto kind = static_cast<ColumnKind>(row.column / blocksci::AddressType::size);
+                auto keySize = kind == ColumnKind::Nested ? nestedKeySize : inoutKeySize;
+                writer.add(rocksdb::Slice{reinterpret_cast<const char *>(row.key), keySize}, rocksdb::Slice{});
+            });
+        }
+
+        std::cout << "Ingesting address index files\n";
+        for (size_t column = 0; column < bulkColumnCount; column++) {
+            std::vector<std::string> columnPaths;
+            for (size_t partition = column * partitionsPerColumn; partition < (column + 1) * partitionsPerColumn; partition++) {
+                if (!sstPaths[partition].empty()) {
+                    columnPaths.push_back(sstPaths[partition]);
+                }
+            }
+            auto kind = static_cast<ColumnKind>(column / blocksci::AddressType::size);
+            auto type = static_cast<blocksci::AddressType::Enum>(column % blocksci::AddressType::size);
+            db.ingestFiles(kind, type, columnPaths);
+        }
+
+        for (auto &path : sstPaths) {
+            if (!path.empty()) {
+                std::remove(path.c_str());
+            }
+        }
+        std::remove(workDirectory.str().c_str());
+    }
+
+    ParserScriptUpdater<AddressDB> updater(*this, state, scripts);
+    blocksci::for_each(blocksci::DedupAddressType::all(), updater);
+    latestState = state;
+}
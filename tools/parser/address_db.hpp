@@ -30,10 +30,12 @@ class AddressDB : public ParserIndex<AddressDB> {
     static constexpr int cacheSize = 1000;
     
     std::vector<std::pair<blocksci::RawAddress, blocksci::InoutPointer>> outputCache;
+    std::vector<std::pair<blocksci::RawAddress, blocksci::InoutPointer>> inputCache;
     std::vector<std::pair<blocksci::RawAddress, blocksci::DedupAddress>> nestedCache;
     
     void clearNestedCache();
     void clearOutputCache();
+    void clearInputCache();
 public:
     
     AddressDB(const ParserConfigurationBase &config, const filesystem::path &path);
@@ -46,6 +48,27 @@ public:
     
     void addAddressNested(const blocksci::RawAddress &childAddress, const blocksci::DedupAddress &parentAddress);
     void addAddressOutput(const blocksci::RawAddress &address, const blocksci::InoutPointer &pointer);
+    void addAddressInput(const blocksci::RawAddress &address, const blocksci::InoutPointer &pointer);
+    
+    /** Adds the inputs of the transactions that were indexed before the address index had input columns */
+    void completeInputIndex();
+
+    /** Updates with at least this many new transactions are done with runBulkUpdate instead of runUpdate */
+    static constexpr uint32_t bulkLoadMinTxCount = 1 << 24;
+
+    /** Number of transactions that have already been added to the index */
+    uint32_t indexedTxCount() const {
+        return latestState.txCount;
+    }
+
+    /** Indexes the same transactions as runUpdate, but writes the output, input and nested columns in their final form
+     *
+     * The new transactions are split into threadCount shards that emit their (scriptNum, txNum, inoutNum) entries per
+     * column and sort them in memory-sized runs in parallel. The runs are merged into one SST file per column and key
+     * range, again in parallel, and the files are ingested into the database without passing through the memtables
+     * or triggering compactions.
+     */
+    void runBulkUpdate(const blocksci::State &state, unsigned int threadCount);
     
     void compact() {
         db.compactDB();
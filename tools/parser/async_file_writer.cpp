@@ -0,0 +1,540 @@
+//
+//  async_file_writer.cpp
+//  blocksci
+//
+
+#include "async_file_writer.hpp"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef BLOCKSCI_HAVE_LIBURING
+#include <liburing.h>
+#endif
+
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+namespace {
+    /** Alignment of the buffers and of the file offsets and lengths written with O_DIRECT */
+    constexpr size_t directIOAlignment = 4096;
+
+    std::string errorString(int error) {
+        return std::string(strerror(error));
+    }
+
+    void pwriteAll(int fd, const char *data, size_t length, uint64_t offset) {
+        while (length > 0) {
+            auto written = pwrite(fd, data, length, static_cast<off_t>(offset));
+            if (written < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                throw std::system_error(errno, std::generic_category(), "write failed");
+            }
+            data += written;
+            length -= static_cast<size_t>(written);
+            offset += static_cast<uint64_t>(written);
+        }
+    }
+
+    /** Reads length bytes at offset, the part past the end of the file reads as zeros */
+    void preadAll(int fd, char *out, size_t length, uint64_t offset) {
+        while (length > 0) {
+            auto count = pread(fd, out, length, static_cast<off_t>(offset));
+            if (count < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                throw std::system_error(errno, std::generic_category(), "read failed");
+            }
+            if (count == 0) {
+                std::memset(out, 0, length);
+                return;
+            }
+            out += count;
+            length -= static_cast<size_t>(count);
+            offset += static_cast<uint64_t>(count);
+        }
+    }
+
+    class SynchronousWriteBackend : public AsyncWriteBackend {
+        std::array<std::exception_ptr, 2> errors;
+
+    public:
+        void submit(size_t slot, int fd, const char *data, size_t length, uint64_t offset) override {
+            try {
+                pwriteAll(fd, data, length, offset);
+            } catch (...) {
+                errors[slot] = std::current_exception();
+            }
+        }
+
+        void wait(size_t slot) override {
+            if (errors[slot]) {
+                auto error = errors[slot];
+                errors[slot] = nullptr;
+                std::rethrow_exception(error);
+            }
+        }
+    };
+
+    /** Pool of threads that performs the positioned writes of the writers using the thread pool backend */
+    class WriterThreadPool {
+        std::mutex mutex;
+        std::condition_variable available;
+        std::deque<std::function<void()>> tasks;
+        std::vector<std::thread> threads;
+        bool stopping = false;
+
+        void run() {
+            while (true) {
+                std::function<void()> task;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    available.wait(lock, [&] { return stopping || !tasks.empty(); });
+                    if (tasks.empty()) {
+                        return;
+                    }
+                    task = std::move(tasks.front());
+                    tasks.pop_front();
+                }
+                task();
+            }
+        }
+
+    public:
+        explicit WriterThreadPool(unsigned int threadCount) {
+            for (unsigned int i = 0; i < std::max(threadCount, 1u); i++) {
+                threads.emplace_back(&WriterThreadPool::run, this);
+            }
+        }
+
+        ~WriterThreadPool() {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+            }
+            available.notify_all();
+            for (auto &thread : threads) {
+                thread.join();
+            }
+        }
+
+        unsigned int threadCount() const {
+            return static_cast<unsigned int>(threads.size());
+        }
+
+        /** Pool with the given number of threads, shared by all writers that are open at the same time and ask for it
+         *
+         * The pool is owned by the backends using it and stops once the last of them is destroyed. Asking for a different
+         * number of threads starts a new pool, the writers of the old one keep using it.
+         */
+        static std::shared_ptr<WriterThreadPool> shared(unsigned int threadCount) {
+            static std::mutex sharedMutex;
+            static std::weak_ptr<WriterThreadPool> sharedPool;
+            std::lock_guard<std::mutex> lock(sharedMutex);
+            auto pool = sharedPool.lock();
+            if (!pool || pool->threadCount() != std::max(threadCount, 1u)) {
+                pool = std::make_shared<WriterThreadPool>(threadCount);
+                sharedPool = pool;
+            }
+            return pool;
+        }
+
+        std::future<void> enqueue(std::function<void()> func) {
+            auto task = std::make_shared<std::packaged_task<void()>>(std::move(func));
+            auto future = task->get_future();
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                tasks.emplace_back([task] { (*task)(); });
+            }
+            available.notify_one();
+            return future;
+        }
+    };
+
+    class ThreadPoolWriteBackend : public AsyncWriteBackend {
+        std::shared_ptr<WriterThreadPool> pool;
+        std::array<std::future<void>, 2> pending;
+
+    public:
+        explicit ThreadPoolWriteBackend(unsigned int threadCount) : pool(WriterThreadPool::shared(threadCount)) {}
+
+        ~ThreadPoolWriteBackend() override {
+            // The pool must not touch the buffers once the writer is gone
+            for (auto &future : pending) {
+                if (future.valid()) {
+                    future.wait();
+                }
+            }
+        }
+
+        void submit(size_t slot, int fd, const char *data, size_t length, uint64_t offset) override {
+            pending[slot] = pool->enqueue([=] { pwriteAll(fd, data, length, offset); });
+        }
+
+        void wait(size_t slot) override {
+            if (pending[slot].valid()) {
+                pending[slot].get();
+            }
+        }
+    };
+
+#ifdef BLOCKSCI_HAVE_LIBURING
+    class UringWriteBackend : public AsyncWriteBackend {
+        struct Request {
+            int fd = -1;
+            const char *data = nullptr;
+            size_t length = 0;
+            uint64_t offset = 0;
+            bool done = true;
+            int error = 0;
+        };
+
+        io_uring ring;
+        std::array<Request, 2> requests;
+
+        void complete(size_t slot, int result) {
+            auto &request = requests[slot];
+            request.done = true;
+            if (result < 0) {
+                request.error = -result;
+            } else if (static_cast<size_t>(result) < request.length) {
+                // Short writes are rare, the rest is written synchronously
+                auto written = static_cast<size_t>(result);
+                try {
+                    pwriteAll(request.fd, request.data + written, request.length - written, request.offset + written);
+                } catch (const std::system_error &e) {
+                    request.error = e.code().value();
+                }
+            }
+        }
+
+    public:
+        UringWriteBackend() {
+            auto result = io_uring_queue_init(static_cast<unsigned int>(requests.size()), &ring, 0);
+            if (result < 0) {
+                throw std::runtime_error("could not set up io_uring: " + errorString(-result));
+            }
+        }
+
+        ~UringWriteBackend() override {
+            for (size_t slot = 0; slot < requests.size(); slot++) {
+                try {
+                    wait(slot);
+                } catch (const std::exception &) {
+                }
+            }
+            io_uring_queue_exit(&ring);
+        }
+
+        void submit(size_t slot, int fd, const char *data, size_t length, uint64_t offset) override {
+            requests[slot] = Request{fd, data, length, offset, false, 0};
+            auto sqe = io_uring_get_sqe(&ring);
+            io_uring_prep_write(sqe, fd, data, static_cast<unsigned int>(length), offset);
+            io_uring_sqe_set_data(sqe, reinterpret_cast<void *>(slot));
+            auto result = io_uring_submit(&ring);
+            if (result < 0) {
+                requests[slot].done = true;
+                requests[slot].error = -result;
+            }
+        }
+
+        void wait(size_t slot) override {
+            while (!requests[slot].done) {
+                io_uring_cqe *cqe = nullptr;
+                auto result = io_uring_wait_cqe(&ring, &cqe);
+                if (result == -EINTR) {
+                    continue;
+                }
+                if (result < 0) {
+                    throw std::runtime_error("io_uring wait failed: " + errorString(-result));
+                }
+                auto completedSlot = reinterpret_cast<size_t>(io_uring_cqe_get_data(cqe));
+                auto written = cqe->res;
+                io_uring_cqe_seen(&ring, cqe);
+                complete(completedSlot, written);
+            }
+            auto error = requests[slot].error;
+            if (error != 0) {
+                requests[slot].error = 0;
+                throw std::runtime_error("write failed: " + errorString(error));
+            }
+        }
+    };
+#endif
+
+    std::unique_ptr<AsyncWriteBackend> makeBackend(const AsyncWriterOptions &options) {
+        using Backend = AsyncWriterOptions::Backend;
+        switch (options.backend) {
+            case Backend::Synchronous:
+                return std::make_unique<SynchronousWriteBackend>();
+            case Backend::ThreadPool:
+                return std::make_unique<ThreadPoolWriteBackend>(options.poolThreads);
+            case Backend::IoUring:
+#ifdef BLOCKSCI_HAVE_LIBURING
+                return std::make_unique<UringWriteBackend>();
+#else
+                throw std::runtime_error("The parser was built without io_uring support");
+#endif
+            case Backend::Auto:
+#ifdef BLOCKSCI_HAVE_LIBURING
+                try {
+                    return std::make_unique<UringWriteBackend>();
+                } catch (const std::exception &) {
+                    // Kernels without io_uring or sandboxes that block it use the thread pool
+                }
+#endif
+                return std::make_unique<ThreadPoolWriteBackend>(options.poolThreads);
+        }
+        return std::make_unique<SynchronousWriteBackend>();
+    }
+} // namespace
+
+AsyncWriteBackend::~AsyncWriteBackend() = default;
+
+AsyncWriterOptions::Backend AsyncWriterOptions::parseBackend(const std::string &name) {
+    if (name == "auto") {
+        return Backend::Auto;
+    } else if (name == "uring") {
+        return Backend::IoUring;
+    } else if (name == "threads") {
+        return Backend::ThreadPool;
+    } else if (name == "sync") {
+        return Backend::Synchronous;
+    }
+    throw std::runtime_error("Unknown I/O backend " + name + ", expected auto, uring, threads or sync");
+}
+
+AsyncWriterOptions &AsyncFileWriter::defaultOptions() {
+    static AsyncWriterOptions options;
+    return options;
+}
+
+void AsyncFileWriter::BufferDeleter::operator()(char *data) const {
+    free(data);
+}
+
+AsyncFileWriter::AsyncFileWriter(const std::string &path_, const AsyncWriterOptions &options) : path(path_) {
+    fd = open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0666);
+    if (fd < 0) {
+        throw std::runtime_error("Could not open " + path + ": " + errorString(errno));
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        auto error = errno;
+        ::close(fd);
+        throw std::runtime_error("Could not stat " + path + ": " + errorString(error));
+    }
+    position = static_cast<uint64_t>(info.st_size);
+
+    writeFd = fd;
+#ifdef O_DIRECT
+    if (options.directIO) {
+        auto directFd = open(path.c_str(), O_WRONLY | O_DIRECT | O_CLOEXEC);
+        if (directFd >= 0) {
+            writeFd = directFd;
+            alignment = directIOAlignment;
+        }
+    }
+#endif
+
+    capacity = (std::max(options.bufferSize, directIOAlignment) + directIOAlignment - 1) / directIOAlignment * directIOAlignment;
+    for (auto &buffer : buffers) {
+        void *data = nullptr;
+        if (posix_memalign(&data, directIOAlignment, capacity) != 0) {
+            close();
+            throw std::bad_alloc();
+        }
+        buffer.storage.reset(static_cast<char *>(data));
+        buffer.data = buffer.storage.get();
+    }
+
+    // With O_DIRECT the buffer starts at an aligned offset, so the partial block at the end of the file is read into it
+    auto &buffer = buffers[activeBuffer];
+    buffer.fileOffset = position / alignment * alignment;
+    buffer.length = static_cast<size_t>(position - buffer.fileOffset);
+    try {
+        preadAll(fd, buffer.data, buffer.length, buffer.fileOffset);
+        backend = makeBackend(options);
+    } catch (const std::exception &e) {
+        close();
+        throw std::runtime_error("Could not open " + path + ": " + e.what());
+    }
+}
+
+AsyncFileWriter::~AsyncFileWriter() {
+    try {
+        flush();
+    } catch (const std::exception &e) {
+        std::cerr << "Error writing " << path << ": " << e.what() << std::endl;
+    }
+    backend.reset();
+    close();
+}
+
+void AsyncFileWriter::close() {
+    if (writeFd >= 0 && writeFd != fd) {
+        ::close(writeFd);
+    }
+    if (fd >= 0) {
+        ::close(fd);
+    }
+    fd = -1;
+    writeFd = -1;
+}
+
+void AsyncFileWriter::appendSlow(const char *data, size_t length) {
+    while (length > 0) {
+        auto &buffer = buffers[activeBuffer];
+        if (buffer.length == capacity) {
+            submitActive();
+            continue;
+        }
+        auto count = std::min(length, capacity - buffer.length);
+        std::memcpy(buffer.data + buffer.length, data, count);
+        buffer.length += count;
+        position += count;
+        data += count;
+        length -= count;
+    }
+}
+
+void AsyncFileWriter::submitActive() {
+    auto &buffer = buffers[activeBuffer];
+    backend->submit(activeBuffer, writeFd, buffer.data, buffer.length, buffer.fileOffset);
+    buffer.inFlight = true;
+
+    auto nextBuffer = 1 - activeBuffer;
+    waitFor(nextBuffer);
+    auto &next = buffers[nextBuffer];
+    next.fileOffset = buffer.fileOffset + buffer.length;
+    next.length = 0;
+    activeBuffer = nextBuffer;
+}
+
+void AsyncFileWriter::waitFor(size_t index) {
+    auto &buffer = buffers[index];
+    if (buffer.inFlight) {
+        buffer.inFlight = false;
+        try {
+            backend->wait(index);
+        } catch (const std::exception &e) {
+            throw std::runtime_error("Error writing " + path + ": " + e.what());
+        }
+    }
+}
+
+void AsyncFileWriter::drain() {
+    waitFor(0);
+    waitFor(1);
+}
+
+void AsyncFileWriter::flush() {
+    drain();
+    auto &buffer = buffers[activeBuffer];
+    if (buffer.length == 0) {
+        return;
+    }
+    // With O_DIRECT the unaligned tail is written as a whole block, padded with the bytes that follow it in the file, and
+    // stays at the start of the buffer so that the next write rewrites the block and the file is only ever written through
+    // the direct descriptor. The padding past the end of the file is cut off again.
+    auto dataEnd = buffer.fileOffset + buffer.length;
+    auto writeLength = (buffer.length + alignment - 1) / alignment * alignment;
+    struct stat info{};
+    if (writeLength > buffer.length) {
+        if (fstat(fd, &info) != 0) {
+            throw std::runtime_error("Could not stat " + path + ": " + errorString(errno));
+        }
+        try {
+            preadAll(fd, buffer.data + buffer.length, writeLength - buffer.length, dataEnd);
+        } catch (const std::exception &e) {
+            throw std::runtime_error("Error reading " + path + ": " + e.what());
+        }
+    }
+    backend->submit(activeBuffer, writeFd, buffer.data, writeLength, buffer.fileOffset);
+    buffer.inFlight = true;
+    waitFor(activeBuffer);
+    if (writeLength > buffer.length) {
+        auto fileSize = std::max(static_cast<uint64_t>(info.st_size), dataEnd);
+        if (fileSize < buffer.fileOffset + writeLength && ftruncate(fd, static_cast<off_t>(fileSize)) != 0) {
+            throw std::runtime_error("Could not resize " + path + ": " + errorString(errno));
+        }
+    }
+    auto alignedLength = buffer.length / alignment * alignment;
+    auto tailLength = buffer.length - alignedLength;
+    if (tailLength > 0) {
+        std::memmove(buffer.data, buffer.data + alignedLength, tailLength);
+    }
+    buffer.fileOffset += alignedLength;
+    buffer.length = tailLength;
+}
+
+void AsyncFileWriter::sync() {
+    flush();
+    if (fdatasync(fd) != 0) {
+        throw std::runtime_error("Could not sync " + path + ": " + errorString(errno));
+    }
+}
+
+void AsyncFileWriter::read(uint64_t offset, void *out, size_t length) {
+    drain();
+    auto &buffer = buffers[activeBuffer];
+    auto bufferEnd = buffer.fileOffset + buffer.length;
+    auto end = offset + length;
+    auto output = static_cast<char *>(out);
+    if (offset < buffer.fileOffset || end > bufferEnd) {
+        preadAll(fd, output, length, offset);
+    }
+    auto overlapStart = std::max(offset, buffer.fileOffset);
+    auto overlapEnd = std::min(end, bufferEnd);
+    if (overlapStart < overlapEnd) {
+        std::memcpy(output + (overlapStart - offset), buffer.data + (overlapStart - buffer.fileOffset), overlapEnd - overlapStart);
+    }
+}
+
+void AsyncFileWriter::update(uint64_t offset, const void *data, size_t length) {
+    drain();
+    auto &buffer = buffers[activeBuffer];
+    auto bufferEnd = buffer.fileOffset + buffer.length;
+    auto end = offset + length;
+    auto input = static_cast<const char *>(data);
+    if (offset < buffer.fileOffset || end > bufferEnd) {
+        try {
+            pwriteAll(fd, input, length, offset);
+        } catch (const std::exception &e) {
+            throw std::runtime_error("Error writing " + path + ": " + e.what());
+        }
+    }
+    auto overlapStart = std::max(offset, buffer.fileOffset);
+    auto overlapEnd = std::min(end, bufferEnd);
+    if (overlapStart < overlapEnd) {
+        std::memcpy(buffer.data + (overlapStart - buffer.fileOffset), input + (overlapStart - offset), overlapEnd - overlapStart);
+    }
+}
+
+void AsyncFileWriter::expandToFit(uint64_t size) {
+    // An outstanding write past the new size could otherwise be cut off by the truncate
+    drain();
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        throw std::runtime_error("Could not stat " + path + ": " + errorString(errno));
+    }
+    if (static_cast<uint64_t>(info.st_size) < size && ftruncate(fd, static_cast<off_t>(size)) != 0) {
+        throw std::runtime_error("Could not resize " + path + ": " + errorString(errno));
+    }
+}
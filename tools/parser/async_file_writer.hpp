@@ -0,0 +1,138 @@
+//
+//  async_file_writer.hpp
+//  blocksci
+//
+
+#ifndef async_file_writer_hpp
+#define async_file_writer_hpp
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+
+/** Settings shared by all AsyncFileWriters of the parser, set once from the command line */
+struct AsyncWriterOptions {
+    enum class Backend {
+        /** io_uring if it is compiled in and usable on the running kernel, otherwise the thread pool */
+        Auto,
+        IoUring,
+        /** Positioned writes performed by a pool of background threads */
+        ThreadPool,
+        /** Positioned writes performed by the thread that fills the buffers */
+        Synchronous
+    };
+
+    Backend backend = Backend::Auto;
+
+    /** Write all appended data with O_DIRECT, bypassing the page cache. Falls back to buffered writes if the file system
+     * does not support it */
+    bool directIO = false;
+
+    /** Size of each of the two buffers of a writer, rounded up to a multiple of the direct I/O alignment */
+    size_t bufferSize = size_t{8} << 20;
+
+    /** Number of threads of the thread pool backend, whose pool is shared by the writers that are open at the same time */
+    unsigned int poolThreads = 4;
+
+    static Backend parseBackend(const std::string &name);
+};
+
+/** Performs the positioned writes of an AsyncFileWriter, implemented in async_file_writer.cpp */
+class AsyncWriteBackend {
+public:
+    virtual ~AsyncWriteBackend();
+
+    /** Starts writing length bytes of data to fd at offset. The data must stay valid until wait(slot) returns */
+    virtual void submit(size_t slot, int fd, const char *data, size_t length, uint64_t offset) = 0;
+
+    /** Waits until the write submitted for slot has completed, throws if it failed */
+    virtual void wait(size_t slot) = 0;
+};
+
+/** Appends to a file through a pair of aligned buffers so that the thread producing the data only copies into memory
+ *
+ * Once a buffer is full it is handed to the write backend (io_uring or a pool of pwrite threads) and filling continues
+ * in the other buffer, so the disk writes overlap with parsing instead of happening on the parser's critical path.
+ * Reads and updates of data that was written before are supported but drain the outstanding writes first, they are
+ * meant for the rare fix-ups of the parser and not for the hot path.
+ *
+ * flush() hands all buffered data to the operating system, sync() additionally makes it durable and is used at the
+ * parser's checkpoints before the state that refers to the data is saved.
+ */
+class AsyncFileWriter {
+public:
+    /** Opens the file at path for appending, creating it if it does not exist */
+    explicit AsyncFileWriter(const std::string &path, const AsyncWriterOptions &options = defaultOptions());
+    AsyncFileWriter(const AsyncFileWriter &) = delete;
+    AsyncFileWriter &operator=(const AsyncFileWriter &) = delete;
+    ~AsyncFileWriter();
+
+    /** Options used by writers that do not get their own */
+    static AsyncWriterOptions &defaultOptions();
+
+    void append(const void *data, size_t length) {
+        auto &buffer = buffers[activeBuffer];
+        if (length <= capacity - buffer.length) {
+            std::memcpy(buffer.data + buffer.length, data, length);
+            buffer.length += length;
+            position += length;
+        } else {
+            appendSlow(static_cast<const char *>(data), length);
+        }
+    }
+
+    void read(uint64_t offset, void *out, size_t length);
+
+    void update(uint64_t offset, const void *data, size_t length);
+
+    /** Grows the file to at least size bytes without moving the append position */
+    void expandToFit(uint64_t size);
+
+    /** Number of bytes appended to the file so far, including data that is still buffered */
+    uint64_t size() const {
+        return position;
+    }
+
+    /** Writes all buffered data and waits for the writes to complete */
+    void flush();
+
+    /** Flushes and makes the data of the file durable */
+    void sync();
+
+private:
+    struct BufferDeleter {
+        void operator()(char *data) const;
+    };
+
+    struct Buffer {
+        std::unique_ptr<char, BufferDeleter> storage;
+        char *data = nullptr;
+        /** Position of the start of the buffer in the file */
+        uint64_t fileOffset = 0;
+        size_t length = 0;
+        bool inFlight = false;
+    };
+
+    std::string path;
+    /** Descriptor for reads and updates of data that is no longer buffered */
+    int fd = -1;
+    /** Descriptor for writing full buffers, opened with O_DIRECT if requested */
+    int writeFd = -1;
+    /** Alignment of file offsets and lengths of the writes through writeFd */
+    size_t alignment = 1;
+    size_t capacity = 0;
+    uint64_t position = 0;
+    std::array<Buffer, 2> buffers;
+    size_t activeBuffer = 0;
+    std::unique_ptr<AsyncWriteBackend> backend;
+
+    void appendSlow(const char *data, size_t length);
+    void submitActive();
+    void waitFor(size_t index);
+    void drain();
+    void close();
+};
+
+#endif /* async_file_writer_hpp */
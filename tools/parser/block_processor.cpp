@@ -396,10 +396,13 @@ std::vector<std::function<void(RawTransaction &tx)>> SerializeTransactionStep::s
         for (size_t i = 0; i < tx.inputs.size(); i++) {
             auto &input = tx.inputs[i];
             auto &scriptInput = tx.scriptInputs[i];
-            linkDataFile.write({input.getOutputPointer(), tx.txNum});
+            linkDataFile.write({input.getOutputPointer(), tx.txNum, static_cast<uint16_t>(i)});
             auto address = scriptInput.address();
             blocksci::Inout blocksciInput{input.utxo.txNum, address.scriptNum, address.type, input.utxo.value};
             txFile.write(blocksciInput);
+            if (inputColumns) {
+                inputColumns->write(blocksciInput);
+            }
         }
         
         for (size_t i = 0; i < tx.outputs.size(); i++) {
@@ -408,6 +411,12 @@ std::vector<std::function<void(RawTransaction &tx)>> SerializeTransactionStep::s
             auto address = scriptOutput.address();
             blocksci::Inout blocksciOutput{0, address.scriptNum, address.type, output.value};
             txFile.write(blocksciOutput);
+            if (outputColumns) {
+                outputColumns->write(blocksciOutput);
+            }
+            if (outputSpendingInputFile) {
+                outputSpendingInputFile->write(unspentOutputSpendingInputNum);
+            }
         }
     }};
 }
@@ -449,6 +458,10 @@ void backUpdateTxes(const ParserConfigurationBase &config) {
 
     std::cout << "Updating spent outputs" << std::endl;
 
+    if (filesystem::path{config.legacyTxUpdatesFilePath() + ".dat"}.exists()) {
+        throw std::runtime_error("Found pending spent output updates from an older parser version. Finish the update with that version before updating with this one");
+    }
+
     {
         blocksci::FixedSizeFileMapper<OutputLinkData> linkDataFile(config.txUpdatesFilePath());
         updates.reserve(static_cast<size_t>(linkDataFile.size()));
@@ -463,7 +476,15 @@ void backUpdateTxes(const ParserConfigurationBase &config) {
     }
 
     {
-        blocksci::IndexedFileMapper<mio::access_mode::write, blocksci::RawTransaction> txFile(blocksci::ChainAccess::txFilePath(config.dataConfig.chainDirectory()));
+        auto chainDirectory = config.dataConfig.chainDirectory();
+        blocksci::IndexedFileMapper<mio::access_mode::write, blocksci::RawTransaction> txFile(blocksci::ChainAccess::txFilePath(chainDirectory));
+
+        // The optional Inout columns mirror the linkedTxNum of every output and must receive the same updates,
+        // the spending input column records which input of the spending tx spent the output
+        bool updateColumns = blocksci::ChainAccess::inoutColumnsDirectory(chainDirectory).exists();
+        blocksci::FixedSizeFileMapper<uint64_t> txFirstOutputFile(blocksci::ChainAccess::firstOutputFilePath(chainDirectory));
+        blocksci::FixedSizeFileMapper<uint32_t, mio::access_mode::write> outputLinkedTxFile(blocksci::InoutColumnMapper::linkedTxNumFilePath(blocksci::ChainAccess::outputColumnsPrefix(chainDirectory)));
+        blocksci::FixedSizeFileMapper<uint16_t, mio::access_mode::write> outputSpendingInputFile(blocksci::ChainAccess::outputSpendingInputFilePath(chainDirectory));
         auto progressBar = blocksci::makeProgressBar(updates.size(), [=]() {});
 
         uint32_t count = 0;
@@ -473,6 +494,12 @@ void backUpdateTxes(const ParserConfigurationBase &config) {
             // Set the forward-reference to the tx number of the tx that contains the spending input
             output.setLinkedTxNum(update.txNum);
 
+            if (updateColumns) {
+                auto outputNum = *txFirstOutputFile[update.pointer.txNum] + update.pointer.inoutNum;
+                *outputLinkedTxFile[static_cast<blocksci::OffsetType>(outputNum)] = update.txNum;
+                *outputSpendingInputFile[static_cast<blocksci::OffsetType>(outputNum)] = update.inputNum;
+            }
+
             count++;
             progressBar.update(count);
         }
@@ -480,10 +507,96 @@ void backUpdateTxes(const ParserConfigurationBase &config) {
         // Explicitly flush TX file buffer to disk before removing the updates file
         // This ensures TX modifications are persisted even if the parser is interrupted
         txFile.clearBuffer();
+        outputLinkedTxFile.clearBuffer();
+        outputSpendingInputFile.clearBuffer();
     }
     filesystem::path{config.txUpdatesFilePath() + ".dat"}.remove_file();
 }
 
+InoutColumnWriter::InoutColumnWriter(const filesystem::path &pathPrefix) :
+    valueFile(blocksci::InoutColumnMapper::valueFilePath(pathPrefix)),
+    typeFile(blocksci::InoutColumnMapper::typeFilePath(pathPrefix)),
+    addressNumFile(blocksci::InoutColumnMapper::addressNumFilePath(pathPrefix)),
+    linkedTxNumFile(blocksci::InoutColumnMapper::linkedTxNumFilePath(pathPrefix)) {}
+
+namespace {
+    /** Writes chain/columns/output_spending_input.dat from the inputs of the chain data, which must not exist yet */
+    void buildOutputSpendingInputColumn(const blocksci::ChainAccess &chain, const filesystem::path &chainDirectory) {
+        std::cout << "Building spending input column" << std::endl;
+
+        // Every input is visited once and records its position at the output it spends, outputs that are not spent by a
+        // loaded input keep the placeholder
+        auto outputCount = chain.outputCount();
+        {
+            FixedSizeFileWriter<uint16_t> spendingInputFile{blocksci::ChainAccess::outputSpendingInputFilePath(chainDirectory)};
+            for (uint64_t i = 0; i < outputCount; i++) {
+                spendingInputFile.write(unspentOutputSpendingInputNum);
+            }
+        }
+        blocksci::FixedSizeFileMapper<uint16_t, mio::access_mode::write> spendingInputFile{blocksci::ChainAccess::outputSpendingInputFilePath(chainDirectory)};
+        auto txCount = static_cast<uint32_t>(chain.txCount());
+        auto progressBar = blocksci::makeProgressBar(txCount, [=]() {});
+        for (uint32_t txNum = 0; txNum < txCount; txNum++) {
+            auto tx = chain.getTx(txNum);
+            if (tx->inputCount > 0) {
+                auto spentOutputNums = chain.getSpentOutputNumbers(txNum);
+                for (uint16_t i = 0; i < tx->inputCount; i++) {
+                    auto outputNum = chain.firstOutputNum(tx->getInput(i).getLinkedTxNum()) + spentOutputNums[i];
+                    *spendingInputFile[static_cast<blocksci::OffsetType>(outputNum)] = i;
+                }
+            }
+            progressBar.update(txNum);
+        }
+        spendingInputFile.clearBuffer();
+    }
+} // namespace
+
+void buildInoutColumns(const ParserConfigurationBase &config) {
+    auto chainDirectory = config.dataConfig.chainDirectory();
+    blocksci::ChainAccess chain{chainDirectory, config.dataConfig.blocksIgnored, config.dataConfig.errorOnReorg};
+
+    // Always rebuild from scratch so that the columns are aligned with the global input/output numbers
+    auto columnsDirectory = blocksci::ChainAccess::inoutColumnsDirectory(chainDirectory);
+    for (auto &prefix : {blocksci::ChainAccess::inputColumnsPrefix(chainDirectory), blocksci::ChainAccess::outputColumnsPrefix(chainDirectory)}) {
+        for (auto &path : {blocksci::InoutColumnMapper::valueFilePath(prefix), blocksci::InoutColumnMapper::typeFilePath(prefix), blocksci::InoutColumnMapper::addressNumFilePath(prefix), blocksci::InoutColumnMapper::linkedTxNumFilePath(prefix)}) {
+            filesystem::path dataPath{path.str() + ".dat"};
+            if (dataPath.exists()) {
+                dataPath.remove_file();
+            }
+        }
+    }
+    filesystem::path spendingInputPath{blocksci::ChainAccess::outputSpendingInputFilePath(chainDirectory).str() + ".dat"};
+    if (spendingInputPath.exists()) {
+        spendingInputPath.remove_file();
+    }
+    if (!columnsDirectory.exists()) {
+        filesystem::create_directory(columnsDirectory);
+    }
+
+    std::cout << "Building Inout columns" << std::endl;
+
+    InoutColumnWriter inputColumns{blocksci::ChainAccess::inputColumnsPrefix(chainDirectory)};
+    InoutColumnWriter outputColumns{blocksci::ChainAccess::outputColumnsPrefix(chainDirectory)};
+
+    auto txCount = static_cast<uint32_t>(chain.txCount());
+    auto progressBar = blocksci::makeProgressBar(txCount, [=]() {});
+    for (uint32_t txNum = 0; txNum < txCount; txNum++) {
+        auto tx = chain.getTx(txNum);
+        for (auto it = tx->beginInputs(); it != tx->endInputs(); ++it) {
+            inputColumns.write(*it);
+        }
+        for (auto it = tx->beginOutputs(); it != tx->endOutputs(); ++it) {
+            outputColumns.write(*it);
+        }
+        progressBar.update(txNum);
+    }
+
+    inputColumns.flush();
+    outputColumns.flush();
+
+    buildOutputSpendingInputColumn(chain, chainDirectory);
+}
+
 struct CompletionGuard {
     explicit CompletionGuard(std::atomic<bool> &isDone_) : isDone(isDone_) {}
     CompletionGuard(const CompletionGuard &) = delete;
@@ -845,6 +958,24 @@ std::vector<blocksci::RawBlock> BlockProcessor::addNewBlocks(const ParserConfigu
     FixedSizeFileWriter<OutputLinkData> linkDataFile(config.txUpdatesFilePath());
     FixedSizeFileWriter<blocksci::uint256> txHashFile{blocksci::ChainAccess::txHashesFilePath(config.dataConfig.chainDirectory())};
 
+    // The optional Inout columns are only maintained once they have been built with the build-columns command
+    std::unique_ptr<InoutColumnWriter> inputColumns;
+    std::unique_ptr<InoutColumnWriter> outputColumns;
+    std::unique_ptr<FixedSizeFileWriter<uint16_t>> outputSpendingInputFile;
+    if (blocksci::ChainAccess::inoutColumnsDirectory(config.dataConfig.chainDirectory()).exists()) {
+        // Columns built before the spending input column was added get it from the chain data
+        if (!filesystem::path{blocksci::ChainAccess::outputSpendingInputFilePath(config.dataConfig.chainDirectory()).str() + ".dat"}.exists()) {
+            blocksci::ChainAccess chain{config.dataConfig.chainDirectory(), config.dataConfig.blocksIgnored, config.dataConfig.errorOnReorg};
+            buildOutputSpendingInputColumn(chain, config.dataConfig.chainDirectory());
+        }
+        inputColumns = std::make_unique<InoutColumnWriter>(blocksci::ChainAccess::inputColumnsPrefix(config.dataConfig.chainDirectory()));
+        outputColumns = std::make_unique<InoutColumnWriter>(blocksci::ChainAccess::outputColumnsPrefix(config.dataConfig.chainDirectory()));
+        outputSpendingInputFile = std::make_unique<FixedSizeFileWriter<uint16_t>>(blocksci::ChainAccess::outputSpendingInputFilePath(config.dataConfig.chainDirectory()));
+        if (inputColumns->size() != currentInputNum || outputColumns->size() != currentOutputNum || outputSpendingInputFile->size() != currentOutputNum) {
+            throw std::runtime_error("Inout columns are out of sync with the chain data. Rerun the build-columns command to rebuild them");
+        }
+    }
+
     auto discardFunc = [](RawTransaction &) { return false; };
     
     auto progressBar = blocksci::makeProgressBar(totalTxCount, [=](RawTransaction &tx) {
@@ -885,7 +1016,7 @@ std::vector<blocksci::RawBlock> BlockProcessor::addNewBlocks(const ParserConfigu
     processQueue.addStep(makeStandardProcessStep(std::make_unique<RecordAddressesStep>(utxoScriptState), discardFunc, discardFunc));
 
     // 6. Step: Serialize transaction data, inputs, and outputs and write them to the txFile
-    processQueue.addStep(makeStandardProcessStep(std::make_unique<SerializeTransactionStep>(txFile, linkDataFile), discardFunc, discardFunc));
+    processQueue.addStep(makeStandardProcessStep(std::make_unique<SerializeTransactionStep>(txFile, linkDataFile, inputColumns.get(), outputColumns.get(), outputSpendingInputFile.get()), discardFunc, discardFunc));
 
     // 7. Step: Save address data into files for the analysis library
     processQueue.addStep(makeStandardProcessStep(std::make_unique<SerializeAddressesStep>(addressWriter), discardFunc, serializeAddressDiscardFunc, false, true));
@@ -963,14 +1094,19 @@ std::vector<blocksci::RawBlock> BlockProcessor::addNewBlocks(const ParserConfigu
     importer.get();
     processQueue.waitForComplete();
 
-    // Flush all file buffers to ensure data persistence before returning
+    // Make all written data durable before returning
     // This is critical for checkpoint integrity - if the parser is interrupted after this function
     // returns but before state is serialized, the TX data must be on disk
-    txFile.flush();
-    txHashFile.flush();
-    linkDataFile.flush();
+    txFile.sync();
+    txHashFile.sync();
+    linkDataFile.sync();
+    if (inputColumns) {
+        inputColumns->sync();
+        outputColumns->sync();
+        outputSpendingInputFile->sync();
+    }
     if (filesPtr) {
-        filesPtr->flush();
+        filesPtr->sync();
     }
 
     return blocksAdded;
@@ -14,9 +14,13 @@
 #include "parser_configuration.hpp"
 #include "file_writer.hpp"
 
+#include <blocksci/core/inout.hpp>
 #include <blocksci/core/inout_pointer.hpp>
 #include <blocksci/core/core_fwd.hpp>
 
+#include <algorithm>
+#include <limits>
+
 class BlockFileReaderBase {
 public:
     BlockFileReaderBase() = default;
@@ -47,11 +51,59 @@ struct NewBlocksFiles {
         inputSpentOutNumFile.flush();
         inputSequenceFile.flush();
     }
+
+    /** Durability point for all files, @see SimpleFileWriter::sync */
+    void sync() {
+        blockCoinbaseFile.sync();
+        txFirstInput.sync();
+        txFirstOutput.sync();
+        txVersionFile.sync();
+        inputSpentOutNumFile.sync();
+        inputSequenceFile.sync();
+    }
+};
+
+/** Writes the optional columnar mirror of Inout data (chain/columns/), @see blocksci::InoutColumnMapper */
+struct InoutColumnWriter {
+    FixedSizeFileWriter<int64_t> valueFile;
+    FixedSizeFileWriter<uint8_t> typeFile;
+    FixedSizeFileWriter<uint32_t> addressNumFile;
+    FixedSizeFileWriter<uint32_t> linkedTxNumFile;
+
+    explicit InoutColumnWriter(const filesystem::path &pathPrefix);
+
+    void write(const blocksci::Inout &inout) {
+        valueFile.write(inout.getValue());
+        typeFile.write(static_cast<uint8_t>(inout.getType()));
+        addressNumFile.write(inout.getAddressNum());
+        linkedTxNumFile.write(inout.getLinkedTxNum());
+    }
+
+    size_t size() const {
+        return std::min({valueFile.size(), typeFile.size(), addressNumFile.size(), linkedTxNumFile.size()});
+    }
+
+    void flush() {
+        valueFile.flush();
+        typeFile.flush();
+        addressNumFile.flush();
+        linkedTxNumFile.flush();
+    }
+
+    void sync() {
+        valueFile.sync();
+        typeFile.sync();
+        addressNumFile.sync();
+        linkedTxNumFile.sync();
+    }
 };
 
+/** Links a spent output to the input that spends it, applied to the chain data by backUpdateTxes */
 struct OutputLinkData {
     blocksci::InoutPointer pointer;
     uint32_t txNum;
+    /** Position of the spending input within the inputs of tx txNum */
+    uint16_t inputNum;
 };
 
 blocksci::RawBlock readNewBlock(uint32_t firstTxNum, uint64_t firstInputNum, uint64_t firstOutputNum, const BlockInfoBase &block, BlockFileReaderBase &fileReader, NewBlocksFiles &files, const std::function<bool(RawTransaction *&tx)> &loadFunc, const std::function<void(RawTransaction *tx)> &outFunc, bool isSegwit);
@@ -108,8 +160,13 @@ struct RecordAddressesStep : public ProcessorStep {
 struct SerializeTransactionStep : public ProcessorStep {
     IndexedFileWriter<1> &txFile;
     FixedSizeFileWriter<OutputLinkData> &linkDataFile;
+
+    /** Writers for the optional Inout columns, nullptr if the columns are not maintained for this data directory */
+    InoutColumnWriter *inputColumns;
+    InoutColumnWriter *outputColumns;
+    FixedSizeFileWriter<uint16_t> *outputSpendingInputFile;
     
-    SerializeTransactionStep(IndexedFileWriter<1> &txFile_, FixedSizeFileWriter<OutputLinkData> &linkDataFile_) : txFile(txFile_), linkDataFile(linkDataFile_) {}
+    SerializeTransactionStep(IndexedFileWriter<1> &txFile_, FixedSizeFileWriter<OutputLinkData> &linkDataFile_, InoutColumnWriter *inputColumns_ = nullptr, InoutColumnWriter *outputColumns_ = nullptr, FixedSizeFileWriter<uint16_t> *outputSpendingInputFile_ = nullptr) : txFile(txFile_), linkDataFile(linkDataFile_), inputColumns(inputColumns_), outputColumns(outputColumns_), outputSpendingInputFile(outputSpendingInputFile_) {}
     
     std::vector<std::function<void(RawTransaction &tx)>> steps() override;
 };
@@ -124,6 +181,12 @@ struct SerializeAddressesStep : public ProcessorStep {
 
 void backUpdateTxes(const ParserConfigurationBase &config);
 
+/** Placeholder in chain/columns/output_spending_input.dat for outputs that have not been spent yet */
+constexpr uint16_t unspentOutputSpendingInputNum = std::numeric_limits<uint16_t>::max();
+
+/** Build the columnar mirror of the Inout data (chain/columns/) and the spending input column from the existing chain/tx_data.dat file */
+void buildInoutColumns(const ParserConfigurationBase &config);
+
 
 /** BlockProcessor handles parsing blocks and their transactions, inputs, outputs etc. using a processing pipeline */
 class BlockProcessor {
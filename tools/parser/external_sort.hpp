@@ -0,0 +1,157 @@
+//
+//  external_sort.hpp
+//  blocksci
+//
+
+#ifndef external_sort_hpp
+#define external_sort_hpp
+
+#include <internal/batch_lookup.hpp>
+#include <internal/file_mapper.hpp>
+
+#include <wjfilesystem/path.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <mutex>
+#include <queue>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/** Collects fixed size records of one producer thread and spills them to disk as sorted runs
+ *
+ * Every run is a flat array of Records in a file <pathPrefix>_<n>.dat that can be memory mapped as a
+ * blocksci::FixedSizeFileMapper<Record>. Runs of all producers are merged with SortedRuns.
+ */
+template <typename Record, typename Compare>
+class SortedRunWriter {
+    std::string pathPrefix;
+    size_t maxRecords;
+    Compare compare;
+    std::vector<Record> buffer;
+    std::vector<filesystem::path> runPaths;
+
+    void spill() {
+        std::sort(buffer.begin(), buffer.end(), compare);
+        filesystem::path runPath{pathPrefix + "_" + std::to_string(runPaths.size())};
+        auto dataPath = runPath.str() + ".dat";
+        std::ofstream out(dataPath, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char *>(buffer.data()), static_cast<std::streamsize>(buffer.size() * sizeof(Record)));
+        if (!out) {
+            throw std::runtime_error("Error writing sorted run " + dataPath);
+        }
+        runPaths.push_back(runPath);
+        buffer.clear();
+    }
+
+public:
+    SortedRunWriter(std::string pathPrefix_, size_t maxRecords_, Compare compare_ = Compare{}) : pathPrefix(std::move(pathPrefix_)), maxRecords(std::max<size_t>(maxRecords_, 1)), compare(compare_) {
+        buffer.reserve(maxRecords);
+    }
+
+    void add(const Record &record) {
+        buffer.push_back(record);
+        if (buffer.size() == maxRecords) {
+            spill();
+        }
+    }
+
+    /** Spills the remaining records and returns the paths (without .dat) of all runs written by this writer */
+    std::vector<filesystem::path> finish() {
+        if (!buffer.empty()) {
+            spill();
+        }
+        std::vector<Record>{}.swap(buffer);
+        return runPaths;
+    }
+};
+
+/** Sorts the records produced for [0, count) into runs on threadCount threads
+ *
+ * [0, count) is split into one contiguous chunk per thread and produce(begin, end, writer) has to add the records of
+ * a chunk to the given writer. The threads share memoryLimit bytes of run buffers.
+ *
+ * @return the paths of all runs, @see SortedRuns
+ */
+template <typename Record, typename Compare, typename Produce>
+std::vector<filesystem::path> sortInRuns(const filesystem::path &directory, size_t count, unsigned int threadCount, size_t memoryLimit, Produce &&produce) {
+    threadCount = std::max(threadCount, 1u);
+    std::vector<filesystem::path> runPaths;
+    std::mutex runPathsMutex;
+    auto runRecords = memoryLimit / sizeof(Record) / threadCount;
+    blocksci::forEachChunk(count, threadCount, [&](size_t begin, size_t end) {
+        SortedRunWriter<Record, Compare> writer{(directory/("run_" + std::to_string(begin))).str(), runRecords};
+        produce(begin, end, writer);
+        auto chunkRuns = writer.finish();
+        std::lock_guard<std::mutex> lock(runPathsMutex);
+        runPaths.insert(runPaths.end(), chunkRuns.begin(), chunkRuns.end());
+    });
+    return runPaths;
+}
+
+/** Memory mapped sorted runs written by one or more SortedRunWriters */
+template <typename Record>
+class SortedRuns {
+    std::vector<filesystem::path> paths;
+    std::vector<blocksci::FixedSizeFileMapper<Record>> runs;
+
+public:
+    explicit SortedRuns(std::vector<filesystem::path> paths_) : paths(std::move(paths_)) {
+        runs.reserve(paths.size());
+        for (auto &path : paths) {
+            runs.emplace_back(path);
+        }
+    }
+
+    SortedRuns(const SortedRuns &) = delete;
+    SortedRuns &operator=(const SortedRuns &) = delete;
+
+    ~SortedRuns() {
+        runs.clear();
+        for (auto &path : paths) {
+            std::remove((path.str() + ".dat").c_str());
+        }
+    }
+
+    /** Calls func(record) for all records r with partitionOf(r) == partition in sorted order
+     *
+     * partitionOf must be monotone with respect to compare, so that every partition is a contiguous range of every run.
+     * This allows partitions to be merged independently and in parallel.
+     */
+    template <typename Compare, typename PartitionOf, typename Func>
+    void mergePartition(size_t partition, Compare compare, PartitionOf partitionOf, Func &&func) const {
+        struct Cursor {
+            const Record *current;
+            const Record *end;
+        };
+        auto cursorCompare = [&](const Cursor &a, const Cursor &b) {
+            return compare(*b.current, *a.current);
+        };
+        std::priority_queue<Cursor, std::vector<Cursor>, decltype(cursorCompare)> heap(cursorCompare);
+        for (auto &run : runs) {
+            if (run.size() == 0) {
+                continue;
+            }
+            auto begin = run[0];
+            auto end = begin + run.size();
+            auto first = std::partition_point(begin, end, [&](const Record &r) { return partitionOf(r) < partition; });
+            auto last = std::partition_point(first, end, [&](const Record &r) { return partitionOf(r) <= partition; });
+            if (first != last) {
+                heap.push(Cursor{first, last});
+            }
+        }
+        while (!heap.empty()) {
+            auto cursor = heap.top();
+            heap.pop();
+            func(*cursor.current);
+            cursor.current++;
+            if (cursor.current != cursor.end) {
+                heap.push(cursor);
+            }
+        }
+    }
+};
+
+#endif /* external_sort_hpp */
@@ -9,73 +9,54 @@
 #ifndef file_writer_hpp
 #define file_writer_hpp
 
-#include <fstream>
+#include "async_file_writer.hpp"
 
 #include <wjfilesystem/path.h>
 
+/** Appends to a data file of the parser, the writes themselves are performed in the background, @see AsyncFileWriter */
 struct SimpleFileWriter {
 protected:
-    uint64_t lastDataPos;
-    std::fstream file;
+    AsyncFileWriter file;
 public:
     
-    uint64_t getLastPos() const { return lastDataPos; }
-    
-    SimpleFileWriter(filesystem::path path) {
-        auto mainParams = std::fstream::out | std::fstream::binary;
-        auto extraParams = std::fstream::ate | std::fstream::in;
-        path = filesystem::path{path.str() + ".dat"};
-        
-        file.open(path.str(), mainParams | extraParams);
-        if (!file.is_open())
-        {
-            // create
-            file.open(path.str(), mainParams);
-            
-            // close
-            if (file.is_open())
-                file.close();
-            
-            // re-open
-            file.open(path.str(), mainParams | extraParams);
-        }
-        lastDataPos = static_cast<size_t>(file.tellp());
-    }
+    uint64_t getLastPos() const { return file.size(); }
+    
+    SimpleFileWriter(filesystem::path path) : file(path.str() + ".dat") {}
     
     template<typename T, typename = std::enable_if_t<std::is_trivially_copyable<T>::value>>
     void writeImp(const T &t) {
-        file.write(reinterpret_cast<const char *>(&t), sizeof(T));
-        lastDataPos += sizeof(T);
+        file.append(&t, sizeof(T));
     }
     
     template <typename T>
     T read(size_t offset) {
         T ret;
-        file.seekg(static_cast<std::streamoff>(offset));
-        file.read(reinterpret_cast<char *>(&ret), sizeof(T));
-        file.seekg(static_cast<std::streamoff>(lastDataPos));
+        file.read(offset, &ret, sizeof(T));
         return ret;
     }
     
     template<typename K>
     void update(size_t offset, const K &t) {
-        file.seekp(static_cast<std::streamoff>(offset));
-        file.write(reinterpret_cast<const char *>(&t), sizeof(t));
-        file.seekp(static_cast<std::streamoff>(lastDataPos));
+        file.update(offset, &t, sizeof(t));
     }
     
-    void expandToFit(std::streamoff size) {
-        file.seekp(size - 1);
-        file.write("", 1);
+    void expandToFit(uint64_t size) {
+        file.expandToFit(size);
     }
     
     size_t size() const {
-        return lastDataPos;
+        return file.size();
     }
     
+    /** Hands all buffered data to the operating system */
     void flush() {
         file.flush();
     }
+    
+    /** Durability point, returns once all data written so far is on disk */
+    void sync() {
+        file.sync();
+    }
 };
 
 struct ArbitraryFileWriter : SimpleFileWriter {
@@ -128,6 +109,10 @@ public:
     void flush() {
         dataFile.flush();
     }
+    
+    void sync() {
+        dataFile.sync();
+    }
 };
 
 template <size_t indexCount>
@@ -176,6 +161,11 @@ public:
         dataFile.flush();
         indexFile.flush();
     }
+    
+    void sync() {
+        dataFile.sync();
+        indexFile.sync();
+    }
 };
 
 #endif /* file_writer_hpp */
@@ -9,10 +9,15 @@
 #include "hash_index_creator.hpp"
 #include "parser_configuration.hpp"
 #include "raw_address_visitor.hpp"
+#include "sst_file_builder.hpp"
 
 #include <blocksci/core/raw_address.hpp>
 #include <internal/hash.hpp>
 
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
 HashIndexCreator::HashIndexCreator(const ParserConfigurationBase &config_, const filesystem::path &path) : ParserIndex(config_, "hashIndex"), db(path, false) {}
 
 template <bool, blocksci::AddressType::Enum type>
@@ -53,15 +58,18 @@ HashIndexCreator::~HashIndexCreator() {
     });
 }
 
-void HashIndexCreator::processTx(const blocksci::RawTransaction *tx, uint32_t txNum, const blocksci::ChainAccess &chain, const blocksci::ScriptAccess &scripts) {
+/** Passes every tx hash and address identifier of tx that belongs into the hash index to visitor.addTx and
+ * visitor.addAddress<type>, only the address identifiers of addressTypeFilter if it is not empty */
+template <typename Visitor>
+void visitIndexedHashes(const blocksci::RawTransaction *tx, uint32_t txNum, const blocksci::ChainAccess &chain, const blocksci::ScriptAccess &scripts, const std::string &addressTypeFilter, Visitor &visitor) {
     // Helper to check if an address type should be processed based on filter
-    auto shouldProcess = [this](const char *typeName) {
+    auto shouldProcess = [&](const char *typeName) {
         return addressTypeFilter.empty() || addressTypeFilter == typeName;
     };
 
     // Skip TX hash indexing if filtering by address type
     if (addressTypeFilter.empty()) {
-        addTx(*chain.getTxHash(txNum), txNum);
+        visitor.addTx(*chain.getTxHash(txNum), txNum);
     }
 
     bool insideP2SH;
@@ -72,7 +80,7 @@ void HashIndexCreator::processTx(const blocksci::RawTransaction *tx, uint32_t tx
         } else if (a.type == blocksci::AddressType::WITNESS_SCRIPTHASH && insideP2SH) {
             if (shouldProcess("WITNESS_SCRIPTHASH")) {
                 auto script = scripts.getScriptData<blocksci::DedupAddressType::SCRIPTHASH>(a.scriptNum);
-                addAddress<blocksci::AddressType::WITNESS_SCRIPTHASH>(script->hash256, a.scriptNum);
+                visitor.template addAddress<blocksci::AddressType::WITNESS_SCRIPTHASH>(script->hash256, a.scriptNum);
             }
             return false;
         } else {
@@ -95,7 +103,7 @@ void HashIndexCreator::processTx(const blocksci::RawTransaction *tx, uint32_t tx
                 if (shouldProcess("SCRIPTHASH")) {
                     // Add P2SH (3...) addresses to hash index
                     auto script = scripts.getScriptData<blocksci::DedupAddressType::SCRIPTHASH>(addressNum);
-                    addAddress<blocksci::AddressType::SCRIPTHASH>(script->hash160, addressNum);
+                    visitor.template addAddress<blocksci::AddressType::SCRIPTHASH>(script->hash160, addressNum);
                 }
                 break;
             }
@@ -103,7 +111,7 @@ void HashIndexCreator::processTx(const blocksci::RawTransaction *tx, uint32_t tx
                 if (shouldProcess("WITNESS_SCRIPTHASH")) {
                     // Add P2WSH addresses to hash index
                     auto script = scripts.getScriptData<blocksci::DedupAddressType::SCRIPTHASH>(addressNum);
-                    addAddress<blocksci::AddressType::WITNESS_SCRIPTHASH>(script->hash256, addressNum);
+                    visitor.template addAddress<blocksci::AddressType::WITNESS_SCRIPTHASH>(script->hash256, addressNum);
                 }
                 break;
             }
@@ -121,7 +129,7 @@ void HashIndexCreator::processTx(const blocksci::RawTransaction *tx, uint32_t tx
                         // Otherwise use the stored address (which is already the hash)
                         pubkeyHash = script->address;
                     }
-                    addAddress<blocksci::AddressType::PUBKEYHASH>(pubkeyHash, addressNum);
+                    visitor.template addAddress<blocksci::AddressType::PUBKEYHASH>(pubkeyHash, addressNum);
                 }
                 break;
             }
@@ -139,7 +147,7 @@ void HashIndexCreator::processTx(const blocksci::RawTransaction *tx, uint32_t tx
                         // Otherwise use the stored address (which is already the hash)
                         pubkeyHash = script->address;
                     }
-                    addAddress<blocksci::AddressType::WITNESS_PUBKEYHASH>(pubkeyHash, addressNum);
+                    visitor.template addAddress<blocksci::AddressType::WITNESS_PUBKEYHASH>(pubkeyHash, addressNum);
                 }
                 break;
             }
@@ -152,7 +160,7 @@ void HashIndexCreator::processTx(const blocksci::RawTransaction *tx, uint32_t tx
                     if (script->witnessVersion == 1 && script->scriptData.size() == 32) {
                         blocksci::uint256 witnessProgram;
                         memcpy(witnessProgram.begin(), script->scriptData.begin(), 32);
-                        addAddress<blocksci::AddressType::WITNESS_UNKNOWN>(witnessProgram, addressNum);
+                        visitor.template addAddress<blocksci::AddressType::WITNESS_UNKNOWN>(witnessProgram, addressNum);
                     }
                 }
                 break;
@@ -163,6 +171,10 @@ void HashIndexCreator::processTx(const blocksci::RawTransaction *tx, uint32_t tx
     }
 }
 
+void HashIndexCreator::processTx(const blocksci::RawTransaction *tx, uint32_t txNum, const blocksci::ChainAccess &chain, const blocksci::ScriptAccess &scripts) {
+    visitIndexedHashes(tx, txNum, chain, scripts, addressTypeFilter, *this);
+}
+
 void HashIndexCreator::addTx(const blocksci::uint256 &hash, uint32_t txNum) {
     txCache.insert(hash, txNum);
     if (txCache.isFull()) {
@@ -188,3 +200,129 @@ void HashIndexCreator::clearTxCache() {
     txCache.clear();
     db.addTxes(std::move(rows));
 }
+
+namespace {
+    /** Row of a bulk hash index build
+     *
+     * column is the AddressType of an address identifier or bulkTxColumn for a tx hash. Identifiers shorter than
+     * 32 bytes are padded with zeros, which keeps them in the bytewise order that RocksDB uses for the unpadded keys.
+     */
+    struct BulkHashIndexRow {
+        uint32_t value;
+        uint8_t column;
+        blocksci::uint256 key;
+    };
+
+    constexpr uint8_t bulkTxColumn = blocksci::AddressType::size;
+
+    struct BulkHashIndexRowCompare {
+        bool operator()(const BulkHashIndexRow &a, const BulkHashIndexRow &b) const {
+            if (a.column != b.column) {
+                return a.column < b.column;
+            }
+            auto cmp = std::memcmp(a.key.begin(), b.key.begin(), sizeof(a.key));
+            return cmp < 0 || (cmp == 0 && a.value < b.value);
+        }
+    };
+
+    using BulkHashIndexRunWriter = SortedRunWriter<BulkHashIndexRow, BulkHashIndexRowCompare>;
+
+    /** Receives the rows of the transactions of one shard from visitIndexedHashes */
+    struct BulkHashIndexShard {
+        BulkHashIndexRunWriter &rows;
+
+        void addTx(const blocksci::uint256 &hash, uint32_t txNum) {
+            rows.add(BulkHashIndexRow{txNum, bulkTxColumn, hash});
+        }
+
+        template<blocksci::AddressType::Enum type>
+        void addAddress(const typename blocksci::AddressInfo<type>::IDType &hash, uint32_t scriptNum) {
+            static_assert(sizeof(hash) <= sizeof(blocksci::uint256), "Identifier does not fit into a bulk hash index row");
+            BulkHashIndexRow row{scriptNum, static_cast<uint8_t>(type), blocksci::uint256{}};
+            std::memcpy(row.key.begin(), &hash, sizeof(hash));
+            rows.add(row);
+        }
+    };
+
+    /** Memory used for the sorted runs of all shards together */
+    constexpr size_t bulkRunMemory = size_t{4} << 30;
+
+    /** Targeted number of tx hashes per SST file */
+    constexpr uint64_t bulkRowsPerFile = uint64_t{1} << 22;
+} // namespace
+
+void HashIndexCreator::runBulkUpdate(const blocksci::State &state, unsigned int threadCount) {
+    blocksci::ChainAccess chain{config.dataConfig.chainDirectory(), config.dataConfig.blocksIgnored, config.dataConfig.errorOnReorg};
+    blocksci::ScriptAccess scripts{config.dataConfig.scriptsDirectory()};
+
+    // Rows still cached by the incremental path must not be written after the ingested files
+    clearTxCache();
+    for_each(blocksci::AddressType::all{}, [&](auto tag) {
+        ClearerFunctor<!std::is_same<typename blocksci::AddressInfo<tag.value>::IDType, void>::value, tag.value>{std::get<HashIndexAddressCache<tag.value>>(addressCache), db}();
+    });
+
+    threadCount = std::max(threadCount, 1u);
+    auto firstTxNum = latestState.txCount;
+    if (firstTxNum < state.txCount) {
+        auto newCount = state.txCount - firstTxNum;
+        auto workDirectory = config.parserDirectory()/"hashIndexBulk";
+        if (!workDirectory.exists()) {
+            filesystem::create_directory(workDirectory);
+        }
+
+        std::cout << "Bulk loading hash index with " << newCount << " txes on " << threadCount << " threads\n";
+
+        // Phase 1: every shard sorts the rows of a contiguous range of transactions into runs
+        auto runPaths = sortInRuns<BulkHashIndexRow, BulkHashIndexRowCompare>(workDirectory, newCount, threadCount, bulkRunMemory, [&](size_t begin, size_t end, BulkHashIndexRunWriter &writer) {
+            BulkHashIndexShard shard{writer};
+            for (auto i = begin; i < end; i++) {
+                auto txNum = static_cast<uint32_t>(firstTxNum + i);
+                visitIndexedHashes(chain.getTx(txNum), txNum, chain, scripts, std::string{}, shard);
+            }
+        });
+
+        // Phase 2: every partition, a range of keys of one column, is merged from all runs into its own SST file.
+        // Partitions are split by the leading key bits, so the files of a column cover disjoint key ranges.
+        auto partitionBits = partitionBitsFor(newCount, bulkRowsPerFile);
+        auto partitionsPerColumn = size_t{1} << partitionBits;
+        auto partitionOf = [&](const BulkHashIndexRow &row) {
+            return (static_cast<size_t>(row.column) << partitionBits) | leadingKeyBits(row.key.begin(), partitionBits);
+        };
+        std::vector<std::string> sstPaths;
+        {
+            SortedRuns<BulkHashIndexRow> runs{std::move(runPaths)};
+            std::cout << "Writing hash index files\n";
+            auto partitionCount = (static_cast<size_t>(bulkTxColumn) + 1) * partitionsPerColumn;
+            sstPaths = writeSstPartitions(runs, partitionCount, threadCount, workDirectory, blocksci::HashIndex::sstFileOptions(), BulkHashIndexRowCompare{}, partitionOf, [](const BulkHashIndexRow &row, SstPartitionWriter &writer) {
+                auto keySize = row.column == bulkTxColumn ? sizeof(row.key) : blocksci::HashIndex::addressKeySize(static_cast<blocksci::AddressType::Enum>(row.column));
+                writer.add(rocksdb::Slice{reinterpret_cast<const char *>(row.key.begin()), keySize}, rocksdb::Slice{reinterpret_cast<const char *>(&row.value), sizeof(row.value)});
+            });
+        }
+
+        std::cout << "Ingesting hash index files\n";
+        for (size_t column = 0; column <= bulkTxColumn; column++) {
+            std::vector<std::string> columnPaths;
+            for (size_t partition = column * partitionsPerColumn; partition < (column + 1) * partitionsPerColumn; partition++) {
+                if (!sstPaths[partition].empty()) {
+                    columnPaths.push_back(sstPaths[partition]);
+                }
+            }
+            if (column == bulkTxColumn) {
+                db.ingestTxFiles(columnPaths);
+            } else {
+                db.ingestAddressFiles(static_cast<blocksci::AddressType::Enum>(column), columnPaths);
+            }
+        }
+
+        for (auto &path : sstPaths) {
+            if (!path.empty()) {
+                std::remove(path.c_str());
+            }
+        }
+        std::remove(workDirectory.str().c_str());
+    }
+
+    ParserScriptUpdater<HashIndexCreator> updater(*this, state, scripts);
+    blocksci::for_each(blocksci::DedupAddressType::all(), updater);
+    latestState = state;
+}
@@ -162,6 +162,23 @@ public:
     ~HashIndexCreator();
     
     void processTx(const blocksci::RawTransaction *tx, uint32_t txNum, const blocksci::ChainAccess &chain, const blocksci::ScriptAccess &scripts);
+
+    /** Updates with at least this many new transactions are done with runBulkUpdate instead of runUpdate */
+    static constexpr uint32_t bulkLoadMinTxCount = 1 << 24;
+
+    /** Number of transactions that have already been added to the index */
+    uint32_t indexedTxCount() const {
+        return latestState.txCount;
+    }
+
+    /** Indexes the same transactions as runUpdate, but without going through the RocksDB write path
+     *
+     * The new transactions are split into threadCount shards whose rows are sorted in memory-sized runs in parallel.
+     * The runs are merged into one SST file per column and key range with rocksdb::SstFileWriter, again in parallel,
+     * and the files are ingested into the database with IngestExternalFile. As the files of a column do not overlap,
+     * they are placed directly into the LSM tree without passing through the memtables or triggering compactions.
+     */
+    void runBulkUpdate(const blocksci::State &state, unsigned int threadCount);
     
     template<blocksci::DedupAddressType::Enum type>
     void processScript(uint32_t equivNum, const blocksci::ScriptAccess &);
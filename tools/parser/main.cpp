@@ -23,8 +23,16 @@
 #include "doctor.hpp"
 #include "file_writer.hpp"
 
+#include <internal/address_output_index.hpp>
+#include <internal/balance_history_index.hpp>
 #include <internal/bitcoin_uint256_hex.hpp>
+#include <internal/compressed_file.hpp>
 #include <internal/data_configuration.hpp>
+#include <internal/offset_index.hpp>
+#include <internal/script_access.hpp>
+#include <internal/taproot_index.hpp>
+#include <internal/tx_hash_index.hpp>
+#include <internal/warmup.hpp>
 
 #ifdef BLOCKSCI_RPC_PARSER
 #include <bitcoinapi/bitcoinapi.h>
@@ -40,12 +48,16 @@
 #include <cstdio>
 
 #include <sys/resource.h>
+#include <unistd.h>
 
+#include <algorithm>
+#include <chrono>
 #include <fstream>
 #include <future>
 #include <iostream>
 #include <iomanip>
 #include <cassert>
+#include <thread>
 
 using json = nlohmann::json;
 
@@ -262,7 +274,7 @@ void updateChain(const ParserConfiguration<ParserTag> &config, blocksci::BlockHe
         for (auto &block : blocks) {
             blockFile.write(block);
         }
-        blockFile.flush();
+        blockFile.sync();
 
         // This step represents the "Back linking transactions" step of the parser output messages.
         // backUpdateTxes modifies TX files and flushes them internally
@@ -300,7 +312,8 @@ void updateChain(const ParserConfiguration<ParserTag> &config, blocksci::BlockHe
     }
 }
 
-void updateHashDB(const ParserConfigurationBase &config, HashIndexCreator &db, uint32_t maxTxCount = 0, const std::string &addressTypeFilter = "") {
+/** Brings the hash index up to date, large updates of all address types are bulk loaded, @see HashIndexCreator::runBulkUpdate */
+void updateHashDB(const ParserConfigurationBase &config, HashIndexCreator &db, uint32_t maxTxCount = 0, const std::string &addressTypeFilter = "", bool forceBulkLoad = false, unsigned int threadCount = 0) {
     blocksci::ChainAccess chain{config.dataConfig.chainDirectory(), config.dataConfig.blocksIgnored, config.dataConfig.errorOnReorg};
     blocksci::ScriptAccess scripts{config.dataConfig.scriptsDirectory()};
 
@@ -313,10 +326,16 @@ void updateHashDB(const ParserConfigurationBase &config, HashIndexCreator &db, u
         db.setAddressTypeFilter(addressTypeFilter);
     }
 
-    db.runUpdate(updateState, maxTxCount);
+    auto newTxCount = updateState.txCount > db.indexedTxCount() ? updateState.txCount - db.indexedTxCount() : 0;
+    if (addressTypeFilter.empty() && maxTxCount == 0 && newTxCount > 0 && (forceBulkLoad || newTxCount >= HashIndexCreator::bulkLoadMinTxCount)) {
+        db.runBulkUpdate(updateState, threadCount > 0 ? threadCount : std::thread::hardware_concurrency());
+    } else {
+        db.runUpdate(updateState, maxTxCount);
+    }
 }
 
-void updateAddressDB(const ParserConfigurationBase &config) {
+/** Brings the address index up to date, large updates are bulk loaded, @see AddressDB::runBulkUpdate */
+void updateAddressDB(const ParserConfigurationBase &config, bool forceBulkLoad = false, unsigned int threadCount = 0) {
     blocksci::ChainAccess chain{config.dataConfig.chainDirectory(), config.dataConfig.blocksIgnored, config.dataConfig.errorOnReorg};
     blocksci::ScriptAccess scripts{config.dataConfig.scriptsDirectory()};
     
@@ -325,7 +344,189 @@ void updateAddressDB(const ParserConfigurationBase &config) {
     
     std::cout << "Updating address index\n";
     
-    db.runUpdate(updateState);
+    db.completeInputIndex();
+    auto newTxCount = updateState.txCount > db.indexedTxCount() ? updateState.txCount - db.indexedTxCount() : 0;
+    if (newTxCount > 0 && (forceBulkLoad || newTxCount >= AddressDB::bulkLoadMinTxCount)) {
+        db.runBulkUpdate(updateState, threadCount > 0 ? threadCount : std::thread::hardware_concurrency());
+    } else {
+        db.runUpdate(updateState);
+    }
+}
+
+/** Data files that may be compressed, including any additional files listed in the storage configuration */
+std::vector<std::string> candidateCompressedFiles(const blocksci::DataConfiguration &dataConfig) {
+    auto files = blocksci::compressibleDataFiles();
+    for (auto &file : dataConfig.storage.compressedFiles) {
+        if (std::find(files.begin(), files.end(), file) == files.end()) {
+            files.push_back(file);
+        }
+    }
+    return files;
+}
+
+/** Extends the compact offset index of chain/tx_index.dat if it does not cover all transactions, @see blocksci::updateOffsetIndex */
+void updateTxOffsetIndex(const ParserConfigurationBase &config) {
+    auto txFilePath = blocksci::ChainAccess::txFilePath(config.dataConfig.chainDirectory());
+    {
+        blocksci::IndexedFileMapper<mio::access_mode::read, blocksci::RawTransaction> txFile(txFilePath);
+        if (txFile.size() == 0 || txFile.offsetIndexSize() == txFile.size()) {
+            return;
+        }
+    }
+    std::cout << "Updating compact transaction offset index" << std::endl;
+    auto addedCount = blocksci::updateOffsetIndex(txFilePath.str() + "_index");
+    std::cout << "Indexed offsets of " << addedCount << " transactions" << std::endl;
+}
+
+/** Brings the memory mapped tx hash index up to date with chain/tx_hashes.dat, @see blocksci::TxHashIndex */
+void updateTxHashIndex(const ParserConfigurationBase &config, unsigned int threadCount = 0) {
+    std::cout << "Updating tx hash index" << std::endl;
+    auto addedCount = blocksci::updateTxHashIndex(config.dataConfig.txHashIndexFilePath(), config.dataConfig.chainDirectory(), threadCount > 0 ? threadCount : std::thread::hardware_concurrency());
+    std::cout << "Added " << addedCount << " transactions to the tx hash index" << std::endl;
+}
+
+/** Brings the memory mapped taproot index up to date with the WITNESS_UNKNOWN scripts, @see blocksci::TaprootIndex */
+void updateTaprootIndex(const ParserConfigurationBase &config) {
+    blocksci::ScriptAccess scripts{config.dataConfig.scriptsDirectory()};
+    std::cout << "Updating taproot index" << std::endl;
+    auto addedCount = blocksci::updateTaprootIndex(config.dataConfig.taprootIndexFilePath(), scripts);
+    std::cout << "Added " << addedCount << " scripts to the taproot index" << std::endl;
+}
+
+/** Brings the memory mapped address to outputs index up to date with the chain, @see blocksci::AddressOutputIndex */
+void updateAddressOutputIndex(const ParserConfigurationBase &config) {
+    blocksci::ChainAccess chain{config.dataConfig.chainDirectory(), config.dataConfig.blocksIgnored, config.dataConfig.errorOnReorg};
+    std::cout << "Updating address output index" << std::endl;
+    auto addedCount = blocksci::updateAddressOutputIndex(config.dataConfig.addressOutputIndexDirectory(), chain);
+    std::cout << "Added " << addedCount << " transactions to the address output index" << std::endl;
+}
+
+/** Brings the memory mapped balance history index up to date with the chain, @see blocksci::BalanceHistoryIndex */
+void updateBalanceHistoryIndex(const ParserConfigurationBase &config, unsigned int threadCount = 0) {
+    blocksci::ChainAccess chain{config.dataConfig.chainDirectory(), config.dataConfig.blocksIgnored, config.dataConfig.errorOnReorg};
+    std::cout << "Updating balance history index" << std::endl;
+    auto addedCount = blocksci::updateBalanceHistoryIndex(config.dataConfig.balanceHistoryIndexDirectory(), chain, threadCount > 0 ? threadCount : std::thread::hardware_concurrency());
+    std::cout << "Added " << addedCount << " transactions to the balance history index" << std::endl;
+}
+
+/** Brings chain/tx_height.dat up to date with the block file. Entries that no longer match their block, eg. after blocks
+ *  were replaced by a reorg, are dropped before entries for the new transactions are appended.
+ */
+void updateTxHeightDirectory(const ParserConfigurationBase &config) {
+    using blocksci::ChainAccess;
+    auto chainDirectory = config.dataConfig.chainDirectory();
+    blocksci::FixedSizeFileMapper<blocksci::RawBlock> blockFile(ChainAccess::blockFilePath(chainDirectory));
+    blocksci::FixedSizeFileMapper<uint32_t, mio::access_mode::write> directory(ChainAccess::txHeightDirectoryFilePath(chainDirectory));
+
+    auto blockCount = blockFile.size();
+    auto entryMatches = [&](blocksci::OffsetType entry) {
+        auto height = static_cast<blocksci::OffsetType>(*directory[entry]);
+        return height < blockCount && ChainAccess::blockContainsTx(*blockFile[height], static_cast<uint64_t>(entry) << ChainAccess::txHeightDirectoryShift);
+    };
+    auto validEntries = directory.size();
+    while (validEntries > 0 && !entryMatches(validEntries - 1)) {
+        validEntries--;
+    }
+    if (validEntries < directory.size()) {
+        directory.truncate(validEntries);
+    }
+    directory.seekEnd();
+
+    uint64_t txCount = 0;
+    if (blockCount > 0) {
+        auto lastBlock = blockFile[blockCount - 1];
+        txCount = static_cast<uint64_t>(lastBlock->firstTxIndex) + lastBlock->txCount;
+    }
+    uint32_t height = validEntries > 0 ? *directory[validEntries - 1] : 0;
+    for (auto entry = static_cast<uint64_t>(validEntries); (entry << ChainAccess::txHeightDirectoryShift) < txCount; entry++) {
+        auto txNum = entry << ChainAccess::txHeightDirectoryShift;
+        while (!ChainAccess::blockContainsTx(*blockFile[height], txNum)) {
+            height++;
+        }
+        directory.write(height);
+    }
+}
+
+/** The parser appends to chain and script files in place, which is not possible for compressed files */
+void checkNoCompressedFiles(const blocksci::DataConfiguration &dataConfig) {
+    for (auto &file : candidateCompressedFiles(dataConfig)) {
+        if (blocksci::compressedFilePath(dataConfig.chainConfig.dataDirectory/file).exists()) {
+            throw std::runtime_error("Data file " + file + " is compressed. Run compress-files --decompress before updating the chain and compress the files again afterwards");
+        }
+    }
+}
+
+/** Converts the data directory to match the storage configuration: files listed in compressedFiles are compressed and
+ *  all other compressed files are decompressed. If decompressAll is set, every compressed file is decompressed.
+ */
+void compressDataFiles(const ParserConfigurationBase &config, bool decompressAll) {
+    auto &storage = config.dataConfig.storage;
+    auto &listed = storage.compressedFiles;
+    for (auto &file : candidateCompressedFiles(config.dataConfig)) {
+        auto pathPrefix = config.dataConfig.chainConfig.dataDirectory/file;
+        filesystem::path plainPath{pathPrefix.str() + ".dat"};
+        auto compressedPath = blocksci::compressedFilePath(pathPrefix);
+        bool compress = !decompressAll && std::find(listed.begin(), listed.end(), file) != listed.end();
+        if (compress && plainPath.exists()) {
+            std::cout << "Compressing " << file << std::flush;
+            filesystem::path tempPath{compressedPath.str() + ".tmp"};
+            blocksci::compressFile(plainPath, tempPath, storage.chunkSize);
+            if (std::rename(tempPath.str().c_str(), compressedPath.str().c_str()) != 0) {
+                throw std::runtime_error("Failed to save compressed file " + compressedPath.str());
+            }
+            std::cout << ": " << plainPath.file_size() << " -> " << compressedPath.file_size() << " bytes" << std::endl;
+            plainPath.remove_file();
+        } else if (!compress && compressedPath.exists() && !plainPath.exists()) {
+            std::cout << "Decompressing " << file << std::endl;
+            filesystem::path tempPath{plainPath.str() + ".tmp"};
+            blocksci::decompressFile(compressedPath, tempPath);
+            if (std::rename(tempPath.str().c_str(), plainPath.str().c_str()) != 0) {
+                throw std::runtime_error("Failed to save decompressed file " + plainPath.str());
+            }
+            compressedPath.remove_file();
+        }
+    }
+}
+
+/** Reads the selected data files into the page cache and prints throughput and residency per file.
+ *  If markerName is not empty, a marker file of that name is then created in the data directory.
+ *  Locked files stay in memory until the process is interrupted.
+ */
+void warmupDataDirectory(const ParserConfigurationBase &config, const blocksci::WarmupSpec &spec, const std::string &markerName) {
+    blocksci::LockedMappings lockedFiles;
+    auto start = std::chrono::steady_clock::now();
+    auto results = blocksci::warmupDataFiles(config.dataConfig, spec, lockedFiles);
+    double totalSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    uint64_t totalSize = 0;
+    std::cout << std::left << std::setw(70) << "File" << std::right << std::setw(12) << "MiB" << std::setw(12) << "MiB/s" << std::setw(12) << "Resident" << std::setw(8) << "Locked" << std::endl;
+    for (auto &result : results) {
+        totalSize += result.size;
+        std::cout << std::left << std::setw(70) << result.path << std::right << std::fixed << std::setprecision(1)
+        << std::setw(12) << static_cast<double>(result.size) / (1024 * 1024)
+        << std::setw(12) << result.throughput()
+        << std::setw(11) << result.residentFraction * 100 << "%"
+        << std::setw(8) << (result.locked ? "yes" : "no") << std::endl;
+        if (!result.error.empty()) {
+            std::cerr << "Failed to warm up " << result.path << " after " << result.bytesRead << " bytes: " << result.error << std::endl;
+        }
+    }
+    std::cout << "Read " << results.size() << " files (" << static_cast<double>(totalSize) / (1024 * 1024 * 1024) << " GiB) in " << totalSeconds << " seconds" << std::endl;
+
+    if (!markerName.empty()) {
+        auto markerPath = config.dataConfig.chainConfig.dataDirectory/markerName;
+        std::ofstream marker(markerPath.str(), std::ios::trunc);
+        if (!marker) {
+            throw std::runtime_error("Could not create marker file " + markerPath.str());
+        }
+    }
+
+    if (!lockedFiles.empty()) {
+        std::cout << "Holding " << lockedFiles.size() << " locked files in memory, interrupt to release them" << std::endl;
+        while (true) {
+            pause();
+        }
+    }
 }
 
 ParserConfigurationBase getBaseConfig(const filesystem::path &configPath) {
@@ -341,6 +542,10 @@ void updateChain(const filesystem::path &configFilePath, bool fullParse) {
 
     blocksci::ChainConfiguration chainConfig = jsonConf.at("chainConfig");
     blocksci::DataConfiguration dataConfig{configFilePath.str(), chainConfig, true, 0};
+    if (jsonConf.find("storage") != jsonConf.end()) {
+        dataConfig.storage = jsonConf.at("storage");
+    }
+    checkNoCompressedFiles(dataConfig);
 
     ParserConfigurationBase config{dataConfig};
     HashIndexCreator hashDb(config, config.dataConfig.hashIndexFilePath());
@@ -360,10 +565,16 @@ void updateChain(const filesystem::path &configFilePath, bool fullParse) {
     } else {
         throw std::runtime_error("Must provide either rpc or disk parsing settings");
     }
+    updateTxHeightDirectory(config);
+    updateTxOffsetIndex(config);
 
     if (fullParse) {
         updateHashDB(config, hashDb);
+        updateTxHashIndex(config);
+        updateTaprootIndex(config);
         updateAddressDB(config);
+        updateAddressOutputIndex(config);
+        updateBalanceHistoryIndex(config);
     }
 }
 
@@ -376,7 +587,7 @@ int main(int argc, char * argv[]) {
     //    --data-directory /Users/hkalodner/bitcoin-samp
     //    --coin-directory /Users/hkalodner/Library/Application\ Support/Bitcoin
     
-    enum class mode {generateConfig, update, updateCore, updateIndexes, updateHashIndex, updateAddressIndex, compactIndexes, help, doctor};
+    enum class mode {generateConfig, update, updateCore, updateIndexes, updateHashIndex, updateAddressIndex, compactIndexes, buildColumns, compressFiles, warmup, help, doctor};
     mode selected = mode::help;
     
     bool enableRPC = false;
@@ -434,24 +645,63 @@ int main(int argc, char * argv[]) {
     ) % "Configuration options";
     
     auto generateConfigCommand = clipp::command("generate-config").set(selected,mode::generateConfig) % "Create new BlockSci configuration";
-    auto updateCommand = clipp::command("update").set(selected,mode::update) % "Update all BlockSci data";
-    auto updateCoreCommand = clipp::command("core-update").set(selected,mode::updateCore) % "Update just the core BlockSci data (excluding indexes)";
+    auto &writerOptions = AsyncFileWriter::defaultOptions();
+    std::string ioBackendName = "auto";
+    size_t ioBufferMB = writerOptions.bufferSize >> 20;
+    auto ioOptions = (
+        (clipp::option("--io-backend") & clipp::value("backend", ioBackendName)) % "How the chain files are written in the background: auto (io_uring if available), uring, threads or sync",
+        clipp::option("--direct-io").set(writerOptions.directIO) % "Write the chain files with O_DIRECT, bypassing the page cache",
+        (clipp::option("--io-buffer-mb") & clipp::value("size", ioBufferMB)) % "Size in MiB of each of the two write buffers per file (default: 8)",
+        (clipp::option("--io-threads") & clipp::value("thread count", writerOptions.poolThreads)) % "Number of writer threads of the threads backend (default: 4)"
+    );
+    auto updateCommand = (clipp::command("update").set(selected,mode::update) % "Update all BlockSci data", ioOptions);
+    auto updateCoreCommand = (clipp::command("core-update").set(selected,mode::updateCore) % "Update just the core BlockSci data (excluding indexes)", ioOptions);
     auto indexUpdateCommand = clipp::command("index-update").set(selected,mode::updateIndexes) % "Update indexes to latest chain state";
-    auto addressIndexUpdateCommand = clipp::command("address-index-update").set(selected,mode::updateAddressIndex) % "Update address index to latest state";
+    bool addressIndexBulk = false;
+    unsigned int addressIndexThreads = 0;
+    auto addressIndexUpdateCommand = (
+        clipp::command("address-index-update").set(selected,mode::updateAddressIndex) % "Update address index to latest state",
+        clipp::option("--bulk").set(addressIndexBulk) % "Build SST files in parallel and ingest them, the default for large updates",
+        (clipp::option("--threads") & clipp::value("thread count", addressIndexThreads)) % "Number of threads of a bulk load (default: one per hardware thread)"
+    );
     uint32_t hashIndexMaxTx = 0;
     std::string hashIndexAddressType;
+    bool hashIndexBulk = false;
+    unsigned int hashIndexThreads = 0;
     auto hashIndexUpdateCommand = (
         clipp::command("hash-index-update").set(selected,mode::updateHashIndex) % "Update hash index to latest state",
         (clipp::option("--max-tx") & clipp::value("max tx count", hashIndexMaxTx)) % "Limit number of transactions to process (for testing)",
-        (clipp::option("--address-type") & clipp::value("type", hashIndexAddressType)) % "Only process specific address type (e.g., WITNESS_PUBKEYHASH, PUBKEYHASH)"
+        (clipp::option("--address-type") & clipp::value("type", hashIndexAddressType)) % "Only process specific address type (e.g., WITNESS_PUBKEYHASH, PUBKEYHASH)",
+        clipp::option("--bulk").set(hashIndexBulk) % "Build SST files in parallel and ingest them, the default for large updates",
+        (clipp::option("--threads") & clipp::value("thread count", hashIndexThreads)) % "Number of threads of a bulk load (default: one per hardware thread)"
     );
     auto compactIndexesCommand = clipp::command("compact-indexes").set(selected, mode::compactIndexes) % "Compact indexes to speed up blockchain construction";
+    auto buildColumnsCommand = clipp::command("build-columns").set(selected, mode::buildColumns) % "Build the columnar mirror of input and output data (chain/columns/) which the parser then keeps up to date";
+    bool decompressAll = false;
+    auto compressFilesCommand = (
+        clipp::command("compress-files").set(selected, mode::compressFiles) % "Compress or decompress data files to match the \"storage\" section of the config file",
+        clipp::option("--decompress").set(decompressAll) % "Decompress all compressed data files"
+    );
+    blocksci::WarmupSpec warmupSpec;
+    bool warmupSkipChain = false;
+    bool warmupSkipScripts = false;
+    std::string warmupMarker;
+    auto warmupCommand = (
+        clipp::command("warmup").set(selected, mode::warmup) % "Read data files into the page cache using parallel reads and report throughput and residency per file",
+        clipp::option("--skip-chain").set(warmupSkipChain) % "Do not warm up chain/",
+        clipp::option("--skip-scripts").set(warmupSkipScripts) % "Do not warm up scripts/",
+        clipp::option("--indexes").set(warmupSpec.indexes) % "Also warm up the hash and address indexes",
+        (clipp::option("--path") & clipp::values("paths", warmupSpec.extraPaths)) % "Additional files or directories to warm up, eg. a cluster directory",
+        (clipp::option("--lock") & clipp::values("paths", warmupSpec.lockedPaths)) % "Files or directories to lock in memory, held until the command is interrupted",
+        (clipp::option("--threads") & clipp::value("thread count", warmupSpec.threadCount)) % "Number of reader threads (default: one per hardware thread)",
+        (clipp::option("--marker") & clipp::value("file name", warmupMarker)) % "Create a marker file of this name in the data directory once the files have been read, before holding locked files"
+    );
     auto doctorCommand = clipp::command("doctor").set(selected,mode::doctor) % "Diagnose issues with BlockSci or the provided config file.";
     
     std::string configFilePathString;
     auto configFileOpt = clipp::value("config file", configFilePathString) % "Path to config file";
     
-    auto commands = (generateConfigCommand, configOptions) | updateCommand | updateCoreCommand | indexUpdateCommand | addressIndexUpdateCommand | hashIndexUpdateCommand | compactIndexesCommand | doctorCommand;
+    auto commands = (generateConfigCommand, configOptions) | updateCommand | updateCoreCommand | indexUpdateCommand | addressIndexUpdateCommand | hashIndexUpdateCommand | compactIndexesCommand | buildColumnsCommand | compressFilesCommand | warmupCommand | doctorCommand;
     
     auto cli = (configFileOpt, commands);
     
@@ -587,6 +837,9 @@ int main(int argc, char * argv[]) {
             doctor.checkOpenFilesLimit();
             std::cout << std::endl;
 
+            writerOptions.backend = AsyncWriterOptions::parseBackend(ioBackendName);
+            writerOptions.bufferSize = ioBufferMB << 20;
+
             auto config = getBaseConfig(configFilePath);
             lockDataDirectory(config);
             updateChain(configFilePath, selected == mode::update);
@@ -598,10 +851,14 @@ int main(int argc, char * argv[]) {
             auto config = getBaseConfig(configFilePath);
             lockDataDirectory(config);
             updateAddressDB(config);
+            updateAddressOutputIndex(config);
+            updateBalanceHistoryIndex(config);
             {
                 HashIndexCreator db(config, config.dataConfig.hashIndexFilePath());
                 updateHashDB(config, db);
             }
+            updateTxHashIndex(config);
+            updateTaprootIndex(config);
             unlockDataDirectory(config);
             break;
         }
@@ -618,7 +875,13 @@ int main(int argc, char * argv[]) {
                 }
             }
             HashIndexCreator db(config, config.dataConfig.hashIndexFilePath());
-            updateHashDB(config, db, hashIndexMaxTx, hashIndexAddressType);
+            updateHashDB(config, db, hashIndexMaxTx, hashIndexAddressType, hashIndexBulk, hashIndexThreads);
+            if (hashIndexAddressType.empty()) {
+                updateTxHashIndex(config, hashIndexThreads);
+            }
+            if (hashIndexAddressType.empty() || hashIndexAddressType == "WITNESS_UNKNOWN") {
+                updateTaprootIndex(config);
+            }
             unlockDataDirectory(config);
             break;
         }
@@ -626,7 +889,9 @@ int main(int argc, char * argv[]) {
         case mode::updateAddressIndex: {
             auto config = getBaseConfig(configFilePath);
             lockDataDirectory(config);
-            updateAddressDB(config);
+            updateAddressDB(config, addressIndexBulk, addressIndexThreads);
+            updateAddressOutputIndex(config);
+            updateBalanceHistoryIndex(config, addressIndexThreads);
             unlockDataDirectory(config);
             break;
         }
@@ -646,6 +911,30 @@ int main(int argc, char * argv[]) {
             break;
         }
 
+        case mode::buildColumns: {
+            auto config = getBaseConfig(configFilePath);
+            lockDataDirectory(config);
+            buildInoutColumns(config);
+            unlockDataDirectory(config);
+            break;
+        }
+
+        case mode::compressFiles: {
+            auto config = getBaseConfig(configFilePath);
+            lockDataDirectory(config);
+            compressDataFiles(config, decompressAll);
+            unlockDataDirectory(config);
+            break;
+        }
+
+        case mode::warmup: {
+            auto config = getBaseConfig(configFilePath);
+            warmupSpec.chain = !warmupSkipChain;
+            warmupSpec.scripts = !warmupSkipScripts;
+            warmupDataDirectory(config, warmupSpec, warmupMarker);
+            break;
+        }
+
         case mode::doctor: {
             auto doctor = BlockSciDoctor(configFilePath);
             doctor.checkDiskSpace();
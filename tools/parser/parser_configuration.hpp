@@ -64,9 +64,14 @@ struct ParserConfigurationBase {
 
     /** Stores serialized OutputLinkData, memory-mapped as blocksci::FixedSizeFileMapper<OutputLinkData>
      *
-     * OutputLinkData links an output (InoutPointer) with the spending transaction (tx number)
+     * OutputLinkData links an output (InoutPointer) with the spending transaction (tx number) and input
      */
     std::string txUpdatesFilePath() const {
+        return (parserDirectory()/"outputLinks").str();
+    }
+
+    /** Pending updates written by parser versions whose OutputLinkData did not contain the spending input */
+    std::string legacyTxUpdatesFilePath() const {
         return (parserDirectory()/"txUpdates").str();
     }
 };
@@ -0,0 +1,111 @@
+//
+//  sst_file_builder.hpp
+//  blocksci
+//
+
+#ifndef sst_file_builder_hpp
+#define sst_file_builder_hpp
+
+#include "external_sort.hpp"
+
+#include <internal/batch_lookup.hpp>
+
+#include <rocksdb/options.h>
+#include <rocksdb/sst_file_writer.h>
+
+#include <wjfilesystem/path.h>
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/** Writes the rows of one partition of a bulk index build, which arrive in key order, into an SST file
+ *
+ * Rows with equal keys have to be added one after another and only the last of them is written, which leaves the
+ * same entry as Putting them in order would. The file is only created once the first row is added.
+ */
+class SstPartitionWriter {
+    std::string path;
+    rocksdb::SstFileWriter writer;
+    std::string pendingKey;
+    std::string pendingValue;
+    bool hasPending = false;
+    bool isOpen = false;
+
+    void check(const rocksdb::Status &status) const {
+        if (!status.ok()) {
+            throw std::runtime_error("Error writing " + path + ": " + status.ToString());
+        }
+    }
+
+    void writePending() {
+        if (!isOpen) {
+            check(writer.Open(path));
+            isOpen = true;
+        }
+        check(writer.Put(pendingKey, pendingValue));
+    }
+
+public:
+    SstPartitionWriter(std::string path_, const rocksdb::Options &options) : path(std::move(path_)), writer(rocksdb::EnvOptions{}, options) {}
+
+    void add(const rocksdb::Slice &key, const rocksdb::Slice &value) {
+        if (hasPending && key != rocksdb::Slice{pendingKey}) {
+            writePending();
+        }
+        pendingKey.assign(key.data(), key.size());
+        pendingValue.assign(value.data(), value.size());
+        hasPending = true;
+    }
+
+    /** Writes the last row and completes the file, returns false if no row was added and so no file was written */
+    bool finish() {
+        if (!hasPending) {
+            return false;
+        }
+        writePending();
+        check(writer.Finish());
+        return true;
+    }
+};
+
+/** Merges every partition of runs into its own SST file, on threadCount threads
+ *
+ * putRow(record, writer) has to add the key and value of a record to the SstPartitionWriter of its partition.
+ *
+ * @return the path of the SST file of every partition, empty for partitions without records
+ */
+template <typename Record, typename Compare, typename PartitionOf, typename PutRow>
+std::vector<std::string> writeSstPartitions(const SortedRuns<Record> &runs, size_t partitionCount, unsigned int threadCount, const filesystem::path &directory, const rocksdb::Options &options, Compare compare, PartitionOf partitionOf, PutRow putRow) {
+    std::vector<std::string> sstPaths(partitionCount);
+    blocksci::forEachChunk(partitionCount, std::max(threadCount, 1u), [&](size_t begin, size_t end) {
+        for (auto partition = begin; partition < end; partition++) {
+            auto sstPath = (directory/("partition_" + std::to_string(partition) + ".sst")).str();
+            SstPartitionWriter writer{sstPath, options};
+            runs.mergePartition(partition, compare, partitionOf, [&](const Record &record) {
+                putRow(record, writer);
+            });
+            if (writer.finish()) {
+                sstPaths[partition] = sstPath;
+            }
+        }
+    });
+    return sstPaths;
+}
+
+/** Number of leading key bits that split a column with about rowCount rows into partitions of at most rowsPerPartition rows */
+inline uint32_t partitionBitsFor(uint64_t rowCount, uint64_t rowsPerPartition) {
+    uint32_t bits = 0;
+    while (bits < 12 && (rowCount >> bits) > rowsPerPartition) {
+        bits++;
+    }
+    return bits;
+}
+
+/** Top partitionBits bits of the first two bytes of a key */
+inline size_t leadingKeyBits(const uint8_t *key, uint32_t partitionBits) {
+    auto leadingBits = (static_cast<size_t>(key[0]) << 8) | key[1];
+    return leadingBits >> (16 - partitionBits);
+}
+
+#endif /* sst_file_builder_hpp */
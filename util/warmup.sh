@@ -1,25 +1,47 @@
-fio --filename=/home/ubuntu/bitcoin/chain/block.dat --rw=read --bs=128k --iodepth=32 --ioengine=libaio --direct=1 --name=volume-initialize
-fio --filename=/home/ubuntu/bitcoin/chain/tx_index.dat --rw=read --bs=128k --iodepth=32 --ioengine=libaio --direct=1 --name=volume-initialize
-fio --filename=/home/ubuntu/bitcoin/chain/tx_data.dat --rw=read --bs=128k --iodepth=32 --ioengine=libaio --direct=1 --name=volume-initialize
-touch /home/ubuntu/BlockSci/TX_DATA_HEATED
+#!/bin/bash
+# Reads the BlockSci data files into the page cache using the parser's parallel warmup.
+# Usage: warmup.sh <config file> [--path <file or directory>]... [--lock <file or directory>]... [--threads <count>]
+#
+# The chain, the scripts and the indexes are read one after the other. Once a stage has finished, the parser creates
+# its marker file (TX_DATA_HEATED, SCRIPT_DATA_HEATED, INDEX_DATA_HEATED) in the data directory, which the Python module
+# checks on EC2 instances. Extra paths are read in the index stage. Locked files are held in memory by a separate
+# background process started after the last stage, kill it to release them.
 
-fio --filename=/home/ubuntu/bitcoin/scripts/pubkey_script.dat --rw=read --bs=128k --iodepth=32 --ioengine=libaio --direct=1 --name=volume-initialize
-fio --filename=/home/ubuntu/bitcoin/scripts/multisig_script_data.dat --rw=read --bs=128k --iodepth=32 --ioengine=libaio --direct=1 --name=volume-initialize
-fio --filename=/home/ubuntu/bitcoin/scripts/multisig_script_index.dat --rw=read --bs=128k --iodepth=32 --ioengine=libaio --direct=1 --name=volume-initialize
-fio --filename=/home/ubuntu/bitcoin/scripts/nonstandard_script_data.dat --rw=read --bs=128k --iodepth=32 --ioengine=libaio --direct=1 --name=volume-initialize
-fio --filename=/home/ubuntu/bitcoin/scripts/nonstandard_script_index.dat --rw=read --bs=128k --iodepth=32 --ioengine=libaio --direct=1 --name=volume-initialize
-fio --filename=/home/ubuntu/bitcoin/scripts/null_data_script_data.dat --rw=read --bs=128k --iodepth=32 --ioengine=libaio --direct=1 --name=volume-initialize
-fio --filename=/home/ubuntu/bitcoin/scripts/null_data_script_index.dat --rw=read --bs=128k --iodepth=32 --ioengine=libaio --direct=1 --name=volume-initialize
-fio --filename=/home/ubuntu/bitcoin/scripts/scripthash_script.dat --rw=read --bs=128k --iodepth=32 --ioengine=libaio --direct=1 --name=volume-initialize
+if [ -z "$1" ]; then
+    echo "Usage: $0 <config file> [--path <file or directory>]... [--lock <file or directory>]... [--threads <count>]"
+    exit 1
+fi
 
-touch /home/ubuntu/BlockSci/SCRIPT_DATA_HEATED
+config="$1"
+shift
 
-fio --opendir=/home/ubuntu/bitcoin/hashIndex --rw=read --bs=128k --iodepth=32 --ioengine=libaio --direct=1 --name=volume-initialize
-fio --opendir=/home/ubuntu/bitcoin/addressesDb --rw=read --bs=128k --iodepth=32 --ioengine=libaio --direct=1 --name=volume-initialize
+paths=()
+locks=()
+threads=()
+while [ $# -gt 0 ]; do
+    if [ $# -lt 2 ]; then
+        echo "Missing value for $1"
+        exit 1
+    fi
+    case "$1" in
+        --path) paths+=("$2") ;;
+        --lock) locks+=("$2") ;;
+        --threads) threads=(--threads "$2") ;;
+        *) echo "Unknown option $1"; exit 1 ;;
+    esac
+    shift 2
+done
 
-touch /home/ubuntu/BlockSci/INDEX_DATA_HEATED
+extra=()
+if [ ${#paths[@]} -gt 0 ]; then
+    extra=(--path "${paths[@]}")
+fi
 
-fio --filename=/home/ubuntu/bitcoin/chain/sequence_index.dat --rw=read --bs=128k --iodepth=32 --ioengine=libaio --direct=1 --name=volume-initialize
-fio --filename=/home/ubuntu/bitcoin/chain/sequence_data.dat --rw=read --bs=128k --iodepth=32 --ioengine=libaio --direct=1 --name=volume-initialize
-fio --filename=/home/ubuntu/bitcoin/chain/tx_hashes.dat --rw=read --bs=128k --iodepth=32 --ioengine=libaio --direct=1 --name=volume-initialize
-fio --filename=/home/ubuntu/bitcoin/chain/coinbases.dat --rw=read --bs=128k --iodepth=32 --ioengine=libaio --direct=1 --name=volume-initialize
+blocksci_parser "$config" warmup --skip-scripts --marker TX_DATA_HEATED "${threads[@]}" || exit 1
+blocksci_parser "$config" warmup --skip-chain --marker SCRIPT_DATA_HEATED "${threads[@]}" || exit 1
+blocksci_parser "$config" warmup --skip-chain --skip-scripts --indexes --marker INDEX_DATA_HEATED "${extra[@]}" "${threads[@]}" || exit 1
+
+if [ ${#locks[@]} -gt 0 ]; then
+    blocksci_parser "$config" warmup --skip-chain --skip-scripts --lock "${locks[@]}" "${threads[@]}" &
+    echo "Holding the locked files in process $!, kill it to release them"
+fi